@@ -0,0 +1,85 @@
+#include "data_generator.hpp"
+#include <random>
+#include <util.hpp>
+
+namespace bench {
+
+namespace {
+
+const char* const categories[column_mix::key_cardinality] = {
+		"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+		"india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa"};
+
+} // namespace
+
+minidb::value column_mix::key(std::size_t k) const {
+	for(const auto& column : columns) {
+		if(column.name() != key_column) continue;
+		if(column.type() == minidb::value_type::integer) return static_cast<long long>(k % key_cardinality);
+		return std::string(categories[k % key_cardinality]);
+	}
+	return {};
+}
+
+std::vector<std::vector<minidb::value>> column_mix::generate_rows(std::size_t count, std::uint64_t seed) const {
+	std::mt19937_64 rng(seed);
+	std::uniform_int_distribution<std::size_t> key_distribution(0, key_cardinality - 1);
+	std::uniform_int_distribution<long long> integer_distribution(0, 1'000'000);
+	std::uniform_real_distribution<double> decimal_distribution(0.0, 1000.0);
+	std::vector<std::vector<minidb::value>> rows(count);
+	for(std::size_t i = 0; i != count; ++i) {
+		auto& row = rows[i];
+		row.reserve(columns.size());
+		for(const auto& column : columns) {
+			if(column.name() == "id") row.emplace_back(static_cast<long long>(i));
+			else if(column.name() == key_column) row.push_back(key(key_distribution(rng)));
+			else if(column.type() == minidb::value_type::integer) row.emplace_back(integer_distribution(rng));
+			else if(column.type() == minidb::value_type::decimal) row.emplace_back(decimal_distribution(rng));
+			else row.emplace_back(column.name() + "_" + std::to_string(integer_distribution(rng)));
+		}
+	}
+	return rows;
+}
+
+void column_mix::fill(minidb::database& db, const std::string& name, std::size_t count, std::uint64_t seed) const {
+	db.create_table(name, minidb::schema{columns});
+	for(auto& row : generate_rows(count, seed)) db.append_row(name, std::move(row));
+}
+
+std::vector<column_mix> standard_mixes() {
+	using minidb::value_type;
+	return {
+			{"numeric",
+			 {{"id", value_type::integer}, {"bucket", value_type::integer}, {"amount", value_type::integer},
+			  {"price", value_type::decimal}},
+			 "bucket",
+			 "price",
+			 0.5},
+			{"mixed",
+			 {{"id", value_type::integer},
+			  {"category", value_type::string, minidb::column_encoding::dictionary},
+			  {"name", value_type::string},
+			  {"price", value_type::decimal}},
+			 "category",
+			 "price",
+			 0.5},
+			{"strings",
+			 {{"id", value_type::integer}, {"category", value_type::string}, {"name", value_type::string}},
+			 "category",
+			 "name",
+			 std::string("updated")},
+	};
+}
+
+std::string to_command_list(const std::vector<minidb::value>& cells) {
+	std::string list = "[";
+	for(const auto& cell : cells) {
+		if(list.size() != 1) list += ", ";
+		std::visit(minidb::overloaded{[&list](const std::string& s) { list += s; },
+		                              [&list](const auto& number) { list += std::to_string(number); }},
+		           cell);
+	}
+	return list + "]";
+}
+
+} // namespace bench
@@ -0,0 +1,40 @@
+#ifndef MINIDB_BENCH_DATA_GENERATOR_INCLUDED
+#define MINIDB_BENCH_DATA_GENERATOR_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <database.hpp>
+#include <schema.hpp>
+#include <string>
+#include <value.hpp>
+#include <vector>
+
+namespace bench {
+
+// A synthetic table layout. Every mix has an integer id column and a key column holding key_cardinality distinct
+// values, which filters and histograms use. Rows are generated from a fixed seed, so runs are reproducible.
+struct column_mix {
+	std::string name;
+	std::vector<minidb::column> columns;
+	std::string key_column;
+	std::string update_column;
+	minidb::value update_value;
+
+	static constexpr std::size_t key_cardinality = 16;
+
+	minidb::value key(std::size_t k) const;
+	std::vector<std::vector<minidb::value>> generate_rows(std::size_t count, std::uint64_t seed) const;
+	// Creates the table name in db and fills it with count generated rows.
+	void fill(minidb::database& db, const std::string& name, std::size_t count, std::uint64_t seed) const;
+};
+
+// numeric: only integer and decimal columns. mixed: adds a dictionary and a plain string column. strings: plain
+// string columns only besides the id.
+std::vector<column_mix> standard_mixes();
+
+// Formats cells as the list argument of an append_row command.
+std::string to_command_list(const std::vector<minidb::value>& cells);
+
+} // namespace bench
+
+#endif // MINIDB_BENCH_DATA_GENERATOR_INCLUDED
@@ -0,0 +1,58 @@
+#include "harness.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <ostream>
+
+namespace bench {
+
+std::vector<result> run(const std::vector<benchmark_case>& cases, const run_options& options, std::ostream& progress) {
+	std::vector<result> results;
+	for(const auto& c : cases) {
+		const auto id = c.name + "/" + c.mix + "/" + std::to_string(c.rows);
+		if(id.find(options.filter) == std::string::npos) continue;
+		progress << id << " ... " << std::flush;
+		std::vector<double> samples;
+		const auto repetitions = std::max<std::size_t>(options.repetitions, 1);
+		for(std::size_t repetition = 0; repetition != repetitions; ++repetition) {
+			const auto work = c.setup();
+			const auto start = std::chrono::steady_clock::now();
+			work();
+			const auto stop = std::chrono::steady_clock::now();
+			samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+		}
+		std::sort(samples.begin(), samples.end());
+		const auto median = samples.size() % 2 == 1
+				? samples[samples.size() / 2]
+				: (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+		results.push_back({c.name, c.mix, c.rows, c.items, repetitions, samples.front(), median,
+		                   std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size())});
+		progress << static_cast<long long>(median) << " ns\n";
+	}
+	return results;
+}
+
+void write_json(const std::vector<result>& results, std::ostream& output) {
+	output << std::fixed << std::setprecision(1) << "[\n";
+	for(std::size_t i = 0; i != results.size(); ++i) {
+		const auto& r = results[i];
+		// Names are generated by the suite and never need escaping.
+		output << "  {\"name\": \"" << r.name << "\", \"mix\": \"" << r.mix << "\", \"rows\": " << r.rows
+		       << ", \"items\": " << r.items << ", \"repetitions\": " << r.repetitions << ", \"min_ns\": " << r.min_ns
+		       << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns
+		       << ", \"items_per_second\": " << r.items_per_second() << "}" << (i + 1 != results.size() ? "," : "")
+		       << "\n";
+	}
+	output << "]\n";
+}
+
+void write_csv(const std::vector<result>& results, std::ostream& output) {
+	output << std::fixed << std::setprecision(1)
+	       << "name,mix,rows,items,repetitions,min_ns,median_ns,mean_ns,items_per_second\n";
+	for(const auto& r : results) {
+		output << r.name << ',' << r.mix << ',' << r.rows << ',' << r.items << ',' << r.repetitions << ',' << r.min_ns
+		       << ',' << r.median_ns << ',' << r.mean_ns << ',' << r.items_per_second() << '\n';
+	}
+}
+
+} // namespace bench
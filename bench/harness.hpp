@@ -0,0 +1,61 @@
+#ifndef MINIDB_BENCH_HARNESS_INCLUDED
+#define MINIDB_BENCH_HARNESS_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Keeps the compiler from optimizing away a computation whose result is otherwise unused.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "g"(&value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+struct result {
+	std::string name;
+	std::string mix;
+	std::size_t rows;
+	// Operations processed by one timed run, used for the throughput.
+	std::size_t items;
+	std::size_t repetitions;
+	double min_ns;
+	double median_ns;
+	double mean_ns;
+
+	double items_per_second() const noexcept {
+		return median_ns == 0 ? 0 : static_cast<double>(items) * 1e9 / median_ns;
+	}
+};
+
+// A benchmark case prepares its input in setup, untimed, and then returns the work to time. setup runs again before
+// every repetition, so mutating cases start from the same state each time.
+struct benchmark_case {
+	std::string name;
+	std::string mix;
+	std::size_t rows;
+	std::size_t items;
+	std::function<std::function<void()>()> setup;
+};
+
+struct run_options {
+	std::size_t repetitions = 5;
+	std::string filter;
+};
+
+std::vector<result> run(const std::vector<benchmark_case>& cases, const run_options& options, std::ostream& progress);
+void write_json(const std::vector<result>& results, std::ostream& output);
+void write_csv(const std::vector<result>& results, std::ostream& output);
+
+} // namespace bench
+
+#endif // MINIDB_BENCH_HARNESS_INCLUDED
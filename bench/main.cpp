@@ -0,0 +1,394 @@
+#include "data_generator.hpp"
+#include "harness.hpp"
+#include <algorithm>
+#include <command_parser.hpp>
+#include <command_processor.hpp>
+#include <database.hpp>
+#include <result_writer.hpp>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using bench::benchmark_case;
+using bench::column_mix;
+using rows_type = std::vector<std::vector<minidb::value>>;
+
+const std::string table_name = "bench";
+
+struct suite_options {
+	std::vector<std::size_t> sizes{1'000, 100'000, 1'000'000};
+	std::string mix;
+	std::uint64_t seed = 42;
+	std::size_t threads = 0;
+};
+
+// Generated data and filled databases are shared by all cases of the same mix and size.
+class data_cache {
+	const suite_options& options_;
+	std::map<std::pair<std::string, std::size_t>, std::shared_ptr<const rows_type>> rows_;
+	std::map<std::pair<std::string, std::size_t>, std::shared_ptr<minidb::database>> databases_;
+
+public:
+	explicit data_cache(const suite_options& options) : options_(options) {}
+
+	std::shared_ptr<const rows_type> rows(const column_mix& mix, std::size_t count) {
+		auto& rows = rows_[{mix.name, count}];
+		if(!rows) rows = std::make_shared<const rows_type>(mix.generate_rows(count, options_.seed));
+		return rows;
+	}
+
+	std::shared_ptr<minidb::database> empty_database(const column_mix& mix) const {
+		auto db = std::make_shared<minidb::database>();
+		db->configure_scans(options_.threads);
+		db->create_table(table_name, minidb::schema{mix.columns});
+		return db;
+	}
+
+	std::shared_ptr<minidb::database> fresh_database(const column_mix& mix, std::size_t count) {
+		auto db = empty_database(mix);
+		for(const auto& row : *rows(mix, count)) db->append_row(table_name, row);
+		return db;
+	}
+
+	// A filled database for read-only cases, built once.
+	std::shared_ptr<minidb::database> shared_database(const column_mix& mix, std::size_t count) {
+		auto& db = databases_[{mix.name, count}];
+		if(!db) db = fresh_database(mix, count);
+		return db;
+	}
+};
+
+// Counts and discards everything written to it, so output cases measure formatting only.
+class discarding_buffer : public std::streambuf {
+public:
+	std::size_t bytes = 0;
+
+protected:
+	int_type overflow(int_type c) override {
+		++bytes;
+		return traits_type::not_eof(c);
+	}
+	std::streamsize xsputn(const char*, std::streamsize count) override {
+		bytes += static_cast<std::size_t>(count);
+		return count;
+	}
+};
+
+minidb::row_filter key_filter(const column_mix& mix) {
+	return minidb::row_filter{{mix.key_column, mix.key(3)}};
+}
+
+// The cases refer to mixes, which have to outlive them.
+std::vector<benchmark_case> make_cases(const std::vector<column_mix>& mixes, const suite_options& options,
+                                       data_cache& cache) {
+	std::vector<benchmark_case> cases;
+	for(const auto& mix : mixes) {
+		if(!options.mix.empty() && mix.name != options.mix) continue;
+		for(const auto rows : options.sizes) {
+			const auto add = [&](std::string name, std::function<std::function<void()>()> setup) {
+				cases.push_back({std::move(name), mix.name, rows, rows, std::move(setup)});
+			};
+
+			add("parse_command", [&cache, &mix, rows] {
+				auto lines = std::make_shared<std::vector<std::string>>();
+				for(const auto& row : *cache.rows(mix, rows)) {
+					lines->push_back("append_row " + table_name + " " + bench::to_command_list(row));
+				}
+				return [lines] {
+					for(auto& line : *lines) {
+						bench::do_not_optimize(minidb::command_parser::parse_command(std::move(line)));
+					}
+				};
+			});
+			add("parse_command_view", [&cache, &mix, rows] {
+				auto lines = std::make_shared<std::vector<std::string>>();
+				for(const auto& row : *cache.rows(mix, rows)) {
+					lines->push_back("append_row " + table_name + " " + bench::to_command_list(row));
+				}
+				return [lines] {
+					minidb::command_parser::parsed_command parsed;
+					for(const auto& line : *lines) {
+						minidb::command_parser::parse_command(line, parsed);
+						bench::do_not_optimize(parsed);
+					}
+				};
+			});
+			add("append_row", [&cache, &mix, rows] {
+				auto db = cache.empty_database(mix);
+				auto data = std::make_shared<rows_type>(*cache.rows(mix, rows));
+				return [db, data] {
+					for(auto& row : *data) db->append_row(table_name, std::move(row));
+				};
+			});
+			add("append_rows", [&cache, &mix, rows] {
+				auto db = cache.empty_database(mix);
+				auto data = std::make_shared<rows_type>(*cache.rows(mix, rows));
+				return [db, data] {
+					// In batches of 1000 rows, as a producer would send them.
+					const std::span<std::vector<minidb::value>> all_rows{*data};
+					for(std::size_t first = 0; first < all_rows.size(); first += 1000) {
+						const auto count = std::min<std::size_t>(1000, all_rows.size() - first);
+						db->append_rows(table_name, all_rows.subspan(first, count));
+					}
+				};
+			});
+			add("query_table_unfiltered", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db] {
+					std::size_t count = 0;
+					db->query_table(table_name, [&count](const minidb::row&) { ++count; });
+					bench::do_not_optimize(count);
+				};
+			});
+			add("query_table_filtered", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] {
+					std::size_t count = 0;
+					db->query_table(table_name, key_filter(mix), [&count](const minidb::row&) { ++count; });
+					bench::do_not_optimize(count);
+				};
+			});
+			add("query_table_range", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				// One percent of the rows, the ids are ascending so the zone maps skip the rest.
+				const auto first = static_cast<long long>(rows / 2);
+				return [db, first, rows] {
+					std::size_t count = 0;
+					db->query_table(table_name,
+					                minidb::row_filter{{{"id", minidb::row_filter::comparison::between,
+					                                     {first, first + static_cast<long long>(rows / 100)}}}},
+					                [&count](const minidb::row&) { ++count; });
+					bench::do_not_optimize(count);
+				};
+			});
+			add("query_table_expression", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				// The key rows plus one percent of the others, which neither the index nor the zone maps can narrow.
+				const auto limit = static_cast<long long>(rows / 100);
+				return [db, &mix, limit] {
+					using filter = minidb::row_filter;
+					std::size_t count = 0;
+					db->query_table(table_name,
+					                filter{{filter::predicate{mix.key_column, filter::comparison::equal, {mix.key(3)}},
+					                        filter::predicate{"id", filter::comparison::less, {limit}},
+					                        filter::connective::disjunction}},
+					                [&count](const minidb::row&) { ++count; });
+					bench::do_not_optimize(count);
+				};
+			});
+			// The same query repeated once its result is cached, which only costs replaying the matching rows.
+			add("query_table_expression_cached", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				db->configure_result_cache(std::size_t{64} << 20);
+				const auto limit = static_cast<long long>(rows / 100);
+				const auto query = [db, &mix, limit] {
+					using filter = minidb::row_filter;
+					std::size_t count = 0;
+					db->query_table(table_name,
+					                filter{{filter::predicate{mix.key_column, filter::comparison::equal, {mix.key(3)}},
+					                        filter::predicate{"id", filter::comparison::less, {limit}},
+					                        filter::connective::disjunction}},
+					                [&count](const minidb::row&) { ++count; });
+					bench::do_not_optimize(count);
+				};
+				query();
+				return query;
+			});
+			// Many lookups of single rows through an index, where executing a command costs more than finding the row.
+			constexpr long long point_queries = 10'000;
+			add("point_query_command", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				db->create_index(table_name, "id");
+				auto lines = std::make_shared<std::vector<std::string>>();
+				for(long long id = 0; id != point_queries; ++id) {
+					lines->push_back("query_table " + table_name + " {id=" + std::to_string(id) + "}");
+				}
+				return [db, lines] {
+					minidb::command_processor processor(*db);
+					discarding_buffer buffer;
+					std::ostream output(&buffer);
+					for(const auto& line : *lines) processor.execute(line, output);
+					bench::do_not_optimize(buffer.bytes);
+				};
+			});
+			add("point_query_prepared", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				db->create_index(table_name, "id");
+				return [db] {
+					minidb::command_processor processor(*db);
+					auto statement = processor.prepare("query_table " + table_name + " {id=?}");
+					discarding_buffer buffer;
+					std::ostream output(&buffer);
+					std::vector<minidb::value> parameters(1);
+					for(long long id = 0; id != point_queries; ++id) {
+						parameters[0] = id;
+						processor.execute(statement, parameters, output);
+					}
+					bench::do_not_optimize(buffer.bytes);
+				};
+			});
+			for(const auto& [format_name, format] : {std::pair{"text", minidb::output_format::text},
+			                                         std::pair{"csv", minidb::output_format::csv},
+			                                         std::pair{"json", minidb::output_format::json_lines}}) {
+				add(std::string("write_results_") + format_name, [&cache, &mix, rows, format] {
+					auto db = cache.shared_database(mix, rows);
+					return [db, format] {
+						discarding_buffer buffer;
+						std::ostream output(&buffer);
+						{
+							const auto& tab = db->lookup_table(table_name);
+							minidb::result_writer writer(output, format, tab);
+							for(const auto& row : tab.rows()) writer.write_row(row);
+						}
+						bench::do_not_optimize(buffer.bytes);
+					};
+				});
+			}
+			add("query_column_histogram", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] { bench::do_not_optimize(db->query_column_histogram(table_name, mix.key_column)); };
+			});
+			add("query_column_histogram_distinct", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db] { bench::do_not_optimize(db->query_column_histogram(table_name, "id")); };
+			});
+			add("approx_distinct", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db] { bench::do_not_optimize(db->approx_distinct(table_name, "id")); };
+			});
+			add("approx_quantiles", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db] { bench::do_not_optimize(db->approx_quantiles(table_name, "id", {0.5, 0.9, 0.99})); };
+			});
+			add("query_column_histogram_filtered", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] {
+					bench::do_not_optimize(db->query_column_histogram(table_name, mix.update_column, key_filter(mix)));
+				};
+			});
+			add("aggregate_group_by", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] {
+					bench::do_not_optimize(db->aggregate(table_name, {mix.key_column},
+					                                     {{minidb::aggregate_function::count, ""},
+					                                      {minidb::aggregate_function::max, mix.update_column}}));
+				};
+			});
+			add("update_rows", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				return [db, &mix] {
+					db->update_rows(table_name, key_filter(mix), {{mix.update_column, mix.update_value}});
+				};
+			});
+			add("erase_rows", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				return [db, &mix] { db->erase_rows(table_name, key_filter(mix)); };
+			});
+			add("erase_row_scattered", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				// Every seventh row, few enough to stay below the compaction threshold.
+				return [db, rows] {
+					for(std::size_t row_index = 0; row_index < rows; row_index += 7) db->erase_row(table_name, row_index);
+				};
+			});
+			add("compact", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				db->configure_compaction(0);
+				for(std::size_t row_index = 0; row_index < rows; row_index += 7) db->erase_row(table_name, row_index);
+				return [db] { db->compact(table_name); };
+			});
+			add("update_cell_by_id", [&cache, &mix, rows] {
+				auto db = cache.fresh_database(mix, rows);
+				// Compacting away every seventh row means the IDs no longer equal the row indexes.
+				for(std::size_t row_index = 0; row_index < rows; row_index += 7) db->erase_row(table_name, row_index);
+				db->compact(table_name);
+				const auto column = db->lookup_table(table_name).get_column_index_by_name(mix.update_column);
+				return [db, &mix, rows, column] {
+					for(minidb::row_id id = 1; id < rows; id += 7) db->update_cell_by_id(table_name, id, column, mix.update_value);
+				};
+			});
+			add("row_filter_batch", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] {
+					auto filter = key_filter(mix);
+					filter.bind_to_table(db->lookup_table(table_name));
+					std::size_t count = 0;
+					filter.for_each_match([&count](std::size_t) { ++count; });
+					bench::do_not_optimize(count);
+				};
+			});
+			add("row_filter_rowwise", [&cache, &mix, rows] {
+				auto db = cache.shared_database(mix, rows);
+				return [db, &mix] {
+					const auto& tab = db->lookup_table(table_name);
+					auto filter = key_filter(mix);
+					filter.bind_to_table(tab);
+					std::size_t count = 0;
+					for(const auto& row : tab.rows()) count += filter(row) ? 1 : 0;
+					bench::do_not_optimize(count);
+				};
+			});
+		}
+	}
+	return cases;
+}
+
+std::vector<std::size_t> parse_sizes(std::string_view list) {
+	std::vector<std::size_t> sizes;
+	std::stringstream stream{std::string(list)};
+	for(std::string size; std::getline(stream, size, ',');) sizes.push_back(std::stoul(size));
+	return sizes;
+}
+
+int usage(const char* program) {
+	std::cerr << "Usage: " << program
+	          << " [--sizes <n,n,...>] [--mix numeric|mixed|strings] [--filter <substring>] [--repetitions <n>]"
+	             " [--threads <n>] [--seed <n>] [--format json|csv] [--output <file>]\n";
+	return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+	suite_options options;
+	bench::run_options run_options;
+	std::string format = "json";
+	std::string output_path;
+	for(int arg = 1; arg < argc; ++arg) {
+		const std::string_view option{argv[arg]};
+		if(arg + 1 >= argc) return usage(argv[0]);
+		const std::string_view argument{argv[++arg]};
+		if(option == "--sizes") options.sizes = parse_sizes(argument);
+		else if(option == "--mix") options.mix = argument;
+		else if(option == "--filter") run_options.filter = argument;
+		else if(option == "--repetitions") run_options.repetitions = std::stoul(std::string(argument));
+		else if(option == "--threads") options.threads = std::stoul(std::string(argument));
+		else if(option == "--seed") options.seed = std::stoull(std::string(argument));
+		else if(option == "--format" && (argument == "json" || argument == "csv")) format = argument;
+		else if(option == "--output") output_path = argument;
+		else return usage(argv[0]);
+	}
+
+	const auto mixes = bench::standard_mixes();
+	data_cache cache(options);
+	const auto results = bench::run(make_cases(mixes, options, cache), run_options, std::cerr);
+	std::ofstream file;
+	if(!output_path.empty()) {
+		file.open(output_path);
+		if(!file) {
+			std::cerr << "Failed to open " << output_path << "\n";
+			return 1;
+		}
+	}
+	auto& output = output_path.empty() ? std::cout : file;
+	if(format == "csv") bench::write_csv(results, output);
+	else bench::write_json(results, output);
+}
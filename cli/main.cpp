@@ -1,11 +1,130 @@
+#include <charconv>
 #include <command_processor.hpp>
+#include <csignal>
 #include <database.hpp>
 #include <iostream>
+#include <server.hpp>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
 
-int main() {
+namespace {
+
+minidb::server* running_server = nullptr;
+
+void stop_server(int) {
+	if(running_server != nullptr) running_server->stop();
+}
+
+// The whole argument as an unsigned number, unlike std::stoul, which accepts a minus sign and trailing characters.
+std::size_t parse_count(std::string_view argument) {
+	std::size_t count = 0;
+	const auto [end, error] = std::from_chars(argument.data(), argument.data() + argument.size(), count);
+	if(error != std::errc{} || end != argument.data() + argument.size()) {
+		throw std::invalid_argument("Invalid number " + std::string(argument));
+	}
+	return count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
 	minidb::database db;
+	std::string wal_path;
+	minidb::write_ahead_log::options wal_options;
+	auto format = minidb::output_format::text;
+	std::string serve_address;
+	std::size_t event_loops = 1;
+	std::size_t scan_threads = 0;
+	for(int arg = 1; arg < argc; ++arg) {
+		const std::string_view option{argv[arg]};
+		if(option == "--threads" && arg + 1 < argc) {
+			try {
+				scan_threads = parse_count(argv[++arg]);
+			} catch(const std::exception& ex) {
+				std::cerr << ex.what() << "\n";
+				return 1;
+			}
+		} else if(option == "--wal" && arg + 1 < argc) {
+			wal_path = argv[++arg];
+		} else if(option == "--sync" && arg + 1 < argc) {
+			const std::string_view policy{argv[++arg]};
+			if(policy == "none") wal_options.sync = minidb::write_ahead_log::sync_policy::none;
+			else if(policy == "batch") wal_options.sync = minidb::write_ahead_log::sync_policy::batch;
+			else if(policy == "always") wal_options.sync = minidb::write_ahead_log::sync_policy::always;
+			else {
+				std::cerr << "Unknown sync policy: " << policy << "\n";
+				return 1;
+			}
+		} else if(option == "--compact-at" && arg + 1 < argc) {
+			try {
+				db.configure_compaction(std::stod(argv[++arg]));
+			} catch(const std::exception& ex) {
+				std::cerr << ex.what() << "\n";
+				return 1;
+			}
+		} else if(option == "--result-cache" && arg + 1 < argc) {
+			try {
+				db.configure_result_cache(parse_count(argv[++arg]));
+			} catch(const std::exception& ex) {
+				std::cerr << ex.what() << "\n";
+				return 1;
+			}
+		} else if(option == "--serve" && arg + 1 < argc) {
+			serve_address = argv[++arg];
+		} else if(option == "--event-loops" && arg + 1 < argc) {
+			try {
+				event_loops = parse_count(argv[++arg]);
+			} catch(const std::exception& ex) {
+				std::cerr << ex.what() << "\n";
+				return 1;
+			}
+		} else if(option == "--format" && arg + 1 < argc) {
+			try {
+				format = minidb::parse_output_format(argv[++arg]);
+			} catch(const std::exception& ex) {
+				std::cerr << ex.what() << "\n";
+				return 1;
+			}
+		} else {
+			std::cerr << "Usage: " << argv[0]
+			          << " [--threads <scan thread count>] [--wal <log file> [--sync none|batch|always]]"
+			             " [--compact-at <erased share>] [--result-cache <bytes>] [--format text|tsv|csv|json]"
+			             " [--serve <port>|<socket path> [--event-loops <n>]]\n"
+			          << "--sync batch, the default, returns from operations before they are on disk and writes"
+			             " them every 10 ms, so a crash loses the operations of the last 10 ms. always waits for the"
+			             " disk on every operation, none leaves writing to the operating system.\n";
+			return 1;
+		}
+	}
+	db.configure_scans(scan_threads);
+	if(!wal_path.empty()) {
+		try {
+			db.open_log(wal_path, wal_options);
+		} catch(const std::exception& ex) {
+			std::cerr << "Error: " << ex.what() << "\n";
+			return 1;
+		}
+	}
+	if(!serve_address.empty()) {
+		try {
+			minidb::server srv(db, serve_address, {event_loops, format});
+			running_server = &srv;
+			std::signal(SIGINT, stop_server);
+			std::signal(SIGTERM, stop_server);
+			if(srv.port() != 0) std::cerr << "Listening on 127.0.0.1:" << srv.port() << "\n";
+			else std::cerr << "Listening on " << serve_address << "\n";
+			srv.run();
+			running_server = nullptr;
+		} catch(const std::exception& ex) {
+			std::cerr << "Error: " << ex.what() << "\n";
+			return 1;
+		}
+		return 0;
+	}
 	minidb::command_processor cmd_proc(db);
+	cmd_proc.set_output_format(format);
 	std::string line;
 	std::cout << "minidb> ";
 	while(!cmd_proc.should_exit() && getline(std::cin, line)) {
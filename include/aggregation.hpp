@@ -0,0 +1,64 @@
+#ifndef MINIDB_AGGREGATION_INCLUDED
+#define MINIDB_AGGREGATION_INCLUDED
+
+#include "table.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace minidb {
+
+enum class aggregate_function { count, sum, min, max, avg };
+
+// Accepts count, sum, min, max and avg.
+aggregate_function parse_aggregate_function(std::string_view name);
+
+// An aggregate computed for every group. count counts the rows of a group and ignores the column, which may be
+// empty. sum and avg take integer or decimal columns, min and max columns of any type. sum and min and max yield
+// cells of the column's type, avg a decimal and count an integer.
+struct aggregation {
+	aggregate_function function;
+	std::string column;
+};
+
+// Appends the indexes of the rows in [first_row, last_row) to aggregate, in ascending order.
+using row_collector = std::function<void(std::size_t, std::size_t, std::vector<std::size_t>&)>;
+
+// Groups the rows collect yields by the cells of the group_by columns and computes the aggregations for each group in
+// one pass over the table. Every scan thread aggregates into its own open-addressing hash table with typed
+// accumulators, the partial tables are then merged in parallel, one hash partition per task. The result has a column
+// per group_by column followed by one per aggregation, named like sum(price), and a row per group, ordered by the
+// group_by cells. Without group_by columns all rows form a single group, unless there are none.
+table aggregate_rows(const table& tab, const std::vector<std::string>& group_by,
+                     const std::vector<aggregation>& aggregations, thread_pool& pool, std::size_t morsel_rows,
+                     const row_collector& collect);
+
+// Counts how often each cell of column occurs in the rows collect yields, or in all rows if collect is empty.
+// Dictionary codes and integers spanning a small range compared to the rows are counted in arrays indexed by the cell,
+// other cells in per-thread open-addressing hash tables merged like the groups of aggregate_rows. The distinct cells
+// are only sorted once, when the result is built.
+std::map<value, std::size_t> column_histogram(const column_storage& column, thread_pool& pool, std::size_t morsel_rows,
+                                              const row_collector& collect = {});
+
+// Estimates the number of distinct cells of column in the rows collect yields, or in all rows if collect is empty,
+// with a HyperLogLog sketch per scan thread. Takes one pass and a fixed 16 KiB per thread, the estimate is usually
+// within 2% of the exact count.
+double approx_distinct_cells(const column_storage& column, thread_pool& pool, std::size_t morsel_rows,
+                             const row_collector& collect = {});
+
+// Estimates the cells of an integer or decimal column at the given quantiles, in [0, 1], over the rows collect
+// yields, or all rows if collect is empty, with a KLL sketch per scan thread. NaN cells are left out. Takes one pass
+// and memory logarithmic in the rows, the estimates are usually within 1% of the rows from the exact rank, NaN if
+// there are no rows.
+std::vector<double> approx_cell_quantiles(const column_storage& column, std::span<const double> fractions,
+                                          thread_pool& pool, std::size_t morsel_rows,
+                                          const row_collector& collect = {});
+
+} // namespace minidb
+
+#endif // MINIDB_AGGREGATION_INCLUDED
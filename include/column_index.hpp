@@ -0,0 +1,43 @@
+#ifndef MINIDB_COLUMN_INDEX_INCLUDED
+#define MINIDB_COLUMN_INDEX_INCLUDED
+
+#include "column_storage.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace minidb {
+
+enum class index_kind { hash, ordered };
+
+// Secondary index mapping each distinct cell value of one column to the ascending list of row indices holding it.
+class column_index {
+public:
+	using row_list = std::vector<std::size_t>;
+	using hash_entries = std::unordered_map<value, row_list>;
+	using ordered_entries = std::map<value, row_list>;
+
+	column_index(index_kind kind, const column_storage& column);
+
+	index_kind kind() const noexcept {
+		return kind_;
+	}
+
+	// Returns the rows whose cell equals val, in ascending order.
+	const row_list& lookup(const value& val) const;
+
+	void insert(const value& val, std::size_t row_index);
+	void erase(const value& val, std::size_t row_index);
+	void rebuild(const column_storage& column);
+
+private:
+	index_kind kind_;
+	std::variant<hash_entries, ordered_entries> entries_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_COLUMN_INDEX_INCLUDED
@@ -0,0 +1,103 @@
+#ifndef MINIDB_COLUMN_STORAGE_INCLUDED
+#define MINIDB_COLUMN_STORAGE_INCLUDED
+
+#include "dictionary_column.hpp"
+#include "numeric_column.hpp"
+#include "schema.hpp"
+#include "string_column.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace minidb {
+
+// The value of a cell as yielded by operator[] of a column_storage alternative.
+template <typename Cell>
+value cell_value(const Cell& cell) {
+	if constexpr(std::is_same_v<Cell, std::string_view>) return value{std::string(cell)};
+	else return value{cell};
+}
+
+// Contiguous, typed storage for all cells of one column. Integer and decimal columns are dense arrays of their
+// primitive type, owned or mapped from a snapshot, so scans over them never touch the variant machinery of value. String columns are either plain
+// string heaps or dictionary-encoded. Every alternative supports size() and operator[] yielding the cell's value, or a
+// std::string_view of it, so generic visitors work on all of them.
+class column_storage {
+public:
+	using integer_data = numeric_column<long long>;
+	using decimal_data = numeric_column<double>;
+	using string_data = string_column;
+	using dictionary_data = dictionary_column;
+	using data_type = std::variant<integer_data, decimal_data, string_data, dictionary_data>;
+	// Plain cells of one column for appending many rows at once.
+	using cell_vector = std::variant<std::vector<long long>, std::vector<double>, std::vector<std::string>>;
+	// The storage alternative holding cells of type T.
+	template <typename T>
+	using cells_type = std::conditional_t<std::is_arithmetic_v<T>, numeric_column<T>, string_column>;
+	// What reading a cell of type T yields, strings are viewed in place.
+	template <typename T>
+	using cell_ref = std::conditional_t<std::is_same_v<T, std::string>, std::string_view, const T&>;
+
+	explicit column_storage(value_type type, column_encoding encoding = column_encoding::plain);
+	explicit column_storage(data_type data) : data_(std::move(data)) {}
+
+	value_type type() const noexcept {
+		return is_dictionary() ? value_type::string : static_cast<value_type>(data_.index());
+	}
+
+	bool is_dictionary() const noexcept {
+		return std::holds_alternative<dictionary_data>(data_);
+	}
+
+	// Only valid for dictionary-encoded columns.
+	const dictionary_data& dictionary() const {
+		return std::get<dictionary_data>(data_);
+	}
+
+	std::size_t size() const noexcept {
+		return std::visit([](const auto& data) { return data.size(); }, data_);
+	}
+
+	template <typename T>
+	const cells_type<T>& data() const {
+		return std::get<cells_type<T>>(data_);
+	}
+
+	template <typename T>
+	cell_ref<T> get(std::size_t index) const {
+		if constexpr(std::is_same_v<T, std::string>) {
+			if(const auto* dictionary = std::get_if<dictionary_data>(&data_)) return dictionary->at(index);
+		}
+		return data<T>().at(index);
+	}
+
+	template <typename Visitor>
+	decltype(auto) visit(Visitor&& visitor) const {
+		return std::visit(std::forward<Visitor>(visitor), data_);
+	}
+
+	bool accepts(const value& val) const noexcept {
+		return static_cast<value_type>(val.index()) == type();
+	}
+
+	value get(std::size_t index) const;
+	bool equals(std::size_t index, const value& val) const;
+	void reserve(std::size_t capacity);
+	void push_back(value val);
+	void set(std::size_t index, value val);
+	// Appends all cells, which must be of the column's type.
+	void append(cell_vector cells);
+	// Removes every cell whose entry in erase_mask is true, keeping the relative order of the remaining cells.
+	void erase_masked(const std::vector<bool>& erase_mask);
+
+private:
+	data_type data_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_COLUMN_STORAGE_INCLUDED
@@ -1,6 +1,8 @@
 #ifndef MINIDB_COMMAND_PARSER_INCLUDED
 #define MINIDB_COMMAND_PARSER_INCLUDED
 
+#include <cstddef>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -34,15 +36,120 @@ public:
 			key_value_list_argument_type>;
 	static std::pair<std::string, std::vector<argument_type>> parse_command(std::string&& cmd);
 
+	// Non-owning counterparts of the argument types. Strings are views into the parsed command line, lists and
+	// key-value lists refer to the elements stored in the parsed_command they belong to.
+	using primitive_view = std::variant<integer_argument_type, decimal_argument_type, std::string_view>;
+	using key_value_view = std::pair<std::string_view, primitive_view>;
+	struct list_view {
+		std::size_t first;
+		std::size_t count;
+	};
+	// A list of lists of primitives, as in [[1, a], [2, b]].
+	struct nested_list_view {
+		std::size_t first;
+		std::size_t count;
+	};
+	struct key_value_list_view {
+		std::size_t first;
+		std::size_t count;
+	};
+	struct expression_view {
+		std::size_t first;
+		std::size_t count;
+	};
+	using argument_view = std::variant<integer_argument_type, decimal_argument_type, std::string_view, list_view,
+	                                   key_value_list_view, expression_view, nested_list_view>;
+
+	// An unquoted ? stands for a parameter of a prepared statement. It's parsed as a view of the text "?" that doesn't
+	// point into the command line, which tells it apart from a quoted "?". Commands that aren't prepared treat it as
+	// that text.
+	static bool is_placeholder(const primitive_view& primitive) noexcept;
+	static bool is_placeholder(const argument_view& argument) noexcept;
+
+	// Key-value entries are written key=value by default and may use another comparison instead, as in
+	// {price>=10, name!=x, id between [1, 5], tag in [a, b]}. between and in take a list of operands, the entry's own
+	// value is unused for them.
+	enum class comparison_operator { equal, not_equal, less, less_equal, greater, greater_equal, between, in };
+	struct condition_view {
+		comparison_operator op;
+		list_view operands;
+	};
+
+	// A filter expression is a parenthesized combination of conditions, written like key-value entries, with
+	// and (also && or ,), or (also ||), not (also !) and parentheses, as in (price<10 or (tag in [a, b] and not id=3)).
+	// and binds tighter than or. Its terms are stored in postfix order: a condition term refers to the entry and
+	// condition with the index entry, the connectives combine the results of the preceding terms.
+	enum class term_kind { condition, conjunction, disjunction, negation };
+	struct term_view {
+		term_kind kind;
+		std::size_t entry;
+	};
+
+	// Result of parsing a command line without copying it. All views refer to the parsed line, which has to outlive
+	// them. The storage for arguments and list elements is kept between parses, so reusing one parsed_command for
+	// many lines parses them without heap allocations once it has grown to fit.
+	class parsed_command {
+	public:
+		std::string_view command() const noexcept {
+			return command_;
+		}
+		std::span<const argument_view> arguments() const noexcept {
+			return arguments_;
+		}
+		std::span<const primitive_view> elements(const list_view& list) const noexcept {
+			return std::span<const primitive_view>{elements_}.subspan(list.first, list.count);
+		}
+		std::span<const list_view> lists(const nested_list_view& list) const noexcept {
+			return std::span<const list_view>{lists_}.subspan(list.first, list.count);
+		}
+		std::span<const key_value_view> entries(const key_value_list_view& list) const noexcept {
+			return std::span<const key_value_view>{entries_}.subspan(list.first, list.count);
+		}
+		// The comparison of each entry, in the same order as entries(list).
+		std::span<const condition_view> conditions(const key_value_list_view& list) const noexcept {
+			return std::span<const condition_view>{conditions_}.subspan(list.first, list.count);
+		}
+		std::span<const term_view> terms(const expression_view& expression) const noexcept {
+			return std::span<const term_view>{terms_}.subspan(expression.first, expression.count);
+		}
+		const key_value_view& entry(const term_view& term) const noexcept {
+			return entries_[term.entry];
+		}
+		const condition_view& condition(const term_view& term) const noexcept {
+			return conditions_[term.entry];
+		}
+
+	private:
+		friend class command_parser;
+		std::string_view command_;
+		std::vector<argument_view> arguments_;
+		std::vector<primitive_view> elements_;
+		std::vector<list_view> lists_;
+		std::vector<key_value_view> entries_;
+		std::vector<condition_view> conditions_;
+		std::vector<term_view> terms_;
+	};
+
+	static void parse_command(std::string_view cmd, parsed_command& result);
+
 private:
 	static void consume_expected(std::string_view& input, const char& expected);
 	static void consume_whitespace(std::string_view& input);
 	static std::string_view extract_command(std::string_view& input);
-	static std::string_view extract_text(std::string_view& input, const std::string& end_delimiters = " \t");
+	static std::string_view extract_text(std::string_view& input, std::string_view end_delimiters = " \t");
 	static std::variant<std::monostate, long long, double> parse_number(std::string_view& text);
-	static primitive_argument_type extract_primitive(std::string_view& input, const std::string& end_delimiters = " \t");
-	static std::vector<primitive_argument_type> extract_list(std::string_view& input);
-	static std::vector<std::pair<std::string, primitive_argument_type>> extract_key_value_list(std::string_view& input);
+	static primitive_view extract_primitive(std::string_view& input, std::string_view end_delimiters = " \t");
+	static list_view extract_list(std::string_view& input, std::vector<primitive_view>& elements);
+	static nested_list_view extract_nested_list(std::string_view& input, parsed_command& result);
+	static comparison_operator extract_comparison(std::string_view& input, std::string_view& key);
+	static void extract_condition(std::string_view& input, parsed_command& result, std::string_view key_delimiters,
+	                              std::string_view value_delimiters);
+	static key_value_list_view extract_key_value_list(std::string_view& input, parsed_command& result);
+	static bool consume_keyword(std::string_view& input, std::string_view keyword);
+	static void extract_disjunction(std::string_view& input, parsed_command& result);
+	static void extract_conjunction(std::string_view& input, parsed_command& result);
+	static void extract_negation(std::string_view& input, parsed_command& result);
+	static expression_view extract_expression(std::string_view& input, parsed_command& result);
 };
 
 } // namespace minidb
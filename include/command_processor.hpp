@@ -2,14 +2,17 @@
 #define MINIDB_COMMAND_PROCESSOR_INCLUDED
 
 #include "command_parser.hpp"
+#include "prepared_statement.hpp"
+#include "result_writer.hpp"
 #include "row_filter.hpp"
 #include "value.hpp"
 #include <array>
 #include <functional>
 #include <iosfwd>
 #include <map>
+#include <span>
+#include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 #include <exception>
 
@@ -20,21 +23,41 @@ class database;
 class command_processor {
 	database& db;
 	bool exit = false;
-	using commandCallback = void (command_processor::*)(const std::vector<command_parser::argument_type>&,
-	                                                    std::ostream&);
-	std::unordered_map<std::string, commandCallback> callback_structure;
+	using arguments_type = std::span<const command_parser::argument_view>;
+	using commandCallback = void (command_processor::*)(const arguments_type&, std::ostream&);
+	std::map<std::string, commandCallback, std::less<>> callback_structure;
+	// Reused for every command line, so parsing doesn't allocate once it has grown to fit.
+	command_parser::parsed_command parsed;
+	output_format result_format = output_format::text;
+	std::map<std::string, prepared_statement, std::less<>> prepared_statements;
 
 	static void execute_help(std::ostream& output);
-	void execute_create_table(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_drop_table(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_append_row(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_update_rows(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_update_cell(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_query_table(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_query_column_histogram(const std::vector<command_parser::argument_type>& arguments,
+	void execute_create_table(const arguments_type& arguments, std::ostream& output);
+	void execute_drop_table(const arguments_type& arguments, std::ostream& output);
+	void execute_append_row(const arguments_type& arguments, std::ostream& output);
+	void execute_append_rows(const arguments_type& arguments, std::ostream& output);
+	void execute_update_rows(const arguments_type& arguments, std::ostream& output);
+	void execute_update_cell(const arguments_type& arguments, std::ostream& output);
+	void execute_update_cell_by_id(const arguments_type& arguments, std::ostream& output);
+	void execute_query_table(const arguments_type& arguments, std::ostream& output);
+	void execute_query_column_histogram(const arguments_type& arguments,
 	                                    std::ostream& output);
-	void execute_erase_row(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
-	void execute_erase_rows(const std::vector<command_parser::argument_type>& arguments, std::ostream& output);
+	void execute_erase_row(const arguments_type& arguments, std::ostream& output);
+	void execute_erase_row_by_id(const arguments_type& arguments, std::ostream& output);
+	void execute_row_ids(const arguments_type& arguments, std::ostream& output);
+	void execute_erase_rows(const arguments_type& arguments, std::ostream& output);
+	void execute_compact(const arguments_type& arguments, std::ostream& output);
+	void execute_create_index(const arguments_type& arguments, std::ostream& output);
+	void execute_save(const arguments_type& arguments, std::ostream& output);
+	void execute_load(const arguments_type& arguments, std::ostream& output);
+	void execute_load_csv(const arguments_type& arguments, std::ostream& output);
+	void execute_aggregate(const arguments_type& arguments, std::ostream& output);
+	void execute_approx_distinct(const arguments_type& arguments, std::ostream& output);
+	void execute_approx_quantiles(const arguments_type& arguments, std::ostream& output);
+	void execute_set_output_format(const arguments_type& arguments, std::ostream& output);
+	void execute_result_cache_statistics(const arguments_type& arguments, std::ostream& output);
+	void execute_prepare(std::string_view command_line, std::ostream& output);
+	void execute_prepared(const arguments_type& arguments, std::ostream& output);
 
 	template <typename T, typename... Arg>
 	T get_from_argument(const std::variant<Arg...>& arg) const {
@@ -51,9 +74,31 @@ class command_processor {
 		return std::visit([](const auto& a) { return to_value(a); }, arg);
 	}
 
+	std::span<const command_parser::primitive_view> get_list(const command_parser::argument_view& arg) const {
+		return parsed.elements(get_from_argument<command_parser::list_view>(arg));
+	}
+
+	// A key-value list whose entries all use '='.
+	std::span<const command_parser::key_value_view> get_key_value_list(const command_parser::argument_view& arg) const;
+
+	// Records the placeholders among the operands in parameters, if given.
+	row_filter get_filter(const command_parser::argument_view& arg,
+	                      std::vector<prepared_statement::parameter>* parameters = nullptr) const;
+
 public:
 	command_processor(database& db);
-	void execute(std::string command_line, std::ostream& output);
+	void execute(std::string_view command_line, std::ostream& output);
+
+	// Prepares a command line whose values may be placeholders, see command_parser::is_placeholder. Only append_row,
+	// query_table, query_column_histogram, update_rows and erase_rows can be prepared.
+	prepared_statement prepare(std::string_view command_line);
+	// Executes a statement prepared from a command line with the values of its parameters, writing the output of the
+	// command.
+	void execute(prepared_statement& statement, std::span<const value> parameters, std::ostream& output);
+
+	void set_output_format(output_format format) noexcept {
+		result_format = format;
+	}
 
 	bool should_exit() const noexcept {
 		return exit;
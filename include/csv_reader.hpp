@@ -0,0 +1,57 @@
+#ifndef MINIDB_CSV_READER_INCLUDED
+#define MINIDB_CSV_READER_INCLUDED
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace minidb {
+
+struct csv_options {
+	char delimiter = ',';
+	char quote = '"';
+	// Skip the first record, which names the columns.
+	bool header = false;
+	// Rows parsed before they are appended to the table in one go.
+	std::size_t batch_rows = 64 * 1024;
+	// Bytes read from the file at once. The buffer grows if a single record doesn't fit.
+	std::size_t buffer_size = 1 << 20;
+};
+
+// Streaming CSV parser (RFC 4180 quoting, LF or CRLF line ends) reading the file in large chunks. Fields are returned
+// as views into the read buffer, quoted fields are unescaped in place, so records are parsed without allocating.
+class csv_reader {
+public:
+	csv_reader(const std::filesystem::path& path, const csv_options& options);
+
+	// Reads the fields of the next non-empty record, returns false at the end of the file. The views stay valid
+	// until the next call.
+	bool next(std::vector<std::string_view>& fields);
+
+	// Line number of the first line of the record last returned by next(), starting at 1.
+	std::size_t line() const noexcept {
+		return record_line_;
+	}
+
+private:
+	// Returns the end of the record starting at begin_ or nullptr if the buffer doesn't hold all of it yet.
+	const char* find_record_end() const;
+	// Moves the unparsed rest to the front of the buffer and appends the next chunk of the file.
+	bool fill();
+	void split_fields(char* begin, char* end, std::vector<std::string_view>& fields) const;
+
+	std::ifstream in_;
+	csv_options options_;
+	std::vector<char> buffer_;
+	std::size_t begin_ = 0;
+	std::size_t end_ = 0;
+	bool eof_ = false;
+	std::size_t next_line_ = 1;
+	std::size_t record_line_ = 0;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_CSV_READER_INCLUDED
@@ -1,24 +1,142 @@
 #ifndef MINIDB_DATABASE_INCLUDED
 #define MINIDB_DATABASE_INCLUDED
 
+#include "aggregation.hpp"
+#include "csv_reader.hpp"
+#include "prepared_statement.hpp"
+#include "result_cache.hpp"
 #include "row_filter.hpp"
+#include "snapshot.hpp"
 #include "table.hpp"
+#include "thread_pool.hpp"
+#include "write_ahead_log.hpp"
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
 #include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <util.hpp>
 
 namespace minidb {
 
+// All table operations are safe to call concurrently. The tables are guarded by a reader-writer lock each, so queries
+// of a table run in parallel and exclude the operations modifying it, while operations on different tables don't
+// wait for each other. Creating, dropping and loading tables waits for all other operations. Configuring the database
+// and opening or closing its log mustn't overlap with any other call.
 class database {
-	std::map<std::string, table, std::less<>> tables_;
+	// Holds the catalog lock shared and the lock of one table, shared or exclusive, for the guard's lifetime.
+	template <typename Table, typename TableLock>
+	class table_guard {
+		std::shared_lock<std::shared_mutex> catalog_lock_;
+		TableLock table_lock_;
+		Table* table_;
+
+	public:
+		table_guard(std::shared_lock<std::shared_mutex> catalog_lock, std::shared_mutex& table_mutex, Table& table)
+			: catalog_lock_(std::move(catalog_lock)), table_lock_(table_mutex), table_(&table) {}
+
+		Table& operator*() const noexcept {
+			return *table_;
+		}
+		Table* operator->() const noexcept {
+			return table_;
+		}
+	};
+	using read_guard = table_guard<const table, std::shared_lock<std::shared_mutex>>;
+	using write_guard = table_guard<table, std::unique_lock<std::shared_mutex>>;
+
+	table_map tables_;
+	// Guards the set of tables, table_mutexes_ holds the lock of each table.
+	mutable std::shared_mutex catalog_mutex_;
+	mutable std::map<std::string, std::shared_mutex, std::less<>> table_mutexes_;
+	// Incremented whenever tables are created, dropped or loaded, prepared statements then resolve their table again.
+	std::uint64_t catalog_version_ = 0;
+	std::unique_ptr<thread_pool> scan_pool_ = std::make_unique<thread_pool>(1);
+	std::size_t morsel_rows_;
+	std::unique_ptr<write_ahead_log> log_;
+	double compaction_threshold_ = default_compaction_threshold;
+	std::unique_ptr<result_cache> result_cache_;
+
+	// Calls callback(row_index) for each row of table matching the bound filter, in ascending row order. Large tables
+	// are filtered in parallel unless the scan threads are busy with another query, callback is always invoked on the
+	// calling thread.
+	void for_each_matching_row(const table& table, const row_filter& filter,
+	                           const std::function<void(std::size_t)>& callback) const;
+	// Binds the filter and calls callback(row_index) like for_each_matching_row, taking the rows from the result
+	// cache if it holds them.
+	void for_each_query_match(const table& table, row_filter& filter,
+	                          const std::function<void(std::size_t)>& callback) const;
+	// The histogram of the column over the rows matching the filter, or all rows without one, from the result cache if
+	// it holds it.
+	std::shared_ptr<const result_cache::histogram> histogram(const table& table, std::size_t column_index,
+	                                                         row_filter* filter) const;
+	// Compacts the table if the share of its rows that are erased exceeds the compaction threshold.
+	void compact_if_needed(std::string_view table_name, table& table);
+	// Look up the table and lock it for reading or writing, throw std::out_of_range if there is no such table.
+	read_guard read_table(std::string_view name) const;
+	write_guard write_table(std::string_view name);
+	// Like read_table and write_table for the table of a prepared statement of the given kind, which is resolved again
+	// if the catalog changed since. Throw std::invalid_argument if the statement is of another kind.
+	read_guard read_table(prepared_statement& statement, prepared_statement::kind kind) const;
+	write_guard write_table(prepared_statement& statement, prepared_statement::kind kind);
+	// Looks up the table and columns of the statement, the catalog lock has to be held.
+	void resolve(prepared_statement& statement) const;
+	// Applies the changes, pairs of column index and new value, to the rows matching the bound filter.
+	void update_matching_rows(table& table, const row_filter& filter,
+	                          const std::vector<std::pair<std::size_t, value>>& changes) const;
+	void erase_matching_rows(std::string_view table_name, table& table, const row_filter& filter);
 
 public:
 	using rowCallBack = std::function<void(const row&)>;
+	// Receives the queried table while it's locked, before any of its rows, so rows can be read in its context.
+	using tableCallBack = std::function<void(const table&)>;
+
+	// Rows per unit of work in parallel scans, a multiple of the row_filter batch size.
+	static constexpr std::size_t default_morsel_rows = 16 * row_filter::batch_size;
+	static constexpr double default_compaction_threshold = 0;
+
+	database() : morsel_rows_(default_morsel_rows) {}
 
+	// Sets the number of threads scanning a table (0 means one per hardware thread) and the number of rows they
+	// process per unit of work. Until then scans run on the calling thread only.
+	void configure_scans(std::size_t worker_count, std::size_t morsel_rows = default_morsel_rows);
+
+	std::size_t scan_concurrency() const noexcept {
+		return scan_pool_->concurrency();
+	}
+
+	// Erasing rows only marks them, a table is compacted once more than this share of its rows is erased. 0, the
+	// default, disables the automatic compaction, tables are then only compacted by compact().
+	void configure_compaction(double threshold);
+
+	// Keeps the results of filtered queries and column histograms in a cache of about budget_bytes, 0 disables it.
+	// Every modification of a table makes the cached results of its queries stale, so they are computed again.
+	void configure_result_cache(std::size_t budget_bytes);
+	// All zero while the result cache is disabled.
+	result_cache::statistics result_cache_statistics() const;
+
+	// Replays the write-ahead log at path into this database, then records every further mutation in it.
+	void open_log(const std::filesystem::path& path, write_ahead_log::options options = {});
+	// Flushes and detaches the write-ahead log, further mutations are no longer logged.
+	void close_log();
+	void flush_log();
+
+	// Writes all tables to a binary snapshot file.
+	void save(const std::filesystem::path& path) const;
+	// Replaces all tables by the ones in the snapshot file. Integer and decimal columns are served from a memory
+	// mapping of the file until they are modified. Not available while a write-ahead log is open, as the log couldn't
+	// reproduce the loaded state.
+	void load(const std::filesystem::path& path);
+
+	// Neither the tables nor the table references returned by lookup_table are guarded, they may only be used while no
+	// other thread modifies them.
 	const auto& tables() const noexcept {
 		return tables_;
 	}
@@ -27,33 +145,89 @@ public:
 	const table& lookup_table(std::string_view name) const;
 	void create_table(std::string_view name, schema table_schema);
 	void drop_table(std::string_view name);
-	void append_row(std::string_view table_name, std::vector<value> cell_values);
+	// Returns the ID of the new row, which stays valid when rows are erased or the table is compacted.
+	row_id append_row(std::string_view table_name, std::vector<value> cell_values);
+	// Appends the rows in one go, moving their cells column by column into the table, and returns the ID of the first
+	// one, the others following consecutively. If any row doesn't match the schema, nothing is appended.
+	row_id append_rows(std::string_view table_name, std::span<std::vector<value>> rows);
+	// Marks the row as erased, the indexes of the other rows stay valid until the table is compacted.
 	void erase_row(std::string_view table_name, std::size_t row_index);
+	// Removes the erased rows from the table, renumbering the remaining ones.
+	void compact(std::string_view table_name);
+	// Appends as many rows as there are cells in each column, one cell_vector per column of the table.
+	void append_columns(std::string_view table_name, std::vector<column_storage::cell_vector> columns);
+	// Appends all records of the CSV file at path to the table, parsing each field as the type of its column. Rows are
+	// appended in batches of options.batch_rows, so a malformed record leaves the batches before it in the table.
+	// Returns the number of appended rows.
+	std::size_t bulk_load_csv(std::string_view table_name, const std::filesystem::path& path,
+	                          const csv_options& options = {});
 	void erase_rows(std::string_view table_name, row_filter filter);
 	void update_rows(std::string_view table_name, row_filter filter, std::unordered_map<std::string, value> changes);
 	table& bind_filter_if(std::string_view table_name, row_filter& filter);
 	void update_cell(std::string_view table_name, const std::size_t& row_index, const std::size_t& column_index,
 	                 const value& new_value);
+	void create_index(std::string_view table_name, std::string_view column_name, index_kind kind = index_kind::hash);
+	// Like update_cell and erase_row, but address the row by its ID. Throw std::out_of_range if the table has no row
+	// with that ID.
+	void update_cell_by_id(std::string_view table_name, row_id id, std::size_t column_index, const value& new_value);
+	void erase_row_by_id(std::string_view table_name, row_id id);
 
-	void query_table(std::string_view table_name, const rowCallBack& row_callback
-			) const {
-		const auto& table = lookup_table(table_name);
-		for(const auto& row : table.rows()) row_callback(row);
+	// Checks the definition against its table and prepares it for repeated execution. Throws like executing the
+	// statement would if the table or a column it names doesn't exist.
+	prepared_statement prepare(prepared_statement::definition definition) const;
+	// Execute a prepared statement of the respective kind with the given parameters, like the methods of the same name
+	// do for a table name and values.
+	row_id append_row(prepared_statement& statement, std::span<const value> parameters);
+	void query_table(prepared_statement& statement, std::span<const value> parameters,
+	                 const rowCallBack& row_callback, const tableCallBack& table_callback = nullptr) const;
+	auto query_column_histogram(prepared_statement& statement,
+	                            std::span<const value> parameters) const -> std::map<value, std::size_t>;
+	auto shared_column_histogram(prepared_statement& statement, std::span<const value> parameters) const
+			-> std::shared_ptr<const result_cache::histogram>;
+	void update_rows(prepared_statement& statement, std::span<const value> parameters);
+	void erase_rows(prepared_statement& statement, std::span<const value> parameters);
+
+	// The table stays locked for reading while row_callback runs, which therefore mustn't modify it.
+	void query_table(std::string_view table_name, const rowCallBack& row_callback,
+	                 const tableCallBack& table_callback = nullptr) const {
+		const auto table = read_table(table_name);
+		if(table_callback) table_callback(*table);
+		for(const auto& row : table->rows()) row_callback(row);
 	}
 
 	void query_table(std::string_view table_name, row_filter filter,
-	                 const rowCallBack& row_callback) const {
-		const auto& table = lookup_table(table_name);
-		filter.bind_to_table(table);
-		for(const auto& row : table.rows()) {
-			if(filter(row)) row_callback(row);
-		}
+	                 const rowCallBack& row_callback, const tableCallBack& table_callback = nullptr) const {
+		const auto table = read_table(table_name);
+		if(table_callback) table_callback(*table);
+		for_each_query_match(*table, filter, [&](std::size_t row_index) { row_callback(table->row_at(row_index)); });
 	}
 
 	auto query_column_histogram(std::string_view table_name, std::string_view column_name,
 	                            row_filter filter) const -> std::map<value, std::size_t>;
 	auto query_column_histogram(std::string_view table_name,
 	                            std::string_view column_name) const -> std::map<value, std::size_t>;
+	// Like query_column_histogram, but shares the histogram with the result cache, so a cached one isn't copied.
+	auto shared_column_histogram(std::string_view table_name, std::string_view column_name,
+	                             row_filter filter) const -> std::shared_ptr<const result_cache::histogram>;
+	auto shared_column_histogram(std::string_view table_name, std::string_view column_name) const
+			-> std::shared_ptr<const result_cache::histogram>;
+
+	// Groups the rows matching the filter by their cells in the group_by columns and computes the aggregations per
+	// group, see aggregate_rows.
+	table aggregate(std::string_view table_name, const std::vector<std::string>& group_by,
+	                const std::vector<aggregation>& aggregations, row_filter filter) const;
+	table aggregate(std::string_view table_name, const std::vector<std::string>& group_by,
+	                const std::vector<aggregation>& aggregations) const;
+
+	// Estimates the number of distinct cells of the column in the rows matching the filter, see approx_distinct_cells.
+	std::size_t approx_distinct(std::string_view table_name, std::string_view column_name, row_filter filter) const;
+	std::size_t approx_distinct(std::string_view table_name, std::string_view column_name) const;
+	// Estimates the cells of the column at the given quantiles in the rows matching the filter, see
+	// approx_cell_quantiles.
+	std::vector<double> approx_quantiles(std::string_view table_name, std::string_view column_name,
+	                                     const std::vector<double>& fractions, row_filter filter) const;
+	std::vector<double> approx_quantiles(std::string_view table_name, std::string_view column_name,
+	                                     const std::vector<double>& fractions) const;
 };
 
 } // namespace minidb
@@ -0,0 +1,82 @@
+#ifndef MINIDB_DICTIONARY_COLUMN_INCLUDED
+#define MINIDB_DICTIONARY_COLUMN_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace minidb {
+
+// Dictionary-encoded string cells: every distinct string is stored once in the dictionary and each row holds the code
+// of its string. Codes are assigned in insertion order and stay valid for the lifetime of the column, entries that are
+// no longer referenced by any row are kept until the column is destroyed.
+class dictionary_column {
+public:
+	using code_type = std::uint32_t;
+
+	dictionary_column() = default;
+	// Rebuilds a column from its distinct strings, in code order, and the codes of its rows.
+	dictionary_column(std::vector<std::string> entries, std::vector<code_type> codes);
+	// The lookup table refers into the dictionary, so copies would have to rebuild it. Columns are only ever moved.
+	dictionary_column(const dictionary_column&) = delete;
+	dictionary_column& operator=(const dictionary_column&) = delete;
+	dictionary_column(dictionary_column&&) = default;
+	dictionary_column& operator=(dictionary_column&&) = default;
+
+	std::size_t size() const noexcept {
+		return codes_.size();
+	}
+
+	const std::string& operator[](std::size_t index) const {
+		return dictionary_[codes_[index]];
+	}
+
+	const std::string& at(std::size_t index) const {
+		return dictionary_[codes_.at(index)];
+	}
+
+	const std::vector<code_type>& codes() const noexcept {
+		return codes_;
+	}
+
+	const std::string& decode(code_type code) const {
+		return dictionary_.at(code);
+	}
+
+	std::size_t dictionary_size() const noexcept {
+		return dictionary_.size();
+	}
+
+	// Returns the code of str, or nothing if no cell has ever held str.
+	std::optional<code_type> find_code(std::string_view str) const;
+
+	void reserve(std::size_t capacity) {
+		codes_.reserve(capacity);
+	}
+	void push_back(std::string_view str) {
+		codes_.push_back(intern(str));
+	}
+	void set(std::size_t index, std::string_view str) {
+		codes_.at(index) = intern(str);
+	}
+	std::vector<code_type>& mutable_codes() noexcept {
+		return codes_;
+	}
+
+private:
+	code_type intern(std::string_view str);
+
+	// A deque never relocates its elements, so the string_view keys of lookup_ stay valid as it grows.
+	std::deque<std::string> dictionary_;
+	std::unordered_map<std::string_view, code_type> lookup_;
+	std::vector<code_type> codes_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_DICTIONARY_COLUMN_INCLUDED
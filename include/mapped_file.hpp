@@ -0,0 +1,36 @@
+#ifndef MINIDB_MAPPED_FILE_INCLUDED
+#define MINIDB_MAPPED_FILE_INCLUDED
+
+#include <cstddef>
+#include <filesystem>
+
+namespace minidb {
+
+// Read-only memory mapping of a whole file. Pages are loaded lazily by the OS, so mapping even a huge file is cheap.
+class mapped_file {
+public:
+	explicit mapped_file(const std::filesystem::path& path);
+	~mapped_file();
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	const std::byte* data() const noexcept {
+		return data_;
+	}
+
+	std::size_t size() const noexcept {
+		return size_;
+	}
+
+private:
+	const std::byte* data_ = nullptr;
+	std::size_t size_ = 0;
+#ifdef _WIN32
+	void* file_handle_ = nullptr;
+	void* mapping_handle_ = nullptr;
+#endif
+};
+
+} // namespace minidb
+
+#endif // MINIDB_MAPPED_FILE_INCLUDED
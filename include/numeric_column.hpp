@@ -0,0 +1,192 @@
+#ifndef MINIDB_NUMERIC_COLUMN_INCLUDED
+#define MINIDB_NUMERIC_COLUMN_INCLUDED
+
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace minidb {
+
+// Dense array of integer or decimal cells. The cells either live in an owned vector or, for columns loaded from a
+// snapshot, directly in the memory mapping of the snapshot file. A mapped column is read in place and copied into an
+// owned vector on its first modification.
+//
+// Every block of zone_rows consecutive cells has a zone with the smallest and largest cell of the block, so range scans
+// can skip blocks that can't contain a match. Zones are exact after appending and rebuilding, overwriting a cell only
+// widens its zone. NaN cells are left out of the zones as no comparison with them is true. The zones of a mapped
+// column are computed when they're first needed, so loading a snapshot doesn't read every cell.
+template <typename T>
+class numeric_column {
+public:
+	using value_type = T;
+	using const_iterator = const T*;
+
+	static constexpr std::size_t zone_rows = 1024;
+	struct zone {
+		T min = std::numeric_limits<T>::max();
+		T max = std::numeric_limits<T>::lowest();
+
+		bool overlaps(T lower, T upper) const noexcept {
+			return min <= upper && lower <= max;
+		}
+	};
+
+	numeric_column() = default;
+	numeric_column(const numeric_column&) = delete;
+	numeric_column& operator=(const numeric_column&) = delete;
+	numeric_column(numeric_column&& other) noexcept
+		: owned_(std::move(other.owned_)), mapping_(std::move(other.mapping_)),
+		  cells_(std::exchange(other.cells_, nullptr)), size_(std::exchange(other.size_, 0)),
+		  zones_(std::move(other.zones_)), has_zones_(other.has_zones_.exchange(true)) {}
+	numeric_column& operator=(numeric_column&& other) noexcept {
+		owned_ = std::move(other.owned_);
+		mapping_ = std::move(other.mapping_);
+		cells_ = std::exchange(other.cells_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+		zones_ = std::move(other.zones_);
+		has_zones_ = other.has_zones_.exchange(true);
+		return *this;
+	}
+
+	// Serves the size cells at cells without copying them, mapping keeps the memory alive.
+	numeric_column(std::shared_ptr<const mapped_file> mapping, const T* cells, std::size_t size)
+		: mapping_(std::move(mapping)), cells_(cells), size_(size), has_zones_(false) {}
+
+	bool is_mapped() const noexcept {
+		return mapping_ != nullptr;
+	}
+
+	std::size_t size() const noexcept {
+		return size_;
+	}
+
+	bool empty() const noexcept {
+		return size_ == 0;
+	}
+
+	const T* data() const noexcept {
+		return cells_;
+	}
+
+	const T& operator[](std::size_t index) const noexcept {
+		return cells_[index];
+	}
+
+	const T& at(std::size_t index) const {
+		if(index >= size_) throw std::out_of_range("Row index out of range");
+		return cells_[index];
+	}
+
+	const_iterator begin() const noexcept {
+		return cells_;
+	}
+
+	const_iterator end() const noexcept {
+		return cells_ + size_;
+	}
+
+	// Safe to call concurrently, the first call on a mapped column computes the zones.
+	const std::vector<zone>& zones() const {
+		if(!has_zones_.load(std::memory_order_acquire)) {
+			const std::lock_guard lock(zones_mutex_);
+			if(!has_zones_.load(std::memory_order_relaxed)) {
+				rebuild_zones(0);
+				has_zones_.store(true, std::memory_order_release);
+			}
+		}
+		return zones_;
+	}
+
+	friend bool operator==(const numeric_column& lhs, const std::vector<T>& rhs) {
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+
+	void reserve(std::size_t capacity) {
+		modify([capacity](std::vector<T>& cells) { cells.reserve(capacity); }, std::numeric_limits<std::size_t>::max());
+	}
+
+	void push_back(T cell) {
+		modify([cell](std::vector<T>& cells) { cells.push_back(cell); }, std::numeric_limits<std::size_t>::max());
+		widen_zone(size_ - 1, cell);
+	}
+
+	void set(std::size_t index, T cell) {
+		if(index >= size_) throw std::out_of_range("Row index out of range");
+		modify([index, cell](std::vector<T>& cells) { cells[index] = cell; }, std::numeric_limits<std::size_t>::max());
+		widen_zone(index, cell);
+	}
+
+	// Calls modifier with the owned cells, copying mapped cells into them first. The zones of all blocks from the one
+	// holding first_changed on are rebuilt afterwards.
+	template <typename Modifier>
+	void modify(Modifier&& modifier, std::size_t first_changed = 0) {
+		zones();
+		if(mapping_ != nullptr) {
+			owned_.assign(cells_, cells_ + size_);
+			mapping_.reset();
+		}
+		// Keep the view in sync with the vector even if modifier throws half way.
+		struct resync {
+			numeric_column& column;
+			std::size_t first_changed;
+			~resync() {
+				column.cells_ = column.owned_.data();
+				column.size_ = column.owned_.size();
+				column.rebuild_zones(first_changed);
+			}
+		} guard{*this, first_changed};
+		std::forward<Modifier>(modifier)(owned_);
+	}
+
+private:
+	static bool is_nan(T cell) noexcept {
+		if constexpr(std::is_floating_point_v<T>) return std::isnan(cell);
+		else return false;
+	}
+
+	void widen_zone(std::size_t index, T cell) {
+		if(index / zone_rows == zones_.size()) zones_.emplace_back();
+		if(is_nan(cell)) return;
+		auto& z = zones_[index / zone_rows];
+		z.min = std::min(z.min, cell);
+		z.max = std::max(z.max, cell);
+	}
+
+	// Recomputes the zones of the blocks from the one holding first_row on, no-op if first_row is past the end.
+	void rebuild_zones(std::size_t first_row) const {
+		const auto first_block = first_row / zone_rows;
+		const auto blocks = (size_ + zone_rows - 1) / zone_rows;
+		if(first_block > blocks) return;
+		zones_.resize(blocks);
+		for(auto block = first_block; block < blocks; ++block) {
+			zone z;
+			for(auto row = block * zone_rows; row != std::min(size_, (block + 1) * zone_rows); ++row) {
+				if(is_nan(cells_[row])) continue;
+				z.min = std::min(z.min, cells_[row]);
+				z.max = std::max(z.max, cells_[row]);
+			}
+			zones_[block] = z;
+		}
+	}
+
+	std::vector<T> owned_;
+	std::shared_ptr<const mapped_file> mapping_;
+	const T* cells_ = nullptr;
+	std::size_t size_ = 0;
+	mutable std::vector<zone> zones_;
+	mutable std::atomic<bool> has_zones_ = true;
+	mutable std::mutex zones_mutex_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_NUMERIC_COLUMN_INCLUDED
@@ -0,0 +1,79 @@
+#ifndef MINIDB_PREPARED_STATEMENT_INCLUDED
+#define MINIDB_PREPARED_STATEMENT_INCLUDED
+
+#include "row_filter.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace minidb {
+
+class table;
+
+// An operation on one table that database::prepare checks and resolves once: the table, the columns it names and its
+// filter. Executing it only substitutes its parameters, which stand in for values of the definition, and passes the
+// new operands to the filter, which is compiled on the first execution. The table is looked up and the filter compiled
+// again only after tables were created, dropped or loaded. A statement mustn't be executed by several threads at once.
+class prepared_statement {
+public:
+	enum class kind { append_row, query_table, query_column_histogram, update_rows, erase_rows };
+
+	// Where the value of a parameter goes: the cell with the given index of the appended row or the new value of the
+	// change with that index, or operand number operand of the predicate at index in the filter expression.
+	struct parameter {
+		enum class target : std::uint8_t { cell, filter_operand };
+		target place;
+		std::size_t index;
+		std::size_t operand = 0;
+	};
+
+	// Which members a statement uses depends on its kind: append_row appends cells, query_column_histogram counts the
+	// cells of column and update_rows applies changes. All but append_row only consider the rows matching the filter,
+	// if there is one. The values of parameters are bound in the order of parameters.
+	struct definition {
+		prepared_statement::kind kind;
+		std::string table;
+		std::vector<value> cells;
+		std::string column;
+		std::vector<std::pair<std::string, value>> changes;
+		std::optional<row_filter> filter;
+		std::vector<parameter> parameters;
+	};
+
+	prepared_statement::kind get_kind() const noexcept {
+		return definition_.kind;
+	}
+	const std::string& table_name() const noexcept {
+		return definition_.table;
+	}
+	std::size_t parameter_count() const noexcept {
+		return definition_.parameters.size();
+	}
+
+private:
+	friend class database;
+
+	explicit prepared_statement(definition statement);
+
+	// Substitutes the parameters into the cells, changes and filter. Throws std::invalid_argument if their number
+	// doesn't match.
+	void bind(std::span<const value> parameters);
+
+	definition definition_;
+	// Resolved when the catalog had the version catalog_version_.
+	const table* table_ = nullptr;
+	std::shared_mutex* table_mutex_ = nullptr;
+	std::uint64_t catalog_version_ = 0;
+	std::size_t column_index_ = 0;
+	std::vector<std::size_t> change_columns_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_PREPARED_STATEMENT_INCLUDED
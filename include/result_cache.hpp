@@ -0,0 +1,81 @@
+#ifndef MINIDB_RESULT_CACHE_INCLUDED
+#define MINIDB_RESULT_CACHE_INCLUDED
+
+#include "row_filter.hpp"
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace minidb {
+
+// Query results of tables that didn't change since, evicting the least recently used ones once their estimated size
+// exceeds the budget. Every result is stored with the version of its table when it was computed and only found while
+// the table still has that version. Safe to use from several threads at once.
+class result_cache {
+public:
+	// The indexes of the matching rows, or a column histogram.
+	using row_list = std::vector<std::size_t>;
+	using histogram = std::map<value, std::size_t>;
+	using result = std::variant<row_list, histogram>;
+
+	struct statistics {
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t evictions = 0;
+		std::size_t entries = 0;
+		std::size_t bytes = 0;
+	};
+
+	explicit result_cache(std::size_t budget) : budget_(budget) {}
+
+	// The key of a query of the table, the column it concerns, if any, and its filter, if any. Filters that are a list
+	// of predicates have the same key in any order.
+	static std::string key(std::string_view query, std::string_view table_name, std::string_view column,
+	                       const row_filter* filter);
+
+	// The result stored under key if it was computed from the given version of the table, counting a hit, otherwise
+	// nullptr, counting a miss. The result stays valid while it's referenced, even once it's evicted.
+	std::shared_ptr<const result> find(const std::string& key, std::uint64_t version);
+	// Stores the result under key, replacing an earlier one, unless it alone exceeds the budget. Returns it either way.
+	std::shared_ptr<const result> insert(std::string key, std::string_view table_name, std::uint64_t version,
+	                                     result query_result);
+	// Drops the results of the named table.
+	void erase_table(std::string_view table_name);
+	void clear();
+
+	std::size_t budget() const noexcept {
+		return budget_;
+	}
+	statistics get_statistics() const;
+
+private:
+	struct entry {
+		std::string key;
+		std::string table_name;
+		std::uint64_t version;
+		std::size_t bytes;
+		std::shared_ptr<const result> query_result;
+	};
+
+	void erase(std::list<entry>::iterator it);
+
+	std::size_t budget_;
+	mutable std::mutex mutex_;
+	// Most recently used first.
+	std::list<entry> entries_;
+	std::unordered_map<std::string_view, std::list<entry>::iterator> index_;
+	statistics statistics_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_RESULT_CACHE_INCLUDED
@@ -0,0 +1,62 @@
+#ifndef MINIDB_RESULT_WRITER_INCLUDED
+#define MINIDB_RESULT_WRITER_INCLUDED
+
+#include "table.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace minidb {
+
+enum class output_format {
+	// Every cell followed by a blank, as written by operator<< for rows.
+	text,
+	// Tab-separated values with a header line. Tabs, line breaks and backslashes in strings are escaped as \t, \n, \r
+	// and \\.
+	tsv,
+	// Comma-separated values with a header line, quoted as in RFC 4180 where necessary.
+	csv,
+	// One JSON object per row, keyed by the column names.
+	json_lines
+};
+
+// Accepts text, tsv, csv and json.
+output_format parse_output_format(std::string_view name);
+
+// Formats query results into a reusable buffer and writes it to the stream in large chunks, so dumping many rows
+// costs about as much as copying their bytes. Numbers are formatted with std::to_chars, strings are copied in bulk.
+class result_writer {
+public:
+	static constexpr std::size_t default_flush_size = 1 << 16;
+
+	// Writes the header line of the format for the columns of tab, whose rows are passed to write_row.
+	result_writer(std::ostream& output, output_format format, const table& tab,
+	              std::size_t flush_size = default_flush_size);
+	result_writer(const result_writer&) = delete;
+	result_writer& operator=(const result_writer&) = delete;
+	// Flushes the remaining output, but ignores errors of the stream, call flush() before to have them thrown.
+	~result_writer();
+
+	void write_row(const row& r);
+	// Writes the buffered output to the stream.
+	void flush();
+
+private:
+	void write_string(std::string_view text);
+	void write_integer(long long number);
+	void write_decimal(double number);
+
+	std::ostream& output_;
+	output_format format_;
+	const table& table_;
+	std::size_t flush_size_;
+	std::string buffer_;
+	// Each column name as a quoted JSON key followed by a colon.
+	std::vector<std::string> json_keys_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_RESULT_WRITER_INCLUDED
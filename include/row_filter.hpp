@@ -2,10 +2,20 @@
 #define MINIDB_ROW_FILTER_INCLUDED
 
 #include "table.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace minidb {
 
@@ -13,27 +23,163 @@ class row_filter {
 public:
 	using filter_value_type = std::variant<long long, double, std::string>;
 
+	enum class comparison { equal, not_equal, less, less_equal, greater, greater_equal, between, in };
+
+	// A condition on the cells of one column. between takes the inclusive lower and upper bound as operands, in any
+	// number of values and a cell matches if it equals one of them, and all other comparisons take a single operand.
+	// All comparisons treat integers and decimals as numbers, so 5 equals 5.0. A string never equals a number and
+	// can't be ordered relative to one.
+	struct predicate {
+		std::string column;
+		comparison op;
+		std::vector<filter_value_type> operands;
+	};
+
+	enum class connective { conjunction, disjunction, negation };
+	// One step of a filter expression in postfix order. A predicate pushes its result, conjunction and disjunction
+	// combine the two topmost results and negation inverts the topmost one. Results left over at the end are combined
+	// by conjunction, so a list of predicates on its own requires all of them to hold.
+	using term = std::variant<predicate, connective>;
+
+	row_filter(std::vector<term> expression)
+		: filter_expression{std::move(expression)} {
+	}
+
+	// A copy has the expression of the filter but isn't bound, as the compiled predicates share their operands.
+	row_filter(const row_filter& other) : filter_expression(other.filter_expression) {}
+	row_filter(row_filter&&) noexcept = default;
+	row_filter& operator=(const row_filter& other) {
+		if(this != &other) *this = row_filter(other);
+		return *this;
+	}
+	row_filter& operator=(row_filter&&) noexcept = default;
+
+	row_filter(std::vector<predicate> predicates)
+		: filter_expression(std::make_move_iterator(predicates.begin()), std::make_move_iterator(predicates.end())) {
+	}
+
 	row_filter(std::unordered_map<std::string_view, filter_value_type>&& filter)
-		: filters{std::move(filter)} {
+		: row_filter(filter.begin(), filter.end()) {
 	}
 
 	row_filter(const std::initializer_list<std::pair<std::string_view const, filter_value_type>>& filter)
-		: filters(filter) {
+		: row_filter(filter.begin(), filter.end()) {
 	}
 
+	// Equality conditions from (column name, value) pairs.
 	template <typename BeginIt, typename EndIt>
-	row_filter(BeginIt beginIt, EndIt endIt)
-		: filters{beginIt, endIt} {
+	row_filter(BeginIt beginIt, EndIt endIt) {
+		for(; beginIt != endIt; ++beginIt) {
+			filter_expression.emplace_back(predicate{std::string(beginIt->first), comparison::equal, {beginIt->second}});
+		}
 	}
 
+	// Number of rows evaluated together by evaluate_batch.
+	static constexpr std::size_t batch_size = 1024;
+	using selection_batch = std::array<std::uint64_t, batch_size / 64>;
+
+	const std::vector<term>& expression() const noexcept {
+		return filter_expression;
+	}
+
+	// Replaces an operand of the predicate at term_index of the expression, which takes effect once the filter is bound
+	// again.
+	void set_operand(std::size_t term_index, std::size_t operand_index, filter_value_type operand) {
+		std::get<predicate>(filter_expression.at(term_index)).operands.at(operand_index) = std::move(operand);
+		operands_changed = true;
+	}
+
+	// Compiles the expression against the columns of tab: every predicate becomes a functor specialized for the type
+	// of its column and the connectives a flat program over their results, so evaluating rows involves no further type
+	// dispatch. Binding the filter to the table it's bound to again only passes the compiled predicates the operands
+	// set since and what changed in the table, such as its dictionaries and indexes.
 	void bind_to_table(const table& tab);
-	bool operator()(const row& r);
+	// Makes the next bind_to_table compile the filter again, which is required once the table it's bound to is gone.
+	void unbind() noexcept {
+		bound_table = nullptr;
+	}
+	bool operator()(const row& r) const;
+
+	// Evaluates the filter for the count (at most batch_size) rows starting at first_row of the bound table, one
+	// predicate at a time. On return bit i of selection is set iff row first_row + i matches and isn't erased.
+	void evaluate_batch(std::size_t first_row, std::size_t count, selection_batch& selection) const;
+
+	// Calls callback(row_index) for every row of the bound table that matches the filter and isn't erased, in ascending
+	// row order. If the filter is a conjunction and one of the columns it filters for equality is indexed, only the rows
+	// the index yields for that column are checked, otherwise the table is evaluated in batches of batch_size rows.
+	// Batches whose zones rule out a match are skipped.
+	template <typename Callback>
+	void for_each_match(Callback&& callback) const {
+		for_each_match_in(0, bound_table->slot_count(), std::forward<Callback>(callback));
+	}
+
+	// Like for_each_match, but only for the rows in [first_row, last_row). Safe to call concurrently on disjoint
+	// ranges as long as the table isn't modified.
+	template <typename Callback>
+	void for_each_match_in(std::size_t first_row, std::size_t last_row, Callback&& callback) const {
+		if(never_matches) return;
+		if(candidate_rows != nullptr) {
+			const auto first = std::lower_bound(candidate_rows->begin(), candidate_rows->end(), first_row);
+			const auto last = std::lower_bound(first, candidate_rows->end(), last_row);
+			for(auto it = first; it != last; ++it) {
+				if((*this)(bound_table->row_at(*it))) callback(*it);
+			}
+			return;
+		}
+		selection_batch selection;
+		for(std::size_t batch_row = first_row; batch_row < last_row; batch_row += batch_size) {
+			const auto count = std::min(batch_size, last_row - batch_row);
+			if(!may_match(batch_row, count)) continue;
+			evaluate_batch(batch_row, count, selection);
+			for(std::size_t word = 0; word != selection.size(); ++word) {
+				for(auto bits = selection[word]; bits != 0; bits &= bits - 1) {
+					callback(batch_row + word * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+				}
+			}
+		}
+	}
+
+	// False if the zone maps of the bound table rule out a match among the count rows starting at first_row.
+	bool may_match(std::size_t first_row, std::size_t count) const;
 
 private:
-	std::unordered_map<std::string_view, filter_value_type>
-	filters;
-	std::unordered_map<int, filter_value_type>
-	column_indexed_filters;
+	std::vector<term> filter_expression;
+	// What the operands of a predicate imply for the whole table: whether it matches every row or none, and the rows
+	// an index yields for an equality on an indexed column.
+	struct operand_outcome {
+		std::optional<bool> constant;
+		const column_index::row_list* indexed_rows = nullptr;
+	};
+	// A predicate compiled for the type of its column and comparison. The functors share the operands, in the form the
+	// test of a cell takes them, with assign, so new operands don't require compiling the predicate again.
+	struct compiled_predicate {
+		std::function<bool(std::size_t)> matches;
+		// Clears the bits of the non-matching rows among the count rows starting at first_row.
+		std::function<void(std::size_t, std::size_t, std::uint64_t*)> select;
+		// False if the zones of the count rows starting at first_row rule out a match.
+		std::function<bool(std::size_t, std::size_t)> may_match;
+		// Checks the operands of the predicate and passes them to the functors.
+		std::function<operand_outcome(const predicate&)> assign;
+	};
+	// Passes the operands of all predicates to the compiled ones and derives never_matches and candidate_rows.
+	void assign_operands();
+	struct instruction {
+		enum class code : std::uint8_t { test, conjunction, disjunction, negation } op;
+		// Index of the compiled predicate a test evaluates.
+		std::uint32_t predicate;
+	};
+	std::vector<compiled_predicate> compiled_predicates;
+	std::vector<instruction> program;
+	// Maximum number of intermediate results of the program.
+	std::size_t program_depth = 0;
+	// The program only tests and conjunctions, so predicates can be evaluated one after the other on one selection.
+	bool is_conjunction = true;
+	bool never_matches = false;
+	const table* bound_table = nullptr;
+	const column_index::row_list* candidate_rows = nullptr;
+	// The version of the bound table when the operands were last assigned, and whether they were set since.
+	std::uint64_t assigned_version = 0;
+	bool operands_changed = false;
 };
 
 } // namespace minidb
@@ -2,23 +2,36 @@
 #define MINIDB_SCHEMA_INCLUDED
 
 #include "value.hpp"
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace minidb {
 
+// How the cells of a column are laid out in memory. Dictionary encoding is only available for string columns and stores
+// each distinct string once plus a small integer code per row.
+enum class column_encoding { plain, dictionary };
+
 class column {
 	std::string name_;
 	value_type type_;
+	column_encoding encoding_;
 
 public:
-	column(std::string name, value_type type) : name_(std::move(name)), type_(type) {}
+	column(std::string name, value_type type, column_encoding encoding = column_encoding::plain)
+		: name_(std::move(name)), type_(type), encoding_(encoding) {
+		if(encoding_ == column_encoding::dictionary && type_ != value_type::string) throw std::invalid_argument(
+				"Dictionary encoding is only supported for string columns");
+	}
 	const std::string& name() const noexcept {
 		return name_;
 	}
 	value_type type() const noexcept {
 		return type_;
 	}
+	column_encoding encoding() const noexcept {
+		return encoding_;
+	}
 };
 
 class schema {
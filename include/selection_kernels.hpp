@@ -0,0 +1,29 @@
+#ifndef MINIDB_SELECTION_KERNELS_INCLUDED
+#define MINIDB_SELECTION_KERNELS_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+namespace minidb {
+
+// Instruction set used by the selection kernels. The best level supported by the running CPU is picked on first use.
+enum class simd_level { scalar, sse2, avx2 };
+
+simd_level detected_simd_level() noexcept;
+simd_level active_simd_level() noexcept;
+// Switches the kernels to the given level, e.g. to compare implementations. Throws if the CPU doesn't support it.
+void set_simd_level(simd_level level);
+
+// Selection bitmaps hold one bit per row, bit i % 64 of word i / 64 for row i. The kernels clear the bit of every row i
+// in [0, count) whose data[i] differs from key and leave all other bits untouched.
+void select_equal(const long long* data, std::size_t count, long long key, std::uint64_t* selection) noexcept;
+void select_equal(const double* data, std::size_t count, double key, std::uint64_t* selection) noexcept;
+void select_equal(const std::uint32_t* data, std::size_t count, std::uint32_t key, std::uint64_t* selection) noexcept;
+// Clear the bit of every row whose cell lies outside [lower, upper]. NaN cells are outside of every range.
+void select_range(const long long* data, std::size_t count, long long lower, long long upper,
+                  std::uint64_t* selection) noexcept;
+void select_range(const double* data, std::size_t count, double lower, double upper, std::uint64_t* selection) noexcept;
+
+} // namespace minidb
+
+#endif // MINIDB_SELECTION_KERNELS_INCLUDED
@@ -0,0 +1,66 @@
+#ifndef MINIDB_SERVER_INCLUDED
+#define MINIDB_SERVER_INCLUDED
+
+#include "result_writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace minidb {
+
+class database;
+
+// Serves the command line syntax to many clients over local stream sockets. Every line a client sends is executed by a
+// command_processor of its own connection and answered by a header line "ok <size>" or "error <size>" followed by
+// size bytes of output or error message. Clients may send any number of commands without waiting for the responses,
+// which come back in order, those to the commands of one read in a single write. Empty lines are ignored, exit closes
+// the connection.
+//
+// Each event loop is an epoll instance on its own thread owning the connections it accepted, so commands of different
+// clients run in parallel on the shared, internally synchronized database. Only available on Linux.
+class server {
+public:
+	static constexpr std::size_t default_max_line_size = 64 << 20;
+
+	struct options {
+		std::size_t event_loops = 1;
+		output_format format = output_format::text;
+		// Longest command line accepted, a connection sending a longer one is answered with an error and closed.
+		std::size_t max_line_size = default_max_line_size;
+	};
+
+	// A connection's unanswered commands stop being read once this much output is waiting for the client.
+	static constexpr std::size_t max_pending_output = 1 << 20;
+
+	// Listens on the loopback interface if address is a port number, port 0 picking a free one, otherwise on a Unix
+	// socket at the path address, replacing a stale socket file. Throws std::system_error if that fails.
+	server(database& db, std::string_view address, options opts);
+	~server();
+	server(const server&) = delete;
+	server& operator=(const server&) = delete;
+
+	// The TCP port listened on, 0 for a Unix socket.
+	std::uint16_t port() const noexcept {
+		return port_;
+	}
+
+	// Runs the event loops, one of them on the calling thread, and returns once stop() was called.
+	void run();
+	// Makes run() return, closing all connections. Safe to call from any thread and from signal handlers.
+	void stop() noexcept;
+
+private:
+	class event_loop;
+
+	database& db_;
+	options options_;
+	int listen_fd_ = -1;
+	int stop_fd_ = -1;
+	std::uint16_t port_ = 0;
+	std::filesystem::path socket_path_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_SERVER_INCLUDED
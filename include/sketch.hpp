@@ -0,0 +1,88 @@
+#ifndef MINIDB_SKETCH_INCLUDED
+#define MINIDB_SKETCH_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace minidb {
+
+// HyperLogLog estimate of the number of distinct hashes added to it, in 2^precision bytes. The relative standard
+// error is about 1.04 / sqrt(2^precision), 0.8% for the default precision. Small counts are estimated by linear
+// counting, which is close to exact.
+class hyperloglog {
+public:
+	static constexpr unsigned default_precision = 14;
+
+	// Accepts precisions from 4 to 18.
+	explicit hyperloglog(unsigned precision = default_precision);
+
+	// The hashes have to be uniformly distributed over all 64 bits.
+	void add(std::uint64_t hash) noexcept {
+		// The top bits select the register, it keeps the largest position of the first one bit in the rest. The bit
+		// or'ed in caps the position for hashes whose remaining bits are all zero.
+		auto& reg = registers_[hash >> (64 - precision_)];
+		const auto rest = (hash << precision_) | (1ULL << (precision_ - 1));
+		const auto rank = static_cast<std::uint8_t>(std::countl_zero(rest) + 1);
+		if(rank > reg) reg = rank;
+	}
+
+	// Afterwards this estimates the distinct hashes added to either. Both need the same precision.
+	void merge(const hyperloglog& other);
+	double estimate() const;
+
+private:
+	unsigned precision_;
+	std::vector<std::uint8_t> registers_;
+};
+
+// KLL sketch of a stream of numbers. It keeps O(accuracy * log(count / accuracy)) of them, each standing for a power
+// of two of the numbers added, and estimates quantiles with a rank error of about 1.7 / accuracy, 1% of the count for
+// the default accuracy. Every compaction randomly keeps the even or the odd ones of a sorted level.
+class quantile_sketch {
+public:
+	static constexpr std::size_t default_accuracy = 200;
+
+	explicit quantile_sketch(std::size_t accuracy = default_accuracy, std::uint64_t seed = 0x9e3779b97f4a7c15ULL);
+
+	void add(double number) {
+		levels_.front().push_back(number);
+		++count_;
+		min_ = std::min(min_, number);
+		max_ = std::max(max_, number);
+		if(levels_.front().size() >= capacities_.front()) compress();
+	}
+
+	// Afterwards this sketches the numbers added to either.
+	void merge(const quantile_sketch& other);
+
+	std::size_t count() const noexcept {
+		return count_;
+	}
+
+	// The estimated number at each quantile in [0, 1], NaN for all of them if no number was added. The quantiles 0 and
+	// 1 are the exact smallest and largest number.
+	std::vector<double> quantiles(std::span<const double> fractions) const;
+
+private:
+	void add_level();
+	void compress();
+	bool random_bit() noexcept;
+
+	std::size_t accuracy_;
+	std::size_t count_ = 0;
+	double min_ = std::numeric_limits<double>::infinity();
+	double max_ = -std::numeric_limits<double>::infinity();
+	std::uint64_t random_state_;
+	// The numbers at level h stand for 2^h numbers each. A level is compacted once it holds capacities_[h] numbers.
+	std::vector<std::vector<double>> levels_;
+	std::vector<std::size_t> capacities_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_SKETCH_INCLUDED
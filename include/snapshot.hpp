@@ -0,0 +1,30 @@
+#ifndef MINIDB_SNAPSHOT_INCLUDED
+#define MINIDB_SNAPSHOT_INCLUDED
+
+#include "table.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace minidb {
+
+using table_map = std::map<std::string, table, std::less<>>;
+
+// Versioned binary image of a set of tables. Every table stores its schema, its row count including erased rows, the
+// words of its erased row bitmap (since version 2), its next row ID and the IDs of its rows unless they equal their
+// indexes (since version 3), its indexes and then its columns one after another. Each column is a contiguous block starting at an 8 byte aligned offset:
+//  - integer and decimal cells as a raw native-endian array,
+//  - plain strings as row_count + 1 u64 offsets followed by the concatenated bytes,
+//  - dictionary strings as the entry count, entry_count + 1 u64 offsets, the entry bytes and then one u32 code per row.
+// Loading maps the file into memory and serves integer and decimal columns straight from the mapping.
+constexpr std::uint32_t snapshot_version = 3;
+
+// Writes the snapshot to a temporary file next to path and renames it over path once complete.
+void write_snapshot(const std::filesystem::path& path, const table_map& tables);
+table_map read_snapshot(const std::filesystem::path& path);
+
+} // namespace minidb
+
+#endif // MINIDB_SNAPSHOT_INCLUDED
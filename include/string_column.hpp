@@ -0,0 +1,106 @@
+#ifndef MINIDB_STRING_COLUMN_INCLUDED
+#define MINIDB_STRING_COLUMN_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace minidb {
+
+// Plain string cells in one 8-byte slot each. Strings of up to 7 bytes are stored in the slot itself, longer ones
+// back to back in one heap per column, prefixed by their varint length, the slot holding their offset. So appending
+// a cell only grows two arrays, and destroying the column frees all of them at once. Overwriting a cell with a longer
+// string appends its bytes and leaves the old ones behind, until they make up more than half of the heap and it is
+// rewritten.
+class string_column {
+public:
+	// The longest string kept inside its slot.
+	static constexpr std::size_t inline_capacity = 7;
+
+	string_column() = default;
+	// Adopts count cells as written to a snapshot, count + 1 ascending offsets into bytes.
+	string_column(const std::uint64_t* offsets, const char* bytes, std::size_t count);
+
+	std::size_t size() const noexcept {
+		return slots_.size();
+	}
+
+	std::string_view operator[](std::size_t index) const noexcept {
+		const auto& s = slots_[index];
+		if(s.is_inline()) return {s.bytes, s.inline_size()};
+		auto offset = s.offset();
+		std::size_t length = 0;
+		for(unsigned shift = 0;; shift += 7) {
+			const auto byte = static_cast<unsigned char>(bytes_[offset++]);
+			length |= std::size_t{byte & 0x7fu} << shift;
+			if(byte < 0x80) break;
+		}
+		return {bytes_.data() + offset, length};
+	}
+
+	std::string_view at(std::size_t index) const {
+		if(index >= slots_.size()) throw std::out_of_range("Row index out of range");
+		return (*this)[index];
+	}
+
+	// Bytes held by the heap, including those of overwritten cells not reclaimed yet. Strings stored inline don't take
+	// any.
+	std::size_t heap_size() const noexcept {
+		return bytes_.size();
+	}
+
+	void reserve(std::size_t capacity) {
+		slots_.reserve(capacity);
+	}
+
+	void push_back(std::string_view str) {
+		slots_.push_back(make_slot(str));
+	}
+
+	void set(std::size_t index, std::string_view str);
+	// Removes every cell whose entry in erase_mask is true and copies the remaining bytes into a heap of their size.
+	void erase_masked(const std::vector<bool>& erase_mask);
+
+	// Overwritten bytes are only reclaimed once there are at least this many, so small heaps aren't rewritten often.
+	static constexpr std::size_t min_reclaimed_bytes = 4096;
+
+private:
+	// The last byte tags the slot. With its top bit set it holds the size of the string in the bytes before it,
+	// otherwise it is 0 and those bytes hold the little-endian offset of the string in the heap.
+	struct slot {
+		char bytes[8];
+
+		bool is_inline() const noexcept {
+			return (static_cast<unsigned char>(bytes[7]) & 0x80u) != 0;
+		}
+		std::size_t inline_size() const noexcept {
+			return static_cast<unsigned char>(bytes[7]) & 0x7fu;
+		}
+		std::size_t offset() const noexcept {
+			std::size_t offset = 0;
+			for(int index = 6; index >= 0; --index) offset = offset << 8 | static_cast<unsigned char>(bytes[index]);
+			return offset;
+		}
+	};
+	static_assert(sizeof(slot) == 8);
+
+	slot make_slot(std::string_view str);
+	static slot inline_slot(std::string_view str) noexcept;
+	static slot heap_slot(std::size_t offset) noexcept;
+	// Appends str with its length prefix to the heap and returns the offset of the prefix.
+	std::size_t append_bytes(std::string_view str);
+	// Copies the cells not marked in erase_mask, or all of them without one, into a heap of their size.
+	void rewrite(const std::vector<bool>* erase_mask);
+
+	std::vector<slot> slots_;
+	std::vector<char> bytes_;
+	// Bytes in the heap no cell refers to anymore.
+	std::size_t dead_bytes_ = 0;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_STRING_COLUMN_INCLUDED
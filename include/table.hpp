@@ -1,88 +1,178 @@
 #ifndef MINIDB_TABLE_INCLUDED
 #define MINIDB_TABLE_INCLUDED
 
+#include "column_index.hpp"
+#include "column_storage.hpp"
 #include "schema.hpp"
 #include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <util.hpp>
 #include <vector>
 
 namespace minidb {
 
+class table;
+
+// Identifies a row for the lifetime of its table, unlike its index, which changes when the table is compacted.
+using row_id = std::uint64_t;
+
+template <typename Row>
+class basic_row_range;
+
+// Lightweight read-only view of a single row of a table. The cells themselves live column-wise in the table, so a row
+// is just a table pointer and a row index and is cheap to copy. A row view is invalidated by compacting the table.
 class row {
-	std::vector<value> cells_;
-	schema* table_schema_;
+protected:
+	const table* table_;
+	std::size_t index_;
 
 	friend class table;
-	row(std::vector<value> cells, schema* table_schema);
+	template <typename Row>
+	friend class basic_row_range;
+	row(const table* tab, std::size_t index) : table_(tab), index_(index) {}
 
 public:
 	friend std::ostream& operator<<(std::ostream& stream, const row& row);
-	const value& get_cell_value(std::size_t column_index) const {
-		return cells_.at(column_index);
+
+	std::size_t index() const noexcept {
+		return index_;
 	}
 
-	const value& get_cell_value_if(std::size_t column_index) const {
-		if(column_index >= cells_.size()) {
+	row_id id() const noexcept;
+
+	std::size_t size() const noexcept;
+
+	value get_cell_value(std::size_t column_index) const;
+
+	value get_cell_value_if(std::size_t column_index) const {
+		if(column_index >= size()) {
 			throw std::out_of_range("Cell index out of range");
 		}
 		return get_cell_value(column_index);
 	}
 
-	const value_type get_value_type_at_cell(std::size_t column_index) const {
-		return table_schema_->columns().at(column_index).type();
-	}
+	value_type get_value_type_at_cell(std::size_t column_index) const;
 
-	const value_type get_value_type_at_cell_if(std::size_t column_index) const {
-		if(column_index >= cells_.size()) {
+	value_type get_value_type_at_cell_if(std::size_t column_index) const {
+		if(column_index >= size()) {
 			throw std::out_of_range("Column index out of range");
 		}
 		return get_value_type_at_cell(column_index);
 	}
 
 	template <typename T>
-	const T& get_cell_value(std::size_t column_index) const {
-		return std::get<T>(get_cell_value_if(column_index));
-	}
+	column_storage::cell_ref<T> get_cell_value(std::size_t column_index) const;
 
+	bool cell_equals(std::size_t column_index, const value& val) const;
+};
+
+// View of a row that can also change its cells, only handed out by tables that aren't const.
+class mutable_row : public row {
+	friend class table;
+	template <typename Row>
+	friend class basic_row_range;
+	mutable_row(table* tab, std::size_t index) : row(tab, index) {}
+
+public:
 	// Allows supplying string_views for cells where a string is expected.
 	void set_cell_value(std::size_t column_index, std::string_view val) {
-		set_cell_value(column_index, std::string(val));
+		set_cell_value(column_index, value(std::string(val)));
 	}
 
+	void set_cell_value(std::size_t column_index, value val);
+
 	template <typename T>
-	value_type getVal(T) const {
-		throw std::invalid_argument("Invalid");
+	void set_cell_value(std::size_t column_index, T val) {
+		set_cell_value(column_index, value(std::move(val)));
 	}
+};
 
-	value_type getVal(value& v) const {
-		return std::visit([]<typename T0>(T0)
-		{
-			return value_type_index<T0>::value;
-		}, v);
-	}
+// Range of views of the rows of a table that aren't erased, as returned by table::rows(). Positions count these rows
+// only, so while the table holds erased rows at() and [] have to count them from the start, and the iterators only go
+// forward. Row is row for const tables and mutable_row otherwise.
+template <typename Row>
+class basic_row_range {
+	using table_pointer = std::conditional_t<std::is_same_v<Row, row>, const table*, table*>;
+	table_pointer table_;
+
+	friend class table;
+	explicit basic_row_range(table_pointer tab) : table_(tab) {}
 
+public:
+	class iterator {
+		table_pointer table_ = nullptr;
+		std::size_t index_ = 0;
 
-	template <typename T>
-	void set_cell_value(std::size_t column_index, T val) {
-		if(getVal(val) == get_value_type_at_cell_if(column_index)) {
-			cells_.at(column_index) = val;
-		} else {
-			throw std::invalid_argument("Invalid type at the given index when setting cell");
+		friend class basic_row_range;
+		iterator(table_pointer tab, std::size_t index) : table_(tab), index_(index) {}
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Row;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Row;
+
+		iterator() = default;
+		Row operator*() const;
+		iterator& operator++();
+		iterator operator++(int) {
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+		friend bool operator==(const iterator& lhs, const iterator& rhs) {
+			return lhs.index_ == rhs.index_ && lhs.table_ == rhs.table_;
 		}
+	};
+
+	std::size_t size() const noexcept;
+	bool empty() const noexcept {
+		return size() == 0;
 	}
+	Row at(std::size_t index) const;
+	Row operator[](std::size_t index) const;
+	iterator begin() const;
+	iterator end() const;
 };
 
+using row_range = basic_row_range<row>;
+using mutable_row_range = basic_row_range<mutable_row>;
+
 class table {
 	std::string name_;
 	std::unique_ptr<schema> schema_;
-	std::vector<row> rows_;
+	std::vector<column_storage> column_data_;
+	std::map<std::size_t, column_index> indexes_;
+	std::size_t slot_count_ = 0;
+	// One bit per row, set for erased rows. Covers the rows up to the last erased one only.
+	std::vector<std::uint64_t> erased_;
+	std::size_t erased_count_ = 0;
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+	// Row IDs are handed out in append order and never reused. Until compacting removes a row the ID of every row
+	// equals its index and row_ids_ and row_slots_ stay empty.
+	row_id next_row_id_ = 0;
+	std::vector<row_id> row_ids_;
+	// The index of the row with ID first_row_id_ + i, npos once compacting removed it.
+	std::vector<std::size_t> row_slots_;
+	row_id first_row_id_ = 0;
+	// Incremented by every change to the rows or their cells, so results computed from the table can tell they're
+	// stale.
+	std::uint64_t version_ = 0;
 
 public:
 	table(std::string name, schema table_schema);
+	// Adopts existing cells, one column_storage per schema column, all of the same size.
+	table(std::string name, schema table_schema, std::vector<column_storage> column_data);
 
 	const std::vector<column>& columns() const noexcept {
 		return schema_->columns();
@@ -92,22 +182,190 @@ public:
 		return name_;
 	}
 
-	const std::vector<row>& rows() const noexcept {
-		return rows_;
+	row_range rows() const noexcept {
+		return row_range{this};
+	}
+	mutable_row_range rows() noexcept {
+		return mutable_row_range{this};
+	}
+
+	// Number of rows that aren't erased.
+	std::size_t row_count() const noexcept {
+		return slot_count_ - erased_count_;
+	}
+
+	// Number of rows including the erased ones, which keep their index until the table is compacted. Scans cover the
+	// row indexes below it and skip the erased rows.
+	std::size_t slot_count() const noexcept {
+		return slot_count_;
+	}
+
+	std::size_t erased_count() const noexcept {
+		return erased_count_;
+	}
+
+	bool is_erased(std::size_t row_index) const noexcept {
+		return row_index / 64 < erased_.size() && (erased_[row_index / 64] >> row_index % 64 & 1) != 0;
+	}
+
+	// Bit i is set iff row first_row + i is erased.
+	std::uint64_t erased_bits(std::size_t first_row) const noexcept;
+
+	// The first row from row_index on that isn't erased, slot_count() if there is none.
+	std::size_t next_row(std::size_t row_index) const noexcept {
+		return erased_count_ == 0 || !is_erased(row_index) ? row_index : find_row(row_index);
+	}
+
+	// The row at position n among the rows that aren't erased.
+	std::size_t nth_row(std::size_t n) const noexcept;
+
+	row row_at(std::size_t row_index) const noexcept {
+		return row{this, row_index};
+	}
+	mutable_row row_at(std::size_t row_index) noexcept {
+		return mutable_row{this, row_index};
+	}
+
+	row_id id_of(std::size_t row_index) const noexcept {
+		return ids_are_indexes() ? row_index : row_ids_[row_index];
 	}
 
-	std::vector<row>& rows() noexcept {
-		return rows_;
+	// The index of the row with the given ID, in constant time. Throws std::out_of_range if there is no such row or
+	// it was erased.
+	std::size_t slot_of(row_id id) const;
+
+	// The ID the next appended row gets.
+	row_id next_row_id() const noexcept {
+		return next_row_id_;
+	}
+
+	std::uint64_t version() const noexcept {
+		return version_;
+	}
+
+	// Restores the IDs of all rows as written to a snapshot, row_ids is either empty, if every row's ID is its index, or
+	// holds the ascending IDs of all rows, which are below next_row_id.
+	void restore_row_ids(std::vector<row_id> row_ids, row_id next_row_id);
+
+	const column_storage& column_data(std::size_t column_index) const {
+		return column_data_.at(column_index);
 	}
 
 	std::size_t get_column_index_by_name(std::string_view name) const;
 	value_type get_column_type(std::size_t column_index) const;
 	const std::string& get_column_name(std::size_t column_index) const;
-	void append_row(std::vector<value> cell_values);
+	// Returns the ID of the new row.
+	row_id append_row(std::vector<value> cell_values);
+	// Appends as many rows as there are cells in each column, one cell_vector per column of the schema.
+	void append_columns(std::vector<column_storage::cell_vector> columns);
+	// Marks the row as erased and drops it from the indexes, its cells stay in place until the table is compacted.
 	void erase_row(std::size_t row_index);
 	void update_cell(const std::size_t row_index, const std::size_t column_index, const value& value);
+
+	// Erases every row whose entry in erase_mask, which covers all slots, is true.
+	void erase_rows(const std::vector<bool>& erase_mask);
+	// Removes the cells of the erased rows and renumbers the remaining rows in order, then rebuilds the indexes and
+	// zones. Invalidates all row indexes, but not the row IDs.
+	void compact();
+
+	void create_index(std::size_t column_index, index_kind kind);
+
+	// Throw like append_row, append_columns, erase_row, update_cell and create_index would, without changing the table,
+	// so operations can be checked before they're logged.
+	void check_cells(const std::vector<value>& cell_values) const;
+	void check_columns(const std::vector<column_storage::cell_vector>& columns) const;
+	void check_row(std::size_t row_index) const;
+	void check_cell(std::size_t column_index, const value& value) const;
+	void check_new_index(std::size_t column_index) const;
+
+	// Returns the index on the given column, or nullptr if the column isn't indexed.
+	const minidb::column_index* find_index(std::size_t column_index) const {
+		const auto it = indexes_.find(column_index);
+		return it == indexes_.end() ? nullptr : &it->second;
+	}
+
+	// The IDs of all rows by index, empty while every row's ID is its index.
+	const std::vector<row_id>& row_ids() const noexcept {
+		return row_ids_;
+	}
+
+private:
+	bool ids_are_indexes() const noexcept {
+		return next_row_id_ == slot_count_;
+	}
+
+	void rebuild_row_slots();
+	std::size_t find_row(std::size_t row_index) const noexcept;
+	void rebuild_indexes();
 };
 
+inline std::size_t row::size() const noexcept {
+	return table_->columns().size();
+}
+
+inline value row::get_cell_value(std::size_t column_index) const {
+	return table_->column_data(column_index).get(index_);
+}
+
+inline value_type row::get_value_type_at_cell(std::size_t column_index) const {
+	return table_->get_column_type(column_index);
+}
+
+template <typename T>
+column_storage::cell_ref<T> row::get_cell_value(std::size_t column_index) const {
+	return table_->column_data(column_index).get<T>(index_);
+}
+
+inline bool row::cell_equals(std::size_t column_index, const value& val) const {
+	return table_->column_data(column_index).equals(index_, val);
+}
+
+inline void mutable_row::set_cell_value(std::size_t column_index, value val) {
+	// Only tables that aren't const hand out mutable rows.
+	const_cast<table*>(table_)->update_cell(index_, column_index, val);
+}
+
+template <typename Row>
+Row basic_row_range<Row>::iterator::operator*() const {
+	return table_->row_at(index_);
+}
+
+inline row_id row::id() const noexcept {
+	return table_->id_of(index_);
+}
+
+template <typename Row>
+auto basic_row_range<Row>::iterator::operator++() -> iterator& {
+	index_ = table_->next_row(index_ + 1);
+	return *this;
+}
+
+template <typename Row>
+std::size_t basic_row_range<Row>::size() const noexcept {
+	return table_->row_count();
+}
+
+template <typename Row>
+Row basic_row_range<Row>::at(std::size_t index) const {
+	if(index >= size()) throw std::out_of_range("Row index out of range");
+	return table_->row_at(table_->nth_row(index));
+}
+
+template <typename Row>
+Row basic_row_range<Row>::operator[](std::size_t index) const {
+	return table_->row_at(table_->nth_row(index));
+}
+
+template <typename Row>
+auto basic_row_range<Row>::begin() const -> iterator {
+	return {table_, table_->next_row(0)};
+}
+
+template <typename Row>
+auto basic_row_range<Row>::end() const -> iterator {
+	return {table_, table_->slot_count()};
+}
+
 } // namespace minidb
 
 #endif // MINIDB_TABLE_INCLUDED
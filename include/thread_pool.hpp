@@ -0,0 +1,66 @@
+#ifndef MINIDB_THREAD_POOL_INCLUDED
+#define MINIDB_THREAD_POOL_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minidb {
+
+// Fixed set of worker threads for data-parallel scans. parallel_for hands every participant an equal share of the
+// morsels (fixed-size row ranges) of a job; participants that run out of work steal morsels from the others' shares.
+class thread_pool {
+public:
+	// Called as task(begin, end, participant) for every morsel [begin, end). participant is in [0, concurrency()) and
+	// identifies the thread running the morsel, so tasks can keep per-participant state without locking.
+	using task_type = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+	// concurrency is the total number of threads working on a job, including the one calling parallel_for. Zero
+	// means one per hardware thread.
+	explicit thread_pool(std::size_t concurrency = 0);
+	~thread_pool();
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	std::size_t concurrency() const noexcept {
+		return threads_.size() + 1;
+	}
+
+	// Runs task over [0, size) split into morsels of morsel_size and returns once all morsels are done. The first
+	// exception thrown by the task is rethrown here after the job has finished. While the workers are busy with the
+	// job of another thread, the calling thread runs all morsels itself, so concurrent jobs don't wait for each other.
+	void parallel_for(std::size_t size, std::size_t morsel_size, const task_type& task);
+
+private:
+	struct alignas(64) share {
+		std::atomic<std::size_t> next{0};
+		std::size_t end = 0;
+	};
+
+	void worker_loop(std::size_t participant);
+	void run_shares(std::size_t participant);
+	void run_share(share& s, std::size_t participant);
+
+	std::vector<std::thread> threads_;
+	std::unique_ptr<share[]> shares_;
+	std::mutex job_mutex_;
+	std::mutex state_mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	const task_type* task_ = nullptr;
+	std::size_t morsel_size_ = 0;
+	std::size_t generation_ = 0;
+	std::size_t running_ = 0;
+	bool stopping_ = false;
+	std::exception_ptr error_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_THREAD_POOL_INCLUDED
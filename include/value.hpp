@@ -2,6 +2,7 @@
 #define MINIDB_VALUE_INCLUDED
 
 #include <iosfwd>
+#include <stdexcept>
 #include <string>
 #include <variant>
 
@@ -26,8 +27,8 @@ struct value_type_index<std::string> {
 };
 
 template<typename T>
-inline value to_value(T val) {
-	throw std::exception("Not valid value");
+inline value to_value(T) {
+	throw std::invalid_argument("Not valid value");
 }
 inline value to_value(long long val) {
 	return val;
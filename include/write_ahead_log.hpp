@@ -0,0 +1,120 @@
+#ifndef MINIDB_WRITE_AHEAD_LOG_INCLUDED
+#define MINIDB_WRITE_AHEAD_LOG_INCLUDED
+
+#include "column_index.hpp"
+#include "column_storage.hpp"
+#include "row_filter.hpp"
+#include "schema.hpp"
+#include "value.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace minidb {
+
+class database;
+
+// Append-only binary log of all mutating database operations. Every record is framed by its length and a CRC32, so
+// replay stops cleanly at a record that was only partially written when the process died.
+class write_ahead_log {
+public:
+	enum class sync_policy {
+		// Records are written when the buffer fills up or the log is flushed, durability is left to the OS.
+		none,
+		// Group commit: a background thread writes and fsyncs all records buffered within group_commit_interval in
+		// one go. Operations return before that, so a crash loses at most that interval of operations that returned.
+		batch,
+		// Every operation is written and fsynced before it returns.
+		always
+	};
+
+	struct options {
+		sync_policy sync = sync_policy::batch;
+		std::chrono::milliseconds group_commit_interval{10};
+		// Buffered bytes that trigger an immediate write regardless of the policy.
+		std::size_t group_commit_bytes = 1 << 20;
+	};
+
+	enum class operation : std::uint8_t {
+		create_table = 1,
+		drop_table,
+		append_row,
+		update_rows,
+		update_cell,
+		erase_row,
+		erase_rows,
+		create_index,
+		append_columns,
+		// Filtered updates and erases with arbitrary predicates. update_rows and erase_rows only hold equality
+		// conditions and are still replayed, but no longer written.
+		update_rows_where,
+		erase_rows_where,
+		// Erases that leave tombstones and explicit compactions. erase_row, erase_rows and erase_rows_where were
+		// written when erasing compacted the table right away and are replayed that way.
+		tombstone_row,
+		tombstone_rows_where,
+		compact_table
+	};
+
+	// Opens the log at path for appending, creating it if it doesn't exist.
+	write_ahead_log(const std::filesystem::path& path, options opts);
+	~write_ahead_log();
+	write_ahead_log(const write_ahead_log&) = delete;
+	write_ahead_log& operator=(const write_ahead_log&) = delete;
+
+	// Applies all intact records of the log at path to db and truncates a torn record at the end of the file.
+	// Returns the number of applied records, zero if the file doesn't exist.
+	static std::size_t replay(const std::filesystem::path& path, database& db);
+
+	void log_create_table(std::string_view name, const schema& table_schema);
+	void log_drop_table(std::string_view name);
+	void log_append_row(std::string_view table_name, const std::vector<value>& cell_values);
+	void log_append_columns(std::string_view table_name, const std::vector<column_storage::cell_vector>& columns);
+	void log_update_rows(std::string_view table_name, const row_filter& filter,
+	                     const std::unordered_map<std::string, value>& changes);
+	void log_update_rows(std::string_view table_name, const row_filter& filter,
+	                     const std::vector<std::pair<std::string, value>>& changes);
+	void log_update_cell(std::string_view table_name, std::size_t row_index, std::size_t column_index,
+	                     const value& new_value);
+	void log_erase_row(std::string_view table_name, std::size_t row_index);
+	void log_erase_rows(std::string_view table_name, const row_filter& filter);
+	void log_compact(std::string_view table_name);
+	void log_create_index(std::string_view table_name, std::string_view column_name, index_kind kind);
+
+	// Writes and fsyncs everything buffered so far.
+	void flush();
+
+private:
+	class record_writer;
+
+	void commit(const std::vector<std::uint8_t>& payload);
+	void write_out(bool sync);
+	void flusher_loop();
+
+	std::FILE* file_;
+	options options_;
+	// Guards buffer_ and the flusher state. file_mutex_ serializes writes and is always taken first.
+	std::mutex mutex_;
+	std::mutex file_mutex_;
+	std::condition_variable flush_requested_;
+	std::vector<std::uint8_t> buffer_;
+	std::vector<std::uint8_t> writing_;
+	bool stopping_ = false;
+	std::exception_ptr flush_error_;
+	std::thread flusher_;
+};
+
+} // namespace minidb
+
+#endif // MINIDB_WRITE_AHEAD_LOG_INCLUDED
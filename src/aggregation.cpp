@@ -0,0 +1,682 @@
+#include <aggregation.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sketch.hpp>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <util.hpp>
+
+namespace minidb {
+
+namespace {
+
+constexpr std::uint32_t empty_slot = std::numeric_limits<std::uint32_t>::max();
+
+// Finalizer of MurmurHash3, spreads the bits of integer keys over the whole hash.
+std::uint64_t mix(std::uint64_t h) noexcept {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+column_storage::cell_vector empty_cells(value_type type) {
+	switch(type) {
+	case value_type::integer: return std::vector<long long>{};
+	case value_type::decimal: return std::vector<double>{};
+	case value_type::string: return std::vector<std::string>{};
+	}
+	throw std::invalid_argument("Unknown value type");
+}
+
+// A group_by column. Its cells are represented by 64-bit key parts that are equal iff the cells are: integers and
+// dictionary codes as they are, decimals by their bits with all zeros and all NaNs made the same, and plain strings
+// by the index of a row holding the string.
+class key_column {
+public:
+	explicit key_column(const column_storage& column) {
+		column.visit(overloaded{[this](const column_storage::integer_data& data) {
+			                        kind_ = kind::integer;
+			                        integers_ = data.data();
+		                        },
+		                        [this](const column_storage::decimal_data& data) {
+			                        kind_ = kind::decimal;
+			                        decimals_ = data.data();
+		                        },
+		                        [this](const column_storage::string_data& data) {
+			                        kind_ = kind::string;
+			                        strings_ = &data;
+		                        },
+		                        [this](const column_storage::dictionary_data& data) {
+			                        kind_ = kind::code;
+			                        dictionary_ = &data;
+			                        codes_ = data.codes().data();
+		                        }});
+	}
+
+	std::uint64_t part(std::size_t row_index) const noexcept {
+		switch(kind_) {
+		case kind::integer: return static_cast<std::uint64_t>(integers_[row_index]);
+		case kind::decimal: {
+			const auto cell = decimals_[row_index];
+			if(cell == 0) return 0;
+			return std::bit_cast<std::uint64_t>(std::isnan(cell) ? std::numeric_limits<double>::quiet_NaN() : cell);
+		}
+		case kind::code: return codes_[row_index];
+		case kind::string: return row_index;
+		}
+		return 0;
+	}
+
+	std::uint64_t hash(std::uint64_t part) const noexcept {
+		if(kind_ == kind::string) return std::hash<std::string_view>{}((*strings_)[part]);
+		return mix(part);
+	}
+
+	bool equal(std::uint64_t lhs, std::uint64_t rhs) const noexcept {
+		return lhs == rhs || (kind_ == kind::string && (*strings_)[lhs] == (*strings_)[rhs]);
+	}
+
+	// Orders the cells, decimals with NaN last.
+	bool less(std::uint64_t lhs, std::uint64_t rhs) const {
+		switch(kind_) {
+		case kind::integer: return static_cast<long long>(lhs) < static_cast<long long>(rhs);
+		case kind::decimal: {
+			const auto left = std::bit_cast<double>(lhs);
+			const auto right = std::bit_cast<double>(rhs);
+			return !std::isnan(left) && (std::isnan(right) || left < right);
+		}
+		case kind::code:
+			return dictionary_->decode(static_cast<dictionary_column::code_type>(lhs)) <
+			       dictionary_->decode(static_cast<dictionary_column::code_type>(rhs));
+		case kind::string: return (*strings_)[lhs] < (*strings_)[rhs];
+		}
+		return false;
+	}
+
+	value cell_value(std::uint64_t part) const {
+		switch(kind_) {
+		case kind::integer: return static_cast<long long>(part);
+		case kind::decimal: return std::bit_cast<double>(part);
+		case kind::code: return dictionary_->decode(static_cast<dictionary_column::code_type>(part));
+		case kind::string: return std::string((*strings_)[part]);
+		}
+		return {};
+	}
+
+	void append_cell(std::uint64_t part, column_storage::cell_vector& cells) const {
+		switch(kind_) {
+		case kind::integer: std::get<std::vector<long long>>(cells).push_back(static_cast<long long>(part));
+			break;
+		case kind::decimal: std::get<std::vector<double>>(cells).push_back(std::bit_cast<double>(part));
+			break;
+		case kind::code:
+			std::get<std::vector<std::string>>(cells).push_back(
+					dictionary_->decode(static_cast<dictionary_column::code_type>(part)));
+			break;
+		case kind::string: std::get<std::vector<std::string>>(cells).emplace_back((*strings_)[part]);
+			break;
+		}
+	}
+
+private:
+	enum class kind { integer, decimal, code, string } kind_ = kind::integer;
+	const long long* integers_ = nullptr;
+	const double* decimals_ = nullptr;
+	const dictionary_column* dictionary_ = nullptr;
+	const dictionary_column::code_type* codes_ = nullptr;
+	const string_column* strings_ = nullptr;
+};
+
+// Open-addressing hash table (linear probing, at most half full) assigning consecutive group numbers to the keys it
+// is given. A key is an array of one part per key_column, all keys are stored back to back.
+class group_table {
+public:
+	explicit group_table(std::size_t width) : width_(width), slots_(16, empty_slot) {}
+
+	std::size_t size() const noexcept {
+		return hashes_.size();
+	}
+
+	const std::uint64_t* key(std::uint32_t group) const noexcept {
+		return keys_.data() + group * width_;
+	}
+
+	std::uint64_t hash(std::uint32_t group) const noexcept {
+		return hashes_[group];
+	}
+
+	// Returns the group of key, adding a group if there is none yet. equal(lhs, rhs) compares two keys.
+	template <typename Equal>
+	std::uint32_t find_or_add(const std::uint64_t* key, std::uint64_t hash, const Equal& equal) {
+		const auto mask = slots_.size() - 1;
+		for(auto slot = hash & mask;; slot = (slot + 1) & mask) {
+			const auto group = slots_[slot];
+			if(group == empty_slot) {
+				const auto added = static_cast<std::uint32_t>(hashes_.size());
+				slots_[slot] = added;
+				hashes_.push_back(hash);
+				keys_.insert(keys_.end(), key, key + width_);
+				if(2 * hashes_.size() > slots_.size()) grow();
+				return added;
+			}
+			if(hashes_[group] == hash && equal(this->key(group), key)) return group;
+		}
+	}
+
+private:
+	void grow() {
+		slots_.assign(2 * slots_.size(), empty_slot);
+		const auto mask = slots_.size() - 1;
+		for(std::uint32_t group = 0; group != hashes_.size(); ++group) {
+			auto slot = hashes_[group] & mask;
+			while(slots_[slot] != empty_slot) slot = (slot + 1) & mask;
+			slots_[slot] = group;
+		}
+	}
+
+	std::size_t width_;
+	std::vector<std::uint64_t> keys_;
+	std::vector<std::uint64_t> hashes_;
+	std::vector<std::uint32_t> slots_;
+};
+
+// State of one aggregation for every group of a group_table.
+class accumulator {
+public:
+	virtual ~accumulator() = default;
+	// Adds initial states up to group_count groups.
+	virtual void resize(std::size_t group_count) = 0;
+	// Folds the cell of rows[i] into the state of groups[i] for every i < count.
+	virtual void update(const std::size_t* rows, const std::uint32_t* groups, std::size_t count) = 0;
+	// Folds the state of group from of other, which aggregates the same column the same way, into group to.
+	virtual void merge(const accumulator& other, std::uint32_t from, std::uint32_t to) = 0;
+	virtual void append_result(std::uint32_t group, column_storage::cell_vector& cells) const = 0;
+};
+
+// Accumulator for the cells of a column storage alternative. Op defines the state_type and result_type, the initial
+// state(), fold(state, cell), merge(state, other_state) and result(state).
+template <typename Cells, typename Op>
+class typed_accumulator final : public accumulator {
+public:
+	explicit typed_accumulator(const Cells& cells) : cells_(cells) {}
+
+	void resize(std::size_t group_count) override {
+		states_.resize(group_count, Op::state());
+	}
+
+	void update(const std::size_t* rows, const std::uint32_t* groups, std::size_t count) override {
+		for(std::size_t i = 0; i != count; ++i) Op::fold(states_[groups[i]], cells_[rows[i]]);
+	}
+
+	void merge(const accumulator& other, std::uint32_t from, std::uint32_t to) override {
+		Op::merge(states_[to], static_cast<const typed_accumulator&>(other).states_[from]);
+	}
+
+	void append_result(std::uint32_t group, column_storage::cell_vector& cells) const override {
+		std::get<std::vector<typename Op::result_type>>(cells).push_back(Op::result(states_[group]));
+	}
+
+private:
+	const Cells& cells_;
+	std::vector<typename Op::state_type> states_;
+};
+
+// Stands in for the cells of count, which doesn't look at them.
+struct no_cells {
+	std::nullptr_t operator[](std::size_t) const noexcept {
+		return nullptr;
+	}
+};
+constexpr no_cells any_cells;
+
+struct count_op {
+	using state_type = long long;
+	using result_type = long long;
+	static long long state() noexcept {
+		return 0;
+	}
+	static void fold(long long& state, std::nullptr_t) noexcept {
+		++state;
+	}
+	static void merge(long long& state, long long other) noexcept {
+		state += other;
+	}
+	static long long result(long long state) noexcept {
+		return state;
+	}
+};
+
+template <typename T>
+struct sum_op {
+	using state_type = T;
+	using result_type = T;
+	static T state() noexcept {
+		return 0;
+	}
+	static void fold(T& state, T cell) noexcept {
+		// Integer sums wrap around instead of overflowing.
+		if constexpr(std::is_integral_v<T>) {
+			state = static_cast<T>(static_cast<std::make_unsigned_t<T>>(state) + static_cast<std::make_unsigned_t<T>>(cell));
+		} else {
+			state += cell;
+		}
+	}
+	static void merge(T& state, T other) noexcept {
+		fold(state, other);
+	}
+	static T result(T state) noexcept {
+		return state;
+	}
+};
+
+template <typename T>
+struct avg_op {
+	struct state_type {
+		double sum;
+		long long count;
+	};
+	using result_type = double;
+	static state_type state() noexcept {
+		return {0, 0};
+	}
+	static void fold(state_type& state, T cell) noexcept {
+		state.sum += static_cast<double>(cell);
+		++state.count;
+	}
+	static void merge(state_type& state, const state_type& other) noexcept {
+		state.sum += other.sum;
+		state.count += other.count;
+	}
+	static double result(const state_type& state) noexcept {
+		return state.sum / static_cast<double>(state.count);
+	}
+};
+
+// Minimum or maximum, depending on whether Better is std::less or std::greater. Strings are kept as views of the
+// table's cells and only copied for the result.
+template <typename T, typename Better>
+struct extreme_op {
+	struct state_type {
+		T cell;
+		bool empty;
+	};
+	using result_type = std::conditional_t<std::is_same_v<T, std::string_view>, std::string, T>;
+	static state_type state() noexcept {
+		return {T{}, true};
+	}
+	static void fold(state_type& state, const T& cell) noexcept {
+		if(state.empty || Better{}(cell, state.cell)) state = {cell, false};
+	}
+	static void merge(state_type& state, const state_type& other) noexcept {
+		if(!other.empty) fold(state, other.cell);
+	}
+	static result_type result(const state_type& state) {
+		return result_type(state.cell);
+	}
+};
+
+std::unique_ptr<accumulator> make_accumulator(const aggregation& aggregate, const column_storage* column) {
+	if(aggregate.function == aggregate_function::count) {
+		return std::make_unique<typed_accumulator<no_cells, count_op>>(any_cells);
+	}
+	return column->visit([&aggregate](const auto& cells) -> std::unique_ptr<accumulator> {
+		using cells_type = std::decay_t<decltype(cells)>;
+		using cell_type = std::decay_t<decltype(cells[0])>;
+		if constexpr(std::is_same_v<cell_type, std::string> || std::is_same_v<cell_type, std::string_view>) {
+			using view = std::string_view;
+			switch(aggregate.function) {
+			case aggregate_function::min:
+				return std::make_unique<typed_accumulator<cells_type, extreme_op<view, std::less<>>>>(cells);
+			case aggregate_function::max:
+				return std::make_unique<typed_accumulator<cells_type, extreme_op<view, std::greater<>>>>(cells);
+			default: throw std::invalid_argument("Can't compute the sum or average of the strings in " + aggregate.column);
+			}
+		} else {
+			switch(aggregate.function) {
+			case aggregate_function::sum: return std::make_unique<typed_accumulator<cells_type, sum_op<cell_type>>>(cells);
+			case aggregate_function::avg: return std::make_unique<typed_accumulator<cells_type, avg_op<cell_type>>>(cells);
+			case aggregate_function::min:
+				return std::make_unique<typed_accumulator<cells_type, extreme_op<cell_type, std::less<>>>>(cells);
+			case aggregate_function::max:
+				return std::make_unique<typed_accumulator<cells_type, extreme_op<cell_type, std::greater<>>>>(cells);
+			case aggregate_function::count: break;
+			}
+			throw std::invalid_argument("Unknown aggregate function");
+		}
+	});
+}
+
+const char* function_name(aggregate_function function) noexcept {
+	switch(function) {
+	case aggregate_function::count: return "count";
+	case aggregate_function::sum: return "sum";
+	case aggregate_function::min: return "min";
+	case aggregate_function::max: return "max";
+	case aggregate_function::avg: return "avg";
+	}
+	return "";
+}
+
+struct partial_aggregate {
+	group_table groups;
+	std::vector<std::unique_ptr<accumulator>> accumulators;
+	// Scratch space for the rows of a morsel and their groups.
+	std::vector<std::size_t> rows;
+	std::vector<std::uint32_t> row_groups;
+};
+
+// The smallest key part of column and the number of parts up to its largest one if counting into an array indexed by
+// the parts is cheaper than hashing them: always for dictionary codes, for integers if the range of their zones is
+// small compared to the rows every thread counts.
+std::optional<std::pair<std::uint64_t, std::size_t>> dense_range(const column_storage& column, std::size_t concurrency) {
+	if(column.is_dictionary()) return std::pair<std::uint64_t, std::size_t>{0, column.dictionary().dictionary_size()};
+	if(column.type() != value_type::integer) return std::nullopt;
+	const auto& zones = column.data<long long>().zones();
+	if(zones.empty()) return std::nullopt;
+	auto lowest = zones.front().min;
+	auto highest = zones.front().max;
+	for(const auto& z : zones) {
+		lowest = std::min(lowest, z.min);
+		highest = std::max(highest, z.max);
+	}
+	const std::size_t limit = std::max<std::size_t>(column.size() / concurrency, 1 << 16);
+	const auto width = static_cast<std::uint64_t>(highest) - static_cast<std::uint64_t>(lowest);
+	if(width >= limit) return std::nullopt;
+	return std::pair<std::uint64_t, std::size_t>{static_cast<std::uint64_t>(lowest), width + 1};
+}
+
+// Calls callback with the index of every row collect yields for [first_row, last_row), or of every row there if
+// collect is empty. rows is scratch space for the collected rows.
+template <typename Callback>
+void for_each_collected_row(const row_collector& collect, std::size_t first_row, std::size_t last_row,
+                            std::vector<std::size_t>& rows, const Callback& callback) {
+	if(!collect) {
+		for(auto row_index = first_row; row_index != last_row; ++row_index) callback(row_index);
+		return;
+	}
+	rows.clear();
+	collect(first_row, last_row, rows);
+	for(const auto row_index : rows) callback(row_index);
+}
+
+} // namespace
+
+aggregate_function parse_aggregate_function(std::string_view name) {
+	for(const auto function : {aggregate_function::count, aggregate_function::sum, aggregate_function::min,
+	                           aggregate_function::max, aggregate_function::avg}) {
+		if(name == function_name(function)) return function;
+	}
+	throw std::invalid_argument("Unknown aggregate function: " + std::string(name));
+}
+
+table aggregate_rows(const table& tab, const std::vector<std::string>& group_by,
+                     const std::vector<aggregation>& aggregations, thread_pool& pool, std::size_t morsel_rows,
+                     const row_collector& collect) {
+	if(group_by.empty() && aggregations.empty()) throw std::invalid_argument("Nothing to group by or aggregate");
+	std::vector<column> result_columns;
+	std::vector<key_column> keys;
+	for(const auto& name : group_by) {
+		const auto index = tab.get_column_index_by_name(name);
+		keys.emplace_back(tab.column_data(index));
+		result_columns.emplace_back(name, tab.get_column_type(index));
+	}
+	std::vector<const column_storage*> sources;
+	for(const auto& aggregate : aggregations) {
+		std::string name = function_name(aggregate.function);
+		if(aggregate.function == aggregate_function::count) {
+			// Every row has a cell in every column, so counting the cells of one counts the rows, if it exists.
+			if(!aggregate.column.empty()) tab.get_column_index_by_name(aggregate.column);
+			sources.push_back(nullptr);
+			result_columns.emplace_back(aggregate.column.empty() ? name : name + "(" + aggregate.column + ")",
+			                            value_type::integer);
+			continue;
+		}
+		const auto index = tab.get_column_index_by_name(aggregate.column);
+		sources.push_back(&tab.column_data(index));
+		result_columns.emplace_back(name + "(" + aggregate.column + ")", aggregate.function == aggregate_function::avg
+			                                                                 ? value_type::decimal
+			                                                                 : tab.get_column_type(index));
+	}
+
+	const auto make_partial = [&] {
+		partial_aggregate partial{group_table(keys.size()), {}, {}, {}};
+		for(std::size_t i = 0; i != aggregations.size(); ++i) {
+			partial.accumulators.push_back(make_accumulator(aggregations[i], sources[i]));
+		}
+		return partial;
+	};
+	const auto hash_of = [&keys](const std::uint64_t* key) {
+		std::uint64_t hash = 0x9e3779b97f4a7c15ULL;
+		for(std::size_t i = 0; i != keys.size(); ++i) hash = mix(hash ^ keys[i].hash(key[i]));
+		return hash;
+	};
+	const auto equal = [&keys](const std::uint64_t* lhs, const std::uint64_t* rhs) {
+		for(std::size_t i = 0; i != keys.size(); ++i) {
+			if(!keys[i].equal(lhs[i], rhs[i])) return false;
+		}
+		return true;
+	};
+	// Rejects unsupported aggregations before scanning.
+	make_partial();
+
+	std::vector<std::optional<partial_aggregate>> partials(pool.concurrency());
+	pool.parallel_for(tab.slot_count(), morsel_rows, [&](std::size_t first_row, std::size_t last_row, std::size_t thread) {
+		auto& partial = partials[thread] ? *partials[thread] : partials[thread].emplace(make_partial());
+		partial.rows.clear();
+		collect(first_row, last_row, partial.rows);
+		partial.row_groups.resize(partial.rows.size());
+		std::vector<std::uint64_t> key(keys.size());
+		for(std::size_t i = 0; i != partial.rows.size(); ++i) {
+			for(std::size_t k = 0; k != keys.size(); ++k) key[k] = keys[k].part(partial.rows[i]);
+			partial.row_groups[i] = partial.groups.find_or_add(key.data(), hash_of(key.data()), equal);
+		}
+		for(const auto& accumulator : partial.accumulators) {
+			accumulator->resize(partial.groups.size());
+			accumulator->update(partial.rows.data(), partial.row_groups.data(), partial.rows.size());
+		}
+	});
+
+	// The top bits of a group's hash pick the partition it is merged in, the bottom ones its slot there.
+	const auto partition_count = std::bit_ceil(pool.concurrency());
+	const auto partition_bits = std::countr_zero(partition_count);
+	const auto partition_of = [partition_bits](std::uint64_t hash) {
+		return partition_bits == 0 ? 0 : static_cast<std::size_t>(hash >> (64 - partition_bits));
+	};
+	std::vector<std::optional<partial_aggregate>> merged(partition_count);
+	pool.parallel_for(partition_count, 1, [&](std::size_t first, std::size_t last, std::size_t) {
+		for(auto partition = first; partition != last; ++partition) {
+			auto& target = merged[partition].emplace(make_partial());
+			for(const auto& source : partials) {
+				if(!source) continue;
+				for(std::uint32_t group = 0; group != source->groups.size(); ++group) {
+					const auto hash = source->groups.hash(group);
+					if(partition_of(hash) != partition) continue;
+					const auto into = target.groups.find_or_add(source->groups.key(group), hash, equal);
+					for(std::size_t i = 0; i != target.accumulators.size(); ++i) {
+						target.accumulators[i]->resize(target.groups.size());
+						target.accumulators[i]->merge(*source->accumulators[i], group, into);
+					}
+				}
+			}
+		}
+	});
+
+	// (partition, group) of every group in the order of their keys.
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> order;
+	for(std::uint32_t partition = 0; partition != merged.size(); ++partition) {
+		for(std::uint32_t group = 0; group != merged[partition]->groups.size(); ++group) order.emplace_back(partition, group);
+	}
+	std::sort(order.begin(), order.end(), [&](const auto& lhs, const auto& rhs) {
+		const auto* left = merged[lhs.first]->groups.key(lhs.second);
+		const auto* right = merged[rhs.first]->groups.key(rhs.second);
+		for(std::size_t i = 0; i != keys.size(); ++i) {
+			if(keys[i].less(left[i], right[i])) return true;
+			if(keys[i].less(right[i], left[i])) return false;
+		}
+		return false;
+	});
+
+	std::vector<column_storage::cell_vector> cells;
+	for(const auto& column : result_columns) cells.push_back(empty_cells(column.type()));
+	for(const auto& [partition, group] : order) {
+		const auto& source = *merged[partition];
+		for(std::size_t i = 0; i != keys.size(); ++i) keys[i].append_cell(source.groups.key(group)[i], cells[i]);
+		for(std::size_t i = 0; i != source.accumulators.size(); ++i) {
+			source.accumulators[i]->append_result(group, cells[keys.size() + i]);
+		}
+	}
+	table result(tab.name(), schema{std::move(result_columns)});
+	result.append_columns(std::move(cells));
+	return result;
+}
+
+std::map<value, std::size_t> column_histogram(const column_storage& column, thread_pool& pool, std::size_t morsel_rows,
+                                              const row_collector& collect) {
+	const key_column key(column);
+
+	// The key part and count of every distinct cell.
+	std::vector<std::pair<std::uint64_t, std::size_t>> counts;
+	// Integers counted by their offset from the smallest one come out in order.
+	bool ordered = false;
+	if(const auto dense = dense_range(column, pool.concurrency())) {
+		const auto [lowest, span] = *dense;
+		struct partial_counts {
+			std::vector<std::size_t> counts;
+			std::vector<std::size_t> rows;
+		};
+		std::vector<partial_counts> partials(pool.concurrency());
+		const auto count_cells = [&](const auto* cells) {
+			pool.parallel_for(column.size(), morsel_rows, [&](std::size_t first_row, std::size_t last_row,
+			                                                  std::size_t thread) {
+				auto& partial = partials[thread];
+				partial.counts.resize(span);
+				for_each_collected_row(collect, first_row, last_row, partial.rows, [&](std::size_t row_index) {
+					++partial.counts[static_cast<std::uint64_t>(cells[row_index]) - lowest];
+				});
+			});
+		};
+		if(column.is_dictionary()) count_cells(column.dictionary().codes().data());
+		else count_cells(column.data<long long>().data());
+		std::vector<std::size_t> totals(span);
+		pool.parallel_for(span, std::size_t{1} << 14, [&](std::size_t first, std::size_t last, std::size_t) {
+			for(const auto& partial : partials) {
+				if(partial.counts.empty()) continue;
+				for(auto index = first; index != last; ++index) totals[index] += partial.counts[index];
+			}
+		});
+		for(std::size_t index = 0; index != span; ++index) {
+			if(totals[index] != 0) counts.emplace_back(lowest + index, totals[index]);
+		}
+		ordered = !column.is_dictionary();
+	} else {
+		const auto equal = [&key](const std::uint64_t* lhs, const std::uint64_t* rhs) { return key.equal(*lhs, *rhs); };
+		struct partial_counts {
+			group_table cells{1};
+			std::vector<std::size_t> counts;
+			std::vector<std::size_t> rows;
+		};
+		std::vector<partial_counts> partials(pool.concurrency());
+		pool.parallel_for(column.size(), morsel_rows, [&](std::size_t first_row, std::size_t last_row, std::size_t thread) {
+			auto& partial = partials[thread];
+			for_each_collected_row(collect, first_row, last_row, partial.rows, [&](std::size_t row_index) {
+				const auto part = key.part(row_index);
+				const auto cell = partial.cells.find_or_add(&part, key.hash(part), equal);
+				if(cell == partial.counts.size()) partial.counts.push_back(0);
+				++partial.counts[cell];
+			});
+		});
+		// As in aggregate_rows, the top bits of the hash pick the partition a cell is merged in.
+		const auto partition_count = std::bit_ceil(pool.concurrency());
+		const auto partition_bits = std::countr_zero(partition_count);
+		std::vector<partial_counts> merged(partition_count);
+		pool.parallel_for(partition_count, 1, [&](std::size_t first, std::size_t last, std::size_t) {
+			for(auto partition = first; partition != last; ++partition) {
+				auto& target = merged[partition];
+				for(const auto& source : partials) {
+					for(std::uint32_t cell = 0; cell != source.cells.size(); ++cell) {
+						const auto hash = source.cells.hash(cell);
+						if(partition_bits != 0 && hash >> (64 - partition_bits) != partition) continue;
+						const auto into = target.cells.find_or_add(source.cells.key(cell), hash, equal);
+						if(into == target.counts.size()) target.counts.push_back(0);
+						target.counts[into] += source.counts[cell];
+					}
+				}
+			}
+		});
+		for(const auto& partition : merged) {
+			for(std::uint32_t cell = 0; cell != partition.cells.size(); ++cell) {
+				counts.emplace_back(*partition.cells.key(cell), partition.counts[cell]);
+			}
+		}
+	}
+
+	if(!ordered) {
+		std::sort(counts.begin(), counts.end(),
+		          [&key](const auto& lhs, const auto& rhs) { return key.less(lhs.first, rhs.first); });
+	}
+	std::map<value, std::size_t> rslt;
+	for(const auto& [part, count] : counts) rslt.emplace_hint(rslt.end(), key.cell_value(part), count);
+	return rslt;
+}
+
+double approx_distinct_cells(const column_storage& column, thread_pool& pool, std::size_t morsel_rows,
+                             const row_collector& collect) {
+	const key_column key(column);
+	struct partial_sketch {
+		hyperloglog cells;
+		std::vector<std::size_t> rows;
+	};
+	std::vector<std::optional<partial_sketch>> partials(pool.concurrency());
+	pool.parallel_for(column.size(), morsel_rows, [&](std::size_t first_row, std::size_t last_row, std::size_t thread) {
+		auto& partial = partials[thread] ? *partials[thread] : partials[thread].emplace();
+		for_each_collected_row(collect, first_row, last_row, partial.rows,
+		                       [&](std::size_t row_index) { partial.cells.add(key.hash(key.part(row_index))); });
+	});
+	hyperloglog merged;
+	for(const auto& partial : partials) {
+		if(partial) merged.merge(partial->cells);
+	}
+	return merged.estimate();
+}
+
+std::vector<double> approx_cell_quantiles(const column_storage& column, std::span<const double> fractions,
+                                          thread_pool& pool, std::size_t morsel_rows, const row_collector& collect) {
+	if(column.type() == value_type::string) throw std::invalid_argument("Quantiles need an integer or decimal column");
+	// Rejects invalid fractions before scanning.
+	quantile_sketch{}.quantiles(fractions);
+	struct partial_sketch {
+		quantile_sketch numbers;
+		std::vector<std::size_t> rows;
+	};
+	std::vector<std::optional<partial_sketch>> partials(pool.concurrency());
+	const auto sketch_cells = [&](const auto* cells) {
+		pool.parallel_for(column.size(), morsel_rows, [&](std::size_t first_row, std::size_t last_row,
+		                                                  std::size_t thread) {
+			auto& partial = partials[thread] ? *partials[thread]
+			                                 : partials[thread].emplace(quantile_sketch{
+					                                   quantile_sketch::default_accuracy, mix(thread + 1)});
+			for_each_collected_row(collect, first_row, last_row, partial.rows, [&](std::size_t row_index) {
+				const auto number = static_cast<double>(cells[row_index]);
+				if(!std::isnan(number)) partial.numbers.add(number);
+			});
+		});
+	};
+	if(column.type() == value_type::integer) sketch_cells(column.data<long long>().data());
+	else sketch_cells(column.data<double>().data());
+	quantile_sketch merged;
+	for(const auto& partial : partials) {
+		if(partial) merged.merge(partial->numbers);
+	}
+	return merged.quantiles(fractions);
+}
+
+} // namespace minidb
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <column_index.hpp>
+
+namespace minidb {
+
+column_index::column_index(index_kind kind, const column_storage& column) : kind_(kind) {
+	if(kind_ == index_kind::ordered) entries_ = ordered_entries{};
+	rebuild(column);
+}
+
+const column_index::row_list& column_index::lookup(const value& val) const {
+	static const row_list no_rows;
+	return std::visit(
+			[&val](const auto& entries) -> const row_list& {
+				const auto it = entries.find(val);
+				return it == entries.end() ? no_rows : it->second;
+			},
+			entries_);
+}
+
+void column_index::insert(const value& val, std::size_t row_index) {
+	std::visit(
+			[&](auto& entries) {
+				auto& rows = entries[val];
+				// Appends always carry the largest row index, so this is a push_back in the common case.
+				rows.insert(std::upper_bound(rows.begin(), rows.end(), row_index), row_index);
+			},
+			entries_);
+}
+
+void column_index::erase(const value& val, std::size_t row_index) {
+	std::visit(
+			[&](auto& entries) {
+				const auto it = entries.find(val);
+				if(it == entries.end()) return;
+				auto& rows = it->second;
+				const auto pos = std::lower_bound(rows.begin(), rows.end(), row_index);
+				if(pos != rows.end() && *pos == row_index) rows.erase(pos);
+				if(rows.empty()) entries.erase(it);
+			},
+			entries_);
+}
+
+void column_index::rebuild(const column_storage& column) {
+	std::visit(
+			[&column](auto& entries) {
+				entries.clear();
+				column.visit([&entries](const auto& data) {
+					for(std::size_t row_index = 0; row_index != data.size(); ++row_index) {
+						entries[cell_value(data[row_index])].push_back(row_index);
+					}
+				});
+			},
+			entries_);
+}
+
+} // namespace minidb
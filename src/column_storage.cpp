@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <iterator>
+#include <column_storage.hpp>
+#include <stdexcept>
+#include <util.hpp>
+#include <utility>
+
+namespace minidb {
+
+namespace {
+
+column_storage::data_type make_data(value_type type, column_encoding encoding) {
+	if(encoding == column_encoding::dictionary) {
+		if(type != value_type::string) throw std::invalid_argument("Dictionary encoding requires a string column");
+		return column_storage::dictionary_data{};
+	}
+	switch(type) {
+	case value_type::integer: return column_storage::integer_data{};
+	case value_type::decimal: return column_storage::decimal_data{};
+	case value_type::string: return column_storage::string_data{};
+	}
+	throw std::invalid_argument("Unknown column type");
+}
+
+template <typename Cells>
+void erase_masked_cells(Cells& cells, const std::vector<bool>& erase_mask) {
+	std::size_t write = 0;
+	for(std::size_t read = 0; read < cells.size(); ++read) {
+		if(erase_mask[read]) continue;
+		if(write != read) cells[write] = std::move(cells[read]);
+		++write;
+	}
+	cells.resize(write);
+}
+
+} // namespace
+
+column_storage::column_storage(value_type type, column_encoding encoding) : data_(make_data(type, encoding)) {}
+
+value column_storage::get(std::size_t index) const {
+	return std::visit([index](const auto& data) { return cell_value(data.at(index)); }, data_);
+}
+
+bool column_storage::equals(std::size_t index, const value& val) const {
+	return std::visit(
+			[index]<typename Data, typename U>(const Data& data, const U& v) {
+				if constexpr(std::is_same_v<Data, dictionary_data> && std::is_same_v<U, std::string>) {
+					return data[index] == v;
+				} else if constexpr(std::is_same_v<Data, cells_type<U>>) {
+					return data[index] == v;
+				} else {
+					return false;
+				}
+			},
+			data_, val);
+}
+
+void column_storage::reserve(std::size_t capacity) {
+	std::visit([capacity](auto& data) { data.reserve(capacity); }, data_);
+}
+
+void column_storage::push_back(value val) {
+	if(!accepts(val)) throw std::invalid_argument("Invalid type for the column when appending a cell");
+	std::visit(overloaded{[&val](dictionary_data& data) { data.push_back(std::get<std::string>(val)); },
+	                      [&val]<typename T>(numeric_column<T>& data) { data.push_back(std::get<T>(val)); },
+	                      [&val](string_data& data) { data.push_back(std::get<std::string>(val)); }},
+	           data_);
+}
+
+void column_storage::append(cell_vector cells) {
+	if(static_cast<value_type>(cells.index()) != type()) throw std::invalid_argument(
+			"Invalid type for the column when appending cells");
+	std::visit(overloaded{[](dictionary_data& data, std::vector<std::string>& new_cells) {
+		                      for(const auto& cell : new_cells) data.push_back(cell);
+	                      },
+	                      [](string_data& data, std::vector<std::string>& new_cells) {
+		                      for(const auto& cell : new_cells) data.push_back(cell);
+	                      },
+	                      []<typename T>(numeric_column<T>& data, std::vector<T>& new_cells) {
+		                      data.modify([&new_cells](std::vector<T>& cells) {
+			                      if(cells.empty()) cells = std::move(new_cells);
+			                      else cells.insert(cells.end(), new_cells.begin(), new_cells.end());
+		                      }, data.size());
+	                      },
+	                      [](auto&, auto&) {}},
+	           data_, cells);
+}
+
+void column_storage::set(std::size_t index, value val) {
+	if(!accepts(val)) throw std::invalid_argument("Invalid type at the given index when setting cell");
+	std::visit(overloaded{[index, &val](dictionary_data& data) { data.set(index, std::get<std::string>(val)); },
+	                      [index, &val]<typename T>(numeric_column<T>& data) {
+		                      data.set(index, std::get<T>(val));
+	                      },
+	                      [index, &val](string_data& data) { data.set(index, std::get<std::string>(val)); }},
+	           data_);
+}
+
+void column_storage::erase_masked(const std::vector<bool>& erase_mask) {
+	std::visit(overloaded{[&erase_mask](dictionary_data& data) { erase_masked_cells(data.mutable_codes(), erase_mask); },
+	                      [&erase_mask]<typename T>(numeric_column<T>& data) {
+		                      data.modify([&erase_mask](std::vector<T>& cells) { erase_masked_cells(cells, erase_mask); });
+	                      },
+	                      [&erase_mask](string_data& data) { data.erase_masked(erase_mask); }},
+	           data_);
+}
+
+} // namespace minidb
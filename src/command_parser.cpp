@@ -1,30 +1,133 @@
 #include <algorithm>
 #include <command_parser.hpp>
+#include <type_traits>
+#include <util.hpp>
 
 namespace minidb {
 
 using namespace std::literals;
+
+namespace {
+
+command_parser::primitive_argument_type to_owning(const command_parser::primitive_view& view) {
+	return std::visit([](const auto& v) -> command_parser::primitive_argument_type {
+		if constexpr(std::is_same_v<std::decay_t<decltype(v)>, std::string_view>) return std::string{v};
+		else return v;
+	}, view);
+}
+
+// The view of every placeholder, see is_placeholder.
+constexpr std::string_view placeholder = "?";
+
+bool is_blank(char c) noexcept {
+	return c == ' ' || c == '\t';
+}
+
+// Hand-written equivalents of string_view::find_first_of and friends. The library versions search the delimiter set
+// with a call to memchr for every character, which dominates the parsing time of short command lines.
+std::size_t find_any_of(std::string_view text, std::string_view delimiters) noexcept {
+	for(std::size_t pos = 0; pos != text.size(); ++pos) {
+		for(const char delimiter : delimiters) {
+			if(text[pos] == delimiter) return pos;
+		}
+	}
+	return std::string_view::npos;
+}
+
+std::size_t find_non_blank(std::string_view text) noexcept {
+	for(std::size_t pos = 0; pos != text.size(); ++pos) {
+		if(!is_blank(text[pos])) return pos;
+	}
+	return std::string_view::npos;
+}
+
+std::string_view trim_trailing_blanks(std::string_view text) noexcept {
+	while(!text.empty() && is_blank(text.back())) text.remove_suffix(1);
+	return text;
+}
+
+bool equals_ignoring_case(std::string_view text, std::string_view lower_case) noexcept {
+	return std::ranges::equal(text, lower_case,
+	                          [](char c, char lower) { return (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) == lower; });
+}
+
+} // namespace
+
 // Moving the string in as no caller uses the passed in string again
 std::pair<std::string, std::vector<command_parser::argument_type>>
 command_parser::parse_command(std::string&& cmd_lin) {
-	_CrtSetDbgFlag(_CRTDBG_CHECK_ALWAYS_DF);
+	parsed_command parsed;
+	parse_command(cmd_lin, parsed);
 	std::vector<argument_type> arguments;
-	auto cmd_line = std::string_view{cmd_lin};
+	arguments.reserve(parsed.arguments().size());
+	for(const auto& argument : parsed.arguments()) {
+		std::visit(overloaded{[&](const list_view& list) {
+			                      auto& owning = std::get<list_argument_type>(arguments.emplace_back(list_argument_type{}));
+			                      for(const auto& element : parsed.elements(list)) owning.push_back(to_owning(element));
+		                      },
+		                      [&](const key_value_list_view& list) {
+			                      auto& owning = std::get<key_value_list_argument_type>(
+					                      arguments.emplace_back(key_value_list_argument_type{}));
+			                      for(const auto& condition : parsed.conditions(list)) {
+				                      if(condition.op != comparison_operator::equal) throw syntax_error(
+						                      "Comparisons other than '=' are only supported when parsing into views.");
+			                      }
+			                      for(const auto& [key, val] : parsed.entries(list)) {
+				                      owning.emplace_back(std::string{key}, to_owning(val));
+			                      }
+		                      },
+		                      [](const expression_view&) {
+			                      throw syntax_error("Filter expressions are only supported when parsing into views.");
+		                      },
+		                      [](const nested_list_view&) {
+			                      throw syntax_error("Nested lists are only supported when parsing into views.");
+		                      },
+		                      [&](std::string_view text) { arguments.emplace_back(std::string{text}); },
+		                      [&](auto number) { arguments.emplace_back(number); }},
+		           argument);
+	}
+	return {std::string{parsed.command()}, std::move(arguments)};
+}
+
+void command_parser::parse_command(std::string_view cmd_line, parsed_command& result) {
+	result.arguments_.clear();
+	result.elements_.clear();
+	result.lists_.clear();
+	result.entries_.clear();
+	result.conditions_.clear();
+	result.terms_.clear();
 	consume_whitespace(cmd_line);
-	const auto command = extract_command(cmd_line);
+	result.command_ = extract_command(cmd_line);
 	consume_whitespace(cmd_line);
 	while(!cmd_line.empty()) {
 		switch(cmd_line.front()) {
-		case '[': arguments.emplace_back(extract_list(cmd_line));
+		case '[': {
+			// A list whose first element is a list is a nested list.
+			auto first_element = cmd_line.substr(1);
+			consume_whitespace(first_element);
+			if(first_element.starts_with('[')) result.arguments_.emplace_back(extract_nested_list(cmd_line, result));
+			else result.arguments_.emplace_back(extract_list(cmd_line, result.elements_));
 			break;
-		case '{': arguments.emplace_back(extract_key_value_list(cmd_line));
+		}
+		case '{': result.arguments_.emplace_back(extract_key_value_list(cmd_line, result));
 			break;
-		default: std::visit([&](auto&& val) { arguments.emplace_back(val); }, extract_primitive(cmd_line));
+		case '(': result.arguments_.emplace_back(extract_expression(cmd_line, result));
+			break;
+		default: std::visit([&](auto val) { result.arguments_.emplace_back(val); }, extract_primitive(cmd_line));
 			break;
 		}
 		consume_whitespace(cmd_line);
 	}
-	return {std::string{command}, arguments};
+}
+
+bool command_parser::is_placeholder(const primitive_view& primitive) noexcept {
+	const auto* text = std::get_if<std::string_view>(&primitive);
+	return text != nullptr && text->data() == placeholder.data();
+}
+
+bool command_parser::is_placeholder(const argument_view& argument) noexcept {
+	const auto* text = std::get_if<std::string_view>(&argument);
+	return text != nullptr && text->data() == placeholder.data();
 }
 
 void command_parser::consume_expected(std::string_view& input, const char& expected) {
@@ -38,17 +141,17 @@ void command_parser::consume_expected(std::string_view& input, const char& expec
 }
 
 void command_parser::consume_whitespace(std::string_view& input) {
-	input = input.substr(std::min(input.find_first_not_of(" \t"sv), input.size()));
+	input = input.substr(std::min(find_non_blank(input), input.size()));
 }
 
 std::string_view command_parser::extract_command(std::string_view& input) {
-	const auto separator_pos = input.find_first_of(" \t"sv);
+	const auto separator_pos = find_any_of(input, " \t"sv);
 	auto cmd = input.substr(0, separator_pos);
 	input = input.substr(std::min(separator_pos, input.size()));
 	return cmd;
 }
 
-std::string_view command_parser::extract_text(std::string_view& input, const std::string& end_delimiters) {
+std::string_view command_parser::extract_text(std::string_view& input, std::string_view end_delimiters) {
 	if(input.front() == '"') {
 		const auto end_pos = input.find('"', 1);
 		if(end_pos == std::string_view::npos) {
@@ -59,10 +162,10 @@ std::string_view command_parser::extract_text(std::string_view& input, const std
 		consume_whitespace(input);
 		return result;
 	}
-	const auto end_pos = input.find_first_of(end_delimiters);
+	const auto end_pos = find_any_of(input, end_delimiters);
 	const auto element_text = input.substr(0, end_pos);
 	input = input.substr(std::min(end_pos, input.size()));
-	return element_text.substr(0, element_text.find_last_not_of(" \t") + 1);
+	return trim_trailing_blanks(element_text);
 }
 
 std::variant<std::monostate, long long, double> command_parser::parse_number(std::string_view& text) {
@@ -113,20 +216,21 @@ std::variant<std::monostate, long long, double> command_parser::parse_number(std
 	return (negative ? -integral_part : integral_part);
 }
 
-command_parser::primitive_argument_type command_parser::extract_primitive(std::string_view& input,
-                                                                          const std::string& end_delimiters) {
+command_parser::primitive_view command_parser::extract_primitive(std::string_view& input,
+                                                                 std::string_view end_delimiters) {
 	if(input.front() == '"') {
-		return std::string{extract_text(input, end_delimiters)};
+		return extract_text(input, end_delimiters);
 	}
-	const auto end_pos = input.find_first_of(end_delimiters);
+	const auto end_pos = find_any_of(input, end_delimiters);
 	const auto element_text = input.substr(0, end_pos);
 	auto number_element_text = element_text;
 	const auto number_result = parse_number(number_element_text);
 	input = input.substr(std::min(end_pos, input.size()));
 	if(std::holds_alternative<std::monostate>(number_result) ||
-	   number_element_text.find_first_not_of(" \t") != std::string_view::npos) {
+	   find_non_blank(number_element_text) != std::string_view::npos) {
 		// Couldn't parse element_text completely as number. Pass it as text instead.
-		return std::string{element_text.substr(0, element_text.find_last_not_of(" \t") + 1)};
+		const auto text = trim_trailing_blanks(element_text);
+		return text == placeholder ? placeholder : text;
 	}
 	if(std::holds_alternative<long long>(number_result)) {
 		return std::get<long long>(number_result);
@@ -134,8 +238,9 @@ command_parser::primitive_argument_type command_parser::extract_primitive(std::s
 	return std::get<double>(number_result);
 }
 
-std::vector<command_parser::primitive_argument_type> command_parser::extract_list(std::string_view& input) {
-	std::vector<primitive_argument_type> result;
+command_parser::list_view command_parser::extract_list(std::string_view& input,
+                                                       std::vector<primitive_view>& elements) {
+	list_view result{elements.size(), 0};
 	consume_expected(input, '[');
 	consume_whitespace(input);
 	bool first = true;
@@ -146,16 +251,87 @@ std::vector<command_parser::primitive_argument_type> command_parser::extract_lis
 		} else {
 			first = false;
 		}
-		result.push_back(extract_primitive(input, ",]"));
+		elements.push_back(extract_primitive(input, ",]"));
+		++result.count;
 		consume_whitespace(input);
 	}
 	consume_expected(input, ']');
 	return result;
 }
 
-std::vector<std::pair<std::string, command_parser::primitive_argument_type>>
-command_parser::extract_key_value_list(std::string_view& input) {
-	std::vector<std::pair<std::string, primitive_argument_type>> result;
+command_parser::nested_list_view command_parser::extract_nested_list(std::string_view& input,
+                                                                     parsed_command& result) {
+	nested_list_view list{result.lists_.size(), 0};
+	consume_expected(input, '[');
+	consume_whitespace(input);
+	bool first = true;
+	while(!input.empty() && input.front() != ']' && (first || input.front() == ',')) {
+		if(!first) {
+			consume_expected(input, ',');
+			consume_whitespace(input);
+		} else {
+			first = false;
+		}
+		result.lists_.push_back(extract_list(input, result.elements_));
+		++list.count;
+		consume_whitespace(input);
+	}
+	consume_expected(input, ']');
+	return list;
+}
+
+command_parser::comparison_operator command_parser::extract_comparison(std::string_view& input,
+                                                                       std::string_view& key) {
+	constexpr std::pair<std::string_view, comparison_operator> keywords[] = {
+			{"between", comparison_operator::between}, {"in", comparison_operator::in}};
+	constexpr std::pair<std::string_view, comparison_operator> symbols[] = {
+			{"!=", comparison_operator::not_equal}, {"<=", comparison_operator::less_equal},
+			{">=", comparison_operator::greater_equal}, {"<", comparison_operator::less},
+			{">", comparison_operator::greater}, {"=", comparison_operator::equal}};
+	for(const auto& [symbol, op] : symbols) {
+		if(input.starts_with(symbol)) {
+			input.remove_prefix(symbol.size());
+			return op;
+		}
+	}
+	std::string_view keyword;
+	if(!input.empty() && input.front() == '[') {
+		// An unquoted key runs up to the list, so a keyword operator ends up as its last word.
+		std::size_t blank = key.size();
+		while(blank != 0 && !is_blank(key[blank - 1])) --blank;
+		keyword = key.substr(blank);
+		key = trim_trailing_blanks(key.substr(0, blank));
+	} else if(!input.empty()) {
+		keyword = extract_text(input, " \t[");
+		consume_whitespace(input);
+	}
+	for(const auto& [word, op] : keywords) {
+		if(!key.empty() && equals_ignoring_case(keyword, word)) return op;
+	}
+	throw syntax_error("Expected a comparison operator after the key.", input);
+}
+
+void command_parser::extract_condition(std::string_view& input, parsed_command& result,
+                                       std::string_view key_delimiters, std::string_view value_delimiters) {
+	auto key = extract_text(input, key_delimiters);
+	consume_whitespace(input);
+	const auto op = extract_comparison(input, key);
+	consume_whitespace(input);
+	if(op == comparison_operator::between || op == comparison_operator::in) {
+		const auto operands = extract_list(input, result.elements_);
+		if(op == comparison_operator::between && operands.count != 2) throw syntax_error(
+				"between takes a list of the lower and the upper bound.", input);
+		result.entries_.emplace_back(key, std::string_view{});
+		result.conditions_.push_back({op, operands});
+	} else {
+		result.entries_.emplace_back(key, extract_primitive(input, value_delimiters));
+		result.conditions_.push_back({op, {}});
+	}
+}
+
+command_parser::key_value_list_view command_parser::extract_key_value_list(std::string_view& input,
+                                                                          parsed_command& result) {
+	key_value_list_view list{result.entries_.size(), 0};
 	consume_expected(input, '{');
 	consume_whitespace(input);
 	bool first = true;
@@ -166,15 +342,70 @@ command_parser::extract_key_value_list(std::string_view& input) {
 		} else {
 			first = false;
 		}
-		auto key = extract_text(input, "=");
-		consume_expected(input, '=');
-		consume_whitespace(input);
-		auto value = extract_primitive(input, ",}");
-		result.emplace_back(key, value);
+		extract_condition(input, result, "=!<>[,}", ",}");
+		++list.count;
 		consume_whitespace(input);
 	}
 	consume_expected(input, '}');
-	return result;
+	return list;
+}
+
+bool command_parser::consume_keyword(std::string_view& input, std::string_view keyword) {
+	// Symbolic keywords stand on their own, words only if they aren't the start of a longer word.
+	const bool symbolic = keyword.front() < 'a' || keyword.front() > 'z';
+	if(input.size() < keyword.size() || !equals_ignoring_case(input.substr(0, keyword.size()), keyword)) return false;
+	if(!symbolic && input.size() > keyword.size() && !is_blank(input[keyword.size()]) && input[keyword.size()] != '(') {
+		return false;
+	}
+	input.remove_prefix(keyword.size());
+	consume_whitespace(input);
+	return true;
+}
+
+void command_parser::extract_disjunction(std::string_view& input, parsed_command& result) {
+	extract_conjunction(input, result);
+	while(consume_keyword(input, "or") || consume_keyword(input, "||")) {
+		extract_conjunction(input, result);
+		result.terms_.push_back({term_kind::disjunction, 0});
+	}
+}
+
+void command_parser::extract_conjunction(std::string_view& input, parsed_command& result) {
+	extract_negation(input, result);
+	while(consume_keyword(input, "and") || consume_keyword(input, "&&") || consume_keyword(input, ",")) {
+		extract_negation(input, result);
+		result.terms_.push_back({term_kind::conjunction, 0});
+	}
+}
+
+void command_parser::extract_negation(std::string_view& input, parsed_command& result) {
+	if(consume_keyword(input, "not") || (input.starts_with('!') && !input.starts_with("!=") &&
+	                                     consume_keyword(input, "!"))) {
+		extract_negation(input, result);
+		result.terms_.push_back({term_kind::negation, 0});
+	} else if(!input.empty() && input.front() == '(') {
+		consume_expected(input, '(');
+		consume_whitespace(input);
+		extract_disjunction(input, result);
+		consume_expected(input, ')');
+		consume_whitespace(input);
+	} else {
+		if(input.empty() || find_any_of(input.substr(0, 1), "=!<>[(),") == 0) throw syntax_error(
+				"Expected a condition in the filter expression.", input);
+		result.terms_.push_back({term_kind::condition, result.entries_.size()});
+		extract_condition(input, result, "=!<>[ \t(),", " \t,)");
+		consume_whitespace(input);
+	}
+}
+
+command_parser::expression_view command_parser::extract_expression(std::string_view& input,
+                                                                   parsed_command& result) {
+	const auto first = result.terms_.size();
+	consume_expected(input, '(');
+	consume_whitespace(input);
+	extract_disjunction(input, result);
+	consume_expected(input, ')');
+	return {first, result.terms_.size() - first};
 }
 
 } // namespace minidb
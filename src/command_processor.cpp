@@ -1,28 +1,64 @@
 #include "database.hpp"
+#include "result_writer.hpp"
 #include "util.hpp"
 #include <algorithm>
 #include <command_processor.hpp>
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include <ostream>
 #include <string>
 
 namespace minidb {
 
+namespace {
+
+row_filter::comparison to_comparison(command_parser::comparison_operator op) {
+	using parsed = command_parser::comparison_operator;
+	using comparison = row_filter::comparison;
+	switch(op) {
+	case parsed::equal: return comparison::equal;
+	case parsed::not_equal: return comparison::not_equal;
+	case parsed::less: return comparison::less;
+	case parsed::less_equal: return comparison::less_equal;
+	case parsed::greater: return comparison::greater;
+	case parsed::greater_equal: return comparison::greater_equal;
+	case parsed::between: return comparison::between;
+	case parsed::in: return comparison::in;
+	}
+	throw std::invalid_argument("Unknown comparison");
+}
+
+} // namespace
+
 command_processor::command_processor(database& db)
 	: db(db) {
-	using args_t = std::vector<command_parser::argument_type>;
 	using namespace std::literals;
 
 	callback_structure.emplace("create_table"s, &command_processor::execute_create_table);
 	callback_structure.emplace("drop_table"s, &command_processor::execute_drop_table);
 	callback_structure.emplace("append_row"s, &command_processor::execute_append_row);
+	callback_structure.emplace("append_rows"s, &command_processor::execute_append_rows);
 	callback_structure.emplace("update_rows"s, &command_processor::execute_update_rows);
 	callback_structure.emplace("update_cell"s, &command_processor::execute_update_cell);
+	callback_structure.emplace("update_cell_by_id"s, &command_processor::execute_update_cell_by_id);
 	callback_structure.emplace("query_table"s, &command_processor::execute_query_table);
 	callback_structure.emplace("query_column_histogram"s, &command_processor::execute_query_column_histogram);
 	callback_structure.emplace("erase_row"s, &command_processor::execute_erase_row);
+	callback_structure.emplace("erase_row_by_id"s, &command_processor::execute_erase_row_by_id);
+	callback_structure.emplace("row_ids"s, &command_processor::execute_row_ids);
 	callback_structure.emplace("erase_rows"s, &command_processor::execute_erase_rows);
+	callback_structure.emplace("compact"s, &command_processor::execute_compact);
+	callback_structure.emplace("create_index"s, &command_processor::execute_create_index);
+	callback_structure.emplace("save"s, &command_processor::execute_save);
+	callback_structure.emplace("load"s, &command_processor::execute_load);
+	callback_structure.emplace("load_csv"s, &command_processor::execute_load_csv);
+	callback_structure.emplace("aggregate"s, &command_processor::execute_aggregate);
+	callback_structure.emplace("approx_distinct"s, &command_processor::execute_approx_distinct);
+	callback_structure.emplace("approx_quantiles"s, &command_processor::execute_approx_quantiles);
+	callback_structure.emplace("set_output_format"s, &command_processor::execute_set_output_format);
+	callback_structure.emplace("result_cache_statistics"s, &command_processor::execute_result_cache_statistics);
+	callback_structure.emplace("execute"s, &command_processor::execute_prepared);
 }
 
 void command_processor::execute_help(std::ostream& output) {
@@ -32,10 +68,13 @@ help: Display this help text.
 exit: Exit the CLI.
 create_table <table name> {<column name 0>=<column type 0>,<column name 1>=<column type 1>,...}:
 		Create a table with the given schema and name.
-		The valid column types are: integer, decimal, string
+		The valid column types are: integer, decimal, string, dictionary
+		A dictionary column holds strings and stores each distinct string only once, which suits low-cardinality data.
 drop_table <table name>: Drop the named table.
 append_row <table name> [<row value for column 0>,<row value for column 1>,...]:
 		Append a row with the given values to the named table.
+append_rows <table name> [[<row 0 value for column 0>,<row 0 value for column 1>,...],[<row 1 value for column 0>,...],...]:
+		Append all given rows to the named table at once. If any row doesn't match the table, none is appended.
 update_rows <table name> {<filter column name 0>=<filter column value 0>,<filter column name 1>=<filter column value 1>,...} {<update column name 0>=<update column value 0>,<update column name 1>=<update column value 1>,...}:
 		Update all rows in the named table that match the given filter to set the values for the given update columns to their corresponding new value.
 		The filter and the update component name columns and corresponding values.
@@ -45,6 +84,8 @@ update_rows <table name> {<filter column name 0>=<filter column value 0>,<filter
 			This updates all rows with "test" in their "foo" column cell and 42 in their "bar" column cell to have "test test" in their "foo" column cell.
 update_cell <table name> <row index> <column index> <new value>:
 		Update the cell for the column with the given index (starting at 0) in the row with the given index (starting at 0) of the named table to the given value.
+update_cell_by_id <table name> <row id> <column index> <new value>:
+		Like update_cell, but for the row with the given ID. Every row gets an ID when it is appended, which never changes, unlike its index.
 query_table <table name> {<filter column name 0>=<filter column value 0>,<filter column name 1>=<filter column value 1>,...}:
 		Display all rows in the named table that match the given row filter.
 		The filter is optional. If it is ommitted, all rows are displayed.
@@ -54,56 +95,169 @@ query_column_histogram <table name> <column name> {<filter column name 0>=<filte
 		The filter is optional. If it is ommitted, all rows are included in the histogram.
 		A row matches the filter if the cell for each column named in the filter has a value equal to the value given in the filter.
 erase_row <table name> <row index>: Delete the row with the given index (starting at 0) from the named table.
+		Deleted rows are only marked, the other rows keep their index until the table is compacted.
+erase_row_by_id <table name> <row id>: Delete the row with the given ID from the named table.
+row_ids <table name> {<filter>}:
+		Display the IDs of the rows in the named table that match the filter, one per line. The filter is optional.
 erase_rows <table name> {<filter column name 0>=<filter column value 0>,<filter column name 1>=<filter column value 1>,...}:
 		Delete all rows from the named table that match the given filter.
 		The filter names columns and corresponding values.
 		A row matches the filter if the cell for each column named in the filter has a value equal to the value given in the filter.
+compact <table name>: Reclaim the space of the deleted rows of the named table and renumber the remaining rows.
+		Tables are only compacted by this command, unless --compact-at sets a share of deleted rows that compacts them automatically.
+create_index <table name> <column name> [hash|ordered]:
+		Create a secondary index on the named column of the named table. The index kind defaults to hash.
+		Row filters on an indexed column only check the rows the index yields instead of scanning the whole table.
+save <file>: Write all tables, including their indexes, to a binary snapshot file.
+load <file>: Replace all tables by the ones in the given snapshot file.
+		Integer and decimal columns are read directly from the file, so even large snapshots load quickly.
+load_csv <table name> <file> {header=<true|false>,delimiter=<character>,quote=<character>,batch_rows=<count>}:
+		Append all records of the given CSV file to the named table. Each field is parsed as the type of its column.
+		The options are optional. By default the file has no header line, fields are separated by , and quoted by ".
+		Use delimiter=tab for tab-separated files.
+aggregate <table name> {group_by=<column name 0>,group_by=<column name 1>,...} {<function 0>=<column name 0>,<function 1>=<column name 1>,...} {<filter>}:
+		Group the rows of the named table that match the filter by their values in the group_by columns and display one row per group,
+		ordered by the group_by values, with the group_by values followed by the results of the aggregate functions.
+		The functions are count, sum, min, max and avg. count=* counts the rows of a group. Without group_by columns all rows form one group.
+		The filter is optional.
+		Example: aggregate sales {group_by=region} {sum=amount, avg=price, count=*} {year>=2020}
+approx_distinct <table name> <column name> {<filter>}:
+		Estimate the number of distinct values in the named column of the rows in the named table that match the filter.
+		Uses a HyperLogLog sketch, so it takes a single pass with little memory, and is usually within 2% of the exact count.
+		The filter is optional.
+approx_quantiles <table name> <column name> [<quantile 0>,<quantile 1>,...] {<filter>}:
+		Estimate the values of the named integer or decimal column at the given quantiles, between 0 and 1, in the rows that match the filter.
+		Displays each quantile followed by its value. Uses a KLL sketch, the rank of each value is usually within 1% of the rows from the exact one.
+		The filter is optional.
+		Example: approx_quantiles sales price [0.5, 0.9, 0.99]
+set_output_format <text|tsv|csv|json>:
+		Select how query_table and aggregate display rows. text separates cells by blanks, tsv and csv start with a line of column names
+		and json writes one object per row.
+prepare <statement name> <command>:
+		Prepare an append_row, query_table, query_column_histogram, update_rows or erase_rows command to be executed many times.
+		An unquoted ? in place of a value is a parameter, which gets its value when the statement is executed. The table, the columns
+		and the filter are resolved once, so executing the statement skips parsing and checking the command. Preparing a name again replaces the statement.
+		Example: prepare in_category query_table tab {category=?, price<?}
+execute <statement name> <parameter value 0> <parameter value 1> ...:
+		Execute the prepared statement with the given values for its parameters, in the order they appear in the statement.
+		Example: execute in_category books 20
+result_cache_statistics:
+		Display the hits, misses and evictions of the result cache and the number and estimated size in bytes of the results it holds.
+		The cache keeps the results of filtered query_table and query_column_histogram commands until their table changes, see --result-cache.
+
+Filters may compare a column with other operators than =:
+		<column>!=<value>, <column><<value>, <column><=<value>, <column>><value>, <column>>=<value>
+		<column> between [<lower>, <upper>]: the cell lies between the two bounds, inclusively.
+		<column> in [<value 0>, <value 1>, ...]: the cell equals one of the values.
+		A row matches the filter if its cells satisfy all comparisons. Integers and decimals are compared numerically, so 5 equals 5.0.
+		Example: query_table tab {price>=10, price<20, category in [books, music]}
+Instead of {...} a filter may be an expression in parentheses that combines comparisons with and, or, not and nested parentheses:
+		and binds tighter than or, the symbols &&, || and ! may be used instead of the words.
+		Example: query_table tab (price<10 or (category in [books, music] and not author=anonymous))
 )";
 }
 
-void command_processor::execute(std::string command_line, std::ostream& output) {
-	using namespace std::literals;
-	auto [command, arguments] = command_parser::parse_command(std::move(command_line));
+void command_processor::execute(std::string_view command_line, std::ostream& output) {
+	command_parser::parse_command(command_line, parsed);
+	const auto command = parsed.command();
 
 	if(command == "help") {
 		execute_help(output);
 	} else if(command == "exit") {
 		this->exit = true;
+	} else if(command == "prepare") {
+		execute_prepare(command_line, output);
+	} else if(const auto it = callback_structure.find(command); it != callback_structure.end()) {
+		(this->*it->second)(parsed.arguments(), output);
 	} else {
-		(this->*callback_structure[command])(arguments, output);
+		throw std::invalid_argument("Unknown command " + std::string(command));
 	}
 }
 
+std::span<const command_parser::key_value_view>
+command_processor::get_key_value_list(const command_parser::argument_view& arg) const {
+	const auto& list = get_from_argument<command_parser::key_value_list_view>(arg);
+	for(const auto& condition : parsed.conditions(list)) {
+		if(condition.op != command_parser::comparison_operator::equal) throw std::invalid_argument(
+				"Expected key=value pairs");
+	}
+	return parsed.entries(list);
+}
 
-void command_processor::execute_create_table(const std::vector<command_parser::argument_type>& arguments,
+row_filter command_processor::get_filter(const command_parser::argument_view& arg,
+                                         std::vector<prepared_statement::parameter>* parameters) const {
+	const auto to_predicate = [this, parameters](const command_parser::key_value_view& entry,
+	                                             const command_parser::condition_view& condition, std::size_t term) {
+		using op = command_parser::comparison_operator;
+		row_filter::predicate predicate{std::string(entry.first), to_comparison(condition.op), {}};
+		const auto add_operand = [&](const command_parser::primitive_view& operand) {
+			if(parameters != nullptr && command_parser::is_placeholder(operand)) {
+				parameters->push_back({prepared_statement::parameter::target::filter_operand, term,
+				                       predicate.operands.size()});
+			}
+			predicate.operands.push_back(get_value_from_argument(operand));
+		};
+		if(condition.op == op::between || condition.op == op::in) {
+			for(const auto& operand : parsed.elements(condition.operands)) add_operand(operand);
+		} else {
+			add_operand(entry.second);
+		}
+		return predicate;
+	};
+	if(const auto* expression = std::get_if<command_parser::expression_view>(&arg)) {
+		std::vector<row_filter::term> terms;
+		for(const auto& term : parsed.terms(*expression)) {
+			using kind = command_parser::term_kind;
+			switch(term.kind) {
+			case kind::condition:
+				terms.emplace_back(to_predicate(parsed.entry(term), parsed.condition(term), terms.size()));
+				break;
+			case kind::conjunction: terms.emplace_back(row_filter::connective::conjunction); break;
+			case kind::disjunction: terms.emplace_back(row_filter::connective::disjunction); break;
+			case kind::negation: terms.emplace_back(row_filter::connective::negation); break;
+			}
+		}
+		return row_filter{std::move(terms)};
+	}
+	const auto& list = get_from_argument<command_parser::key_value_list_view>(arg);
+	const auto entries = parsed.entries(list);
+	const auto conditions = parsed.conditions(list);
+	std::vector<row_filter::predicate> predicates;
+	predicates.reserve(entries.size());
+	for(std::size_t i = 0; i != entries.size(); ++i) predicates.push_back(to_predicate(entries[i], conditions[i], i));
+	return row_filter{std::move(predicates)};
+}
+
+void command_processor::execute_create_table(const arguments_type& arguments,
                                              std::ostream& output) {
 	if(arguments.size() == 2) {
-		const auto& argVec = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(1));
-
 		std::vector<column> columns;
-		for(const std::pair<command_parser::string_argument_type, command_parser::primitive_argument_type>& pair :
-		    argVec) {
+		for(const auto& pair : get_key_value_list(arguments[1])) {
 
-			const auto& v = get_from_argument<std::string>(pair.second);
+			const auto& v = get_from_argument<std::string_view>(pair.second);
 			value_type secArgs;
+			auto encoding = column_encoding::plain;
 			if(v == "integer") secArgs = value_type_index<command_parser::integer_argument_type>::value;
 			else if(v == "decimal") secArgs = value_type_index<command_parser::decimal_argument_type>::value;
 			else if(v == "string") secArgs = value_type_index<command_parser::string_argument_type>::value;
-			else throw std::invalid_argument("Type not valid");
-			columns.emplace_back(column{pair.first, secArgs});
+			else if(v == "dictionary") {
+				secArgs = value_type_index<command_parser::string_argument_type>::value;
+				encoding = column_encoding::dictionary;
+			} else throw std::invalid_argument("Type not valid");
+			columns.emplace_back(column{std::string(pair.first), secArgs, encoding});
 		}
 
-		db.create_table(get_from_argument<std::string>(arguments.at(0)), schema{columns});
+		db.create_table(get_from_argument<std::string_view>(arguments[0]), schema{columns});
 	} else {
 		throw std::invalid_argument("Arguments don't match specified pattern");
 	}
 	MAYBE_UNUSED(output);
 }
 
-void command_processor::execute_drop_table(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_drop_table(const arguments_type& arguments,
                                            std::ostream& output) {
 	if(arguments.size() == 1) {
-		const auto& name = get_from_argument<std::string>(arguments.at(0));
+		const auto& name = get_from_argument<std::string_view>(arguments[0]);
 		db.drop_table(name);
 		output << "Table names " << name << "dropped";
 	} else {
@@ -112,29 +266,48 @@ void command_processor::execute_drop_table(const std::vector<command_parser::arg
 
 }
 
-void command_processor::execute_append_row(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_append_row(const arguments_type& arguments,
                                            std::ostream& output) {
 	if(arguments.size() == 2) {
-		db.append_row(
-				get_from_argument<std::string>(arguments.at(0)),
-				get_from_argument<std::vector<value>>(arguments.at(1))
-				);
+		std::vector<value> cells;
+		const auto elements = get_list(arguments[1]);
+		cells.reserve(elements.size());
+		for(const auto& element : elements) cells.push_back(get_value_from_argument(element));
+		db.append_row(get_from_argument<std::string_view>(arguments[0]), std::move(cells));
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+	MAYBE_UNUSED(output);
+}
+
+void command_processor::execute_append_rows(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 2) {
+		const auto lists = parsed.lists(get_from_argument<command_parser::nested_list_view>(arguments[1]));
+		std::vector<std::vector<value>> rows(lists.size());
+		for(std::size_t index = 0; index != lists.size(); ++index) {
+			const auto elements = parsed.elements(lists[index]);
+			rows[index].reserve(elements.size());
+			for(const auto& element : elements) rows[index].push_back(get_value_from_argument(element));
+		}
+		db.append_rows(get_from_argument<std::string_view>(arguments[0]), rows);
 	} else {
 		throw std::invalid_argument("Arguments don't match specified pattern");
 	}
 	MAYBE_UNUSED(output);
 }
 
-void command_processor::execute_update_rows(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_update_rows(const arguments_type& arguments,
                                             std::ostream& output) {
 	if(arguments.size() == 3) {
-		const auto& filterPairs = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(1));
-		const auto& changes = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(2));
+		std::unordered_map<std::string, value> changes;
+		for(const auto& [column, new_value] : get_key_value_list(arguments[2])) {
+			changes.emplace(column, get_value_from_argument(new_value));
+		}
 		db.update_rows
 				(
-						get_from_argument<std::string>(arguments.at(0)),
-						row_filter{filterPairs.begin(), filterPairs.end()},
-						std::unordered_map{changes.begin(), changes.end()}
+						get_from_argument<std::string_view>(arguments[0]),
+						get_filter(arguments[1]),
+						std::move(changes)
 						);
 		output << "Updated rows";
 	} else {
@@ -142,15 +315,15 @@ void command_processor::execute_update_rows(const std::vector<command_parser::ar
 	}
 }
 
-void command_processor::execute_update_cell(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_update_cell(const arguments_type& arguments,
                                             std::ostream& output) {
 	if(arguments.size() == 4) {
 		db.update_cell
 				(
-						get_from_argument<std::string>(arguments.at(0)),
-						get_from_argument<long long>(arguments.at(1)),
-						get_from_argument<long long>(arguments.at(2)),
-						get_value_from_argument(arguments.at(3))
+						get_from_argument<std::string_view>(arguments[0]),
+						get_from_argument<long long>(arguments[1]),
+						get_from_argument<long long>(arguments[2]),
+						get_value_from_argument(arguments[3])
 						);
 		output << "Updated cell";
 	} else {
@@ -158,28 +331,30 @@ void command_processor::execute_update_cell(const std::vector<command_parser::ar
 	}
 }
 
-void command_processor::execute_query_table(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_update_cell_by_id(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 4) {
+		db.update_cell_by_id(get_from_argument<std::string_view>(arguments[0]),
+		                     static_cast<row_id>(get_from_argument<long long>(arguments[1])),
+		                     get_from_argument<long long>(arguments[2]), get_value_from_argument(arguments[3]));
+		output << "Updated cell";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_query_table(const arguments_type& arguments,
                                             std::ostream& output) {
 	if(arguments.size() == 1 || arguments.size() == 2) {
-		const auto& callback = [&output](const row& row)
-		{
-			output << row << '\n';
-		};
-		if(arguments.size() == 2) {
-			const auto& filterPairs = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(1));
-			db.query_table
-					(
-							get_from_argument<std::string>(arguments.at(0)),
-							row_filter{filterPairs.begin(), filterPairs.end()},
-							callback
-							);
-			return;
-		}
-		db.query_table
-				(
-						get_from_argument<std::string>(arguments.at(0)),
-						callback
-						);
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		std::optional<row_filter> filter;
+		if(arguments.size() == 2) filter = get_filter(arguments[1]);
+		// The writer reads the rows in the context of the table the query has locked.
+		std::optional<result_writer> writer;
+		const auto open_writer = [&](const table& tab) { writer.emplace(output, result_format, tab); };
+		const auto write_row = [&writer](const row& row) { writer->write_row(row); };
+		if(filter) db.query_table(table_name, *filter, write_row, open_writer);
+		else db.query_table(table_name, write_row, open_writer);
+		writer->flush();
 
 	} else {
 		throw std::invalid_argument("Arguments don't match specified pattern");
@@ -187,37 +362,97 @@ void command_processor::execute_query_table(const std::vector<command_parser::ar
 }
 
 void command_processor::execute_query_column_histogram(
-		const std::vector<command_parser::argument_type>& arguments,
+		const arguments_type& arguments,
 		std::ostream& output) {
 	if(arguments.size() == 2 || arguments.size() == 3) {
-		std::map<value, size_t> rslt;
+		std::shared_ptr<const result_cache::histogram> rslt;
 		if(arguments.size() == 3) {
-			const auto& filterPairs = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(2));
-			rslt = db.query_column_histogram
+			rslt = db.shared_column_histogram
 					(
-							get_from_argument<std::string>(arguments.at(0)),
-							get_from_argument<std::string>(arguments.at(1)),
-							row_filter{filterPairs.begin(), filterPairs.end()}
+							get_from_argument<std::string_view>(arguments[0]),
+							get_from_argument<std::string_view>(arguments[1]),
+							get_filter(arguments[2])
 							);
 		} else {
-			rslt = db.query_column_histogram
+			rslt = db.shared_column_histogram
 					(
-							get_from_argument<std::string>(arguments.at(0)),
-							get_from_argument<std::string>(arguments.at(1))
+							get_from_argument<std::string_view>(arguments[0]),
+							get_from_argument<std::string_view>(arguments[1])
 							);
 		}
-		for(const auto& p : rslt) output << p.first << " " << p.second << '\n';
+		for(const auto& p : *rslt) output << p.first << " " << p.second << '\n';
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_aggregate(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 3 || arguments.size() == 4) {
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		std::vector<std::string> group_by;
+		for(const auto& [key, column] : get_key_value_list(arguments[1])) {
+			if(key != "group_by") throw std::invalid_argument("Expected group_by=<column> entries");
+			group_by.emplace_back(get_from_argument<std::string_view>(column));
+		}
+		std::vector<aggregation> aggregations;
+		for(const auto& [function, column] : get_key_value_list(arguments[2])) {
+			auto& aggregate = aggregations.emplace_back(
+					aggregation{parse_aggregate_function(function), std::string(get_from_argument<std::string_view>(column))});
+			if(aggregate.function == aggregate_function::count && aggregate.column == "*") aggregate.column.clear();
+		}
+		const auto result = arguments.size() == 4
+			                    ? db.aggregate(table_name, group_by, aggregations, get_filter(arguments[3]))
+			                    : db.aggregate(table_name, group_by, aggregations);
+		result_writer writer(output, result_format, result);
+		for(const auto& row : result.rows()) writer.write_row(row);
+		writer.flush();
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_approx_distinct(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 2 || arguments.size() == 3) {
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		const auto column_name = get_from_argument<std::string_view>(arguments[1]);
+		output << (arguments.size() == 3 ? db.approx_distinct(table_name, column_name, get_filter(arguments[2]))
+		                                 : db.approx_distinct(table_name, column_name))
+		       << '\n';
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_approx_quantiles(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 3 || arguments.size() == 4) {
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		const auto column_name = get_from_argument<std::string_view>(arguments[1]);
+		std::vector<double> fractions;
+		for(const auto& element : get_list(arguments[2])) {
+			fractions.push_back(std::visit(overloaded{[](long long number) { return static_cast<double>(number); },
+			                                          [](double number) { return number; },
+			                                          [](std::string_view) -> double {
+				                                          throw std::invalid_argument("Quantiles must be numbers");
+			                                          }},
+			                               element));
+		}
+		const auto values = arguments.size() == 4
+			                    ? db.approx_quantiles(table_name, column_name, fractions, get_filter(arguments[3]))
+			                    : db.approx_quantiles(table_name, column_name, fractions);
+		for(std::size_t index = 0; index != fractions.size(); ++index) {
+			output << fractions[index] << " " << values[index] << '\n';
+		}
 	} else {
 		throw std::invalid_argument("Arguments don't match specified pattern");
 	}
 }
 
-void command_processor::execute_erase_row(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_erase_row(const arguments_type& arguments,
                                           std::ostream& output) {
 	if(arguments.size() == 2) {
 		db.erase_row(
-				get_from_argument<std::string>(arguments.at(0)),
-				get_from_argument<long long>(arguments.at(1))
+				get_from_argument<std::string_view>(arguments[0]),
+				get_from_argument<long long>(arguments[1])
 				);
 		output << "Erased row";
 	} else {
@@ -225,18 +460,247 @@ void command_processor::execute_erase_row(const std::vector<command_parser::argu
 	}
 }
 
-void command_processor::execute_erase_rows(const std::vector<command_parser::argument_type>& arguments,
+void command_processor::execute_erase_row_by_id(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 2) {
+		db.erase_row_by_id(get_from_argument<std::string_view>(arguments[0]),
+		                   static_cast<row_id>(get_from_argument<long long>(arguments[1])));
+		output << "Erased row";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_row_ids(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 1 || arguments.size() == 2) {
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		const auto write_id = [&output](const row& row) { output << row.id() << '\n'; };
+		if(arguments.size() == 2) db.query_table(table_name, get_filter(arguments[1]), write_id);
+		else db.query_table(table_name, write_id);
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_erase_rows(const arguments_type& arguments,
                                            std::ostream& output) {
 	if(arguments.size() == 2) {
-		const auto& filterPairs = get_from_argument<command_parser::key_value_list_argument_type>(arguments.at(1));
 		db.erase_rows
 				(
-						get_from_argument<std::string>(arguments.at(0)),
-						row_filter{filterPairs.begin(), filterPairs.end()}
+						get_from_argument<std::string_view>(arguments[0]),
+						get_filter(arguments[1])
 						);
 		output << "Erased rows";
 	} else {
 		throw std::invalid_argument("Arguments don't match specified pattern");
 	}
 }
+
+void command_processor::execute_result_cache_statistics(const arguments_type& arguments, std::ostream& output) {
+	if(!arguments.empty()) throw std::invalid_argument("Arguments don't match specified pattern");
+	const auto statistics = db.result_cache_statistics();
+	output << "hits " << statistics.hits << "\nmisses " << statistics.misses << "\nevictions " << statistics.evictions
+	       << "\nentries " << statistics.entries << "\nbytes " << statistics.bytes;
+}
+
+void command_processor::execute_compact(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 1) {
+		const auto table_name = get_from_argument<std::string_view>(arguments[0]);
+		db.compact(table_name);
+		output << "Compacted " << table_name;
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_create_index(const arguments_type& arguments,
+                                             std::ostream& output) {
+	if(arguments.size() == 2 || arguments.size() == 3) {
+		auto kind = index_kind::hash;
+		if(arguments.size() == 3) {
+			const auto kind_name = get_from_argument<std::string_view>(arguments[2]);
+			if(kind_name == "hash") kind = index_kind::hash;
+			else if(kind_name == "ordered") kind = index_kind::ordered;
+			else throw std::invalid_argument("Index kind not valid");
+		}
+		db.create_index(
+				get_from_argument<std::string_view>(arguments[0]),
+				get_from_argument<std::string_view>(arguments[1]),
+				kind
+				);
+		output << "Created index";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_save(const arguments_type& arguments,
+                                     std::ostream& output) {
+	if(arguments.size() == 1) {
+		db.save(std::filesystem::path(get_from_argument<std::string_view>(arguments[0])));
+		output << "Saved snapshot";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_load(const arguments_type& arguments,
+                                     std::ostream& output) {
+	if(arguments.size() == 1) {
+		db.load(std::filesystem::path(get_from_argument<std::string_view>(arguments[0])));
+		output << "Loaded snapshot";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+void command_processor::execute_load_csv(const arguments_type& arguments,
+                                         std::ostream& output) {
+	if(arguments.size() == 2 || arguments.size() == 3) {
+		csv_options options;
+		if(arguments.size() == 3) {
+			const auto get_char = [](const command_parser::primitive_view& arg) {
+				const auto* text = std::get_if<std::string_view>(&arg);
+				if(text != nullptr && *text == "tab") return '\t';
+				if(text == nullptr || text->size() != 1) throw std::invalid_argument("Expected a single character");
+				return text->front();
+			};
+			for(const auto& [name, option] : get_key_value_list(arguments[2])) {
+				if(name == "header") {
+					const auto* flag = std::get_if<std::string_view>(&option);
+					const auto* number = std::get_if<long long>(&option);
+					if(flag != nullptr && (*flag == "true" || *flag == "false")) options.header = *flag == "true";
+					else if(number != nullptr) options.header = *number != 0;
+					else throw std::invalid_argument("Expected true or false for the header option");
+				} else if(name == "delimiter") {
+					options.delimiter = get_char(option);
+				} else if(name == "quote") {
+					options.quote = get_char(option);
+				} else if(name == "batch_rows") {
+					const auto rows = get_from_argument<long long>(option);
+					if(rows <= 0) throw std::invalid_argument("batch_rows must be positive");
+					options.batch_rows = static_cast<std::size_t>(rows);
+				} else {
+					throw std::invalid_argument("Unknown load_csv option " + std::string(name));
+				}
+			}
+		}
+		const auto rows = db.bulk_load_csv(get_from_argument<std::string_view>(arguments[0]),
+		                                   std::filesystem::path(get_from_argument<std::string_view>(arguments[1])),
+		                                   options);
+		output << "Loaded " << rows << " rows";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
+
+prepared_statement command_processor::prepare(std::string_view command_line) {
+	using kind = prepared_statement::kind;
+	using target = prepared_statement::parameter::target;
+	command_parser::parse_command(command_line, parsed);
+	const auto command = parsed.command();
+	const auto arguments = parsed.arguments();
+	const auto get_name = [this](const command_parser::argument_view& argument) {
+		if(command_parser::is_placeholder(argument)) throw std::invalid_argument(
+				"Only values can be parameters, not table or column names");
+		return std::string(get_from_argument<std::string_view>(argument));
+	};
+	prepared_statement::definition definition{};
+	auto& parameters = definition.parameters;
+	if(command == "append_row" && arguments.size() == 2) {
+		definition.kind = kind::append_row;
+		for(const auto& element : get_list(arguments[1])) {
+			if(command_parser::is_placeholder(element)) parameters.push_back({target::cell, definition.cells.size()});
+			definition.cells.push_back(get_value_from_argument(element));
+		}
+	} else if(command == "query_table" && (arguments.size() == 1 || arguments.size() == 2)) {
+		definition.kind = kind::query_table;
+		if(arguments.size() == 2) definition.filter = get_filter(arguments[1], &parameters);
+	} else if(command == "query_column_histogram" && (arguments.size() == 2 || arguments.size() == 3)) {
+		definition.kind = kind::query_column_histogram;
+		definition.column = get_name(arguments[1]);
+		if(arguments.size() == 3) definition.filter = get_filter(arguments[2], &parameters);
+	} else if(command == "update_rows" && arguments.size() == 3) {
+		definition.kind = kind::update_rows;
+		definition.filter = get_filter(arguments[1], &parameters);
+		for(const auto& [column, new_value] : get_key_value_list(arguments[2])) {
+			if(command_parser::is_placeholder(new_value)) {
+				parameters.push_back({target::cell, definition.changes.size()});
+			}
+			definition.changes.emplace_back(std::string(column), get_value_from_argument(new_value));
+		}
+	} else if(command == "erase_rows" && arguments.size() == 2) {
+		definition.kind = kind::erase_rows;
+		definition.filter = get_filter(arguments[1], &parameters);
+	} else if(command == "append_row" || command == "query_table" || command == "query_column_histogram" ||
+	          command == "update_rows" || command == "erase_rows") {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	} else {
+		throw std::invalid_argument("Only append_row, query_table, query_column_histogram, update_rows and erase_rows "
+		                            "can be prepared");
+	}
+	definition.table = get_name(arguments[0]);
+	return db.prepare(std::move(definition));
+}
+
+void command_processor::execute(prepared_statement& statement, std::span<const value> parameters,
+                                std::ostream& output) {
+	switch(statement.get_kind()) {
+	case prepared_statement::kind::append_row: db.append_row(statement, parameters); break;
+	case prepared_statement::kind::query_table: {
+		std::optional<result_writer> writer;
+		db.query_table(statement, parameters, [&writer](const row& row) { writer->write_row(row); },
+		               [&](const table& tab) { writer.emplace(output, result_format, tab); });
+		writer->flush();
+		break;
+	}
+	case prepared_statement::kind::query_column_histogram:
+	{
+		const auto histogram = db.shared_column_histogram(statement, parameters);
+		for(const auto& p : *histogram) output << p.first << " " << p.second << '\n';
+		break;
+	}
+	case prepared_statement::kind::update_rows:
+		db.update_rows(statement, parameters);
+		output << "Updated rows";
+		break;
+	case prepared_statement::kind::erase_rows:
+		db.erase_rows(statement, parameters);
+		output << "Erased rows";
+		break;
+	}
+}
+
+void command_processor::execute_prepare(std::string_view command_line, std::ostream& output) {
+	const auto arguments = parsed.arguments();
+	if(arguments.size() < 2 || command_parser::is_placeholder(arguments[0])) throw std::invalid_argument(
+			"Arguments don't match specified pattern");
+	const auto name = get_from_argument<std::string_view>(arguments[0]);
+	// The command follows the name and, if the name is quoted, its closing quote.
+	auto command_start = static_cast<std::size_t>(name.data() + name.size() - command_line.data());
+	if(command_start < command_line.size() && command_line[command_start] == '"') ++command_start;
+	// Preparing parses the command into parsed, name still refers to command_line.
+	auto statement = prepare(command_line.substr(command_start));
+	prepared_statements.insert_or_assign(std::string(name), std::move(statement));
+	output << "Prepared " << name;
+}
+
+void command_processor::execute_prepared(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.empty()) throw std::invalid_argument("Arguments don't match specified pattern");
+	const auto name = get_from_argument<std::string_view>(arguments[0]);
+	const auto it = prepared_statements.find(name);
+	if(it == prepared_statements.end()) throw std::invalid_argument("No prepared statement named " + std::string(name));
+	std::vector<value> parameters;
+	parameters.reserve(arguments.size() - 1);
+	for(const auto& argument : arguments.subspan(1)) parameters.push_back(get_value_from_argument(argument));
+	execute(it->second, parameters, output);
+}
+
+void command_processor::execute_set_output_format(const arguments_type& arguments, std::ostream& output) {
+	if(arguments.size() == 1) {
+		result_format = parse_output_format(get_from_argument<std::string_view>(arguments[0]));
+		output << "Set output format";
+	} else {
+		throw std::invalid_argument("Arguments don't match specified pattern");
+	}
+}
 } // namespace minidb
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstring>
+#include <csv_reader.hpp>
+#include <stdexcept>
+#include <system_error>
+
+namespace minidb {
+
+csv_reader::csv_reader(const std::filesystem::path& path, const csv_options& options)
+	: in_(path, std::ios::binary), options_(options), buffer_(std::max<std::size_t>(options.buffer_size, 1)) {
+	if(!in_) throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+	if(options_.delimiter == options_.quote || options_.delimiter == '\n' || options_.quote == '\n') {
+		throw std::invalid_argument("Invalid CSV delimiter or quote character");
+	}
+}
+
+const char* csv_reader::find_record_end() const {
+	bool quoted = false;
+	for(const char* pos = buffer_.data() + begin_; pos != buffer_.data() + end_; ++pos) {
+		if(*pos == options_.quote) quoted = !quoted;
+		else if(*pos == '\n' && !quoted) return pos;
+	}
+	// The last record of a file doesn't need a line end.
+	return eof_ && begin_ != end_ ? buffer_.data() + end_ : nullptr;
+}
+
+bool csv_reader::fill() {
+	if(eof_) return false;
+	std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+	end_ -= begin_;
+	begin_ = 0;
+	if(end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+	in_.read(buffer_.data() + end_, static_cast<std::streamsize>(buffer_.size() - end_));
+	end_ += static_cast<std::size_t>(in_.gcount());
+	if(in_.eof()) eof_ = true;
+	else if(!in_) throw std::runtime_error("Failed to read the CSV file");
+	return true;
+}
+
+void csv_reader::split_fields(char* begin, char* end, std::vector<std::string_view>& fields) const {
+	fields.clear();
+	char* pos = begin;
+	for(;;) {
+		char* field_begin = pos;
+		char* field_end;
+		if(pos != end && *pos == options_.quote) {
+			// Unescape in place: the unquoted text is never longer than the quoted one.
+			char* write = pos;
+			for(++pos;; ++pos) {
+				if(pos == end) throw std::invalid_argument("Unterminated quoted CSV field");
+				if(*pos == options_.quote) {
+					if(pos + 1 != end && pos[1] == options_.quote) ++pos;
+					else break;
+				}
+				*write++ = *pos;
+			}
+			field_end = write;
+			++pos;
+			if(pos != end && *pos != options_.delimiter) {
+				throw std::invalid_argument("Unexpected character after quoted CSV field");
+			}
+		} else {
+			pos = std::find(pos, end, options_.delimiter);
+			field_end = pos;
+		}
+		fields.emplace_back(field_begin, static_cast<std::size_t>(field_end - field_begin));
+		if(pos == end) return;
+		++pos;
+	}
+}
+
+bool csv_reader::next(std::vector<std::string_view>& fields) {
+	for(;;) {
+		const char* record_end = find_record_end();
+		if(record_end == nullptr) {
+			if(!fill()) return false;
+			continue;
+		}
+		char* begin = buffer_.data() + begin_;
+		auto* end = const_cast<char*>(record_end);
+		const auto lines = static_cast<std::size_t>(std::count(static_cast<const char*>(begin), record_end, '\n'));
+		record_line_ = next_line_;
+		next_line_ += lines + 1;
+		begin_ = std::min(static_cast<std::size_t>(end - buffer_.data()) + 1, end_);
+		if(end != begin && end[-1] == '\r') --end;
+		if(begin == end) continue;
+		split_fields(begin, end, fields);
+		return true;
+	}
+}
+
+} // namespace minidb
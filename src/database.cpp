@@ -1,40 +1,393 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <database.hpp>
 #include <stdexcept>
 #include <util.hpp>
 #include <utility>
 #include <numeric>
+#include <type_traits>
 
 namespace minidb {
 
+namespace {
+
+// Parses a CSV field as a cell of the column's type and appends it to cells. Numbers may be surrounded by blanks.
+bool parse_cell(std::string_view field, column_storage::cell_vector& cells) {
+	return std::visit(overloaded{[field](std::vector<std::string>& strings) {
+		                             strings.emplace_back(field);
+		                             return true;
+	                             },
+	                             [field]<typename T>(std::vector<T>& numbers) {
+		                             const auto first = field.find_first_not_of(" \t");
+		                             if(first == std::string_view::npos) return false;
+		                             auto text = field.substr(first, field.find_last_not_of(" \t") + 1 - first);
+		                             if(text.front() == '+') text.remove_prefix(1);
+		                             T number{};
+		                             const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), number);
+		                             if(error != std::errc{} || end != text.data() + text.size()) return false;
+		                             numbers.push_back(number);
+		                             return true;
+	                             }},
+	                  cells);
+}
+
+column_storage::cell_vector empty_cells(value_type type) {
+	switch(type) {
+	case value_type::integer: return std::vector<long long>{};
+	case value_type::decimal: return std::vector<double>{};
+	case value_type::string: return std::vector<std::string>{};
+	}
+	throw std::invalid_argument("Unknown value type");
+}
+
+// Moves the cells of the rows into one cell_vector per column, after checking that all of them match the schema.
+std::vector<column_storage::cell_vector> to_columns(const std::vector<column>& columns,
+                                                    std::span<std::vector<value>> rows) {
+	for(const auto& row : rows) {
+		if(row.size() != columns.size()) throw std::invalid_argument(
+				"Number of cells doesn't match the number of columns in the schema");
+	}
+	for(std::size_t index = 0; index != columns.size(); ++index) {
+		const auto type = static_cast<std::size_t>(columns[index].type());
+		for(const auto& row : rows) {
+			if(row[index].index() != type) throw std::invalid_argument(
+					"Cell types don't match the column types in the schema");
+		}
+	}
+	std::vector<column_storage::cell_vector> cells;
+	cells.reserve(columns.size());
+	for(std::size_t index = 0; index != columns.size(); ++index) {
+		std::visit(
+				[&rows, index]<typename T>(std::vector<T>& typed_cells) {
+					typed_cells.reserve(rows.size());
+					for(auto& row : rows) typed_cells.push_back(std::move(*std::get_if<T>(&row[index])));
+				},
+				cells.emplace_back(empty_cells(columns[index].type())));
+	}
+	return cells;
+}
+
+std::size_t round_up_to_batches(std::size_t rows) {
+	const auto batches = (std::max<std::size_t>(rows, 1) + row_filter::batch_size - 1) / row_filter::batch_size;
+	return batches * row_filter::batch_size;
+}
+
+// Collects the rows in a morsel that match filter, which has to be bound to the table scanned.
+row_collector matching_rows(const row_filter& filter) {
+	return [&filter](std::size_t first_row, std::size_t last_row, std::vector<std::size_t>& rows) {
+		filter.for_each_match_in(first_row, last_row, [&rows](std::size_t row_index) { rows.push_back(row_index); });
+	};
+}
+
+// Collects the rows in a morsel that aren't erased, empty if the table has no erased rows.
+row_collector live_rows(const table& tab) {
+	if(tab.erased_count() == 0) return {};
+	return [&tab](std::size_t first_row, std::size_t last_row, std::vector<std::size_t>& rows) {
+		for(auto row_index = tab.next_row(first_row); row_index < last_row; row_index = tab.next_row(row_index + 1)) {
+			rows.push_back(row_index);
+		}
+	};
+}
+
+} // namespace
+
+void database::configure_compaction(double threshold) {
+	if(!(threshold >= 0 && threshold <= 1)) throw std::invalid_argument("The compaction threshold must be from 0 to 1");
+	compaction_threshold_ = threshold;
+}
+
+void database::compact_if_needed(std::string_view table_name, table& table) {
+	const auto erased = static_cast<double>(table.erased_count());
+	if(compaction_threshold_ == 0 || erased <= compaction_threshold_ * static_cast<double>(table.slot_count())) return;
+	if(log_) log_->log_compact(table_name);
+	table.compact();
+}
+
+void database::configure_scans(std::size_t worker_count, std::size_t morsel_rows) {
+	scan_pool_ = std::make_unique<thread_pool>(worker_count);
+	morsel_rows_ = round_up_to_batches(morsel_rows);
+}
+
+void database::for_each_matching_row(const table& table, const row_filter& filter,
+                                     const std::function<void(std::size_t)>& callback) const {
+	const auto row_count = table.slot_count();
+	if(scan_pool_->concurrency() == 1 || row_count <= morsel_rows_) {
+		filter.for_each_match(callback);
+		return;
+	}
+	// Every morsel collects its matches separately, replaying them morsel by morsel keeps the row order.
+	std::vector<std::vector<std::size_t>> morsel_matches((row_count + morsel_rows_ - 1) / morsel_rows_);
+	scan_pool_->parallel_for(row_count, morsel_rows_, [&](std::size_t first_row, std::size_t last_row, std::size_t) {
+		auto& matches = morsel_matches[first_row / morsel_rows_];
+		filter.for_each_match_in(first_row, last_row, [&matches](std::size_t row_index) { matches.push_back(row_index); });
+	});
+	for(const auto& matches : morsel_matches) {
+		for(const auto row_index : matches) callback(row_index);
+	}
+}
+
+void database::for_each_query_match(const table& table, row_filter& filter,
+                                    const std::function<void(std::size_t)>& callback) const {
+	if(!result_cache_) {
+		filter.bind_to_table(table);
+		for_each_matching_row(table, filter, callback);
+		return;
+	}
+	auto key = result_cache::key("query_table", table.name(), {}, &filter);
+	auto cached = result_cache_->find(key, table.version());
+	if(!cached) {
+		filter.bind_to_table(table);
+		result_cache::row_list rows;
+		for_each_matching_row(table, filter, [&rows](std::size_t row_index) { rows.push_back(row_index); });
+		rows.shrink_to_fit();
+		cached = result_cache_->insert(std::move(key), table.name(), table.version(), std::move(rows));
+	}
+	for(const auto row_index : std::get<result_cache::row_list>(*cached)) callback(row_index);
+}
+
+std::shared_ptr<const result_cache::histogram> database::histogram(const table& table, std::size_t column_index,
+                                                                   row_filter* filter) const {
+	const auto compute = [&] {
+		const auto& column = table.column_data(column_index);
+		if(filter == nullptr) return column_histogram(column, *scan_pool_, morsel_rows_, live_rows(table));
+		filter->bind_to_table(table);
+		return column_histogram(column, *scan_pool_, morsel_rows_, matching_rows(*filter));
+	};
+	if(!result_cache_) return std::make_shared<const result_cache::histogram>(compute());
+	auto key = result_cache::key("query_column_histogram", table.name(), table.get_column_name(column_index), filter);
+	auto cached = result_cache_->find(key, table.version());
+	if(!cached) cached = result_cache_->insert(std::move(key), table.name(), table.version(), compute());
+	// Shares ownership of the cached result.
+	return {cached, &std::get<result_cache::histogram>(*cached)};
+}
+
+void database::configure_result_cache(std::size_t budget_bytes) {
+	if(budget_bytes == 0) result_cache_.reset();
+	else result_cache_ = std::make_unique<result_cache>(budget_bytes);
+}
+
+result_cache::statistics database::result_cache_statistics() const {
+	return result_cache_ ? result_cache_->get_statistics() : result_cache::statistics{};
+}
+
+void database::open_log(const std::filesystem::path& path, write_ahead_log::options options) {
+	log_.reset();
+	// The log holds a record for every compaction, replaying it mustn't compact on its own.
+	const auto threshold = std::exchange(compaction_threshold_, 0);
+	try {
+		write_ahead_log::replay(path, *this);
+	} catch(...) {
+		compaction_threshold_ = threshold;
+		throw;
+	}
+	compaction_threshold_ = threshold;
+	log_ = std::make_unique<write_ahead_log>(path, options);
+}
+
+void database::close_log() {
+	log_.reset();
+}
+
+void database::flush_log() {
+	if(log_) log_->flush();
+}
+
+void database::save(const std::filesystem::path& path) const {
+	const std::shared_lock catalog_lock(catalog_mutex_);
+	std::vector<std::shared_lock<std::shared_mutex>> table_locks;
+	for(auto& [name, mutex] : table_mutexes_) table_locks.emplace_back(mutex);
+	write_snapshot(path, tables_);
+}
+
+void database::load(const std::filesystem::path& path) {
+	if(log_) throw std::logic_error("Snapshots can't be loaded while a write-ahead log is open");
+	auto tables = read_snapshot(path);
+	const std::unique_lock catalog_lock(catalog_mutex_);
+	tables_ = std::move(tables);
+	++catalog_version_;
+	if(result_cache_) result_cache_->clear();
+	table_mutexes_.clear();
+	for(const auto& [name, tab] : tables_) table_mutexes_.try_emplace(name);
+}
+
 table& database::lookup_table(std::string_view name) {
-	return tables_.at(name.data());
+	return const_cast<table&>(std::as_const(*this).lookup_table(name));
 }
 
 const table& database::lookup_table(std::string_view name) const {
-	return tables_.at(name.data());
+	// Heterogeneous lookup, name needn't be null-terminated.
+	const auto it = tables_.find(name);
+	if(it == tables_.end()) throw std::out_of_range("No table named " + std::string(name));
+	return it->second;
+}
+
+auto database::read_table(std::string_view name) const -> read_guard {
+	std::shared_lock catalog_lock(catalog_mutex_);
+	const auto& tab = lookup_table(name);
+	return {std::move(catalog_lock), table_mutexes_.find(name)->second, tab};
+}
+
+auto database::write_table(std::string_view name) -> write_guard {
+	std::shared_lock catalog_lock(catalog_mutex_);
+	auto& tab = lookup_table(name);
+	return {std::move(catalog_lock), table_mutexes_.find(name)->second, tab};
+}
+
+void database::resolve(prepared_statement& statement) const {
+	if(statement.table_ != nullptr && statement.catalog_version_ == catalog_version_) return;
+	statement.table_ = nullptr;
+	const auto& definition = statement.definition_;
+	const auto& tab = lookup_table(definition.table);
+	if(definition.kind == prepared_statement::kind::query_column_histogram) {
+		statement.column_index_ = tab.get_column_index_by_name(definition.column);
+	}
+	statement.change_columns_.clear();
+	for(const auto& change : definition.changes) {
+		statement.change_columns_.push_back(tab.get_column_index_by_name(change.first));
+	}
+	// The filter is compiled once it's bound to the locked table, but the columns it names have to exist now.
+	if(definition.filter) {
+		for(const auto& term : definition.filter->expression()) {
+			if(const auto* predicate = std::get_if<row_filter::predicate>(&term)) {
+				tab.get_column_index_by_name(predicate->column);
+			}
+		}
+		statement.definition_.filter->unbind();
+	}
+	statement.table_mutex_ = &table_mutexes_.find(definition.table)->second;
+	statement.catalog_version_ = catalog_version_;
+	statement.table_ = &tab;
+}
+
+auto database::read_table(prepared_statement& statement, prepared_statement::kind kind) const -> read_guard {
+	if(statement.get_kind() != kind) throw std::invalid_argument("The statement was prepared for another operation");
+	std::shared_lock catalog_lock(catalog_mutex_);
+	resolve(statement);
+	return {std::move(catalog_lock), *statement.table_mutex_, *statement.table_};
+}
+
+auto database::write_table(prepared_statement& statement, prepared_statement::kind kind) -> write_guard {
+	if(statement.get_kind() != kind) throw std::invalid_argument("The statement was prepared for another operation");
+	std::shared_lock catalog_lock(catalog_mutex_);
+	resolve(statement);
+	// The table belongs to this database, resolve only finds it through the const lookup.
+	return {std::move(catalog_lock), *statement.table_mutex_, const_cast<table&>(*statement.table_)};
 }
 
 void database::create_table(std::string_view name, schema table_schema) {
+	const std::unique_lock catalog_lock(catalog_mutex_);
 	if(tables_.find(name) != tables_.end()) {
 		throw std::invalid_argument("The table already exists in the database");
 	}
-	// Check if it moves out of parent contet without std::move
-	tables_.emplace(name, table{std::string(name), std::move(table_schema)});
+	table created{std::string(name), table_schema};
+	if(log_) log_->log_create_table(name, table_schema);
+	tables_.emplace(name, std::move(created));
+	++catalog_version_;
+	table_mutexes_.try_emplace(std::string(name));
 }
 
 void database::drop_table(std::string_view name) {
-	if(std::erase_if(tables_, [name](const auto& elem) { return elem.first == name; }) == 0) throw
-			std::invalid_argument("Table name doesn't exist");
+	const std::unique_lock catalog_lock(catalog_mutex_);
+	const auto it = tables_.find(name);
+	if(it == tables_.end()) throw std::invalid_argument("Table name doesn't exist");
+	if(log_) log_->log_drop_table(name);
+	tables_.erase(it);
+	++catalog_version_;
+	table_mutexes_.erase(table_mutexes_.find(name));
+	if(result_cache_) result_cache_->erase_table(name);
 }
 
-void database::append_row(std::string_view table_name, std::vector<value> cell_values) {
-	auto& table = lookup_table(table_name);
-	table.append_row(std::move(cell_values));
+row_id database::append_row(std::string_view table_name, std::vector<value> cell_values) {
+	auto table = write_table(table_name);
+	if(log_) {
+		table->check_cells(cell_values);
+		log_->log_append_row(table_name, cell_values);
+	}
+	return table->append_row(std::move(cell_values));
+}
+
+row_id database::append_rows(std::string_view table_name, std::span<std::vector<value>> rows) {
+	auto table = write_table(table_name);
+	const auto first_id = table->next_row_id();
+	auto columns = to_columns(table->columns(), rows);
+	// Columns carry the row count, the empty rows of a table without columns can only be appended one by one.
+	if(columns.empty()) {
+		for(auto& row : rows) {
+			if(log_) log_->log_append_row(table_name, row);
+			table->append_row(std::move(row));
+		}
+		return first_id;
+	}
+	if(log_) log_->log_append_columns(table_name, columns);
+	table->append_columns(std::move(columns));
+	return first_id;
+}
+
+void database::append_columns(std::string_view table_name, std::vector<column_storage::cell_vector> columns) {
+	auto table = write_table(table_name);
+	if(log_) {
+		table->check_columns(columns);
+		log_->log_append_columns(table_name, columns);
+	}
+	table->append_columns(std::move(columns));
+}
+
+std::size_t database::bulk_load_csv(std::string_view table_name, const std::filesystem::path& path,
+                                    const csv_options& options) {
+	// A copy, the table is only locked while appending each batch.
+	const auto columns = read_table(table_name)->columns();
+	csv_reader reader(path, options);
+	const auto batch_rows = std::max<std::size_t>(options.batch_rows, 1);
+	std::vector<column_storage::cell_vector> batch;
+	const auto start_batch = [&] {
+		batch.clear();
+		for(const auto& column : columns) {
+			std::visit([batch_rows](auto& cells) { cells.reserve(batch_rows); },
+			           batch.emplace_back(empty_cells(column.type())));
+		}
+	};
+	start_batch();
+	std::size_t total_rows = 0;
+	std::size_t pending_rows = 0;
+	std::vector<std::string_view> fields;
+	if(options.header) reader.next(fields);
+	while(reader.next(fields)) {
+		if(fields.size() != columns.size()) {
+			throw std::invalid_argument("Line " + std::to_string(reader.line()) + ": expected " +
+			                            std::to_string(columns.size()) + " fields, got " + std::to_string(fields.size()));
+		}
+		for(std::size_t index = 0; index != fields.size(); ++index) {
+			if(!parse_cell(fields[index], batch[index])) {
+				throw std::invalid_argument("Line " + std::to_string(reader.line()) + ": invalid value for column " +
+				                            columns[index].name());
+			}
+		}
+		if(++pending_rows == batch_rows) {
+			append_columns(table_name, std::move(batch));
+			total_rows += pending_rows;
+			pending_rows = 0;
+			start_batch();
+		}
+	}
+	if(pending_rows != 0) append_columns(table_name, std::move(batch));
+	return total_rows + pending_rows;
 }
 
 void database::erase_row(std::string_view table_name, std::size_t row_index) {
-	auto& table = lookup_table(table_name);
-	table.erase_row(row_index);
+	auto table = write_table(table_name);
+	if(log_) {
+		table->check_row(row_index);
+		log_->log_erase_row(table_name, row_index);
+	}
+	table->erase_row(row_index);
+	compact_if_needed(table_name, *table);
+}
+
+void database::compact(std::string_view table_name) {
+	auto table = write_table(table_name);
+	if(log_) log_->log_compact(table_name);
+	table->compact();
 }
 
 table& database::bind_filter_if(std::string_view table_name, row_filter& filter) {
@@ -45,55 +398,236 @@ table& database::bind_filter_if(std::string_view table_name, row_filter& filter)
 
 void database::update_cell(std::string_view table_name, const std::size_t& row_index, const std::size_t& column_index,
                            const value& new_value) {
-	auto& table = lookup_table(table_name);
-	table.update_cell(row_index, column_index, new_value);
+	auto table = write_table(table_name);
+	if(log_) {
+		table->check_row(row_index);
+		table->check_cell(column_index, new_value);
+		log_->log_update_cell(table_name, row_index, column_index, new_value);
+	}
+	table->update_cell(row_index, column_index, new_value);
+}
+
+void database::create_index(std::string_view table_name, std::string_view column_name, index_kind kind) {
+	auto table = write_table(table_name);
+	const auto column_index = table->get_column_index_by_name(column_name);
+	if(log_) {
+		table->check_new_index(column_index);
+		log_->log_create_index(table_name, column_name, kind);
+	}
+	table->create_index(column_index, kind);
+}
+
+// Row IDs are assigned in the order rows are appended, so replaying the log reproduces them and the operations can be
+// logged with the row's index.
+void database::update_cell_by_id(std::string_view table_name, row_id id, std::size_t column_index,
+                                 const value& new_value) {
+	auto table = write_table(table_name);
+	const auto row_index = table->slot_of(id);
+	if(log_) {
+		table->check_cell(column_index, new_value);
+		log_->log_update_cell(table_name, row_index, column_index, new_value);
+	}
+	table->update_cell(row_index, column_index, new_value);
+}
+
+void database::erase_row_by_id(std::string_view table_name, row_id id) {
+	auto table = write_table(table_name);
+	const auto row_index = table->slot_of(id);
+	if(log_) log_->log_erase_row(table_name, row_index);
+	table->erase_row(row_index);
+	compact_if_needed(table_name, *table);
 }
 
 void database::erase_rows(std::string_view table_name, row_filter row_filter) {
-	auto& table = bind_filter_if(table_name, row_filter);
-	std::erase_if(table.rows(),
-	              [&row_filter](const auto& row) -> bool { return row_filter(row); });
+	const auto guard = write_table(table_name);
+	auto& table = *guard;
+	row_filter.bind_to_table(table);
+	erase_matching_rows(table_name, table, row_filter);
+}
+
+void database::erase_matching_rows(std::string_view table_name, table& table, const row_filter& filter) {
+	if(log_) log_->log_erase_rows(table_name, filter);
+	std::vector<std::size_t> matching_rows;
+	for_each_matching_row(table, filter,
+	                      [&matching_rows](std::size_t row_index) { matching_rows.push_back(row_index); });
+	for(const auto row_index : matching_rows) table.erase_row(row_index);
+	compact_if_needed(table_name, table);
 }
 
 void database::update_rows(std::string_view table_name, row_filter row_filter,
                            std::unordered_map<std::string, value> changes) {
 
-	auto& table = bind_filter_if(table_name, row_filter);
-	for(auto& row : table.rows()) {
-		if(row_filter(row)) {
-			for(const auto& p : changes) {
-				row.set_cell_value(table.get_column_index_by_name(p.first), p.second);
-			}
-		}
+	const auto guard = write_table(table_name);
+	auto& table = *guard;
+	row_filter.bind_to_table(table);
+	std::vector<std::pair<std::size_t, value>> indexed_changes;
+	indexed_changes.reserve(changes.size());
+	for(const auto& [name, new_value] : changes) {
+		indexed_changes.emplace_back(table.get_column_index_by_name(name), new_value);
+		table.check_cell(indexed_changes.back().first, new_value);
+	}
+	if(log_) log_->log_update_rows(table_name, row_filter, changes);
+	update_matching_rows(table, row_filter, indexed_changes);
+}
+
+void database::update_matching_rows(table& table, const row_filter& filter,
+                                    const std::vector<std::pair<std::size_t, value>>& changes) const {
+	// Collect the matches first, updating an indexed column changes the row lists the filter iterates over.
+	std::vector<std::size_t> matching_rows;
+	for_each_matching_row(table, filter,
+	                      [&matching_rows](std::size_t row_index) { matching_rows.push_back(row_index); });
+	for(const auto row_index : matching_rows) {
+		for(const auto& [column_index, new_value] : changes) table.update_cell(row_index, column_index, new_value);
 	}
 }
 
 std::map<value, std::size_t> database::query_column_histogram(std::string_view table_name, std::string_view column_name,
                                                               row_filter row_filter) const {
-
-	const auto& table = lookup_table(table_name);
-	row_filter.bind_to_table(table);
-	std::map<value, std::size_t> rslt;
-	const auto& index = table.get_column_index_by_name(column_name);
-	for(const auto& row : table.rows()) {
-		if(row_filter(row)) {
-			rslt[row.get_cell_value(index)]++;
-		}
-	}
-	return rslt;
+	return *shared_column_histogram(table_name, column_name, std::move(row_filter));
 }
 
 std::map<value, std::size_t> database::query_column_histogram(std::string_view table_name,
                                                               std::string_view column_name) const {
+	return *shared_column_histogram(table_name, column_name);
+}
+
+auto database::shared_column_histogram(std::string_view table_name, std::string_view column_name,
+                                       row_filter filter) const -> std::shared_ptr<const result_cache::histogram> {
+	const auto table = read_table(table_name);
+	return histogram(*table, table->get_column_index_by_name(column_name), &filter);
+}
+
+auto database::shared_column_histogram(std::string_view table_name, std::string_view column_name) const
+		-> std::shared_ptr<const result_cache::histogram> {
+	const auto table = read_table(table_name);
+	return histogram(*table, table->get_column_index_by_name(column_name), nullptr);
+}
+
+prepared_statement database::prepare(prepared_statement::definition definition) const {
+	prepared_statement statement(std::move(definition));
+	const std::shared_lock catalog_lock(catalog_mutex_);
+	resolve(statement);
+	return statement;
+}
+
+row_id database::append_row(prepared_statement& statement, std::span<const value> parameters) {
+	statement.bind(parameters);
+	auto cells = statement.definition_.cells;
+	auto table = write_table(statement, prepared_statement::kind::append_row);
+	if(log_) {
+		table->check_cells(cells);
+		log_->log_append_row(statement.table_name(), cells);
+	}
+	return table->append_row(std::move(cells));
+}
+
+void database::query_table(prepared_statement& statement, std::span<const value> parameters,
+                           const rowCallBack& row_callback, const tableCallBack& table_callback) const {
+	statement.bind(parameters);
+	const auto table = read_table(statement, prepared_statement::kind::query_table);
+	if(table_callback) table_callback(*table);
+	auto& filter = statement.definition_.filter;
+	if(!filter) {
+		for(const auto& row : table->rows()) row_callback(row);
+		return;
+	}
+	for_each_query_match(*table, *filter, [&](std::size_t row_index) { row_callback(table->row_at(row_index)); });
+}
+
+std::map<value, std::size_t> database::query_column_histogram(prepared_statement& statement,
+                                                              std::span<const value> parameters) const {
+	return *shared_column_histogram(statement, parameters);
+}
+
+auto database::shared_column_histogram(prepared_statement& statement, std::span<const value> parameters) const
+		-> std::shared_ptr<const result_cache::histogram> {
+	statement.bind(parameters);
+	const auto table = read_table(statement, prepared_statement::kind::query_column_histogram);
+	auto& filter = statement.definition_.filter;
+	return histogram(*table, statement.column_index_, filter ? &*filter : nullptr);
+}
+
+void database::update_rows(prepared_statement& statement, std::span<const value> parameters) {
+	statement.bind(parameters);
+	auto& definition = statement.definition_;
+	const auto table = write_table(statement, prepared_statement::kind::update_rows);
+	std::vector<std::pair<std::size_t, value>> changes;
+	changes.reserve(definition.changes.size());
+	for(std::size_t index = 0; index != definition.changes.size(); ++index) {
+		changes.emplace_back(statement.change_columns_[index], definition.changes[index].second);
+		table->check_cell(changes.back().first, changes.back().second);
+	}
+	row_filter all_rows{std::vector<row_filter::term>{}};
+	auto& filter = definition.filter ? *definition.filter : all_rows;
+	filter.bind_to_table(*table);
+	if(log_) log_->log_update_rows(definition.table, filter, definition.changes);
+	update_matching_rows(*table, filter, changes);
+}
+
+void database::erase_rows(prepared_statement& statement, std::span<const value> parameters) {
+	statement.bind(parameters);
+	auto& definition = statement.definition_;
+	const auto table = write_table(statement, prepared_statement::kind::erase_rows);
+	row_filter all_rows{std::vector<row_filter::term>{}};
+	auto& filter = definition.filter ? *definition.filter : all_rows;
+	filter.bind_to_table(*table);
+	erase_matching_rows(definition.table, *table, filter);
+}
+
+table database::aggregate(std::string_view table_name, const std::vector<std::string>& group_by,
+                          const std::vector<aggregation>& aggregations, row_filter filter) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	filter.bind_to_table(table);
+	return aggregate_rows(table, group_by, aggregations, *scan_pool_, morsel_rows_, matching_rows(filter));
+}
 
-	const auto& table = lookup_table(table_name);
-	std::map<value, std::size_t> rslt;
-	const auto& index = table.get_column_index_by_name(column_name);
-	for(const auto& row : table.rows()) {
-		rslt[row.get_cell_value(index)]++;
+table database::aggregate(std::string_view table_name, const std::vector<std::string>& group_by,
+                          const std::vector<aggregation>& aggregations) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	auto collect = live_rows(table);
+	if(!collect) {
+		collect = [](std::size_t first_row, std::size_t last_row, std::vector<std::size_t>& rows) {
+			for(std::size_t row_index = first_row; row_index != last_row; ++row_index) rows.push_back(row_index);
+		};
 	}
+	return aggregate_rows(table, group_by, aggregations, *scan_pool_, morsel_rows_, collect);
+}
+
+std::size_t database::approx_distinct(std::string_view table_name, std::string_view column_name,
+                                      row_filter filter) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	filter.bind_to_table(table);
+	const auto& column = table.column_data(table.get_column_index_by_name(column_name));
+	return static_cast<std::size_t>(
+			std::llround(approx_distinct_cells(column, *scan_pool_, morsel_rows_, matching_rows(filter))));
+}
+
+std::size_t database::approx_distinct(std::string_view table_name, std::string_view column_name) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	const auto& column = table.column_data(table.get_column_index_by_name(column_name));
+	return static_cast<std::size_t>(
+			std::llround(approx_distinct_cells(column, *scan_pool_, morsel_rows_, live_rows(table))));
+}
+
+std::vector<double> database::approx_quantiles(std::string_view table_name, std::string_view column_name,
+                                               const std::vector<double>& fractions, row_filter filter) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	filter.bind_to_table(table);
+	const auto& column = table.column_data(table.get_column_index_by_name(column_name));
+	return approx_cell_quantiles(column, fractions, *scan_pool_, morsel_rows_, matching_rows(filter));
+}
 
-	return rslt;
+std::vector<double> database::approx_quantiles(std::string_view table_name, std::string_view column_name,
+                                               const std::vector<double>& fractions) const {
+	const auto guard = read_table(table_name);
+	const auto& table = *guard;
+	const auto& column = table.column_data(table.get_column_index_by_name(column_name));
+	return approx_cell_quantiles(column, fractions, *scan_pool_, morsel_rows_, live_rows(table));
 }
 
 } // namespace minidb
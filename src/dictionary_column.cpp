@@ -0,0 +1,35 @@
+#include <dictionary_column.hpp>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace minidb {
+
+dictionary_column::dictionary_column(std::vector<std::string> entries, std::vector<code_type> codes)
+	: codes_(std::move(codes)) {
+	for(auto& entry : entries) {
+		const auto expected_code = dictionary_.size();
+		if(intern(entry) != expected_code) throw std::invalid_argument("Duplicate dictionary entry");
+	}
+	for(const auto code : codes_) {
+		if(code >= dictionary_.size()) throw std::invalid_argument("Dictionary code out of range");
+	}
+}
+
+std::optional<dictionary_column::code_type> dictionary_column::find_code(std::string_view str) const {
+	const auto it = lookup_.find(str);
+	if(it == lookup_.end()) return std::nullopt;
+	return it->second;
+}
+
+dictionary_column::code_type dictionary_column::intern(std::string_view str) {
+	if(const auto it = lookup_.find(str); it != lookup_.end()) return it->second;
+	if(dictionary_.size() >= std::numeric_limits<code_type>::max()) throw std::length_error(
+			"Too many distinct values for a dictionary-encoded column");
+	const auto code = static_cast<code_type>(dictionary_.size());
+	const auto& stored = dictionary_.emplace_back(str);
+	lookup_.emplace(stored, code);
+	return code;
+}
+
+} // namespace minidb
@@ -0,0 +1,67 @@
+#include <mapped_file.hpp>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace minidb {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path& path) : size_(std::filesystem::file_size(path)) {
+	file_handle_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                           FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file_handle_ == INVALID_HANDLE_VALUE) {
+		throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Failed to open " +
+		                                                                                          path.string());
+	}
+	if(size_ == 0) return;
+	mapping_handle_ = CreateFileMappingW(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping_handle_ != nullptr ? MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if(view == nullptr) {
+		const auto error = static_cast<int>(GetLastError());
+		if(mapping_handle_ != nullptr) CloseHandle(mapping_handle_);
+		CloseHandle(file_handle_);
+		throw std::system_error(error, std::system_category(), "Failed to map " + path.string());
+	}
+	data_ = static_cast<const std::byte*>(view);
+}
+
+mapped_file::~mapped_file() {
+	if(data_ != nullptr) UnmapViewOfFile(data_);
+	if(mapping_handle_ != nullptr) CloseHandle(mapping_handle_);
+	CloseHandle(file_handle_);
+}
+
+#else
+
+mapped_file::mapped_file(const std::filesystem::path& path) {
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0) throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+	size_ = std::filesystem::file_size(path);
+	if(size_ == 0) {
+		::close(fd);
+		return;
+	}
+	void* view = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	const int error = errno;
+	// The mapping keeps its own reference to the file.
+	::close(fd);
+	if(view == MAP_FAILED) throw std::system_error(error, std::generic_category(), "Failed to map " + path.string());
+	data_ = static_cast<const std::byte*>(view);
+}
+
+mapped_file::~mapped_file() {
+	if(data_ != nullptr) ::munmap(const_cast<std::byte*>(data_), size_);
+}
+
+#endif
+
+} // namespace minidb
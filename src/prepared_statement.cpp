@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <prepared_statement.hpp>
+#include <stdexcept>
+
+namespace minidb {
+
+prepared_statement::prepared_statement(definition statement) : definition_(std::move(statement)) {
+	const auto& changes = definition_.changes;
+	for(auto it = changes.begin(); it != changes.end(); ++it) {
+		if(std::any_of(changes.begin(), it, [&it](const auto& change) { return change.first == it->first; })) throw
+				std::invalid_argument("The statement changes the column " + it->first + " more than once");
+	}
+	const auto& filter = definition_.filter;
+	const auto cell_count = definition_.kind == kind::append_row ? definition_.cells.size()
+	                                                             : definition_.changes.size();
+	for(const auto& [place, index, operand] : definition_.parameters) {
+		if(place == parameter::target::cell) {
+			if(index >= cell_count) throw std::invalid_argument("A parameter refers to a cell the statement hasn't");
+			continue;
+		}
+		const auto* predicate = filter && index < filter->expression().size()
+			                        ? std::get_if<row_filter::predicate>(&filter->expression()[index])
+			                        : nullptr;
+		if(predicate == nullptr || operand >= predicate->operands.size()) throw std::invalid_argument(
+				"A parameter refers to a filter operand the statement hasn't");
+	}
+}
+
+void prepared_statement::bind(std::span<const value> parameters) {
+	if(parameters.size() != definition_.parameters.size()) throw std::invalid_argument(
+			"Expected " + std::to_string(definition_.parameters.size()) + " parameters, got " +
+			std::to_string(parameters.size()));
+	for(std::size_t index = 0; index != parameters.size(); ++index) {
+		const auto& target = definition_.parameters[index];
+		if(target.place == parameter::target::filter_operand) {
+			definition_.filter->set_operand(target.index, target.operand, parameters[index]);
+		} else if(definition_.kind == kind::append_row) {
+			definition_.cells[target.index] = parameters[index];
+		} else {
+			definition_.changes[target.index].second = parameters[index];
+		}
+	}
+}
+
+} // namespace minidb
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstring>
+#include <result_cache.hpp>
+#include <util.hpp>
+
+namespace minidb {
+
+namespace {
+
+template <typename T>
+void append_raw(std::string& out, const T& number) {
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, &number, sizeof(T));
+	out.append(bytes, sizeof(T));
+}
+
+void append_text(std::string& out, std::string_view text) {
+	append_raw(out, text.size());
+	out.append(text);
+}
+
+std::string term_key(const row_filter::term& term) {
+	std::string key;
+	if(const auto* op = std::get_if<row_filter::connective>(&term)) {
+		key.push_back('c');
+		key.push_back(static_cast<char>(*op));
+		return key;
+	}
+	const auto& predicate = std::get<row_filter::predicate>(term);
+	key.push_back('p');
+	append_text(key, predicate.column);
+	key.push_back(static_cast<char>(predicate.op));
+	for(const auto& operand : predicate.operands) {
+		key.push_back(static_cast<char>(operand.index()));
+		std::visit(overloaded{[&key](const std::string& text) { append_text(key, text); },
+		                      [&key](const auto& number) { append_raw(key, number); }},
+		           operand);
+	}
+	return key;
+}
+
+// Estimated memory held by a result.
+std::size_t result_size(const result_cache::result& query_result) {
+	constexpr std::size_t node_overhead = 32;
+	return std::visit(overloaded{[](const result_cache::row_list& rows) {
+		                             return rows.capacity() * sizeof(std::size_t);
+	                             },
+	                             [](const result_cache::histogram& histogram) {
+		                             std::size_t bytes = 0;
+		                             for(const auto& [cell, count] : histogram) {
+			                             bytes += node_overhead + sizeof(std::pair<const value, std::size_t>);
+			                             if(const auto* text = std::get_if<std::string>(&cell)) {
+				                             bytes += text->capacity() > sizeof(std::string) ? text->capacity() : 0;
+			                             }
+		                             }
+		                             return bytes;
+	                             }},
+	                  query_result);
+}
+
+} // namespace
+
+std::string result_cache::key(std::string_view query, std::string_view table_name, std::string_view column,
+                              const row_filter* filter) {
+	std::string key;
+	append_text(key, query);
+	append_text(key, table_name);
+	append_text(key, column);
+	if(filter == nullptr) return key;
+	key.push_back('f');
+	std::vector<std::string> terms;
+	terms.reserve(filter->expression().size());
+	for(const auto& term : filter->expression()) terms.push_back(term_key(term));
+	// All predicates of a list have to hold, so their order doesn't matter.
+	const bool list = std::ranges::all_of(filter->expression(), [](const row_filter::term& term) {
+		return std::holds_alternative<row_filter::predicate>(term);
+	});
+	if(list) std::ranges::sort(terms);
+	for(const auto& term : terms) append_text(key, term);
+	return key;
+}
+
+auto result_cache::find(const std::string& key, std::uint64_t version) -> std::shared_ptr<const result> {
+	const std::lock_guard lock(mutex_);
+	const auto it = index_.find(key);
+	if(it == index_.end() || it->second->version != version) {
+		// A result of an older version of the table is never found again.
+		if(it != index_.end()) erase(it->second);
+		++statistics_.misses;
+		return nullptr;
+	}
+	++statistics_.hits;
+	entries_.splice(entries_.begin(), entries_, it->second);
+	return it->second->query_result;
+}
+
+auto result_cache::insert(std::string key, std::string_view table_name, std::uint64_t version, result query_result)
+		-> std::shared_ptr<const result> {
+	auto shared_result = std::make_shared<const result>(std::move(query_result));
+	const auto bytes = sizeof(entry) + key.size() + table_name.size() + result_size(*shared_result);
+	if(bytes > budget_) return shared_result;
+	const std::lock_guard lock(mutex_);
+	if(const auto it = index_.find(key); it != index_.end()) erase(it->second);
+	while(statistics_.bytes + bytes > budget_) {
+		erase(std::prev(entries_.end()));
+		++statistics_.evictions;
+	}
+	entries_.push_front({std::move(key), std::string(table_name), version, bytes, shared_result});
+	index_.emplace(entries_.front().key, entries_.begin());
+	statistics_.bytes += bytes;
+	++statistics_.entries;
+	return shared_result;
+}
+
+void result_cache::erase(std::list<entry>::iterator it) {
+	statistics_.bytes -= it->bytes;
+	--statistics_.entries;
+	index_.erase(it->key);
+	entries_.erase(it);
+}
+
+void result_cache::erase_table(std::string_view table_name) {
+	const std::lock_guard lock(mutex_);
+	for(auto it = entries_.begin(); it != entries_.end();) {
+		const auto next = std::next(it);
+		if(it->table_name == table_name) erase(it);
+		it = next;
+	}
+}
+
+void result_cache::clear() {
+	const std::lock_guard lock(mutex_);
+	index_.clear();
+	entries_.clear();
+	statistics_.bytes = 0;
+	statistics_.entries = 0;
+}
+
+auto result_cache::get_statistics() const -> statistics {
+	const std::lock_guard lock(mutex_);
+	return statistics_;
+}
+
+} // namespace minidb
@@ -0,0 +1,179 @@
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+#include <result_writer.hpp>
+#include <stdexcept>
+#include <util.hpp>
+
+namespace minidb {
+
+namespace {
+
+// Appends text, replacing the characters for which escape yields a non-empty replacement. Runs of characters that
+// don't need escaping are appended in one go.
+template <typename Escape>
+void append_escaped(std::string& buffer, std::string_view text, Escape&& escape) {
+	std::size_t run = 0;
+	for(std::size_t pos = 0; pos != text.size(); ++pos) {
+		const std::string_view replacement = escape(text[pos]);
+		if(replacement.empty()) continue;
+		buffer.append(text.substr(run, pos - run));
+		buffer.append(replacement);
+		run = pos + 1;
+	}
+	buffer.append(text.substr(run));
+}
+
+void append_tsv(std::string& buffer, std::string_view text) {
+	append_escaped(buffer, text, [](char c) -> std::string_view {
+		switch(c) {
+		case '\t': return "\\t";
+		case '\n': return "\\n";
+		case '\r': return "\\r";
+		case '\\': return "\\\\";
+		default: return {};
+		}
+	});
+}
+
+void append_csv(std::string& buffer, std::string_view text) {
+	if(text.find_first_of(",\"\r\n") == std::string_view::npos) {
+		buffer.append(text);
+		return;
+	}
+	buffer.push_back('"');
+	append_escaped(buffer, text, [](char c) -> std::string_view { return c == '"' ? "\"\"" : ""; });
+	buffer.push_back('"');
+}
+
+void append_json(std::string& buffer, std::string_view text) {
+	// Control characters other than the ones with a short escape are written as \u00XX.
+	static const auto control_escapes = [] {
+		std::array<std::array<char, 6>, 32> escapes{};
+		constexpr char hex[] = "0123456789abcdef";
+		for(std::size_t c = 0; c != escapes.size(); ++c) escapes[c] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+		return escapes;
+	}();
+	buffer.push_back('"');
+	append_escaped(buffer, text, [](char c) -> std::string_view {
+		switch(c) {
+		case '"': return "\\\"";
+		case '\\': return "\\\\";
+		case '\n': return "\\n";
+		case '\t': return "\\t";
+		default:
+			const auto code = static_cast<unsigned char>(c);
+			if(code < control_escapes.size()) return {control_escapes[code].data(), control_escapes[code].size()};
+			return {};
+		}
+	});
+	buffer.push_back('"');
+}
+
+} // namespace
+
+output_format parse_output_format(std::string_view name) {
+	if(name == "text") return output_format::text;
+	if(name == "tsv") return output_format::tsv;
+	if(name == "csv") return output_format::csv;
+	if(name == "json") return output_format::json_lines;
+	throw std::invalid_argument("Unknown output format: " + std::string(name));
+}
+
+result_writer::result_writer(std::ostream& output, output_format format, const table& tab, std::size_t flush_size)
+	: output_(output), format_(format), table_(tab), flush_size_(flush_size) {
+	buffer_.reserve(flush_size_ + flush_size_ / 4);
+	const auto& columns = tab.columns();
+	if(format_ == output_format::json_lines) {
+		for(const auto& column : columns) {
+			auto& key = json_keys_.emplace_back();
+			append_json(key, column.name());
+			key.push_back(':');
+		}
+	} else if(format_ == output_format::tsv || format_ == output_format::csv) {
+		for(std::size_t index = 0; index != columns.size(); ++index) {
+			if(index != 0) buffer_.push_back(format_ == output_format::tsv ? '\t' : ',');
+			write_string(columns[index].name());
+		}
+		buffer_.push_back('\n');
+	}
+}
+
+result_writer::~result_writer() {
+	// May run while an exception unwinds the stack, errors of the stream only surface through an explicit flush().
+	try {
+		flush();
+	} catch(...) {
+	}
+}
+
+void result_writer::write_row(const row& r) {
+	const auto row_index = r.index();
+	const auto column_count = table_.columns().size();
+	for(std::size_t column_index = 0; column_index != column_count; ++column_index) {
+		switch(format_) {
+		case output_format::text: break;
+		case output_format::tsv: if(column_index != 0) buffer_.push_back('\t');
+			break;
+		case output_format::csv: if(column_index != 0) buffer_.push_back(',');
+			break;
+		case output_format::json_lines:
+			buffer_.push_back(column_index == 0 ? '{' : ',');
+			buffer_.append(json_keys_[column_index]);
+			break;
+		}
+		table_.column_data(column_index).visit(overloaded{
+				[&](const column_storage::integer_data& data) { write_integer(data[row_index]); },
+				[&](const column_storage::decimal_data& data) { write_decimal(data[row_index]); },
+				[&](const auto& data) { write_string(data[row_index]); }});
+		if(format_ == output_format::text) buffer_.push_back(' ');
+	}
+	if(format_ == output_format::json_lines) {
+		if(column_count == 0) buffer_.push_back('{');
+		buffer_.push_back('}');
+	}
+	buffer_.push_back('\n');
+	if(buffer_.size() >= flush_size_) flush();
+}
+
+void result_writer::flush() {
+	output_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+	buffer_.clear();
+}
+
+void result_writer::write_string(std::string_view text) {
+	switch(format_) {
+	case output_format::text: buffer_.append(text);
+		break;
+	case output_format::tsv: append_tsv(buffer_, text);
+		break;
+	case output_format::csv: append_csv(buffer_, text);
+		break;
+	case output_format::json_lines: append_json(buffer_, text);
+		break;
+	}
+}
+
+void result_writer::write_integer(long long number) {
+	std::array<char, 24> digits;
+	const auto result = std::to_chars(digits.data(), digits.data() + digits.size(), number);
+	buffer_.append(digits.data(), result.ptr);
+}
+
+void result_writer::write_decimal(double number) {
+	if(format_ == output_format::json_lines && !std::isfinite(number)) {
+		// JSON has no representation for them.
+		buffer_.append("null");
+		return;
+	}
+	std::array<char, 32> digits;
+	// The text format matches the default formatting of iostreams, the others round-trip.
+	const auto result = format_ == output_format::text
+		                    ? std::to_chars(digits.data(), digits.data() + digits.size(), number,
+		                                    std::chars_format::general, 6)
+		                    : std::to_chars(digits.data(), digits.data() + digits.size(), number);
+	buffer_.append(digits.data(), result.ptr);
+}
+
+} // namespace minidb
@@ -1,37 +1,603 @@
 #include <algorithm>
+#include <cmath>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <row_filter.hpp>
+#include <selection_kernels.hpp>
 #include <util.hpp>
 
 namespace minidb {
 
-void row_filter::bind_to_table(const table& tab) {
+namespace {
+
+using comparison = row_filter::comparison;
+using filter_value_type = row_filter::filter_value_type;
+
+constexpr double two_to_the_63 = 9223372036854775808.0;
+constexpr auto integer_min = std::numeric_limits<long long>::min();
+constexpr auto integer_max = std::numeric_limits<long long>::max();
+
+// Smallest cell of type T that is >= bound, or > bound if strict, empty if there is none.
+template <typename T>
+std::optional<T> at_least(long long bound, bool strict) {
+	if constexpr(std::is_same_v<T, double>) {
+		const auto converted = static_cast<double>(bound);
+		return strict ? std::nextafter(converted, INFINITY) : converted;
+	} else {
+		if(!strict) return bound;
+		if(bound == integer_max) return std::nullopt;
+		return bound + 1;
+	}
+}
+
+template <typename T>
+std::optional<T> at_least(double bound, bool strict) {
+	if(std::isnan(bound)) return std::nullopt;
+	if constexpr(std::is_same_v<T, double>) {
+		if(!strict) return bound;
+		if(bound == INFINITY) return std::nullopt;
+		return std::nextafter(bound, INFINITY);
+	} else {
+		const auto ceiled = std::ceil(bound);
+		if(ceiled < -two_to_the_63) return integer_min;
+		if(ceiled >= two_to_the_63) return std::nullopt;
+		const auto integer = static_cast<long long>(ceiled);
+		return strict && ceiled == bound ? at_least<long long>(integer, true) : integer;
+	}
+}
+
+// Largest cell of type T that is <= bound, or < bound if strict, empty if there is none.
+template <typename T>
+std::optional<T> at_most(long long bound, bool strict) {
+	if constexpr(std::is_same_v<T, double>) {
+		const auto converted = static_cast<double>(bound);
+		return strict ? std::nextafter(converted, -INFINITY) : converted;
+	} else {
+		if(!strict) return bound;
+		if(bound == integer_min) return std::nullopt;
+		return bound - 1;
+	}
+}
 
-	for(const auto& pair : filters) {
-		const auto& name = pair.first;
-		int index = -1;
-		const auto& it =
-				std::find_if(tab.columns().begin(), tab.columns().end(),
-				             [&name, &index](const column& column)
-				             {
-					             ++index;
-					             return column.name() == name;
-				             });
-		if(it == tab.columns().end()) throw
-				std::invalid_argument("Table doesn't contain the row: " + std::string(name));
-		column_indexed_filters[index] = pair.second;
+template <typename T>
+std::optional<T> at_most(double bound, bool strict) {
+	if(std::isnan(bound)) return std::nullopt;
+	if constexpr(std::is_same_v<T, double>) {
+		if(!strict) return bound;
+		if(bound == -INFINITY) return std::nullopt;
+		return std::nextafter(bound, -INFINITY);
+	} else {
+		const auto floored = std::floor(bound);
+		if(floored >= two_to_the_63) return integer_max;
+		if(floored < -two_to_the_63) return std::nullopt;
+		const auto integer = static_cast<long long>(floored);
+		return strict && floored == bound ? at_most<long long>(integer, true) : integer;
 	}
 }
 
-bool row_filter::operator()(const row& r) {
+template <typename T>
+std::optional<T> lower_limit(const filter_value_type& operand, bool strict) {
+	if(const auto* integer = std::get_if<long long>(&operand)) return at_least<T>(*integer, strict);
+	return at_least<T>(std::get<double>(operand), strict);
+}
+
+template <typename T>
+std::optional<T> upper_limit(const filter_value_type& operand, bool strict) {
+	if(const auto* integer = std::get_if<long long>(&operand)) return at_most<T>(*integer, strict);
+	return at_most<T>(std::get<double>(operand), strict);
+}
+
+template <typename T>
+constexpr T lowest_cell = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                                : std::numeric_limits<T>::lowest();
+template <typename T>
+constexpr T highest_cell = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                                 : std::numeric_limits<T>::max();
+
+bool is_ordering(comparison op) noexcept {
+	return op != comparison::equal && op != comparison::not_equal && op != comparison::in;
+}
+
+// Typed tests of a single cell, the building blocks of compiled predicates.
+// Cells are of type T, or std::string_view for strings T.
+template <typename T>
+struct equal_to {
+	T key;
+	template <typename Cell>
+	bool operator()(const Cell& cell) const noexcept {
+		return cell == key;
+	}
+};
+
+template <typename T>
+struct within {
+	T lower;
+	T upper;
+	template <typename Cell>
+	bool operator()(const Cell& cell) const noexcept {
+		return lower <= cell && cell <= upper;
+	}
+};
+
+template <typename T, typename Compare>
+struct compared_to {
+	T operand;
+	template <typename Cell>
+	bool operator()(const Cell& cell) const noexcept {
+		return Compare{}(cell, operand);
+	}
+};
 
-	for(const auto& pair : column_indexed_filters) {
-		if( r.get_cell_value_if(pair.first) != pair.second) {
+template <typename T>
+struct one_of {
+	// Sorted and free of duplicates.
+	std::vector<T> values;
+	template <typename Cell>
+	bool operator()(const Cell& cell) const noexcept {
+		return std::binary_search(values.begin(), values.end(), cell);
+	}
+};
+
+// Dictionary codes whose entry satisfies a predicate. Codes interned after binding never match.
+struct matching_codes {
+	std::vector<bool> matches;
+	bool operator()(dictionary_column::code_type code) const noexcept {
+		return code < matches.size() && matches[code];
+	}
+};
+
+// Clears the bit of every selected row i in [0, count) for which matches(i) is false.
+template <typename Matches>
+void select_if(std::size_t count, std::uint64_t* selection, Matches&& matches) {
+	for(std::size_t word = 0; word * 64 < count; ++word) {
+		for(auto bits = selection[word]; bits != 0; bits &= bits - 1) {
+			const auto bit = static_cast<std::size_t>(std::countr_zero(bits));
+			if(!matches(word * 64 + bit)) selection[word] &= ~(std::uint64_t{1} << bit);
+		}
+	}
+}
+
+// The range of cells a test can match, for comparing it with zones.
+template <typename T>
+std::pair<T, T> zone_bounds(const equal_to<T>& test) {
+	return {test.key, test.key};
+}
+
+template <typename T>
+std::pair<T, T> zone_bounds(const within<T>& test) {
+	return {test.lower, test.upper};
+}
+
+template <typename T>
+std::pair<T, T> zone_bounds(const one_of<T>& test) {
+	return {test.values.front(), test.values.back()};
+}
+
+// A predicate checked against the column it names and normalized: on integer and decimal columns every ordering
+// comparison becomes a between with inclusive bounds of the column's type, and [lower, upper] encloses all cells an
+// equal, between or in predicate can match. Predicates whose outcome doesn't depend on the row are constant.
+struct resolved_predicate {
+	std::size_t column_index;
+	const column_storage* column;
+	comparison op;
+	filter_value_type lower;
+	filter_value_type upper;
+	// Sorted operands of in.
+	std::vector<filter_value_type> values;
+	std::optional<bool> constant;
+};
+
+using match_function = std::function<bool(std::size_t)>;
+using select_function = std::function<void(std::size_t, std::size_t, std::uint64_t*)>;
+using zone_function = std::function<bool(std::size_t, std::size_t)>;
+using assign_function = std::function<void(const resolved_predicate&)>;
+
+// The functors of a compiled predicate and the one that passes them new operands.
+struct compiled_test {
+	match_function matches;
+	select_function select;
+	zone_function may_match;
+	assign_function assign;
+};
+
+// A test and its outcome if it doesn't depend on the row, which the functors of a compiled predicate share.
+template <typename Test>
+struct test_state {
+	Test test;
+	std::optional<bool> constant;
+};
+
+// Instantiates the row and the batch evaluation of the test make(resolved) yields for the operands of a resolved
+// predicate on cells, which is any container with operator[]. Equality and ranges on primitive cells with data() use
+// the SIMD selection kernels, and numeric cells skip the zones that can't hold a match.
+template <typename Cells, typename Make>
+compiled_test compile_test(const Cells& cells, Make make) {
+	using test_type = std::invoke_result_t<Make&, const resolved_predicate&>;
+	const auto state = std::make_shared<test_state<test_type>>();
+	compiled_test compiled;
+	compiled.assign = [state, make = std::move(make)](const resolved_predicate& resolved) mutable {
+		if(!resolved.constant) state->test = make(resolved);
+		state->constant = resolved.constant;
+	};
+	compiled.matches = [&cells, state](std::size_t row_index) {
+		return state->constant ? *state->constant : state->test(cells[row_index]);
+	};
+	compiled.select = [&cells, state](std::size_t first_row, std::size_t count, std::uint64_t* selection) {
+		if(state->constant) {
+			if(!*state->constant) std::fill(selection, selection + (count + 63) / 64, 0);
+			return;
+		}
+		const auto& test = state->test;
+		if constexpr(!requires { cells.data(); }) {
+			select_if(count, selection, [&cells, first_row, &test](std::size_t i) { return test(cells[first_row + i]); });
+		} else {
+			const auto* data = cells.data() + first_row;
+			if constexpr(requires { select_equal(data, count, test.key, selection); }) {
+				select_equal(data, count, test.key, selection);
+			} else if constexpr(requires { select_range(data, count, test.lower, test.upper, selection); }) {
+				select_range(data, count, test.lower, test.upper, selection);
+			} else {
+				select_if(count, selection, [data, &test](std::size_t i) { return test(data[i]); });
+			}
+		}
+	};
+	compiled.may_match = [state](std::size_t, std::size_t) { return state->constant.value_or(true); };
+	if constexpr(requires { cells.zones(); zone_bounds(state->test); }) {
+		compiled.may_match = [&cells, state](std::size_t first_row, std::size_t count) {
+			if(state->constant) return *state->constant;
+			const auto [lower, upper] = zone_bounds(state->test);
+			const auto& zones = cells.zones();
+			const auto last_block = std::min((first_row + count - 1) / cells.zone_rows + 1, zones.size());
+			for(auto block = first_row / cells.zone_rows; block < last_block; ++block) {
+				if(zones[block].overlaps(lower, upper)) return true;
+			}
 			return false;
+		};
+	}
+	return compiled;
+}
+
+resolved_predicate resolve(const table& tab, const row_filter::predicate& predicate) {
+	const auto& name = predicate.column;
+	int index = -1;
+	const auto& it =
+			std::find_if(tab.columns().begin(), tab.columns().end(),
+			             [&name, &index](const column& column)
+			             {
+				             ++index;
+				             return column.name() == name;
+			             });
+	if(it == tab.columns().end()) throw
+			std::invalid_argument("Table doesn't contain the row: " + std::string(name));
+	const auto op = predicate.op;
+	const auto& operands = predicate.operands;
+	if(op == comparison::in ? operands.empty() : operands.size() != (op == comparison::between ? 2u : 1u)) throw
+			std::invalid_argument("Wrong number of values in the filter for the column " + name);
+	const auto& column = tab.column_data(static_cast<std::size_t>(index));
+	const bool numeric = column.type() != value_type::string;
+	if(is_ordering(op)) {
+		for(const auto& operand : operands) {
+			if(std::holds_alternative<std::string>(operand) == numeric) throw std::invalid_argument(
+					"Can't order the cells of the column " + name + " relative to a value of a different type");
 		}
 	}
-	// Placeholder to avoid warnings (remove when implemented):
-	return true;
+
+	// The cell an operand of equal, not_equal or in equals, empty if there is none. Integers and decimals compare
+	// numerically, a string never equals a number.
+	const auto equal_cell = [&column, numeric](const filter_value_type& operand) -> std::optional<filter_value_type> {
+		if(std::holds_alternative<std::string>(operand) == numeric) return std::nullopt;
+		return column.visit(overloaded{
+				[&]<typename T>(const numeric_column<T>&) -> std::optional<filter_value_type> {
+					const auto lower = lower_limit<T>(operand, false);
+					const auto upper = upper_limit<T>(operand, false);
+					if(!lower || !upper || *lower != *upper) return std::nullopt;
+					return *lower;
+				},
+				[&operand](const auto&) -> std::optional<filter_value_type> { return operand; }});
+	};
+
+	resolved_predicate resolved{static_cast<std::size_t>(index), &column, op, operands.front(), operands.back(), {}, {}};
+	if(op == comparison::in) {
+		for(const auto& operand : operands) {
+			if(auto cell = equal_cell(operand)) resolved.values.push_back(std::move(*cell));
+		}
+		std::ranges::sort(resolved.values);
+		resolved.values.erase(std::unique(resolved.values.begin(), resolved.values.end()), resolved.values.end());
+		if(resolved.values.empty()) {
+			resolved.constant = false;
+		} else {
+			resolved.lower = resolved.values.front();
+			resolved.upper = resolved.values.back();
+		}
+	} else if(!is_ordering(op)) {
+		if(auto cell = equal_cell(resolved.lower)) {
+			resolved.lower = *cell;
+			resolved.upper = std::move(*cell);
+		} else {
+			// No cell equals the operand, so every cell differs from it.
+			resolved.constant = op == comparison::not_equal;
+		}
+	} else if(numeric) {
+		const bool strict = op == comparison::less || op == comparison::greater;
+		const bool satisfiable = column.visit(overloaded{
+				[&]<typename T>(const numeric_column<T>&) {
+					std::optional<T> lower = lowest_cell<T>;
+					std::optional<T> upper = highest_cell<T>;
+					if(op == comparison::less || op == comparison::less_equal) {
+						upper = upper_limit<T>(operands[0], strict);
+					} else if(op == comparison::greater || op == comparison::greater_equal) {
+						lower = lower_limit<T>(operands[0], strict);
+					} else {
+						lower = lower_limit<T>(operands[0], false);
+						upper = upper_limit<T>(operands[1], false);
+					}
+					if(!lower || !upper || *upper < *lower) return false;
+					resolved.lower = *lower;
+					resolved.upper = *upper;
+					return true;
+				},
+				[](const auto&) { return false; }});
+		resolved.op = comparison::between;
+		if(!satisfiable) resolved.constant = false;
+	}
+	return resolved;
+}
+
+// Instantiates the test of a resolved comparison op for cells of type T.
+template <typename T, typename Cells>
+compiled_test compile_comparison(const Cells& cells, comparison op) {
+	const auto compile = [&cells]<typename Test>(std::type_identity<Test>) {
+		return compile_test(cells,
+		                    [](const resolved_predicate& resolved) { return Test{std::get<T>(resolved.lower)}; });
+	};
+	switch(op) {
+	case comparison::equal: return compile(std::type_identity<equal_to<T>>{});
+	case comparison::not_equal: return compile(std::type_identity<compared_to<T, std::not_equal_to<>>>{});
+	case comparison::less: return compile(std::type_identity<compared_to<T, std::less<>>>{});
+	case comparison::less_equal: return compile(std::type_identity<compared_to<T, std::less_equal<>>>{});
+	case comparison::greater: return compile(std::type_identity<compared_to<T, std::greater<>>>{});
+	case comparison::greater_equal: return compile(std::type_identity<compared_to<T, std::greater_equal<>>>{});
+	case comparison::between:
+		return compile_test(cells, [](const resolved_predicate& resolved) {
+			return within<T>{std::get<T>(resolved.lower), std::get<T>(resolved.upper)};
+		});
+	case comparison::in:
+		return compile_test(cells, [](const resolved_predicate& resolved) {
+			one_of<T> test;
+			for(const auto& value : resolved.values) test.values.push_back(std::get<T>(value));
+			return test;
+		});
+	}
+	throw std::invalid_argument("Unknown comparison");
+}
+
+// Compares a cell against the operands of a resolved predicate.
+template <typename T>
+bool compare(const T& cell, const resolved_predicate& resolved) {
+	const auto& lower = std::get<T>(resolved.lower);
+	switch(resolved.op) {
+	case comparison::equal: return cell == lower;
+	case comparison::not_equal: return cell != lower;
+	case comparison::less: return cell < lower;
+	case comparison::less_equal: return cell <= lower;
+	case comparison::greater: return cell > lower;
+	case comparison::greater_equal: return cell >= lower;
+	case comparison::between: return lower <= cell && cell <= std::get<T>(resolved.upper);
+	case comparison::in:
+		return std::ranges::binary_search(resolved.values, cell, {},
+		                                  [](const filter_value_type& v) -> const T& { return std::get<T>(v); });
+	}
+	return false;
+}
+
+// Runs a filter program on stack, which has room for its intermediate results. test(i) yields the result of
+// predicate i, combine(conjunction, lhs, rhs) the one of a conjunction or disjunction and invert the one of a negation.
+template <typename Result, typename Program, typename Test, typename Combine, typename Invert>
+Result run_program(const Program& program, Result* stack, Test&& test, Combine&& combine, Invert&& invert) {
+	std::size_t depth = 0;
+	for(const auto& step : program) {
+		using code = decltype(step.op);
+		switch(step.op) {
+		case code::test: stack[depth++] = test(step.predicate); break;
+		case code::negation: stack[depth - 1] = invert(stack[depth - 1]); break;
+		default:
+			--depth;
+			stack[depth - 1] = combine(step.op == code::conjunction, stack[depth - 1], stack[depth]);
+			break;
+		}
+	}
+	return stack[0];
+}
+
+// Evaluates a filter program that isn't a plain conjunction for one row. Kept out of row_filter::operator() so
+// the common case of a conjunction doesn't pay for setting up the stack.
+template <typename Program, typename Predicates>
+bool evaluate_row(const Program& program, std::size_t depth, const Predicates& predicates, std::size_t row_index) {
+	constexpr std::size_t inline_depth = 32;
+	std::array<bool, inline_depth> inline_stack{};
+	std::unique_ptr<bool[]> heap_stack;
+	if(depth > inline_depth) heap_stack = std::make_unique<bool[]>(depth);
+	return run_program(program, heap_stack ? heap_stack.get() : inline_stack.data(),
+	                   [&](std::uint32_t i) { return predicates[i].matches(row_index); },
+	                   [](bool conjunction, bool lhs, bool rhs) { return conjunction ? lhs && rhs : lhs || rhs; },
+	                   [](bool result) { return !result; });
+}
+
+// The bits of the first count rows of a batch.
+row_filter::selection_batch all_rows(std::size_t count) {
+	row_filter::selection_batch selection{};
+	for(std::size_t word = 0; word * 64 < count; ++word) {
+		selection[word] = count - word * 64 >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << (count - word * 64)) - 1;
+	}
+	return selection;
+}
+
+} // namespace
+
+void row_filter::bind_to_table(const table& tab) {
+	if(bound_table == &tab) {
+		if(operands_changed || assigned_version != tab.version()) assign_operands();
+		return;
+	}
+	bound_table = nullptr;
+	compiled_predicates.clear();
+	program.clear();
+	program_depth = 0;
+	is_conjunction = true;
+
+	std::size_t depth = 0;
+	for(const auto& term : filter_expression) {
+		if(const auto* op = std::get_if<connective>(&term)) {
+			const std::size_t operands = *op == connective::negation ? 1 : 2;
+			if(depth < operands) throw std::invalid_argument("Malformed filter expression");
+			depth -= operands - 1;
+			switch(*op) {
+			case connective::conjunction: program.push_back({instruction::code::conjunction, 0}); break;
+			case connective::disjunction: program.push_back({instruction::code::disjunction, 0}); break;
+			case connective::negation: program.push_back({instruction::code::negation, 0}); break;
+			}
+			is_conjunction = is_conjunction && *op == connective::conjunction;
+			continue;
+		}
+		program.push_back({instruction::code::test, static_cast<std::uint32_t>(compiled_predicates.size())});
+		program_depth = std::max(program_depth, ++depth);
+
+		// The column and the normalized comparison don't depend on the operands, only whether they make it constant.
+		const auto resolved = resolve(tab, std::get<predicate>(term));
+		const auto& column = *resolved.column;
+		auto test = column.visit(overloaded{
+				[&]<typename T>(const numeric_column<T>& cells) { return compile_comparison<T>(cells, resolved.op); },
+				[&](const column_storage::string_data& cells) {
+					return compile_comparison<std::string>(cells, resolved.op);
+				},
+				[&](const column_storage::dictionary_data& dictionary) {
+					// Resolve the strings to codes once, a string that isn't in the dictionary can't equal any cell.
+					if(resolved.op == comparison::equal) {
+						return compile_test(dictionary.codes(), [&dictionary](const resolved_predicate& resolved) {
+							constexpr auto no_code = std::numeric_limits<dictionary_column::code_type>::max();
+							const auto code = dictionary.find_code(std::get<std::string>(resolved.lower));
+							return equal_to<dictionary_column::code_type>{code.value_or(no_code)};
+						});
+					}
+					return compile_test(dictionary.codes(), [&dictionary](const resolved_predicate& resolved) {
+						matching_codes test;
+						test.matches.resize(dictionary.dictionary_size());
+						for(std::size_t code = 0; code != dictionary.dictionary_size(); ++code) {
+							const auto& entry = dictionary.decode(static_cast<dictionary_column::code_type>(code));
+							test.matches[code] = compare(entry, resolved);
+						}
+						return test;
+					});
+				}});
+		auto& compiled = compiled_predicates.emplace_back();
+		compiled.matches = std::move(test.matches);
+		compiled.select = std::move(test.select);
+		compiled.may_match = std::move(test.may_match);
+		compiled.assign = [&tab, assign = std::move(test.assign)](const predicate& operands) {
+			const auto resolved = resolve(tab, operands);
+			assign(resolved);
+			operand_outcome outcome{resolved.constant};
+			const auto* column_index = tab.find_index(resolved.column_index);
+			if(column_index != nullptr && resolved.op == comparison::equal && !resolved.constant) {
+				outcome.indexed_rows = &column_index->lookup(resolved.lower);
+			}
+			return outcome;
+		};
+	}
+	for(; depth > 1; --depth) program.push_back({instruction::code::conjunction, 0});
+	bound_table = &tab;
+	assign_operands();
+}
+
+void row_filter::assign_operands() {
+	never_matches = false;
+	candidate_rows = nullptr;
+	// Only mark the filter as up to date once all operands were accepted.
+	operands_changed = true;
+	auto compiled = compiled_predicates.begin();
+	for(const auto& term : filter_expression) {
+		const auto* operands = std::get_if<predicate>(&term);
+		if(operands == nullptr) continue;
+		const auto outcome = (compiled++)->assign(*operands);
+		if(!is_conjunction) continue;
+		if(outcome.constant == false) never_matches = true;
+		// Narrow the scan down to the shortest row list any indexed equality filter column yields.
+		const auto* rows = outcome.indexed_rows;
+		if(rows != nullptr && (candidate_rows == nullptr || rows->size() < candidate_rows->size())) {
+			candidate_rows = rows;
+		}
+	}
+	operands_changed = false;
+	assigned_version = bound_table->version();
+}
+
+bool row_filter::operator()(const row& r) const {
+
+	if(never_matches) return false;
+	const auto row_index = r.index();
+	if(is_conjunction) {
+		for(const auto& predicate : compiled_predicates) {
+			if(!predicate.matches(row_index)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	return evaluate_row(program, program_depth, compiled_predicates, row_index);
+}
+
+bool row_filter::may_match(std::size_t first_row, std::size_t count) const {
+	if(never_matches) return false;
+	if(count == 0) return true;
+	const auto predicate_may_match = [&](std::uint32_t i) {
+		const auto& may_match = compiled_predicates[i].may_match;
+		return !may_match || may_match(first_row, count);
+	};
+	if(is_conjunction) {
+		for(std::uint32_t i = 0; i != compiled_predicates.size(); ++i) {
+			if(!predicate_may_match(i)) return false;
+		}
+		return true;
+	}
+	// A zone that may hold a match may also hold a row that doesn't, so nothing is ruled out below a negation.
+	std::vector<char> stack(program_depth);
+	return run_program<char>(program, stack.data(), predicate_may_match,
+	                         [](bool conjunction, bool lhs, bool rhs) { return conjunction ? lhs && rhs : lhs || rhs; },
+	                         [](bool) { return true; });
+}
+
+void row_filter::evaluate_batch(std::size_t first_row, std::size_t count, selection_batch& selection) const {
+	selection.fill(0);
+	if(never_matches) return;
+	selection = all_rows(count);
+	if(bound_table->erased_count() != 0) {
+		for(std::size_t word = 0; word * 64 < count; ++word) selection[word] &= ~bound_table->erased_bits(first_row + word * 64);
+	}
+	if(is_conjunction) {
+		for(const auto& predicate : compiled_predicates) predicate.select(first_row, count, selection.data());
+		return;
+	}
+	const auto mask = selection;
+	std::vector<selection_batch> stack(program_depth);
+	selection = run_program(
+			program, stack.data(),
+			[&](std::uint32_t i) {
+				auto matches = mask;
+				compiled_predicates[i].select(first_row, count, matches.data());
+				return matches;
+			},
+			[](bool conjunction, selection_batch lhs, const selection_batch& rhs) {
+				for(std::size_t word = 0; word != lhs.size(); ++word) {
+					lhs[word] = conjunction ? lhs[word] & rhs[word] : lhs[word] | rhs[word];
+				}
+				return lhs;
+			},
+			[&mask](selection_batch result) {
+				for(std::size_t word = 0; word != result.size(); ++word) result[word] = ~result[word] & mask[word];
+				return result;
+			});
 }
 
 } // namespace minidb
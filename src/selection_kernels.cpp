@@ -0,0 +1,271 @@
+#include <atomic>
+#include <selection_kernels.hpp>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MINIDB_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MINIDB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MINIDB_TARGET_AVX2
+#endif
+
+namespace minidb {
+
+namespace {
+
+constexpr std::size_t word_bits = 64;
+
+// Each block function compares word_bits consecutive cells against the key or range and returns the bit mask of the
+// matching cells.
+template <typename T>
+std::uint64_t equal_mask_scalar(const T* data, T key) noexcept {
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; ++i) mask |= static_cast<std::uint64_t>(data[i] == key) << i;
+	return mask;
+}
+
+template <typename T>
+std::uint64_t range_mask_scalar(const T* data, T lower, T upper) noexcept {
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; ++i) {
+		mask |= static_cast<std::uint64_t>(lower <= data[i] && data[i] <= upper) << i;
+	}
+	return mask;
+}
+
+#ifdef MINIDB_X86_64
+
+// SSE2 has no 64 bit integer compare, so both 32 bit halves of a lane have to compare equal.
+std::uint64_t equal_mask_sse2(const long long* data, long long key) noexcept {
+	const __m128i needle = _mm_set1_epi64x(key);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 2) {
+		const __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		const auto halves =
+				static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(cells, needle))));
+		const std::uint64_t lanes = ((halves & 3u) == 3u ? 1u : 0u) | ((halves & 12u) == 12u ? 2u : 0u);
+		mask |= lanes << i;
+	}
+	return mask;
+}
+
+std::uint64_t equal_mask_sse2(const double* data, double key) noexcept {
+	const __m128d needle = _mm_set1_pd(key);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 2) {
+		const __m128d cells = _mm_loadu_pd(data + i);
+		mask |= static_cast<std::uint64_t>(_mm_movemask_pd(_mm_cmpeq_pd(cells, needle))) << i;
+	}
+	return mask;
+}
+
+std::uint64_t equal_mask_sse2(const std::uint32_t* data, std::uint32_t key) noexcept {
+	const __m128i needle = _mm_set1_epi32(static_cast<int>(key));
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 4) {
+		const __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		mask |= static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(cells, needle)))) << i;
+	}
+	return mask;
+}
+
+// SSE2 has no 64 bit integer ordering either, integer ranges only have a scalar and an AVX2 kernel.
+std::uint64_t range_mask_sse2(const double* data, double lower, double upper) noexcept {
+	const __m128d low = _mm_set1_pd(lower);
+	const __m128d high = _mm_set1_pd(upper);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 2) {
+		const __m128d cells = _mm_loadu_pd(data + i);
+		const __m128d inside = _mm_and_pd(_mm_cmpge_pd(cells, low), _mm_cmple_pd(cells, high));
+		mask |= static_cast<std::uint64_t>(_mm_movemask_pd(inside)) << i;
+	}
+	return mask;
+}
+
+MINIDB_TARGET_AVX2 std::uint64_t equal_mask_avx2(const long long* data, long long key) noexcept {
+	const __m256i needle = _mm256_set1_epi64x(key);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 4) {
+		const __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(cells, needle))))
+		        << i;
+	}
+	return mask;
+}
+
+MINIDB_TARGET_AVX2 std::uint64_t equal_mask_avx2(const double* data, double key) noexcept {
+	const __m256d needle = _mm256_set1_pd(key);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 4) {
+		const __m256d cells = _mm256_loadu_pd(data + i);
+		mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(cells, needle, _CMP_EQ_OQ))) << i;
+	}
+	return mask;
+}
+
+MINIDB_TARGET_AVX2 std::uint64_t equal_mask_avx2(const std::uint32_t* data, std::uint32_t key) noexcept {
+	const __m256i needle = _mm256_set1_epi32(static_cast<int>(key));
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 8) {
+		const __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		mask |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(cells, needle))))
+		        << i;
+	}
+	return mask;
+}
+
+MINIDB_TARGET_AVX2 std::uint64_t range_mask_avx2(const long long* data, long long lower, long long upper) noexcept {
+	const __m256i low = _mm256_set1_epi64x(lower);
+	const __m256i high = _mm256_set1_epi64x(upper);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 4) {
+		const __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(low, cells), _mm256_cmpgt_epi64(cells, high));
+		mask |= static_cast<std::uint64_t>(~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF) << i;
+	}
+	return mask;
+}
+
+MINIDB_TARGET_AVX2 std::uint64_t range_mask_avx2(const double* data, double lower, double upper) noexcept {
+	const __m256d low = _mm256_set1_pd(lower);
+	const __m256d high = _mm256_set1_pd(upper);
+	std::uint64_t mask = 0;
+	for(std::size_t i = 0; i != word_bits; i += 4) {
+		const __m256d cells = _mm256_loadu_pd(data + i);
+		const __m256d inside = _mm256_and_pd(_mm256_cmp_pd(cells, low, _CMP_GE_OQ), _mm256_cmp_pd(cells, high, _CMP_LE_OQ));
+		mask |= static_cast<std::uint64_t>(_mm256_movemask_pd(inside)) << i;
+	}
+	return mask;
+}
+
+#endif // MINIDB_X86_64
+
+std::atomic<simd_level>& active_level() noexcept {
+	static std::atomic<simd_level> level{detected_simd_level()};
+	return level;
+}
+
+template <typename T>
+std::uint64_t equal_mask(const T* data, T key) noexcept {
+#ifdef MINIDB_X86_64
+	switch(active_level().load(std::memory_order_relaxed)) {
+	case simd_level::avx2: return equal_mask_avx2(data, key);
+	case simd_level::sse2: return equal_mask_sse2(data, key);
+	case simd_level::scalar: break;
+	}
+#endif
+	return equal_mask_scalar(data, key);
+}
+
+std::uint64_t range_mask(const long long* data, long long lower, long long upper) noexcept {
+#ifdef MINIDB_X86_64
+	if(active_level().load(std::memory_order_relaxed) == simd_level::avx2) return range_mask_avx2(data, lower, upper);
+#endif
+	return range_mask_scalar(data, lower, upper);
+}
+
+std::uint64_t range_mask(const double* data, double lower, double upper) noexcept {
+#ifdef MINIDB_X86_64
+	switch(active_level().load(std::memory_order_relaxed)) {
+	case simd_level::avx2: return range_mask_avx2(data, lower, upper);
+	case simd_level::sse2: return range_mask_sse2(data, lower, upper);
+	case simd_level::scalar: break;
+	}
+#endif
+	return range_mask_scalar(data, lower, upper);
+}
+
+// Applies block_mask to all full words of the selection and matches to the cells of a partial last word.
+template <typename T, typename BlockMask, typename Matches>
+void select_words(const T* data, std::size_t count, std::uint64_t* selection, BlockMask block_mask,
+                  Matches matches) noexcept {
+	std::size_t word = 0;
+	for(; (word + 1) * word_bits <= count; ++word) {
+		// Rows already ruled out by an earlier predicate don't need to be compared again.
+		if(selection[word] != 0) selection[word] &= block_mask(data + word * word_bits);
+	}
+	const auto tail = count - word * word_bits;
+	if(tail != 0) {
+		std::uint64_t mask = ~std::uint64_t{0} << tail;
+		for(std::size_t i = 0; i != tail; ++i) {
+			mask |= static_cast<std::uint64_t>(matches(data[word * word_bits + i])) << i;
+		}
+		selection[word] &= mask;
+	}
+}
+
+template <typename T>
+void select_equal_words(const T* data, std::size_t count, T key, std::uint64_t* selection) noexcept {
+	select_words(data, count, selection, [key](const T* block) { return equal_mask(block, key); },
+	             [key](T cell) { return cell == key; });
+}
+
+template <typename T>
+void select_range_words(const T* data, std::size_t count, T lower, T upper, std::uint64_t* selection) noexcept {
+	select_words(data, count, selection, [lower, upper](const T* block) { return range_mask(block, lower, upper); },
+	             [lower, upper](T cell) { return lower <= cell && cell <= upper; });
+}
+
+} // namespace
+
+simd_level detected_simd_level() noexcept {
+#ifdef MINIDB_X86_64
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] >= 7) {
+		__cpuid(info, 1);
+		const bool os_saves_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		if(os_saves_avx && (info[1] & (1 << 5)) != 0) return simd_level::avx2;
+	}
+	return simd_level::sse2;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? simd_level::avx2 : simd_level::sse2;
+#endif
+#else
+	return simd_level::scalar;
+#endif
+}
+
+simd_level active_simd_level() noexcept {
+	return active_level().load(std::memory_order_relaxed);
+}
+
+void set_simd_level(simd_level level) {
+	if(static_cast<int>(level) > static_cast<int>(detected_simd_level())) throw std::invalid_argument(
+			"The requested SIMD level isn't supported by this CPU");
+	active_level().store(level, std::memory_order_relaxed);
+}
+
+void select_equal(const long long* data, std::size_t count, long long key, std::uint64_t* selection) noexcept {
+	select_equal_words(data, count, key, selection);
+}
+
+void select_equal(const double* data, std::size_t count, double key, std::uint64_t* selection) noexcept {
+	select_equal_words(data, count, key, selection);
+}
+
+void select_equal(const std::uint32_t* data, std::size_t count, std::uint32_t key, std::uint64_t* selection) noexcept {
+	select_equal_words(data, count, key, selection);
+}
+
+void select_range(const long long* data, std::size_t count, long long lower, long long upper,
+                  std::uint64_t* selection) noexcept {
+	select_range_words(data, count, lower, upper, selection);
+}
+
+void select_range(const double* data, std::size_t count, double lower, double upper,
+                  std::uint64_t* selection) noexcept {
+	select_range_words(data, count, lower, upper, selection);
+}
+
+} // namespace minidb
@@ -0,0 +1,319 @@
+#include <server.hpp>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <charconv>
+#include <command_processor.hpp>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace minidb {
+
+#ifdef __linux__
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+struct connection {
+	connection(database& db, const server::options& opts) : processor(db), max_line_size(opts.max_line_size) {
+		processor.set_output_format(opts.format);
+	}
+
+	command_processor processor;
+	std::size_t max_line_size;
+	std::ostringstream command_output;
+	std::string input;
+	// Responses not yet sent start at output_start.
+	std::string output;
+	std::size_t output_start = 0;
+	bool peer_closed = false;
+	// Set after exit or an overlong line, the connection closes once its responses are sent.
+	bool closing = false;
+
+	std::size_t pending_output() const noexcept {
+		return output.size() - output_start;
+	}
+
+	void respond(std::string_view status, std::string_view body) {
+		char size[24];
+		const auto end = std::to_chars(size, size + sizeof(size), body.size()).ptr;
+		output.append(status).append(" ").append(size, end).append("\n").append(body);
+	}
+
+	// Executes the complete lines received so far, until the output backs up.
+	void execute_lines() {
+		std::size_t line_start = 0;
+		while(!closing && pending_output() < server::max_pending_output) {
+			const auto line_end = input.find('\n', line_start);
+			if(line_end == std::string::npos) break;
+			auto line = std::string_view(input).substr(line_start, line_end - line_start);
+			line_start = line_end + 1;
+			if(!line.empty() && line.back() == '\r') line.remove_suffix(1);
+			if(line.empty()) continue;
+			command_output.str({});
+			try {
+				processor.execute(line, command_output);
+				respond("ok", command_output.view());
+			} catch(const std::exception& ex) {
+				respond("error", ex.what());
+			}
+			closing = processor.should_exit();
+		}
+		input.erase(0, line_start);
+		// Complete lines may be left over while the output backs up, only the last, partial one can be too long.
+		const auto last_line_end = input.rfind('\n');
+		const auto partial_line = last_line_end == std::string::npos ? input.size() : input.size() - last_line_end - 1;
+		if(!closing && partial_line > max_line_size) {
+			respond("error", "Command line too long");
+			closing = true;
+		}
+	}
+
+	// Returns false once the peer closed its end, or on any error.
+	bool receive(int fd) {
+		char buffer[1 << 16];
+		while(true) {
+			const auto received = ::recv(fd, buffer, sizeof(buffer), 0);
+			if(received > 0) {
+				input.append(buffer, static_cast<std::size_t>(received));
+				// The rest is read once these lines ran.
+				if(input.size() > max_line_size) return true;
+				continue;
+			}
+			if(received < 0 && errno == EINTR) continue;
+			return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+		}
+	}
+
+	// Returns false on an error, when the connection can only be closed.
+	bool send(int fd) {
+		while(pending_output() != 0) {
+			const auto sent = ::send(fd, output.data() + output_start, pending_output(), MSG_NOSIGNAL);
+			if(sent >= 0) {
+				output_start += static_cast<std::size_t>(sent);
+				continue;
+			}
+			if(errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		output.clear();
+		output_start = 0;
+		return true;
+	}
+};
+
+} // namespace
+
+class server::event_loop {
+public:
+	explicit event_loop(server& srv) : server_(srv), epoll_fd_(::epoll_create1(EPOLL_CLOEXEC)) {
+		if(epoll_fd_ < 0) throw_errno("Failed to create an epoll instance");
+		// Every loop waits for new connections, EPOLLEXCLUSIVE wakes only one of them per connection.
+		watch(server_.listen_fd_, EPOLLIN | EPOLLEXCLUSIVE, EPOLL_CTL_ADD);
+		watch(server_.stop_fd_, EPOLLIN, EPOLL_CTL_ADD);
+	}
+	~event_loop() {
+		for(const auto& [fd, conn] : connections_) ::close(fd);
+		::close(epoll_fd_);
+	}
+	event_loop(const event_loop&) = delete;
+	event_loop& operator=(const event_loop&) = delete;
+
+	void run() {
+		epoll_event events[64];
+		while(true) {
+			const auto count = ::epoll_wait(epoll_fd_, events, 64, -1);
+			if(count < 0) {
+				if(errno == EINTR) continue;
+				throw_errno("Failed to wait for connections");
+			}
+			for(int index = 0; index != count; ++index) {
+				const auto fd = events[index].data.fd;
+				// The stop event is never reset, so it reaches every loop.
+				if(fd == server_.stop_fd_) return;
+				if(fd == server_.listen_fd_) accept_connections();
+				else serve(fd, events[index].events);
+			}
+		}
+	}
+
+private:
+	void watch(int fd, std::uint32_t events, int operation) {
+		epoll_event event{};
+		event.events = events;
+		event.data.fd = fd;
+		if(::epoll_ctl(epoll_fd_, operation, fd, &event) != 0) throw_errno("Failed to watch a socket");
+	}
+
+	void accept_connections() {
+		while(true) {
+			const auto fd = ::accept4(server_.listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if(fd < 0) {
+				if(errno == EINTR || errno == ECONNABORTED) continue;
+				// EAGAIN once all pending connections are accepted. Running out of descriptors leaves the remaining
+				// ones waiting in the backlog.
+				return;
+			}
+			if(server_.port_ != 0) {
+				const int enable = 1;
+				::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+			}
+			connections_.emplace(fd, std::make_unique<connection>(server_.db_, server_.options_));
+			watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+		}
+	}
+
+	void serve(int fd, std::uint32_t events) {
+		auto& conn = *connections_.at(fd);
+		if((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 && !conn.peer_closed && !conn.closing) {
+			conn.peer_closed = !conn.receive(fd);
+		}
+		conn.execute_lines();
+		auto ok = conn.send(fd);
+		// The commands left unread while the output was backed up run once it has drained.
+		while(ok && conn.pending_output() == 0 && !conn.closing && conn.input.find('\n') != std::string::npos) {
+			conn.execute_lines();
+			ok = conn.send(fd);
+		}
+		const bool done = conn.pending_output() == 0 && (conn.closing || conn.peer_closed);
+		if(!ok || done || (events & EPOLLERR) != 0) {
+			::close(fd);
+			connections_.erase(fd);
+			return;
+		}
+		std::uint32_t wanted = 0;
+		if(!conn.closing && !conn.peer_closed && conn.pending_output() < max_pending_output) wanted |= EPOLLIN;
+		if(conn.pending_output() != 0) wanted |= EPOLLOUT;
+		watch(fd, wanted, EPOLL_CTL_MOD);
+	}
+
+	server& server_;
+	int epoll_fd_;
+	std::unordered_map<int, std::unique_ptr<connection>> connections_;
+};
+
+server::server(database& db, std::string_view address, options opts) : db_(db), options_(opts) {
+	if(options_.event_loops == 0) options_.event_loops = 1;
+	unsigned port = 0;
+	const auto [end, error] = std::from_chars(address.data(), address.data() + address.size(), port);
+	const bool tcp = !address.empty() && error == std::errc{} && end == address.data() + address.size();
+	if(tcp && port > 65535) throw std::invalid_argument("Invalid port " + std::string(address));
+	sockaddr_storage storage{};
+	socklen_t storage_size = 0;
+	if(tcp) {
+		auto& in = reinterpret_cast<sockaddr_in&>(storage);
+		in.sin_family = AF_INET;
+		in.sin_port = htons(static_cast<std::uint16_t>(port));
+		in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		storage_size = sizeof(in);
+	} else {
+		auto& un = reinterpret_cast<sockaddr_un&>(storage);
+		if(address.empty() || address.size() >= sizeof(un.sun_path)) {
+			throw std::invalid_argument("Invalid socket path " + std::string(address));
+		}
+		un.sun_family = AF_UNIX;
+		std::memcpy(un.sun_path, address.data(), address.size());
+		storage_size = sizeof(un);
+		socket_path_ = address;
+		std::error_code ignored;
+		if(std::filesystem::is_socket(socket_path_, ignored)) std::filesystem::remove(socket_path_, ignored);
+	}
+	listen_fd_ = ::socket(tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(listen_fd_ < 0) throw_errno("Failed to create a socket");
+	try {
+		if(tcp) {
+			const int enable = 1;
+			::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+		}
+		if(::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&storage), storage_size) != 0) {
+			throw_errno("Failed to bind to " + std::string(address));
+		}
+		if(::listen(listen_fd_, SOMAXCONN) != 0) throw_errno("Failed to listen on " + std::string(address));
+		if(tcp) {
+			sockaddr_in bound{};
+			socklen_t bound_size = sizeof(bound);
+			if(::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&bound), &bound_size) != 0) {
+				throw_errno("Failed to query the listening port");
+			}
+			port_ = ntohs(bound.sin_port);
+		}
+		stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(stop_fd_ < 0) throw_errno("Failed to create an eventfd");
+	} catch(...) {
+		::close(listen_fd_);
+		throw;
+	}
+}
+
+server::~server() {
+	::close(stop_fd_);
+	::close(listen_fd_);
+	if(!socket_path_.empty()) {
+		std::error_code ignored;
+		std::filesystem::remove(socket_path_, ignored);
+	}
+}
+
+void server::run() {
+	std::vector<std::unique_ptr<event_loop>> loops;
+	for(std::size_t index = 0; index != options_.event_loops; ++index) {
+		loops.push_back(std::make_unique<event_loop>(*this));
+	}
+	// A loop failing stops the others, run() then rethrows its exception.
+	std::vector<std::exception_ptr> errors(loops.size());
+	const auto run_loop = [&](std::size_t index) {
+		try {
+			loops[index]->run();
+		} catch(...) {
+			errors[index] = std::current_exception();
+			stop();
+		}
+	};
+	std::vector<std::thread> threads;
+	for(std::size_t index = 1; index != loops.size(); ++index) threads.emplace_back(run_loop, index);
+	run_loop(0);
+	for(auto& thread : threads) thread.join();
+	for(const auto& error : errors) {
+		if(error) std::rethrow_exception(error);
+	}
+}
+
+void server::stop() noexcept {
+	const std::uint64_t increment = 1;
+	[[maybe_unused]] const auto written = ::write(stop_fd_, &increment, sizeof(increment));
+}
+
+#else
+
+server::server(database& db, std::string_view, options opts) : db_(db), options_(opts) {
+	throw std::runtime_error("Serving clients requires Linux");
+}
+
+server::~server() = default;
+
+void server::run() {}
+
+void server::stop() noexcept {}
+
+#endif
+
+} // namespace minidb
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sketch.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace minidb {
+
+hyperloglog::hyperloglog(unsigned precision) : precision_(precision) {
+	if(precision < 4 || precision > 18) throw std::invalid_argument("HyperLogLog precision must be from 4 to 18");
+	registers_.resize(std::size_t{1} << precision);
+}
+
+void hyperloglog::merge(const hyperloglog& other) {
+	if(other.precision_ != precision_) throw std::invalid_argument("Can't merge HyperLogLogs of different precision");
+	for(std::size_t index = 0; index != registers_.size(); ++index) {
+		registers_[index] = std::max(registers_[index], other.registers_[index]);
+	}
+}
+
+double hyperloglog::estimate() const {
+	const auto m = static_cast<double>(registers_.size());
+	double sum = 0;
+	std::size_t zeros = 0;
+	for(const auto reg : registers_) {
+		sum += std::ldexp(1.0, -reg);
+		if(reg == 0) ++zeros;
+	}
+	double alpha = 0.7213 / (1 + 1.079 / m);
+	if(registers_.size() == 16) alpha = 0.673;
+	else if(registers_.size() == 32) alpha = 0.697;
+	else if(registers_.size() == 64) alpha = 0.709;
+	const auto raw = alpha * m * m / sum;
+	// 64-bit hashes make a correction for large counts unnecessary.
+	if(raw <= 2.5 * m && zeros != 0) return m * std::log(m / static_cast<double>(zeros));
+	return raw;
+}
+
+quantile_sketch::quantile_sketch(std::size_t accuracy, std::uint64_t seed)
+	: accuracy_(accuracy), random_state_(seed | 1) {
+	if(accuracy < 8) throw std::invalid_argument("The accuracy of a quantile sketch must be at least 8");
+	add_level();
+}
+
+void quantile_sketch::merge(const quantile_sketch& other) {
+	while(levels_.size() < other.levels_.size()) add_level();
+	for(std::size_t level = 0; level != other.levels_.size(); ++level) {
+		levels_[level].insert(levels_[level].end(), other.levels_[level].begin(), other.levels_[level].end());
+	}
+	count_ += other.count_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+	compress();
+}
+
+std::vector<double> quantile_sketch::quantiles(std::span<const double> fractions) const {
+	for(const auto fraction : fractions) {
+		if(!(fraction >= 0 && fraction <= 1)) throw std::invalid_argument("Quantiles must be between 0 and 1");
+	}
+	if(count_ == 0) return std::vector<double>(fractions.size(), std::numeric_limits<double>::quiet_NaN());
+	std::vector<std::pair<double, double>> weighted;
+	for(std::size_t level = 0; level != levels_.size(); ++level) {
+		for(const auto number : levels_[level]) weighted.emplace_back(number, std::ldexp(1.0, static_cast<int>(level)));
+	}
+	std::sort(weighted.begin(), weighted.end());
+	// Turns the weights into the rank of the last number each stands for.
+	for(std::size_t index = 1; index != weighted.size(); ++index) weighted[index].second += weighted[index - 1].second;
+	std::vector<double> rslt;
+	for(const auto fraction : fractions) {
+		if(fraction == 0 || fraction == 1) {
+			rslt.push_back(fraction == 0 ? min_ : max_);
+			continue;
+		}
+		const auto rank = fraction * weighted.back().second;
+		const auto found = std::lower_bound(weighted.begin(), weighted.end(), rank,
+		                                    [](const auto& entry, double r) { return entry.second < r; });
+		rslt.push_back(found == weighted.end() ? weighted.back().first : found->first);
+	}
+	return rslt;
+}
+
+// The top level holds up to accuracy numbers, every level below two thirds of the one above, but at least 8.
+void quantile_sketch::add_level() {
+	levels_.emplace_back();
+	capacities_.resize(levels_.size());
+	auto size = static_cast<double>(accuracy_);
+	for(auto level = capacities_.size(); level-- != 0; size *= 2.0 / 3.0) {
+		capacities_[level] = std::max<std::size_t>(8, static_cast<std::size_t>(std::ceil(size)));
+	}
+}
+
+void quantile_sketch::compress() {
+	for(std::size_t level = 0; level != levels_.size(); ++level) {
+		if(levels_[level].size() < capacities_[level]) continue;
+		if(level + 1 == levels_.size()) add_level();
+		auto& numbers = levels_[level];
+		auto& next = levels_[level + 1];
+		std::sort(numbers.begin(), numbers.end());
+		// Of an odd number of numbers the largest stays on this level.
+		const auto paired = numbers.size() - numbers.size() % 2;
+		for(auto index = std::size_t{random_bit()}; index < paired; index += 2) next.push_back(numbers[index]);
+		numbers.erase(numbers.begin(), numbers.begin() + static_cast<std::ptrdiff_t>(paired));
+	}
+}
+
+bool quantile_sketch::random_bit() noexcept {
+	// xorshift64
+	random_state_ ^= random_state_ << 13;
+	random_state_ ^= random_state_ >> 7;
+	random_state_ ^= random_state_ << 17;
+	return (random_state_ >> 63) != 0;
+}
+
+} // namespace minidb
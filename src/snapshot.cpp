@@ -0,0 +1,300 @@
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <mapped_file.hpp>
+#include <memory>
+#include <snapshot.hpp>
+#include <stdexcept>
+#include <system_error>
+#include <util.hpp>
+
+namespace minidb {
+
+namespace {
+
+constexpr std::array<char, 8> file_magic{'M', 'D', 'B', 'S', 'N', 'A', 'P', '\0'};
+// Written in native byte order, so a snapshot from a machine with a different byte order is detected.
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t column_alignment = 8;
+
+class snapshot_writer {
+	std::ofstream out_;
+	std::uint64_t offset_ = 0;
+
+public:
+	explicit snapshot_writer(const std::filesystem::path& path) : out_(path, std::ios::binary | std::ios::trunc) {
+		if(!out_) throw std::system_error(errno, std::generic_category(), "Failed to create " + path.string());
+	}
+
+	void bytes(const void* data, std::size_t size) {
+		out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		offset_ += size;
+	}
+
+	template <typename T>
+	void raw(const T& v) {
+		bytes(&v, sizeof(T));
+	}
+
+	void u8(std::uint8_t v) {
+		raw(v);
+	}
+
+	void u64(std::uint64_t v) {
+		raw(v);
+	}
+
+	void string(std::string_view s) {
+		u64(s.size());
+		bytes(s.data(), s.size());
+	}
+
+	void align() {
+		static constexpr std::array<char, column_alignment> padding{};
+		bytes(padding.data(), (column_alignment - offset_ % column_alignment) % column_alignment);
+	}
+
+	// Writes strings as an offset array followed by their concatenated bytes.
+	template <typename Strings>
+	void strings(const Strings& strings, std::size_t count) {
+		std::uint64_t end = 0;
+		u64(end);
+		for(std::size_t i = 0; i != count; ++i) u64(end += strings[i].size());
+		for(std::size_t i = 0; i != count; ++i) bytes(strings[i].data(), strings[i].size());
+	}
+
+	void finish() {
+		out_.flush();
+		if(!out_) throw std::runtime_error("Failed to write the snapshot");
+		out_.close();
+	}
+};
+
+class snapshot_reader {
+	std::shared_ptr<const mapped_file> file_;
+	std::size_t offset_ = 0;
+
+	const std::byte* take(std::size_t size) {
+		if(file_->size() - offset_ < size) throw std::runtime_error("Truncated snapshot");
+		const auto* data = file_->data() + offset_;
+		offset_ += size;
+		return data;
+	}
+
+	// The validated offsets and bytes of count strings written by snapshot_writer::strings.
+	std::pair<const std::uint64_t*, const char*> string_block(std::size_t count) {
+		const auto* offsets = array<std::uint64_t>(count + 1);
+		const auto total = offsets[count];
+		const auto* bytes = reinterpret_cast<const char*>(take(static_cast<std::size_t>(total)));
+		for(std::size_t i = 0; i != count; ++i) {
+			if(offsets[i] > offsets[i + 1] || offsets[i + 1] > total) throw std::runtime_error("Corrupt snapshot");
+		}
+		return {offsets, bytes};
+	}
+
+public:
+	explicit snapshot_reader(const std::filesystem::path& path) : file_(std::make_shared<const mapped_file>(path)) {}
+
+	const std::shared_ptr<const mapped_file>& file() const noexcept {
+		return file_;
+	}
+
+	template <typename T>
+	T raw() {
+		T v;
+		std::memcpy(&v, take(sizeof(T)), sizeof(T));
+		return v;
+	}
+
+	std::uint8_t u8() {
+		return raw<std::uint8_t>();
+	}
+
+	std::uint64_t u64() {
+		return raw<std::uint64_t>();
+	}
+
+	// Reads a size that is used to allocate memory, rejecting sizes that can't fit in the rest of the file.
+	std::size_t count(std::size_t element_size) {
+		const auto n = u64();
+		if(n > (file_->size() - offset_) / element_size) throw std::runtime_error("Corrupt snapshot");
+		return static_cast<std::size_t>(n);
+	}
+
+	std::string string() {
+		const auto size = count(1);
+		return {reinterpret_cast<const char*>(take(size)), size};
+	}
+
+	void align() {
+		take((column_alignment - offset_ % column_alignment) % column_alignment);
+	}
+
+	// Returns count cells of type T in place, the caller keeps file() alive while using them.
+	template <typename T>
+	const T* array(std::size_t count) {
+		if(count > (file_->size() - offset_) / sizeof(T)) throw std::runtime_error("Truncated snapshot");
+		return reinterpret_cast<const T*>(take(count * sizeof(T)));
+	}
+
+	std::vector<std::string> strings(std::size_t count) {
+		const auto [offsets, bytes] = string_block(count);
+		std::vector<std::string> result;
+		result.reserve(count);
+		for(std::size_t i = 0; i != count; ++i) {
+			result.emplace_back(bytes + offsets[i], static_cast<std::size_t>(offsets[i + 1] - offsets[i]));
+		}
+		return result;
+	}
+
+	string_column string_heap(std::size_t count) {
+		const auto [offsets, bytes] = string_block(count);
+		return {offsets, bytes, count};
+	}
+};
+
+void write_column(snapshot_writer& out, const column_storage& column) {
+	out.align();
+	column.visit(overloaded{[&out]<typename T>(const numeric_column<T>& cells) {
+		                        out.bytes(cells.data(), cells.size() * sizeof(T));
+	                        },
+	                        [&out](const column_storage::string_data& cells) { out.strings(cells, cells.size()); },
+	                        [&out](const column_storage::dictionary_data& cells) {
+		                        const auto entry_count = cells.dictionary_size();
+		                        out.u64(entry_count);
+		                        std::uint64_t end = 0;
+		                        out.u64(end);
+		                        for(std::size_t code = 0; code != entry_count; ++code) {
+			                        out.u64(end += cells.decode(static_cast<dictionary_column::code_type>(code)).size());
+		                        }
+		                        for(std::size_t code = 0; code != entry_count; ++code) {
+			                        const auto& entry = cells.decode(static_cast<dictionary_column::code_type>(code));
+			                        out.bytes(entry.data(), entry.size());
+		                        }
+		                        out.align();
+		                        out.bytes(cells.codes().data(), cells.size() * sizeof(dictionary_column::code_type));
+	                        }});
+}
+
+column_storage read_column(snapshot_reader& in, const column& col, std::size_t row_count) {
+	in.align();
+	if(col.encoding() == column_encoding::dictionary) {
+		auto entries = in.strings(in.count(sizeof(std::uint64_t)));
+		in.align();
+		const auto* codes = in.array<dictionary_column::code_type>(row_count);
+		return column_storage{dictionary_column{std::move(entries), {codes, codes + row_count}}};
+	}
+	switch(col.type()) {
+	case value_type::integer:
+		return column_storage{column_storage::integer_data{in.file(), in.array<long long>(row_count), row_count}};
+	case value_type::decimal:
+		return column_storage{column_storage::decimal_data{in.file(), in.array<double>(row_count), row_count}};
+	case value_type::string: return column_storage{in.string_heap(row_count)};
+	}
+	throw std::runtime_error("Unknown column type in snapshot");
+}
+
+} // namespace
+
+void write_snapshot(const std::filesystem::path& path, const table_map& tables) {
+	auto temporary_path = path;
+	temporary_path += ".tmp";
+	{
+		snapshot_writer out(temporary_path);
+		out.bytes(file_magic.data(), file_magic.size());
+		out.raw(snapshot_version);
+		out.raw(byte_order_mark);
+		out.u64(tables.size());
+		for(const auto& [name, tab] : tables) {
+			out.string(name);
+			out.u64(tab.columns().size());
+			for(const auto& col : tab.columns()) {
+				out.string(col.name());
+				out.u8(static_cast<std::uint8_t>(col.type()));
+				out.u8(static_cast<std::uint8_t>(col.encoding()));
+			}
+			out.u64(tab.slot_count());
+			const auto words = (tab.slot_count() + 63) / 64;
+			out.u64(tab.erased_count() == 0 ? 0 : words);
+			for(std::size_t word = 0; tab.erased_count() != 0 && word != words; ++word) out.u64(tab.erased_bits(word * 64));
+			out.u64(tab.next_row_id());
+			out.u64(tab.row_ids().size());
+			for(const auto id : tab.row_ids()) out.u64(id);
+			std::vector<std::pair<std::size_t, index_kind>> indexes;
+			for(std::size_t column_index = 0; column_index != tab.columns().size(); ++column_index) {
+				if(const auto* index = tab.find_index(column_index)) indexes.emplace_back(column_index, index->kind());
+			}
+			out.u64(indexes.size());
+			for(const auto& [column_index, kind] : indexes) {
+				out.u64(column_index);
+				out.u8(static_cast<std::uint8_t>(kind));
+			}
+			for(std::size_t column_index = 0; column_index != tab.columns().size(); ++column_index) {
+				write_column(out, tab.column_data(column_index));
+			}
+		}
+		out.finish();
+	}
+	std::filesystem::rename(temporary_path, path);
+}
+
+table_map read_snapshot(const std::filesystem::path& path) {
+	snapshot_reader in(path);
+	const auto magic = in.raw<std::array<char, 8>>();
+	if(magic != file_magic) throw std::runtime_error(path.string() + " is not a minidb snapshot");
+	const auto version = in.raw<std::uint32_t>();
+	if(version == 0 || version > snapshot_version) {
+		throw std::runtime_error("Unsupported snapshot version " + std::to_string(version));
+	}
+	if(in.raw<std::uint32_t>() != byte_order_mark) throw std::runtime_error("Snapshot was written with a different byte order");
+
+	table_map tables;
+	for(auto table_count = in.u64(); table_count != 0; --table_count) {
+		auto name = in.string();
+		std::vector<column> columns;
+		for(auto column_count = in.count(2); column_count != 0; --column_count) {
+			auto column_name = in.string();
+			const auto type = static_cast<value_type>(in.u8());
+			const auto encoding = static_cast<column_encoding>(in.u8());
+			if(type > value_type::string || encoding > column_encoding::dictionary) {
+				throw std::runtime_error("Corrupt snapshot");
+			}
+			columns.emplace_back(std::move(column_name), type, encoding);
+		}
+		const auto row_count = static_cast<std::size_t>(in.u64());
+		std::vector<bool> erase_mask;
+		if(version >= 2) {
+			const auto words = in.count(8);
+			if(words != 0 && words != (row_count + 63) / 64) throw std::runtime_error("Corrupt snapshot");
+			erase_mask.resize(words * 64);
+			for(std::size_t word = 0; word != words; ++word) {
+				const auto bits = in.u64();
+				for(std::size_t bit = 0; bit != 64; ++bit) erase_mask[word * 64 + bit] = (bits >> bit & 1) != 0;
+			}
+			erase_mask.resize(words == 0 ? 0 : row_count);
+		}
+		auto next_row_id = static_cast<row_id>(row_count);
+		std::vector<row_id> row_ids;
+		if(version >= 3) {
+			next_row_id = in.u64();
+			row_ids.resize(in.count(8));
+			for(auto& id : row_ids) id = in.u64();
+		}
+		std::vector<std::pair<std::size_t, index_kind>> indexes(in.count(9));
+		for(auto& [column_index, kind] : indexes) {
+			column_index = static_cast<std::size_t>(in.u64());
+			kind = static_cast<index_kind>(in.u8());
+		}
+		std::vector<column_storage> column_data;
+		column_data.reserve(columns.size());
+		for(const auto& col : columns) column_data.push_back(read_column(in, col, row_count));
+		table tab{name, schema{std::move(columns)}, std::move(column_data)};
+		tab.restore_row_ids(std::move(row_ids), next_row_id);
+		if(!erase_mask.empty()) tab.erase_rows(erase_mask);
+		for(const auto& [column_index, kind] : indexes) tab.create_index(column_index, kind);
+		tables.emplace(std::move(name), std::move(tab));
+	}
+	return tables;
+}
+
+} // namespace minidb
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cstring>
+#include <string_column.hpp>
+
+namespace minidb {
+
+namespace {
+
+std::size_t varint_size(std::size_t number) noexcept {
+	std::size_t size = 1;
+	for(; number >= 0x80; number >>= 7) ++size;
+	return size;
+}
+
+char* write_varint(char* out, std::size_t number) noexcept {
+	for(; number >= 0x80; number >>= 7) *out++ = static_cast<char>((number & 0x7f) | 0x80);
+	*out++ = static_cast<char>(number);
+	return out;
+}
+
+} // namespace
+
+string_column::string_column(const std::uint64_t* offsets, const char* bytes, std::size_t count) {
+	slots_.reserve(count);
+	for(std::size_t index = 0; index != count; ++index) {
+		if(offsets[index + 1] < offsets[index]) throw std::invalid_argument("String offsets must be ascending");
+		push_back({bytes + offsets[index], static_cast<std::size_t>(offsets[index + 1] - offsets[index])});
+	}
+}
+
+auto string_column::inline_slot(std::string_view str) noexcept -> slot {
+	slot s{};
+	if(!str.empty()) std::memcpy(s.bytes, str.data(), str.size());
+	s.bytes[7] = static_cast<char>(0x80 | str.size());
+	return s;
+}
+
+auto string_column::heap_slot(std::size_t offset) noexcept -> slot {
+	slot s{};
+	for(int index = 0; index != 7; ++index, offset >>= 8) s.bytes[index] = static_cast<char>(offset & 0xff);
+	return s;
+}
+
+auto string_column::make_slot(std::string_view str) -> slot {
+	if(str.size() <= inline_capacity) return inline_slot(str);
+	return heap_slot(append_bytes(str));
+}
+
+std::size_t string_column::append_bytes(std::string_view str) {
+	const auto offset = bytes_.size();
+	// str may point into the heap itself, which growing it would invalidate.
+	const auto* heap = bytes_.data();
+	const bool aliased = str.data() >= heap && str.data() < heap + bytes_.size();
+	const auto source = aliased ? static_cast<std::size_t>(str.data() - heap) : 0;
+	const auto prefix = varint_size(str.size());
+	bytes_.resize(offset + prefix + str.size());
+	write_varint(bytes_.data() + offset, str.size());
+	std::memmove(bytes_.data() + offset + prefix, aliased ? bytes_.data() + source : str.data(), str.size());
+	return offset;
+}
+
+void string_column::set(std::size_t index, std::string_view str) {
+	auto& s = slots_.at(index);
+	const auto old_size = s.is_inline() ? 0 : (*this)[index].size();
+	const auto old_bytes = s.is_inline() ? 0 : varint_size(old_size) + old_size;
+	if(str.size() <= inline_capacity) {
+		s = inline_slot(str);
+		dead_bytes_ += old_bytes;
+	} else if(!s.is_inline() && str.size() <= old_size) {
+		// A string no longer than the old one fits in its place, as its length prefix can't be longer either. str may
+		// be part of the old string, so it's moved before the prefix overwrites the start of the cell.
+		const auto prefix = varint_size(str.size());
+		std::memmove(bytes_.data() + s.offset() + prefix, str.data(), str.size());
+		write_varint(bytes_.data() + s.offset(), str.size());
+		dead_bytes_ += old_bytes - prefix - str.size();
+	} else {
+		s = heap_slot(append_bytes(str));
+		dead_bytes_ += old_bytes;
+	}
+	if(dead_bytes_ >= min_reclaimed_bytes && dead_bytes_ > bytes_.size() / 2) rewrite(nullptr);
+}
+
+void string_column::erase_masked(const std::vector<bool>& erase_mask) {
+	rewrite(&erase_mask);
+}
+
+void string_column::rewrite(const std::vector<bool>* erase_mask) {
+	const auto erased = [erase_mask](std::size_t index) { return erase_mask != nullptr && (*erase_mask)[index]; };
+	std::size_t heap_size = 0;
+	for(std::size_t index = 0; index != slots_.size(); ++index) {
+		if(erased(index) || slots_[index].is_inline()) continue;
+		const auto size = (*this)[index].size();
+		heap_size += varint_size(size) + size;
+	}
+	string_column rest;
+	rest.slots_.reserve(slots_.size());
+	rest.bytes_.reserve(heap_size);
+	for(std::size_t index = 0; index != slots_.size(); ++index) {
+		if(erased(index)) continue;
+		if(slots_[index].is_inline()) rest.slots_.push_back(slots_[index]);
+		else rest.push_back((*this)[index]);
+	}
+	*this = std::move(rest);
+}
+
+} // namespace minidb
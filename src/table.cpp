@@ -1,39 +1,38 @@
 #include <algorithm>
+#include <bit>
+#include <functional>
+#include <ostream>
 #include <stdexcept>
+#include <string>
 #include <table.hpp>
 #include <utility>
 
 namespace minidb {
 
-row::row(std::vector<value> cells, schema* table_schema)
-	: table_schema_(table_schema) {
-	// TODO: Check for errors such as element number of cells not matching the number of columns in the table_schema, or
-	//       the types of the supplied cell values not matching the types specified for the corrsponding columns in the
-	//       table_schema. If such an error occurs, throw an appropriate exception, otherwise take on the content of
-	//       cells as the content of the cells_ member variable.
-
-	if(cells.size() != table_schema_->columns().size()) throw std::invalid_argument(
-			"More columns in the scheme than cells");
-	const bool isSame = std::equal(cells.begin(), cells.end(),
-	                         table_schema_->columns().begin(), table_schema_->columns().end(),
-	                         [](const value& cell, const column& column) -> bool
-	                         {
-		                        const auto val = std::visit([&]<typename T0>(T0 const&)
-		                         {
-		                         	return value_type_index<T0>::value;
-		                         }, cell);
-		                         return column.type() == val;
-	                         });
-	if(isSame) cells_ = std::move(cells);
-}
-
 table::table(std::string name, schema table_schema)
 	: name_(std::move(name)), schema_(std::make_unique<schema>(std::move(table_schema))) {
+	column_data_.reserve(schema_->columns().size());
+	for(const auto& column : schema_->columns()) column_data_.emplace_back(column.type(), column.encoding());
+}
+
+table::table(std::string name, schema table_schema, std::vector<column_storage> column_data)
+	: name_(std::move(name)), schema_(std::make_unique<schema>(std::move(table_schema))),
+	  column_data_(std::move(column_data)), slot_count_(column_data_.empty() ? 0 : column_data_.front().size()) {
+	const auto& columns = schema_->columns();
+	if(column_data_.size() != columns.size()) throw std::invalid_argument(
+			"Number of column data doesn't match the number of columns in the schema");
+	for(std::size_t index = 0; index != columns.size(); ++index) {
+		const auto& data = column_data_[index];
+		if(data.type() != columns[index].type() ||
+		   data.is_dictionary() != (columns[index].encoding() == column_encoding::dictionary)) {
+			throw std::invalid_argument("Column data doesn't match the column type in the schema");
+		}
+		if(data.size() != slot_count_) throw std::invalid_argument("Columns differ in their number of cells");
+	}
+	next_row_id_ = slot_count_;
 }
 
 std::size_t table::get_column_index_by_name(std::string_view name) const {
-	// TODO: Return the index of the column with the given name in this table's schema, or throw an appropriate
-	//       exception if no such column exists.
 	for(std::size_t index = 0; index != schema_->columns().size(); ++index) {
 		if(schema_->columns().at(index).name() == name) return index;
 	}
@@ -48,26 +47,214 @@ const std::string& table::get_column_name(std::size_t column_index) const {
 	return schema_->columns().at(column_index).name();
 }
 
-void table::append_row(std::vector<value> cell_values) {
-	// TODO: Append a row with the supplied cell values to this table.
-	rows_.emplace_back(row{std::move(cell_values), schema_.get()});
+void table::check_cells(const std::vector<value>& cell_values) const {
+	if(cell_values.size() != column_data_.size()) throw std::invalid_argument(
+			"Number of cells doesn't match the number of columns in the schema");
+	const bool types_match = std::equal(cell_values.begin(), cell_values.end(), column_data_.begin(),
+	                                    [](const value& cell, const column_storage& column) {
+		                                    return column.accepts(cell);
+	                                    });
+	if(!types_match) throw std::invalid_argument("Cell types don't match the column types in the schema");
+}
+
+row_id table::append_row(std::vector<value> cell_values) {
+	// Validate all cells up front so a failed append leaves every column untouched.
+	check_cells(cell_values);
+	for(std::size_t index = 0; index != cell_values.size(); ++index) {
+		column_data_[index].push_back(std::move(cell_values[index]));
+	}
+	for(auto& [column_index, index] : indexes_) index.insert(column_data_[column_index].get(slot_count_), slot_count_);
+	if(!ids_are_indexes()) {
+		row_ids_.push_back(next_row_id_);
+		row_slots_.push_back(slot_count_);
+	}
+	++slot_count_;
+	++version_;
+	return next_row_id_++;
+}
+
+void table::check_columns(const std::vector<column_storage::cell_vector>& columns) const {
+	if(columns.size() != column_data_.size()) throw std::invalid_argument(
+			"Number of cells doesn't match the number of columns in the schema");
+	const auto new_rows = columns.empty() ? 0 : std::visit([](const auto& cells) { return cells.size(); }, columns[0]);
+	for(std::size_t index = 0; index != columns.size(); ++index) {
+		if(std::visit([](const auto& cells) { return cells.size(); }, columns[index]) != new_rows) {
+			throw std::invalid_argument("Columns differ in their number of cells");
+		}
+		if(static_cast<value_type>(columns[index].index()) != column_data_[index].type()) {
+			throw std::invalid_argument("Cell types don't match the column types in the schema");
+		}
+	}
+}
+
+void table::append_columns(std::vector<column_storage::cell_vector> columns) {
+	check_columns(columns);
+	const auto new_rows = columns.empty() ? 0 : std::visit([](const auto& cells) { return cells.size(); }, columns[0]);
+	for(std::size_t index = 0; index != columns.size(); ++index) column_data_[index].append(std::move(columns[index]));
+	for(auto& [column_index, index] : indexes_) {
+		for(auto row_index = slot_count_; row_index != slot_count_ + new_rows; ++row_index) {
+			index.insert(column_data_[column_index].get(row_index), row_index);
+		}
+	}
+	if(!ids_are_indexes()) {
+		for(std::size_t row = 0; row != new_rows; ++row) {
+			row_ids_.push_back(next_row_id_ + row);
+			row_slots_.push_back(slot_count_ + row);
+		}
+	}
+	slot_count_ += new_rows;
+	next_row_id_ += new_rows;
+	++version_;
+}
+
+std::size_t table::slot_of(row_id id) const {
+	std::size_t row_index = 0;
+	if(ids_are_indexes()) {
+		row_index = id < slot_count_ ? static_cast<std::size_t>(id) : npos;
+	} else {
+		const auto offset = id - first_row_id_;
+		row_index = id >= first_row_id_ && offset < row_slots_.size() ? row_slots_[offset] : npos;
+	}
+	if(row_index == npos || is_erased(row_index)) throw std::out_of_range("No row with ID " + std::to_string(id));
+	return row_index;
+}
+
+void table::restore_row_ids(std::vector<row_id> row_ids, row_id next_row_id) {
+	const auto ascending = std::adjacent_find(row_ids.begin(), row_ids.end(), std::greater_equal<>{}) == row_ids.end();
+	const auto valid = (row_ids.empty() && next_row_id == slot_count_) ||
+	                   (row_ids.size() == slot_count_ && ascending && (row_ids.empty() || row_ids.back() < next_row_id));
+	if(!valid) throw std::invalid_argument("Row IDs don't match the rows of the table");
+	row_ids_ = std::move(row_ids);
+	next_row_id_ = next_row_id;
+	rebuild_row_slots();
+	++version_;
+}
+
+void table::rebuild_row_slots() {
+	row_slots_.clear();
+	if(ids_are_indexes()) {
+		row_ids_.clear();
+		first_row_id_ = 0;
+		return;
+	}
+	first_row_id_ = row_ids_.empty() ? next_row_id_ : row_ids_.front();
+	row_slots_.resize(static_cast<std::size_t>(next_row_id_ - first_row_id_), npos);
+	for(std::size_t row_index = 0; row_index != row_ids_.size(); ++row_index) {
+		row_slots_[static_cast<std::size_t>(row_ids_[row_index] - first_row_id_)] = row_index;
+	}
+}
+
+std::uint64_t table::erased_bits(std::size_t first_row) const noexcept {
+	const auto word = first_row / 64;
+	const auto shift = first_row % 64;
+	if(word >= erased_.size()) return 0;
+	auto bits = erased_[word] >> shift;
+	if(shift != 0 && word + 1 < erased_.size()) bits |= erased_[word + 1] << (64 - shift);
+	return bits;
+}
+
+std::size_t table::find_row(std::size_t row_index) const noexcept {
+	for(auto word = row_index / 64; word < erased_.size(); ++word) {
+		auto live = ~erased_[word];
+		if(word == row_index / 64) live &= ~0ULL << row_index % 64;
+		if(live != 0) return std::min(word * 64 + static_cast<std::size_t>(std::countr_zero(live)), slot_count_);
+	}
+	return std::max(row_index, erased_.size() * 64);
+}
+
+std::size_t table::nth_row(std::size_t n) const noexcept {
+	for(std::size_t word = 0; word != erased_.size(); ++word) {
+		auto live = ~erased_[word];
+		const auto count = static_cast<std::size_t>(std::popcount(live));
+		if(n >= count) {
+			n -= count;
+			continue;
+		}
+		for(; n != 0; --n) live &= live - 1;
+		return word * 64 + static_cast<std::size_t>(std::countr_zero(live));
+	}
+	return erased_.size() * 64 + n;
+}
+
+void table::check_row(std::size_t row_index) const {
+	if(row_index >= slot_count_) throw std::out_of_range("Row index out of range");
+	if(is_erased(row_index)) throw std::out_of_range("Row was erased");
 }
 
 void table::erase_row(std::size_t row_index) {
-	// TODO: Erase the row with the given index from this table, or throw an appropriate exception if no such row exists
-	//       (i.e. if the index is out-of-bounds).
-	if(row_index >= rows_.size()) throw std::out_of_range("Row index out of range");
-	rows_.erase(rows_.begin() + row_index);
+	check_row(row_index);
+	for(auto& [column_index, index] : indexes_) index.erase(column_data_[column_index].get(row_index), row_index);
+	if(erased_.size() <= row_index / 64) erased_.resize(row_index / 64 + 1);
+	erased_[row_index / 64] |= 1ULL << row_index % 64;
+	++erased_count_;
+	++version_;
+}
+
+void table::check_cell(std::size_t column_index, const value& value) const {
+	if(column_index >= column_data_.size()) throw std::out_of_range("Column index out of range");
+	if(!column_data_[column_index].accepts(value)) throw std::invalid_argument(
+			"Invalid type at the given index when setting cell");
 }
 
 void table::update_cell(const std::size_t row_index, const std::size_t column_index, const value& value) {
-	if(row_index >= rows_.size()) throw std::out_of_range("Row index out of range");
-	rows_.at(row_index).set_cell_value(column_index, value);
+	check_row(row_index);
+	check_cell(column_index, value);
+	auto& column = column_data_[column_index];
+	if(const auto it = indexes_.find(column_index); it != indexes_.end()) {
+		it->second.erase(column.get(row_index), row_index);
+		it->second.insert(value, row_index);
+	}
+	column.set(row_index, value);
+	++version_;
+}
+
+void table::check_new_index(std::size_t column_index) const {
+	if(column_index >= column_data_.size()) throw std::out_of_range("Column index out of range");
+	if(indexes_.contains(column_index)) throw std::invalid_argument("The column already has an index");
+}
+
+void table::create_index(std::size_t column_index, index_kind kind) {
+	check_new_index(column_index);
+	auto& index = indexes_.emplace(column_index, minidb::column_index{kind, column_data(column_index)}).first->second;
+	for(std::size_t row_index = 0; erased_count_ != 0 && row_index != slot_count_; ++row_index) {
+		if(is_erased(row_index)) index.erase(column_data_[column_index].get(row_index), row_index);
+	}
+}
+
+void table::rebuild_indexes() {
+	for(auto& [column_index, index] : indexes_) index.rebuild(column_data_[column_index]);
+}
+
+void table::erase_rows(const std::vector<bool>& erase_mask) {
+	if(erase_mask.size() != slot_count_) throw std::invalid_argument("Erase mask doesn't cover all rows of the table");
+	for(std::size_t row_index = 0; row_index != slot_count_; ++row_index) {
+		if(erase_mask[row_index] && !is_erased(row_index)) erase_row(row_index);
+	}
+}
+
+void table::compact() {
+	if(erased_count_ == 0) return;
+	std::vector<bool> erase_mask(slot_count_);
+	std::vector<row_id> row_ids;
+	row_ids.reserve(slot_count_ - erased_count_);
+	for(std::size_t row_index = 0; row_index != slot_count_; ++row_index) {
+		erase_mask[row_index] = is_erased(row_index);
+		if(!erase_mask[row_index]) row_ids.push_back(id_of(row_index));
+	}
+	for(auto& column : column_data_) column.erase_masked(erase_mask);
+	slot_count_ -= erased_count_;
+	erased_.clear();
+	erased_count_ = 0;
+	row_ids_ = std::move(row_ids);
+	rebuild_row_slots();
+	rebuild_indexes();
+	++version_;
 }
 
 std::ostream& operator<<(std::ostream& stream, const row& row) {
-	for(const auto& cell : row.cells_) {
-		stream << cell << " ";
+	for(std::size_t column_index = 0; column_index != row.size(); ++column_index) {
+		row.table_->column_data(column_index).visit([&](const auto& data) { stream << data[row.index_]; });
+		stream << " ";
 	}
 	return stream;
 }
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <thread_pool.hpp>
+#include <utility>
+
+namespace minidb {
+
+thread_pool::thread_pool(std::size_t concurrency) {
+	if(concurrency == 0) concurrency = std::max(1u, std::thread::hardware_concurrency());
+	shares_ = std::make_unique<share[]>(concurrency);
+	threads_.reserve(concurrency - 1);
+	for(std::size_t participant = 1; participant != concurrency; ++participant) {
+		threads_.emplace_back([this, participant] { worker_loop(participant); });
+	}
+}
+
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard lock(state_mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for(auto& thread : threads_) thread.join();
+}
+
+void thread_pool::parallel_for(std::size_t size, std::size_t morsel_size, const task_type& task) {
+	morsel_size = std::max<std::size_t>(morsel_size, 1);
+	const auto morsel_count = (size + morsel_size - 1) / morsel_size;
+	std::unique_lock job_lock(job_mutex_, std::defer_lock);
+	if(threads_.empty() || morsel_count <= 1 || !job_lock.try_lock()) {
+		for(std::size_t begin = 0; begin < size; begin += morsel_size) task(begin, std::min(begin + morsel_size, size), 0);
+		return;
+	}
+
+	const auto participants = concurrency();
+	for(std::size_t participant = 0; participant != participants; ++participant) {
+		// Shares are whole morsels so every morsel starts at a multiple of morsel_size.
+		shares_[participant].next.store(morsel_count * participant / participants * morsel_size,
+		                                std::memory_order_relaxed);
+		shares_[participant].end = std::min(morsel_count * (participant + 1) / participants * morsel_size, size);
+	}
+	{
+		std::lock_guard lock(state_mutex_);
+		task_ = &task;
+		morsel_size_ = morsel_size;
+		running_ = threads_.size();
+		error_ = nullptr;
+		++generation_;
+	}
+	wake_.notify_all();
+	run_shares(0);
+
+	std::unique_lock lock(state_mutex_);
+	done_.wait(lock, [this] { return running_ == 0; });
+	task_ = nullptr;
+	if(error_) std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+void thread_pool::worker_loop(std::size_t participant) {
+	std::size_t seen_generation = 0;
+	for(;;) {
+		{
+			std::unique_lock lock(state_mutex_);
+			wake_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+			if(stopping_) return;
+			seen_generation = generation_;
+		}
+		run_shares(participant);
+		std::lock_guard lock(state_mutex_);
+		if(--running_ == 0) done_.notify_one();
+	}
+}
+
+void thread_pool::run_shares(std::size_t participant) {
+	const auto participants = concurrency();
+	run_share(shares_[participant], participant);
+	// Own share is exhausted, help the others with theirs.
+	for(std::size_t offset = 1; offset != participants; ++offset) {
+		run_share(shares_[(participant + offset) % participants], participant);
+	}
+}
+
+void thread_pool::run_share(share& s, std::size_t participant) {
+	for(;;) {
+		const auto begin = s.next.fetch_add(morsel_size_, std::memory_order_relaxed);
+		if(begin >= s.end) return;
+		try {
+			(*task_)(begin, std::min(begin + morsel_size_, s.end), participant);
+		} catch(...) {
+			std::lock_guard lock(state_mutex_);
+			if(!error_) error_ = std::current_exception();
+		}
+	}
+}
+
+} // namespace minidb
@@ -0,0 +1,529 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <database.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <write_ahead_log.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace minidb {
+
+namespace {
+
+constexpr std::array<char, 8> file_magic{'M', 'D', 'B', 'W', 'A', 'L', '0', '1'};
+constexpr std::size_t frame_header_size = 8;
+// Filter expressions store connectives like predicates without a column or operands, their operator byte follows the
+// ones of the comparisons.
+constexpr std::uint8_t connective_code = 8;
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size) noexcept {
+	static const auto table = [] {
+		std::array<std::uint32_t, 256> t{};
+		for(std::uint32_t i = 0; i != 256; ++i) {
+			auto c = i;
+			for(int bit = 0; bit != 8; ++bit) c = (c & 1) != 0 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t[i] = c;
+		}
+		return t;
+	}();
+	std::uint32_t crc = 0xFFFFFFFFu;
+	for(std::size_t i = 0; i != size; ++i) crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+void put_u32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+	for(int shift = 0; shift != 32; shift += 8) out.push_back(static_cast<std::uint8_t>(v >> shift));
+}
+
+std::uint32_t get_u32(const std::uint8_t* in) noexcept {
+	std::uint32_t v = 0;
+	for(int i = 0; i != 4; ++i) v |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+	return v;
+}
+
+void sync_file(std::FILE* file) {
+#ifdef _WIN32
+	const int result = _commit(_fileno(file));
+#else
+	const int result = ::fsync(fileno(file));
+#endif
+	if(result != 0) throw std::system_error(errno, std::generic_category(), "Failed to sync the write-ahead log");
+}
+
+// Decodes the fields of one record payload, throwing if the payload ends early.
+class record_reader {
+	const std::uint8_t* pos_;
+	const std::uint8_t* end_;
+
+	void require(std::size_t n) const {
+		if(static_cast<std::size_t>(end_ - pos_) < n) throw std::runtime_error("Truncated write-ahead log record");
+	}
+
+public:
+	record_reader(const std::uint8_t* data, std::size_t size) : pos_(data), end_(data + size) {}
+
+	std::uint8_t u8() {
+		require(1);
+		return *pos_++;
+	}
+	std::uint64_t varint() {
+		std::uint64_t v = 0;
+		for(int shift = 0; shift < 64; shift += 7) {
+			const auto byte = u8();
+			v |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+			if((byte & 0x80) == 0) return v;
+		}
+		throw std::runtime_error("Malformed varint in write-ahead log record");
+	}
+	std::size_t size() {
+		return static_cast<std::size_t>(varint());
+	}
+	std::string string() {
+		const auto length = size();
+		require(length);
+		std::string s(reinterpret_cast<const char*>(pos_), length);
+		pos_ += length;
+		return s;
+	}
+	template <typename T>
+	T cell() {
+		if constexpr(std::is_same_v<T, long long>) {
+			const auto zigzag = varint();
+			return static_cast<long long>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+		} else if constexpr(std::is_same_v<T, double>) {
+			std::uint64_t bits = 0;
+			for(int i = 0; i != 8; ++i) bits |= static_cast<std::uint64_t>(u8()) << (8 * i);
+			return std::bit_cast<double>(bits);
+		} else {
+			return string();
+		}
+	}
+	minidb::value value() {
+		switch(static_cast<value_type>(u8())) {
+		case value_type::integer: return cell<long long>();
+		case value_type::decimal: return cell<double>();
+		case value_type::string: return cell<std::string>();
+		}
+		throw std::runtime_error("Unknown value type in write-ahead log record");
+	}
+	column_storage::cell_vector cells() {
+		const auto type = static_cast<value_type>(u8());
+		const auto count = size();
+		const auto read_cells = [&]<typename T>(std::vector<T> cells) -> column_storage::cell_vector {
+			cells.reserve(std::min<std::size_t>(count, static_cast<std::size_t>(end_ - pos_)));
+			for(std::size_t i = 0; i != count; ++i) cells.push_back(cell<T>());
+			return cells;
+		};
+		switch(type) {
+		case value_type::integer: return read_cells(std::vector<long long>{});
+		case value_type::decimal: return read_cells(std::vector<double>{});
+		case value_type::string: return read_cells(std::vector<std::string>{});
+		}
+		throw std::runtime_error("Unknown value type in write-ahead log record");
+	}
+	std::vector<std::pair<std::string, minidb::value>> pairs() {
+		std::vector<std::pair<std::string, minidb::value>> result(size());
+		for(auto& [key, val] : result) {
+			key = string();
+			val = value();
+		}
+		return result;
+	}
+	std::vector<row_filter::term> expression() {
+		std::vector<row_filter::term> result(size());
+		for(auto& term : result) {
+			row_filter::predicate predicate;
+			predicate.column = string();
+			const auto op = u8();
+			predicate.operands.resize(size());
+			for(auto& operand : predicate.operands) operand = value();
+			if(op >= connective_code) {
+				term = static_cast<row_filter::connective>(op - connective_code);
+			} else {
+				predicate.op = static_cast<row_filter::comparison>(op);
+				term = std::move(predicate);
+			}
+		}
+		return result;
+	}
+};
+
+} // namespace
+
+// Encodes one record payload: the operation followed by its fields. Integers are zigzag varints, decimals their IEEE
+// bits in little endian and strings a varint length followed by the bytes.
+class write_ahead_log::record_writer {
+	std::vector<std::uint8_t> bytes_;
+
+public:
+	explicit record_writer(operation op) {
+		bytes_.push_back(static_cast<std::uint8_t>(op));
+	}
+	const std::vector<std::uint8_t>& bytes() const noexcept {
+		return bytes_;
+	}
+	record_writer& u8(std::uint8_t v) {
+		bytes_.push_back(v);
+		return *this;
+	}
+	record_writer& varint(std::uint64_t v) {
+		for(; v >= 0x80; v >>= 7) bytes_.push_back(static_cast<std::uint8_t>(v | 0x80));
+		bytes_.push_back(static_cast<std::uint8_t>(v));
+		return *this;
+	}
+	record_writer& string(std::string_view s) {
+		varint(s.size());
+		bytes_.insert(bytes_.end(), s.begin(), s.end());
+		return *this;
+	}
+	record_writer& cell(long long i) {
+		const auto u = static_cast<std::uint64_t>(i);
+		return varint((u << 1) ^ (i < 0 ? ~std::uint64_t{0} : 0));
+	}
+	record_writer& cell(double d) {
+		const auto bits = std::bit_cast<std::uint64_t>(d);
+		for(int i = 0; i != 8; ++i) u8(static_cast<std::uint8_t>(bits >> (8 * i)));
+		return *this;
+	}
+	record_writer& cell(std::string_view s) {
+		return string(s);
+	}
+	// A cell prefixed by its type.
+	record_writer& value(const minidb::value& v) {
+		u8(static_cast<std::uint8_t>(v.index()));
+		std::visit([this](const auto& c) { cell(c); }, v);
+		return *this;
+	}
+	template <typename Map>
+	record_writer& pairs(const Map& map) {
+		varint(map.size());
+		for(const auto& [key, val] : map) string(key).value(val);
+		return *this;
+	}
+	record_writer& expression(const std::vector<row_filter::term>& expression) {
+		varint(expression.size());
+		for(const auto& term : expression) {
+			if(const auto* op = std::get_if<row_filter::connective>(&term)) {
+				string({}).u8(static_cast<std::uint8_t>(connective_code + static_cast<std::uint8_t>(*op))).varint(0);
+				continue;
+			}
+			const auto& predicate = std::get<row_filter::predicate>(term);
+			string(predicate.column).u8(static_cast<std::uint8_t>(predicate.op)).varint(predicate.operands.size());
+			for(const auto& operand : predicate.operands) value(operand);
+		}
+		return *this;
+	}
+};
+
+write_ahead_log::write_ahead_log(const std::filesystem::path& path, options opts) : options_(opts) {
+	const bool exists = std::filesystem::exists(path) && std::filesystem::file_size(path) != 0;
+	file_ = std::fopen(path.string().c_str(), "ab");
+	if(file_ == nullptr) throw std::system_error(errno, std::generic_category(), "Failed to open " + path.string());
+	if(!exists) {
+		std::fwrite(file_magic.data(), 1, file_magic.size(), file_);
+		std::fflush(file_);
+	}
+	if(options_.sync == sync_policy::batch) flusher_ = std::thread([this] { flusher_loop(); });
+}
+
+write_ahead_log::~write_ahead_log() {
+	if(flusher_.joinable()) {
+		{
+			std::lock_guard lock(mutex_);
+			stopping_ = true;
+		}
+		flush_requested_.notify_one();
+		flusher_.join();
+	}
+	try {
+		flush();
+	} catch(const std::exception&) {
+		// Nothing sensible left to do with the error during destruction.
+	}
+	std::fclose(file_);
+}
+
+void write_ahead_log::commit(const std::vector<std::uint8_t>& payload) {
+	bool write_now = false;
+	{
+		std::lock_guard lock(mutex_);
+		if(flush_error_) std::rethrow_exception(flush_error_);
+		const bool was_empty = buffer_.empty();
+		put_u32(buffer_, static_cast<std::uint32_t>(payload.size()));
+		put_u32(buffer_, crc32(payload.data(), payload.size()));
+		buffer_.insert(buffer_.end(), payload.begin(), payload.end());
+		const bool full = buffer_.size() >= options_.group_commit_bytes;
+		switch(options_.sync) {
+		case sync_policy::always: write_now = true; break;
+		case sync_policy::none: write_now = full; break;
+		case sync_policy::batch:
+			// The first record of a group starts the commit window, a full buffer ends it early.
+			if(was_empty || full) flush_requested_.notify_one();
+			break;
+		}
+	}
+	if(write_now) write_out(options_.sync == sync_policy::always);
+}
+
+void write_ahead_log::write_out(bool sync) {
+	std::lock_guard file_lock(file_mutex_);
+	{
+		std::lock_guard lock(mutex_);
+		writing_.swap(buffer_);
+	}
+	if(!writing_.empty() && std::fwrite(writing_.data(), 1, writing_.size(), file_) != writing_.size()) {
+		writing_.clear();
+		throw std::system_error(errno, std::generic_category(), "Failed to write the write-ahead log");
+	}
+	writing_.clear();
+	if(std::fflush(file_) != 0) throw std::system_error(errno, std::generic_category(), "Failed to flush the log");
+	if(sync) sync_file(file_);
+}
+
+void write_ahead_log::flush() {
+	write_out(true);
+}
+
+void write_ahead_log::flusher_loop() {
+	std::unique_lock lock(mutex_);
+	for(;;) {
+		flush_requested_.wait(lock, [this] { return stopping_ || !buffer_.empty(); });
+		if(stopping_) return;
+		// Let the operations arriving within the commit window share this write and fsync.
+		flush_requested_.wait_for(lock, options_.group_commit_interval,
+		                          [this] { return stopping_ || buffer_.size() >= options_.group_commit_bytes; });
+		lock.unlock();
+		try {
+			write_out(true);
+			lock.lock();
+		} catch(...) {
+			lock.lock();
+			flush_error_ = std::current_exception();
+		}
+	}
+}
+
+void write_ahead_log::log_create_table(std::string_view name, const schema& table_schema) {
+	record_writer record(operation::create_table);
+	record.string(name).varint(table_schema.columns().size());
+	for(const auto& column : table_schema.columns()) {
+		record.string(column.name())
+				.u8(static_cast<std::uint8_t>(column.type()))
+				.u8(static_cast<std::uint8_t>(column.encoding()));
+	}
+	commit(record.bytes());
+}
+
+void write_ahead_log::log_drop_table(std::string_view name) {
+	commit(record_writer(operation::drop_table).string(name).bytes());
+}
+
+void write_ahead_log::log_append_row(std::string_view table_name, const std::vector<value>& cell_values) {
+	record_writer record(operation::append_row);
+	record.string(table_name).varint(cell_values.size());
+	for(const auto& cell : cell_values) record.value(cell);
+	commit(record.bytes());
+}
+
+void write_ahead_log::log_append_columns(std::string_view table_name,
+                                         const std::vector<column_storage::cell_vector>& columns) {
+	record_writer record(operation::append_columns);
+	record.string(table_name).varint(columns.size());
+	for(const auto& cells : columns) {
+		record.u8(static_cast<std::uint8_t>(cells.index()));
+		std::visit(
+				[&record](const auto& typed_cells) {
+					record.varint(typed_cells.size());
+					for(const auto& cell : typed_cells) record.cell(cell);
+				},
+				cells);
+	}
+	commit(record.bytes());
+}
+
+void write_ahead_log::log_update_rows(std::string_view table_name, const row_filter& filter,
+                                      const std::unordered_map<std::string, value>& changes) {
+	commit(record_writer(operation::update_rows_where)
+	               .string(table_name)
+	               .expression(filter.expression())
+	               .pairs(changes)
+	               .bytes());
+}
+
+void write_ahead_log::log_update_rows(std::string_view table_name, const row_filter& filter,
+                                      const std::vector<std::pair<std::string, value>>& changes) {
+	commit(record_writer(operation::update_rows_where)
+	               .string(table_name)
+	               .expression(filter.expression())
+	               .pairs(changes)
+	               .bytes());
+}
+
+void write_ahead_log::log_update_cell(std::string_view table_name, std::size_t row_index, std::size_t column_index,
+                                      const value& new_value) {
+	commit(record_writer(operation::update_cell)
+	               .string(table_name)
+	               .varint(row_index)
+	               .varint(column_index)
+	               .value(new_value)
+	               .bytes());
+}
+
+void write_ahead_log::log_erase_row(std::string_view table_name, std::size_t row_index) {
+	commit(record_writer(operation::tombstone_row).string(table_name).varint(row_index).bytes());
+}
+
+void write_ahead_log::log_erase_rows(std::string_view table_name, const row_filter& filter) {
+	commit(record_writer(operation::tombstone_rows_where).string(table_name).expression(filter.expression()).bytes());
+}
+
+void write_ahead_log::log_compact(std::string_view table_name) {
+	commit(record_writer(operation::compact_table).string(table_name).bytes());
+}
+
+void write_ahead_log::log_create_index(std::string_view table_name, std::string_view column_name, index_kind kind) {
+	commit(record_writer(operation::create_index)
+	               .string(table_name)
+	               .string(column_name)
+	               .u8(static_cast<std::uint8_t>(kind))
+	               .bytes());
+}
+
+std::size_t write_ahead_log::replay(const std::filesystem::path& path, database& db) {
+	std::ifstream in(path, std::ios::binary);
+	if(!in) return 0;
+	std::array<char, file_magic.size()> magic{};
+	if(!in.read(magic.data(), magic.size())) {
+		// Crashed while writing the header, start over with an empty log.
+		in.close();
+		std::filesystem::resize_file(path, 0);
+		return 0;
+	}
+	if(magic != file_magic) throw std::runtime_error(path.string() + " is not a minidb write-ahead log");
+
+	const auto file_size = std::filesystem::file_size(path);
+	std::size_t applied = 0;
+	auto valid_end = static_cast<std::uintmax_t>(file_magic.size());
+	std::array<std::uint8_t, frame_header_size> header{};
+	std::vector<std::uint8_t> payload;
+	while(in.read(reinterpret_cast<char*>(header.data()), header.size())) {
+		// A torn or corrupt header may announce any length, only trust it as far as the file reaches.
+		const auto length = get_u32(header.data());
+		if(length > file_size - valid_end - frame_header_size) break;
+		payload.resize(length);
+		if(!in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size())) ||
+		   crc32(payload.data(), payload.size()) != get_u32(header.data() + 4)) {
+			break;
+		}
+		record_reader record(payload.data(), payload.size());
+		// Operations are logged before they are applied, so a record may describe an operation that failed with a
+		// logic error. Replaying it fails the same way and leaves the database in the same state.
+		try {
+			switch(static_cast<operation>(record.u8())) {
+			case operation::create_table: {
+				auto name = record.string();
+				std::vector<column> columns;
+				for(auto count = record.size(); count != 0; --count) {
+					auto column_name = record.string();
+					const auto type = static_cast<value_type>(record.u8());
+					columns.emplace_back(std::move(column_name), type, static_cast<column_encoding>(record.u8()));
+				}
+				db.create_table(name, schema{std::move(columns)});
+				break;
+			}
+			case operation::drop_table: db.drop_table(record.string()); break;
+			case operation::append_row: {
+				auto name = record.string();
+				std::vector<value> cells(record.size());
+				for(auto& cell : cells) cell = record.value();
+				db.append_row(name, std::move(cells));
+				break;
+			}
+			case operation::append_columns: {
+				auto name = record.string();
+				std::vector<column_storage::cell_vector> columns(record.size());
+				for(auto& cells : columns) cells = record.cells();
+				db.append_columns(name, std::move(columns));
+				break;
+			}
+			case operation::update_rows: {
+				auto name = record.string();
+				const auto filter = record.pairs();
+				auto changes = record.pairs();
+				db.update_rows(name, row_filter{filter.begin(), filter.end()},
+				               std::unordered_map<std::string, value>{changes.begin(), changes.end()});
+				break;
+			}
+			case operation::update_rows_where: {
+				auto name = record.string();
+				auto filter = record.expression();
+				auto changes = record.pairs();
+				db.update_rows(name, row_filter{std::move(filter)},
+				               std::unordered_map<std::string, value>{changes.begin(), changes.end()});
+				break;
+			}
+			case operation::update_cell: {
+				auto name = record.string();
+				const auto row_index = record.size();
+				const auto column_index = record.size();
+				db.update_cell(name, row_index, column_index, record.value());
+				break;
+			}
+			case operation::erase_row: {
+				auto name = record.string();
+				db.erase_row(name, record.size());
+				db.compact(name);
+				break;
+			}
+			case operation::erase_rows: {
+				auto name = record.string();
+				const auto filter = record.pairs();
+				db.erase_rows(name, row_filter{filter.begin(), filter.end()});
+				db.compact(name);
+				break;
+			}
+			case operation::erase_rows_where: {
+				auto name = record.string();
+				db.erase_rows(name, row_filter{record.expression()});
+				db.compact(name);
+				break;
+			}
+			case operation::tombstone_row: {
+				auto name = record.string();
+				db.erase_row(name, record.size());
+				break;
+			}
+			case operation::tombstone_rows_where: {
+				auto name = record.string();
+				db.erase_rows(name, row_filter{record.expression()});
+				break;
+			}
+			case operation::compact_table: db.compact(record.string()); break;
+			case operation::create_index: {
+				auto name = record.string();
+				auto column_name = record.string();
+				db.create_index(name, column_name, static_cast<index_kind>(record.u8()));
+				break;
+			}
+			default: throw std::runtime_error("Unknown operation in write-ahead log record");
+			}
+		} catch(const std::logic_error&) {
+		}
+		++applied;
+		valid_end += frame_header_size + payload.size();
+	}
+	in.close();
+	// Drop the torn record a crash may have left behind, so new records are appended after the intact ones.
+	if(std::filesystem::file_size(path) != valid_end) std::filesystem::resize_file(path, valid_end);
+	return applied;
+}
+
+} // namespace minidb
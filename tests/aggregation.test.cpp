@@ -0,0 +1,142 @@
+#define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include "test_helpers.hpp"
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <database.hpp>
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace {
+using namespace std::literals;
+using minidb::aggregate_function;
+} // namespace
+
+TEST_CASE("Aggregations group rows by their cells and compute typed results per group.", "[aggregate]") {
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"region", minidb::value_type::string, minidb::column_encoding::dictionary},
+										   {"product", minidb::value_type::string},
+										   {"amount", minidb::value_type::integer},
+										   {"price", minidb::value_type::decimal}}});
+	db.append_row("t"sv, {"north"s, "b"s, 3LL, 1.5});
+	db.append_row("t"sv, {"south"s, "a"s, 5LL, 2.0});
+	db.append_row("t"sv, {"north"s, "a"s, -1LL, 4.5});
+	db.append_row("t"sv, {"north"s, "b"s, 10LL, 0.5});
+	db.append_row("t"sv, {"east"s, "c"s, 7LL, 3.0});
+
+	const std::vector<minidb::aggregation> aggregations{{aggregate_function::count, ""},
+	                                                    {aggregate_function::sum, "amount"},
+	                                                    {aggregate_function::min, "price"},
+	                                                    {aggregate_function::max, "product"},
+	                                                    {aggregate_function::avg, "amount"}};
+	const auto by_region = db.aggregate("t"sv, {"region"}, aggregations);
+	REQUIRE(by_region.columns().size() == 6);
+	CHECK(by_region.columns()[0].name() == "region");
+	CHECK(by_region.columns()[1].name() == "count");
+	CHECK(by_region.columns()[2].name() == "sum(amount)");
+	CHECK(by_region.columns()[5].name() == "avg(amount)");
+	CHECK(by_region.columns()[5].type() == minidb::value_type::decimal);
+	test::check_approx_table(by_region, {{"east"s, 1LL, 7LL, 3.0, "c"s, 7.0},
+	                                     {"north"s, 3LL, 12LL, 0.5, "b"s, 4.0},
+	                                     {"south"s, 1LL, 5LL, 2.0, "a"s, 5.0}});
+
+	const auto by_region_and_product = db.aggregate("t"sv, {"region", "product"},
+	                                                {{aggregate_function::sum, "price"}},
+	                                                minidb::row_filter{{{"amount", minidb::row_filter::comparison::less,
+	                                                                     {7LL}}}});
+	test::check_approx_table(by_region_and_product, {{"north"s, "a"s, 4.5}, {"north"s, "b"s, 1.5}, {"south"s, "a"s, 2.0}});
+
+	const auto total = db.aggregate("t"sv, {}, {{aggregate_function::sum, "amount"}, {aggregate_function::max, "price"}});
+	test::check_approx_table(total, {{24LL, 4.5}});
+	const auto counted = db.aggregate("t"sv, {}, {{aggregate_function::count, "price"}});
+	CHECK(counted.get_column_name(0) == "count(price)");
+	test::check_approx_table(counted, {{static_cast<long long>(db.lookup_table("t"sv).row_count())}});
+	const auto nothing = db.aggregate("t"sv, {}, {{aggregate_function::count, ""}},
+	                                  minidb::row_filter{{{"amount", minidb::row_filter::comparison::greater, {100LL}}}});
+	CHECK(nothing.row_count() == 0);
+
+	CHECK_THROWS_AS(db.aggregate("t"sv, {"region"}, {{aggregate_function::sum, "product"}}), std::invalid_argument);
+	CHECK_THROWS_AS(db.aggregate("t"sv, {"missing"}, {{aggregate_function::count, ""}}), std::invalid_argument);
+	CHECK_THROWS_AS(db.aggregate("t"sv, {"region"}, {{aggregate_function::count, "missing"}}), std::invalid_argument);
+	CHECK_THROWS_AS(minidb::parse_aggregate_function("median"), std::invalid_argument);
+}
+
+TEST_CASE("Parallel aggregation over many groups gives the same result as a sequential one.", "[aggregate]") {
+	minidb::database db;
+	db.configure_scans(4, 1024);
+	db.create_table("t"sv, minidb::schema{{{"key", minidb::value_type::integer},
+										   {"name", minidb::value_type::string},
+										   {"weight", minidb::value_type::decimal}}});
+	constexpr long long row_count = 50'000;
+	std::map<std::tuple<long long, std::string>, std::tuple<long long, double, double>> expected;
+	for(long long i = 0; i != row_count; ++i) {
+		const auto key = (i * 7919) % 3001 - 1500;
+		auto name = "n"s + std::to_string(i % 3);
+		const auto weight = i % 5 == 0 ? -0.0 : static_cast<double>(i % 101) / 4;
+		db.append_row("t"sv, {key, name, weight});
+		auto [found, added] = expected.try_emplace({key, name}, 0, weight, weight);
+		auto& [count, min, max] = found->second;
+		++count;
+		min = std::min(min, weight);
+		max = std::max(max, weight);
+	}
+	const auto result = db.aggregate("t"sv, {"key", "name"}, {{aggregate_function::count, ""},
+	                                                        {aggregate_function::min, "weight"},
+	                                                        {aggregate_function::max, "weight"}});
+	REQUIRE(result.row_count() == expected.size());
+	std::size_t row_index = 0;
+	for(const auto& [group, aggregates] : expected) {
+		CAPTURE(row_index);
+		const auto row = result.row_at(row_index++);
+		CHECK(std::get<long long>(row.get_cell_value(0)) == std::get<0>(group));
+		CHECK(std::get<std::string>(row.get_cell_value(1)) == std::get<1>(group));
+		CHECK(std::get<long long>(row.get_cell_value(2)) == std::get<0>(aggregates));
+		CHECK(std::get<double>(row.get_cell_value(3)) == std::get<1>(aggregates));
+		CHECK(std::get<double>(row.get_cell_value(4)) == std::get<2>(aggregates));
+	}
+
+	// Negative and positive zero form one group.
+	const auto by_weight = db.aggregate("t"sv, {"weight"}, {{aggregate_function::count, ""}},
+	                                    minidb::row_filter{{{"weight", minidb::row_filter::comparison::equal, {0.0}}}});
+	REQUIRE(by_weight.row_count() == 1);
+}
+
+TEST_CASE("Column histograms count cells in arrays or hash tables and give the same result as a sorted map.",
+		  "[aggregate][histogram]") {
+	minidb::database db;
+	db.configure_scans(4, 1024);
+	db.create_table("t"sv, minidb::schema{{{"small", minidb::value_type::integer},
+										   {"wide", minidb::value_type::integer},
+										   {"weight", minidb::value_type::decimal},
+										   {"name", minidb::value_type::string},
+										   {"tag", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	constexpr long long row_count = 20'000;
+	std::map<std::string, std::map<minidb::value, std::size_t>> expected;
+	std::map<minidb::value, std::size_t> expected_filtered;
+	for(long long i = 0; i != row_count; ++i) {
+		const minidb::value small = i % 37 - 18;
+		const minidb::value wide = (i * 1'000'003) % 9'973 * 1'000'000'007LL - (1LL << 62);
+		const minidb::value weight = static_cast<double>(i % 11) / 2 - 2.5;
+		const minidb::value name = "n"s + std::to_string(i % 613);
+		const minidb::value tag = i % 3 == 0 ? "fizz"s : "plain"s;
+		db.append_row("t"sv, {small, wide, weight, name, tag});
+		++expected["small"][small];
+		++expected["wide"][wide];
+		++expected["weight"][weight];
+		++expected["name"][name];
+		++expected["tag"][tag];
+		if(std::get<long long>(small) > 10) ++expected_filtered[name];
+	}
+	for(const auto& [column, histogram] : expected) {
+		CAPTURE(column);
+		CHECK(db.query_column_histogram("t"sv, column) == histogram);
+	}
+	CHECK(db.query_column_histogram("t"sv, "name"sv,
+	                                minidb::row_filter{{{"small", minidb::row_filter::comparison::greater, {10LL}}}}) ==
+	      expected_filtered);
+
+	// Negative zero is counted as zero.
+	db.append_row("t"sv, {0LL, 0LL, -0.0, "n0"s, "fizz"s});
+	const auto weights = db.query_column_histogram("t"sv, "weight"sv);
+	CHECK(weights.at(0.0) == expected["weight"][0.0] + 1);
+}
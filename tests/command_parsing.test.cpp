@@ -1,6 +1,89 @@
 #define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include <atomic>
 #include <catch2/catch.hpp>
 #include <command_parser.hpp>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::size_t> allocation_count = 0;
+
+void* counted_allocate(std::size_t size, std::size_t alignment) noexcept {
+	++allocation_count;
+	if(size == 0) size = 1;
+	if(alignment <= alignof(std::max_align_t)) return std::malloc(size);
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* counted_allocate_or_throw(std::size_t size, std::size_t alignment) {
+	if(void* memory = counted_allocate(size, alignment)) return memory;
+	throw std::bad_alloc();
+}
+} // namespace
+
+// Counts heap allocations of the whole test binary, so tests can check that code doesn't allocate. Every form of
+// operator new and delete is replaced, so memory is always freed by the allocator that allocated it.
+void* operator new(std::size_t size) {
+	return counted_allocate_or_throw(size, 0);
+}
+void* operator new[](std::size_t size) {
+	return counted_allocate_or_throw(size, 0);
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return counted_allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return counted_allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocate(size, 0);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocate(size, 0);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+	std::free(memory);
+}
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
 
 TEST_CASE("The command parser correctly parses an argument-less command line.", "[parsing]") {
 	SECTION("without whitespace") {
@@ -313,3 +396,171 @@ TEST_CASE("The command parser correctly parses a command line containing multipl
 	CHECK(arg5->at(3).first == "bar");
 	CHECK(std::get<minidb::command_parser::decimal_argument_type>(arg5->at(3).second) == Approx(1234.5678));
 }
+
+TEST_CASE("The command parser can parse a command line into views without allocating.", "[parsing]") {
+	using parser = minidb::command_parser;
+	const std::string line =
+			"  test_command -123 987.654 \"Test Test\" [12345, \"Hello World\", xyz] {foo=bar, \"a b\"=1.5} [] {}";
+	parser::parsed_command parsed;
+	parser::parse_command(line, parsed);
+	// Parsing again reuses the storage grown by the first parse.
+	const auto allocations_before = allocation_count.load();
+	parser::parse_command(line, parsed);
+	CHECK(allocation_count.load() == allocations_before);
+
+	CHECK(parsed.command() == "test_command");
+	const auto args = parsed.arguments();
+	REQUIRE(args.size() == 7);
+	CHECK(std::get<parser::integer_argument_type>(args[0]) == -123);
+	CHECK(std::get<parser::decimal_argument_type>(args[1]) == Approx(987.654));
+	const auto text = std::get<std::string_view>(args[2]);
+	CHECK(text == "Test Test");
+	CHECK(text.data() == line.data() + line.find("Test Test"));
+
+	const auto elements = parsed.elements(std::get<parser::list_view>(args[3]));
+	REQUIRE(elements.size() == 3);
+	CHECK(std::get<parser::integer_argument_type>(elements[0]) == 12345);
+	CHECK(std::get<std::string_view>(elements[1]) == "Hello World");
+	CHECK(std::get<std::string_view>(elements[2]) == "xyz");
+
+	const auto entries = parsed.entries(std::get<parser::key_value_list_view>(args[4]));
+	REQUIRE(entries.size() == 2);
+	CHECK(entries[0].first == "foo");
+	CHECK(std::get<std::string_view>(entries[0].second) == "bar");
+	CHECK(entries[1].first == "a b");
+	CHECK(std::get<parser::decimal_argument_type>(entries[1].second) == Approx(1.5));
+	CHECK(parsed.elements(std::get<parser::list_view>(args[5])).empty());
+	CHECK(parsed.entries(std::get<parser::key_value_list_view>(args[6])).empty());
+
+	parser::parse_command("other", parsed);
+	CHECK(parsed.command() == "other");
+	CHECK(parsed.arguments().empty());
+	CHECK_THROWS_AS(parser::parse_command("cmd [1, 2", parsed), minidb::syntax_error);
+}
+
+TEST_CASE("The command parser parses lists of lists.", "[parsing]") {
+	using parser = minidb::command_parser;
+	parser::parsed_command parsed;
+	parser::parse_command("append_rows t [ [1, a], [2.5, \"b c\", 3],[] ] [[]]", parsed);
+	const auto args = parsed.arguments();
+	REQUIRE(args.size() == 3);
+	CHECK(std::get<std::string_view>(args[0]) == "t");
+	const auto lists = parsed.lists(std::get<parser::nested_list_view>(args[1]));
+	REQUIRE(lists.size() == 3);
+	const auto first = parsed.elements(lists[0]);
+	REQUIRE(first.size() == 2);
+	CHECK(std::get<parser::integer_argument_type>(first[0]) == 1);
+	CHECK(std::get<std::string_view>(first[1]) == "a");
+	const auto second = parsed.elements(lists[1]);
+	REQUIRE(second.size() == 3);
+	CHECK(std::get<parser::decimal_argument_type>(second[0]) == Approx(2.5));
+	CHECK(std::get<std::string_view>(second[1]) == "b c");
+	CHECK(parsed.elements(lists[2]).empty());
+	CHECK(parsed.lists(std::get<parser::nested_list_view>(args[2])).size() == 1);
+
+	CHECK_THROWS_AS(parser::parse_command("cmd [[1], 2]", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command("cmd [[1], [2]", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command(std::string("cmd [[1]]")), minidb::syntax_error);
+}
+
+TEST_CASE("The command parser tells placeholders apart from the text \"?\".", "[parsing]") {
+	using parser = minidb::command_parser;
+	parser::parsed_command parsed;
+	parser::parse_command("cmd ? \"?\" [?, \"?\", ?x] {a=?, b between [1, ?]} (c<? or d=\"?\")", parsed);
+	const auto args = parsed.arguments();
+	REQUIRE(args.size() == 5);
+	CHECK(parser::is_placeholder(args[0]));
+	CHECK(std::get<std::string_view>(args[0]) == "?");
+	CHECK_FALSE(parser::is_placeholder(args[1]));
+	CHECK(std::get<std::string_view>(args[1]) == "?");
+	const auto elements = parsed.elements(std::get<parser::list_view>(args[2]));
+	REQUIRE(elements.size() == 3);
+	CHECK(parser::is_placeholder(elements[0]));
+	CHECK_FALSE(parser::is_placeholder(elements[1]));
+	CHECK_FALSE(parser::is_placeholder(elements[2]));
+	const auto list = std::get<parser::key_value_list_view>(args[3]);
+	CHECK(parser::is_placeholder(parsed.entries(list)[0].second));
+	CHECK(parser::is_placeholder(parsed.elements(parsed.conditions(list)[1].operands)[1]));
+	const auto terms = parsed.terms(std::get<parser::expression_view>(args[4]));
+	REQUIRE(terms.size() == 3);
+	CHECK(parser::is_placeholder(parsed.entry(terms[0]).second));
+	CHECK_FALSE(parser::is_placeholder(parsed.entry(terms[1]).second));
+}
+
+TEST_CASE("The command parser parses comparison operators in key-value lists.", "[parsing]") {
+	using parser = minidb::command_parser;
+	using op = parser::comparison_operator;
+	const std::string line = "cmd {a>=1, b != x, c<2.5, d>-3, e<=\"q\", \"f g\" in [1, two], h BETWEEN [1, 9], i=<}";
+	parser::parsed_command parsed;
+	parser::parse_command(line, parsed);
+	REQUIRE(parsed.arguments().size() == 1);
+	const auto& list = std::get<parser::key_value_list_view>(parsed.arguments()[0]);
+	const auto entries = parsed.entries(list);
+	const auto conditions = parsed.conditions(list);
+	REQUIRE(entries.size() == 8);
+	REQUIRE(conditions.size() == 8);
+
+	const std::vector<std::string_view> keys{"a", "b", "c", "d", "e", "f g", "h", "i"};
+	const std::vector<op> ops{op::greater_equal, op::not_equal, op::less, op::greater, op::less_equal, op::in,
+							  op::between, op::equal};
+	for(std::size_t i = 0; i != entries.size(); ++i) {
+		CAPTURE(i);
+		CHECK(entries[i].first == keys[i]);
+		CHECK(conditions[i].op == ops[i]);
+	}
+	CHECK(std::get<parser::integer_argument_type>(entries[0].second) == 1);
+	CHECK(std::get<std::string_view>(entries[1].second) == "x");
+	CHECK(std::get<parser::decimal_argument_type>(entries[2].second) == Approx(2.5));
+	CHECK(std::get<parser::integer_argument_type>(entries[3].second) == -3);
+	CHECK(std::get<std::string_view>(entries[4].second) == "q");
+	const auto in_operands = parsed.elements(conditions[5].operands);
+	REQUIRE(in_operands.size() == 2);
+	CHECK(std::get<parser::integer_argument_type>(in_operands[0]) == 1);
+	CHECK(std::get<std::string_view>(in_operands[1]) == "two");
+	CHECK(parsed.elements(conditions[6].operands).size() == 2);
+	CHECK(std::get<std::string_view>(entries[7].second) == "<");
+
+	CHECK_THROWS_AS(parser::parse_command("cmd {a between [1]}", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command("cmd {a [1]}", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command("cmd {a}", parsed), minidb::syntax_error);
+	// The owning parse only supports key=value entries.
+	CHECK_THROWS_AS(parser::parse_command(std::string("cmd {a>1}")), minidb::syntax_error);
+}
+
+TEST_CASE("The command parser parses filter expressions into postfix terms.", "[parsing]") {
+	using parser = minidb::command_parser;
+	using kind = parser::term_kind;
+	const std::string line = "cmd (a>1 and (b = x or not c in [1, 2]) || !(d between [1, 9]), notes!=\"n o\") 5";
+	parser::parsed_command parsed;
+	parser::parse_command(line, parsed);
+	REQUIRE(parsed.arguments().size() == 2);
+	CHECK(std::get<parser::integer_argument_type>(parsed.arguments()[1]) == 5);
+	const auto terms = parsed.terms(std::get<parser::expression_view>(parsed.arguments()[0]));
+
+	// a>1 b=x c in [1, 2] not or and d between [1, 9] not notes!="n o" and or
+	const std::vector<kind> kinds{kind::condition, kind::condition, kind::condition, kind::negation,
+	                              kind::disjunction, kind::conjunction, kind::condition, kind::negation,
+	                              kind::condition, kind::conjunction, kind::disjunction};
+	REQUIRE(terms.size() == kinds.size());
+	for(std::size_t i = 0; i != terms.size(); ++i) {
+		CAPTURE(i);
+		CHECK(terms[i].kind == kinds[i]);
+	}
+	CHECK(parsed.entry(terms[0]).first == "a");
+	CHECK(parsed.condition(terms[0]).op == parser::comparison_operator::greater);
+	CHECK(std::get<parser::integer_argument_type>(parsed.entry(terms[0]).second) == 1);
+	CHECK(parsed.entry(terms[1]).first == "b");
+	CHECK(std::get<std::string_view>(parsed.entry(terms[1]).second) == "x");
+	CHECK(parsed.entry(terms[2]).first == "c");
+	CHECK(parsed.condition(terms[2]).op == parser::comparison_operator::in);
+	CHECK(parsed.elements(parsed.condition(terms[2]).operands).size() == 2);
+	CHECK(parsed.condition(terms[6]).op == parser::comparison_operator::between);
+	CHECK(parsed.entry(terms[8]).first == "notes");
+	CHECK(parsed.condition(terms[8]).op == parser::comparison_operator::not_equal);
+	CHECK(std::get<std::string_view>(parsed.entry(terms[8]).second) == "n o");
+
+	CHECK_THROWS_AS(parser::parse_command("cmd (a=1 and)", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command("cmd (a=1 or (b=2)", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command("cmd ()", parsed), minidb::syntax_error);
+	CHECK_THROWS_AS(parser::parse_command(std::string("cmd (a=1)")), minidb::syntax_error);
+}
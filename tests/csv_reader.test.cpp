@@ -0,0 +1,62 @@
+#define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include "test_helpers.hpp"
+#include <catch2/catch.hpp>
+#include <csv_reader.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::vector<std::string>> read_all(const std::filesystem::path& path, const minidb::csv_options& options) {
+	minidb::csv_reader reader(path, options);
+	std::vector<std::vector<std::string>> records;
+	std::vector<std::string_view> fields;
+	while(reader.next(fields)) records.emplace_back(fields.begin(), fields.end());
+	return records;
+}
+
+void write_file(const std::filesystem::path& path, const std::string& content) {
+	std::ofstream out(path, std::ios::binary);
+	out << content;
+}
+
+} // namespace
+
+TEST_CASE("The CSV reader splits records into fields and unescapes quoted fields.", "[csv]") {
+	test::temporary_file file("minidb_csv_reader.csv");
+	write_file(file.path, "1,plain,2.5\r\n"
+						  "2,\"with, comma\",\"\"\n"
+						  "\n"
+						  "3,\"say \"\"hi\"\"\nacross lines\",\n"
+						  "4,last,-1");
+	// Tiny buffers make records straddle the chunk boundaries and force the buffer to grow.
+	minidb::csv_options options;
+	options.buffer_size = GENERATE(std::size_t{1}, std::size_t{7}, std::size_t{1} << 20);
+	const std::vector<std::vector<std::string>> expected = {{"1", "plain", "2.5"},
+															{"2", "with, comma", ""},
+															{"3", "say \"hi\"\nacross lines", ""},
+															{"4", "last", "-1"}};
+	CHECK(read_all(file.path, options) == expected);
+
+	minidb::csv_reader reader(file.path, options);
+	std::vector<std::string_view> fields;
+	std::vector<std::size_t> lines;
+	while(reader.next(fields)) lines.push_back(reader.line());
+	CHECK(lines == std::vector<std::size_t>{1, 2, 4, 6});
+}
+
+TEST_CASE("The CSV reader supports other delimiters and quote characters and rejects malformed quoting.", "[csv]") {
+	test::temporary_file file("minidb_csv_reader_options.csv");
+	write_file(file.path, "a;'b;c'\n");
+	minidb::csv_options options;
+	options.delimiter = ';';
+	options.quote = '\'';
+	CHECK(read_all(file.path, options) == std::vector<std::vector<std::string>>{{"a", "b;c"}});
+
+	write_file(file.path, "a,\"b\"c\n");
+	CHECK_THROWS_AS(read_all(file.path, {}), std::invalid_argument);
+	write_file(file.path, "a,\"unterminated\n");
+	CHECK_THROWS_AS(read_all(file.path, {}), std::invalid_argument);
+	CHECK_THROWS(minidb::csv_reader("minidb_csv_reader_missing.csv", {}));
+}
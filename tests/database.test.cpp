@@ -1,14 +1,25 @@
 #define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
 #include "test_helpers.hpp"
 #include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
 #include <database.hpp>
+#include <filesystem>
+#include <fstream>
 #include <map>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace {
 using namespace std::literals;
 
+template <typename Row>
+constexpr bool can_set_cells = requires(Row row) { row.set_cell_value(std::size_t{0}, 0LL); };
+
 void create_shop_db(minidb::database& db) {
 	db.create_table("article"sv, minidb::schema{{{"article_number", minidb::value_type::integer},
 												 {"name", minidb::value_type::string},
@@ -185,6 +196,24 @@ TEST_CASE_METHOD(test_fixture, "A table can be querried with a single filter usi
 	});
 	CHECK(index == expected_order_items.size());
 }
+TEST_CASE_METHOD(test_fixture, "database::query_table passes the queried table to the table callback before its rows.",
+				 "[database][query]") {
+	const minidb::table* queried = nullptr;
+	std::size_t rows_before = 0;
+	std::size_t rows = 0;
+	const auto count_row = [&rows](const minidb::row&) { ++rows; };
+	const auto check_table = [&](const minidb::table& tab) {
+		queried = &tab;
+		rows_before = rows;
+	};
+	db.query_table("order_item"sv, {{"article_number"s, 3LL}}, count_row, check_table);
+	CHECK(queried == &db.lookup_table("order_item"sv));
+	CHECK(rows == 0);
+	db.query_table("article"sv, count_row, check_table);
+	CHECK(queried == &db.lookup_table("article"sv));
+	CHECK(rows_before == 0);
+	CHECK(rows == 2);
+}
 TEST_CASE_METHOD(test_fixture, "A table can be querried with multiple filters using database::query_table.",
 				 "[database][query]") {
 	std::vector<std::vector<minidb::value>> expected_order_items = {
@@ -276,6 +305,94 @@ TEST_CASE_METHOD(test_fixture, "Rows in a table can be correctly erased using a
 	auto& order_items_tab = db.lookup_table("order_item");
 	check_approx_table(order_items_tab, expected_order_items);
 }
+TEST_CASE_METHOD(test_fixture, "Erased rows keep their index and are skipped by all scans until the table is compacted.",
+				 "[database][erase][compact]") {
+	db.configure_compaction(0);
+	db.create_index("order_item"sv, "article_number"sv);
+	const auto& tab = db.lookup_table("order_item"sv);
+	db.erase_row("order_item"sv, 0);
+	db.erase_row("order_item"sv, 5);
+	db.erase_rows("order_item"sv, {{"count", 10LL}});
+	CHECK(tab.slot_count() == 14);
+	CHECK(tab.row_count() == 11);
+	CHECK(tab.erased_count() == 3);
+	CHECK(tab.is_erased(5));
+	CHECK_FALSE(tab.is_erased(6));
+	// The rows after an erased one keep their index.
+	check_approx_row(tab.row_at(6), {104LL, 1LL, 4LL, 42.12});
+	CHECK_THROWS_AS(db.erase_row("order_item"sv, 5), std::out_of_range);
+	CHECK_THROWS_AS(db.update_cell("order_item"sv, 5, 2, 1LL), std::out_of_range);
+	check_approx_row(tab.rows()[0], {100LL, 2LL, 1LL, 123.45});
+	check_approx_row(tab.rows()[3], {104LL, 1LL, 4LL, 42.12});
+
+	std::vector<long long> matches;
+	const auto order_number = [&matches](const minidb::row& row) {
+		matches.push_back(std::get<long long>(row.get_cell_value(0)));
+	};
+	db.query_table("order_item"sv, {{"article_number"s, 1LL}}, order_number);
+	CHECK(matches == std::vector<long long>{101, 104, 105, 106, 107, 108});
+	matches.clear();
+	db.query_table("order_item"sv, {{{"count"s, minidb::row_filter::comparison::less, {5LL}}}}, order_number);
+	CHECK(matches == std::vector<long long>{100, 101, 101, 104, 104, 106});
+	std::map<minidb::value, std::size_t> expected_histogram = {{1LL, 3}, {3LL, 1}, {4LL, 2}, {5LL, 3}, {8LL, 1}, {15LL, 1}};
+	CHECK(db.query_column_histogram("order_item"sv, "count"sv) == expected_histogram);
+	CHECK(db.approx_distinct("order_item"sv, "count"sv) == 6);
+	CHECK(db.approx_quantiles("order_item"sv, "count"sv, {0.0, 1.0}) == std::vector<double>{1, 15});
+	const auto counts = db.aggregate("order_item"sv, {}, {{minidb::aggregate_function::count, ""}});
+	CHECK(counts.rows()[0].get_cell_value(0) == minidb::value{11LL});
+
+	db.compact("order_item"sv);
+	CHECK(tab.slot_count() == 11);
+	CHECK(tab.erased_count() == 0);
+	check_approx_row(tab.row_at(3), {104LL, 1LL, 4LL, 42.12});
+	CHECK(tab.find_index(1)->lookup(1LL) == std::vector<std::size_t>{1, 3, 5, 7, 8, 10});
+}
+TEST_CASE_METHOD(test_fixture, "Tables are compacted once the share of erased rows exceeds the compaction threshold.",
+				 "[database][erase][compact]") {
+	CHECK_THROWS_AS(db.configure_compaction(1.5), std::invalid_argument);
+	db.configure_compaction(0.25);
+	const auto& tab = db.lookup_table("order_item"sv);
+	db.erase_row("order_item"sv, 0);
+	db.erase_row("order_item"sv, 1);
+	db.erase_row("order_item"sv, 2);
+	CHECK(tab.erased_count() == 3);
+	CHECK(tab.slot_count() == 14);
+	db.erase_row("order_item"sv, 3);
+	CHECK(tab.erased_count() == 0);
+	CHECK(tab.slot_count() == 10);
+	check_approx_row(tab.row_at(0), {102LL, 1LL, 10LL, 42.12});
+}
+TEST_CASE_METHOD(test_fixture, "Rows keep their ID when rows are erased or the table is compacted.", "[database][row_id]") {
+	db.configure_compaction(0);
+	const auto& tab = db.lookup_table("order_item"sv);
+	CHECK(tab.rows()[5].id() == 5);
+	const auto appended = db.append_row("order_item"sv, {109LL, 2LL, 7LL, 123.45});
+	CHECK(appended == 14);
+	db.erase_row_by_id("order_item"sv, 0);
+	db.erase_row_by_id("order_item"sv, 3);
+	CHECK_THROWS_AS(db.erase_row_by_id("order_item"sv, 3), std::out_of_range);
+	CHECK_THROWS_AS(db.update_cell_by_id("order_item"sv, 15, 2, 1LL), std::out_of_range);
+	db.compact("order_item"sv);
+	CHECK(tab.slot_count() == 13);
+	CHECK(tab.rows()[0].id() == 1);
+	CHECK(tab.rows()[2].id() == 4);
+	CHECK(tab.slot_of(4) == 2);
+	CHECK(tab.slot_of(appended) == 12);
+	CHECK_THROWS_AS(tab.slot_of(3), std::out_of_range);
+
+	db.update_cell_by_id("order_item"sv, appended, 2, 8LL);
+	db.update_cell_by_id("order_item"sv, 4, 2, 9LL);
+	check_approx_row(tab.row_at(12), {109LL, 2LL, 8LL, 123.45});
+	check_approx_row(tab.row_at(2), {102LL, 1LL, 9LL, 42.12});
+	// Appending after a compaction continues the IDs and keeps the lookup current.
+	CHECK(db.append_row("order_item"sv, {110LL, 1LL, 1LL, 42.12}) == 15);
+	db.append_columns("order_item"sv, {std::vector<long long>{111, 112}, std::vector<long long>{1, 2},
+									   std::vector<long long>{1, 1}, std::vector<double>{42.12, 123.45}});
+	CHECK(tab.slot_of(17) == 15);
+	CHECK(tab.rows()[15].id() == 17);
+	db.erase_row_by_id("order_item"sv, 16);
+	CHECK(tab.is_erased(14));
+}
 TEST_CASE_METHOD(test_fixture, "Attempting to use a non-existent table throws an exception.", "[database][errors]") {
 	SECTION("in a query") {
 		bool callback_called = false;
@@ -295,6 +412,14 @@ TEST_CASE_METHOD(test_fixture, "Attempting to use a non-existent table throws an
 		CHECK_THROWS(db.drop_table("test"sv));
 	}
 }
+TEST_CASE_METHOD(test_fixture, "Tables can be looked up by a name view that isn't null-terminated.",
+				 "[database][table]") {
+	const std::string_view names = "orderarticle";
+	CHECK(db.lookup_table(names.substr(0, 5)).name() == "order");
+	CHECK(db.lookup_table(names.substr(5)).name() == "article");
+	CHECK_THROWS_AS(db.lookup_table(names.substr(0, 4)), std::out_of_range);
+}
+
 TEST_CASE_METHOD(test_fixture, "Attempting to use a non-existent column name in a row filter throws an exception.",
 				 "[database][errors]") {
 	SECTION("in a query") {
@@ -324,7 +449,7 @@ TEST_CASE_METHOD(test_fixture, "Attempting to use an invalid column index throws
 	SECTION("in an get_column_type") {
 		CHECK_THROWS(tab.get_column_type(4));
 	}
-	auto& r = tab.rows().at(3);
+	auto r = tab.rows().at(3);
 	SECTION("in an get_column_name") {
 		CHECK_THROWS(r.get_cell_value<std::string>(4));
 	}
@@ -339,7 +464,7 @@ TEST_CASE_METHOD(test_fixture, "Attempting to use an invalid row index in erase_
 TEST_CASE_METHOD(test_fixture, "Attempting to set a cell to a value of the incorrect type throws an exception.",
 				 "[database][table][errors]") {
 	auto& tab = db.lookup_table("article"sv);
-	auto& r = tab.rows().at(0);
+	auto r = tab.rows().at(0);
 	SECTION("floating point to integer") {
 		CHECK_THROWS(r.set_cell_value(0, 123.45));
 	}
@@ -362,7 +487,7 @@ TEST_CASE_METHOD(test_fixture, "Attempting to set a cell to a value of the incor
 TEST_CASE_METHOD(test_fixture, "Attempting to read a cell value using the incorrect type throws an exception.",
 				 "[database][table][errors]") {
 	auto& tab = db.lookup_table("article"sv);
-	auto& r = tab.rows().at(0);
+	auto r = tab.rows().at(0);
 	SECTION("floating point from integer") {
 		CHECK_THROWS(r.get_cell_value<double>(0));
 	}
@@ -382,3 +507,607 @@ TEST_CASE_METHOD(test_fixture, "Attempting to read a cell value using the incorr
 		CHECK_THROWS(r.get_cell_value<std::string>(2));
 	}
 }
+TEST_CASE_METHOD(test_fixture, "Table cells are stored column-wise in typed contiguous arrays.",
+				 "[database][table][storage]") {
+	auto& tab = db.lookup_table("order_item"sv);
+	CHECK(tab.row_count() == 14);
+	const auto& counts = tab.column_data(2).data<long long>();
+	CHECK(counts.size() == 14);
+	CHECK(counts.at(0) == 5);
+	CHECK(counts.at(13) == 15);
+	const auto& prices = tab.column_data(3).data<double>();
+	CHECK(prices.at(1) == Approx(123.45));
+	CHECK_THROWS(tab.column_data(3).data<long long>());
+	auto r = tab.rows().at(1);
+	r.set_cell_value(2, 7LL);
+	CHECK(counts.at(1) == 7);
+	CHECK(r.get_cell_value<long long>(2) == 7);
+	// Only tables that aren't const hand out rows that can change their cells.
+	static_assert(std::is_same_v<decltype(std::as_const(tab).rows().at(1)), minidb::row>);
+	static_assert(std::is_same_v<decltype(*std::as_const(tab).rows().begin()), minidb::row>);
+	static_assert(!can_set_cells<minidb::row> && can_set_cells<minidb::mutable_row>);
+}
+TEST_CASE_METHOD(test_fixture, "Plain string cells take 8 bytes each and share one heap per column for longer strings.",
+				 "[database][table][storage]") {
+	auto& tab = db.lookup_table("customer"sv);
+	const auto& names = tab.column_data(1).data<std::string>();
+	const auto& addresses = tab.column_data(3).data<std::string>();
+	// Strings of up to 7 bytes are stored inline, longer ones with a length prefix of a byte per 7 bits.
+	CHECK(names.heap_size() == 0);
+	CHECK(addresses.heap_size() == 2 * (1 + "Fake Street 123, Fake City"sv.size()));
+	CHECK(addresses.at(1) == "Main Street 234, Somewhere");
+	CHECK_THROWS_AS(addresses.at(2), std::out_of_range);
+
+	const auto heap_size = addresses.heap_size();
+	db.update_cell("customer"sv, 0, 3, "Fake Street 1, Fake City"s);
+	CHECK(addresses.heap_size() == heap_size);
+	db.update_cell("customer"sv, 1, 3, "Short"s);
+	CHECK(addresses.heap_size() == heap_size);
+	const auto long_address = std::string(200, 'x');
+	db.update_cell("customer"sv, 1, 3, long_address);
+	CHECK(addresses.heap_size() == heap_size + 2 + long_address.size());
+	db.update_cell("customer"sv, 0, 1, "Johnathan"s);
+	CHECK(names.heap_size() == 1 + "Johnathan"sv.size());
+	check_approx_row(tab.row_at(0), {10LL, "Johnathan"s, "Doe"s, "Fake Street 1, Fake City"s});
+	check_approx_row(tab.row_at(1), {11LL, "Jane"s, "Smith"s, long_address});
+
+	db.append_row("customer"sv, {12LL, ""s, "Nobody"s, ""s});
+	db.erase_row("customer"sv, 0);
+	db.compact("customer"sv);
+	CHECK(names.heap_size() == 0);
+	CHECK(addresses.heap_size() == 2 + long_address.size());
+	check_approx_table(tab, {{11LL, "Jane"s, "Smith"s, long_address}, {12LL, ""s, "Nobody"s, ""s}});
+
+	// A cell can be overwritten with a part of itself.
+	minidb::string_column column;
+	column.push_back(std::string(200, 'x') + "tail");
+	column.set(0, column[0].substr(1));
+	column.set(0, column[0].substr(150));
+	CHECK(column[0] == std::string(49, 'x') + "tail");
+	column.set(0, column[0].substr(40));
+	CHECK(column[0] == "xxxxxxxxxtail");
+}
+TEST_CASE_METHOD(test_fixture, "The string heap reclaims the bytes of overwritten cells without compacting the table.",
+				 "[database][table][storage]") {
+	const auto& tab = db.lookup_table("customer"sv);
+	const auto& addresses = tab.column_data(3).data<std::string>();
+	std::string address;
+	for(std::size_t size = 8; size <= 2000; ++size) {
+		address.assign(size, static_cast<char>('a' + size % 26));
+		db.update_cell("customer"sv, 0, 3, address);
+		const auto live_bytes = (size < 128 ? 1 : 2) + size + 1 + "Main Street 234, Somewhere"sv.size();
+		const auto reclaimed_at = std::max(live_bytes, minidb::string_column::min_reclaimed_bytes);
+		CHECK(addresses.heap_size() <= live_bytes + reclaimed_at);
+	}
+	check_approx_table(tab, {{10LL, "John"s, "Doe"s, address},
+	                         {11LL, "Jane"s, "Smith"s, "Main Street 234, Somewhere"s}});
+}
+TEST_CASE_METHOD(test_fixture, "Rows can be appended in batches that are validated as a whole.", "[database][append]") {
+	db.create_index("article"sv, "name"sv);
+	db.erase_row("article"sv, 0);
+	db.compact("article"sv);
+	std::vector<std::vector<minidb::value>> rows = {{3LL, "bolt"s, 0.5}, {4LL, "nut"s, 0.25}, {5LL, "bolt"s, 0.75}};
+	CHECK(db.append_rows("article"sv, rows) == 2);
+	std::vector<std::vector<minidb::value>> bad_rows = {{6LL, "washer"s, 0.1}, {7LL, "screw"s, 1LL}};
+	CHECK_THROWS_AS(db.append_rows("article"sv, bad_rows), std::invalid_argument);
+	bad_rows = {{6LL, "washer"s, 0.1}, {7LL, "screw"s}};
+	CHECK_THROWS_AS(db.append_rows("article"sv, bad_rows), std::invalid_argument);
+	CHECK(db.append_rows("article"sv, std::span<std::vector<minidb::value>>{}) == 5);
+
+	const auto& tab = db.lookup_table("article"sv);
+	check_approx_table(tab, {{2LL, "gizmo"s, 123.45}, {3LL, "bolt"s, 0.5}, {4LL, "nut"s, 0.25}, {5LL, "bolt"s, 0.75}});
+	CHECK(tab.slot_of(4) == 3);
+	CHECK(tab.find_index(1)->lookup("bolt"s) == std::vector<std::size_t>{1, 3});
+}
+TEST_CASE_METHOD(test_fixture, "Prepared statements substitute their parameters on every execution.",
+				 "[database][prepared]") {
+	using kind = minidb::prepared_statement::kind;
+	using target = minidb::prepared_statement::parameter::target;
+	using comparison = minidb::row_filter::comparison;
+	db.create_index("order_item"sv, "order_number"sv);
+	const auto filter = [](std::vector<minidb::row_filter::predicate> predicates) {
+		return std::optional<minidb::row_filter>{std::in_place, std::move(predicates)};
+	};
+
+	auto add = db.prepare({kind::append_row, "order_item", {0LL, 0LL, 0LL, 42.12}, {}, {}, {},
+	                       {{target::cell, 0}, {target::cell, 2}, {target::cell, 1}}});
+	CHECK(add.parameter_count() == 3);
+	const std::vector<minidb::value> first_parameters = {109LL, 3LL, 1LL};
+	CHECK(db.append_row(add, first_parameters) == 14);
+	CHECK(db.append_row(add, std::vector<minidb::value>{110LL, 7LL, 1LL}) == 15);
+
+	auto count_of_order = db.prepare({kind::query_column_histogram, "order_item", {}, "count", {},
+	                                  filter({{"order_number", comparison::equal, {0LL}}}),
+	                                  {{target::filter_operand, 0}}});
+	std::map<minidb::value, std::size_t> expected = {{3LL, 1}};
+	CHECK(db.query_column_histogram(count_of_order, std::vector<minidb::value>{109LL}) == expected);
+	expected = {{3LL, 1}, {4LL, 1}};
+	CHECK(db.query_column_histogram(count_of_order, std::vector<minidb::value>{104LL}) == expected);
+
+	auto reprice = db.prepare({kind::update_rows, "order_item", {}, {}, {{"unit_price", 0.0}},
+	                           filter({{"count", comparison::between, {0LL, 0LL}}}),
+	                           {{target::filter_operand, 0, 0}, {target::filter_operand, 0, 1}, {target::cell, 0}}});
+	db.update_rows(reprice, std::vector<minidb::value>{6LL, 9LL, 1.0});
+	auto orders = db.prepare({kind::query_table, "order_item", {}, {}, {},
+	                          filter({{"unit_price", comparison::less, {0.0}}}), {{target::filter_operand, 0}}});
+	std::vector<long long> order_numbers;
+	db.query_table(orders, std::vector<minidb::value>{2.0}, [&](const minidb::row& row) {
+		order_numbers.push_back(row.get_cell_value<long long>(0));
+	});
+	CHECK(order_numbers == std::vector<long long>{105LL, 110LL});
+
+	auto remove = db.prepare({kind::erase_rows, "order_item", {}, {}, {},
+	                          filter({{"order_number", comparison::in, {0LL, 0LL}}}),
+	                          {{target::filter_operand, 0, 0}, {target::filter_operand, 0, 1}}});
+	db.erase_rows(remove, std::vector<minidb::value>{110LL, 100LL});
+	CHECK(db.lookup_table("order_item"sv).row_count() == 13);
+
+	CHECK_THROWS_AS(db.erase_rows(orders, std::vector<minidb::value>{2.0}), std::invalid_argument);
+	CHECK_THROWS_AS(db.append_row(add, std::vector<minidb::value>{111LL}), std::invalid_argument);
+	CHECK_THROWS_AS(db.append_row(add, std::vector<minidb::value>{111LL, "x"s, 1LL}), std::invalid_argument);
+	CHECK_THROWS_AS(db.prepare({kind::append_row, "order_item", {0LL}, {}, {}, {}, {{target::cell, 1}}}),
+	                std::invalid_argument);
+	CHECK_THROWS_AS(db.prepare({kind::query_table, "order_item", {}, {}, {}, {}, {{target::filter_operand, 0}}}),
+	                std::invalid_argument);
+	CHECK_THROWS_AS(db.prepare({kind::update_rows, "order_item", {}, {}, {{"count", 1LL}, {"count", 2LL}}, {}, {}}),
+	                std::invalid_argument);
+	CHECK_THROWS_AS(db.prepare({kind::query_column_histogram, "order_item", {}, "dummy", {}, {}, {}}),
+	                std::invalid_argument);
+	CHECK_THROWS_AS(db.prepare({kind::query_table, "dummy", {}, {}, {}, {}, {}}), std::out_of_range);
+
+	// The table is looked up again once the catalog changed.
+	db.drop_table("order_item"sv);
+	CHECK_THROWS_AS(db.append_row(add, first_parameters), std::out_of_range);
+	db.create_table("order_item"sv, minidb::schema{{{"order_number", minidb::value_type::integer},
+	                                                 {"count", minidb::value_type::integer},
+	                                                 {"article_number", minidb::value_type::integer},
+	                                                 {"unit_price", minidb::value_type::decimal}}});
+	db.append_row(add, first_parameters);
+	check_approx_table(db.lookup_table("order_item"sv), {{109LL, 1LL, 3LL, 42.12}});
+	expected = {{1LL, 1}};
+	CHECK(db.query_column_histogram(count_of_order, std::vector<minidb::value>{109LL}) == expected);
+}
+TEST_CASE("Prepared statements are recorded in the write-ahead log.", "[database][prepared][wal]") {
+	using kind = minidb::prepared_statement::kind;
+	using target = minidb::prepared_statement::parameter::target;
+	test::temporary_file log("minidb_prepared_logged.log");
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"name", minidb::value_type::string}}});
+		auto add = db.prepare({kind::append_row, "t", {0LL, "?"s}, {}, {}, {}, {{target::cell, 0}}});
+		for(long long id = 1; id <= 4; ++id) db.append_row(add, std::vector<minidb::value>{id});
+		const minidb::row_filter by_id{{"id", 0LL}};
+		auto rename = db.prepare({kind::update_rows, "t", {}, {}, {{"name", ""s}}, by_id,
+		                          {{target::filter_operand, 0}, {target::cell, 0}}});
+		db.update_rows(rename, std::vector<minidb::value>{2LL, "two"s});
+		auto remove = db.prepare({kind::erase_rows, "t", {}, {}, {}, by_id, {{target::filter_operand, 0}}});
+		db.erase_rows(remove, std::vector<minidb::value>{3LL});
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	check_approx_table(db.lookup_table("t"sv), {{1LL, "?"s}, {2LL, "two"s}, {4LL, "?"s}});
+}
+TEST_CASE_METHOD(test_fixture, "Query results are cached until their table is modified.", "[database][result_cache]") {
+	db.configure_result_cache(1 << 20);
+	const auto order_numbers = [this](minidb::row_filter filter) {
+		std::vector<long long> numbers;
+		db.query_table("order_item"sv, std::move(filter), [&numbers](const minidb::row& row) {
+			numbers.push_back(row.get_cell_value<long long>(0));
+		});
+		return numbers;
+	};
+	const auto check_statistics = [this](std::size_t hits, std::size_t misses) {
+		const auto statistics = db.result_cache_statistics();
+		CHECK(statistics.hits == hits);
+		CHECK(statistics.misses == misses);
+	};
+
+	CHECK(order_numbers({{"article_number"s, 1LL}, {"count", 5LL}}) == std::vector<long long>{100LL, 105LL, 107LL});
+	check_statistics(0, 1);
+	// The order of the predicates doesn't matter.
+	CHECK(order_numbers({{"count", 5LL}, {"article_number"s, 1LL}}) == std::vector<long long>{100LL, 105LL, 107LL});
+	check_statistics(1, 1);
+	std::map<minidb::value, std::size_t> expected = {{1LL, 8}, {2LL, 6}};
+	CHECK(db.query_column_histogram("order_item"sv, "article_number"sv) == expected);
+	const auto histogram = db.shared_column_histogram("order_item"sv, "article_number"sv);
+	CHECK(*histogram == expected);
+	// A cached histogram can be shared instead of copied.
+	CHECK(db.shared_column_histogram("order_item"sv, "article_number"sv) == histogram);
+	check_statistics(3, 2);
+	CHECK(db.result_cache_statistics().entries == 2);
+
+	// Every modification makes the results of the table stale, but not those of other tables.
+	db.append_row("order_item"sv, {109LL, 2LL, 5LL, 123.45});
+	expected = {{1LL, 8}, {2LL, 7}};
+	CHECK(db.query_column_histogram("order_item"sv, "article_number"sv) == expected);
+	check_statistics(3, 3);
+	db.update_rows("order_item"sv, {{"order_number", 109LL}}, {{"article_number", 1LL}});
+	CHECK(order_numbers({{"article_number"s, 1LL}, {"count", 5LL}}) ==
+	      std::vector<long long>{100LL, 105LL, 107LL, 109LL});
+	db.update_cell("order_item"sv, 0, 2, 6LL);
+	CHECK(order_numbers({{"article_number"s, 1LL}, {"count", 5LL}}) == std::vector<long long>{105LL, 107LL, 109LL});
+	db.erase_row("order_item"sv, 8);
+	CHECK(order_numbers({{"article_number"s, 1LL}, {"count", 5LL}}) == std::vector<long long>{107LL, 109LL});
+	db.erase_rows("order_item"sv, {{"order_number", 109LL}});
+	CHECK(order_numbers({{"article_number"s, 1LL}, {"count", 5LL}}) == std::vector<long long>{107LL});
+	check_statistics(3, 7);
+	expected = {{"Doe"s, 1}};
+	CHECK(db.query_column_histogram("customer"sv, "last_name"sv, {{"first_name", "John"s}}) == expected);
+	db.append_row("article"sv, {3LL, "gadget"s, 9.99});
+	CHECK(db.query_column_histogram("customer"sv, "last_name"sv, {{"first_name", "John"s}}) == expected);
+	check_statistics(4, 8);
+
+	// A table created again under the name of a dropped one doesn't see its results.
+	db.drop_table("customer"sv);
+	db.create_table("customer"sv, minidb::schema{{{"first_name", minidb::value_type::string},
+	                                               {"last_name", minidb::value_type::string}}});
+	db.append_row("customer"sv, {"John"s, "Roe"s});
+	expected = {{"Roe"s, 1}};
+	CHECK(db.query_column_histogram("customer"sv, "last_name"sv, {{"first_name", "John"s}}) == expected);
+	check_statistics(4, 9);
+
+	// Once the budget is exceeded, the least recently used results are evicted.
+	db.configure_result_cache(1024);
+	const std::vector<std::size_t> item_counts = {2, 2, 1, 1, 2, 1, 1, 2, 1};
+	for(long long number = 100; number != 109; ++number) {
+		CHECK(order_numbers({{"order_number", number}}).size() == item_counts[number - 100]);
+	}
+	auto statistics = db.result_cache_statistics();
+	CHECK(statistics.evictions > 0);
+	CHECK(statistics.bytes <= 1024);
+	CHECK(order_numbers({{"order_number", 108LL}}) == std::vector<long long>{108LL});
+	CHECK(db.result_cache_statistics().hits == 1);
+	CHECK(order_numbers({{"order_number", 100LL}}) == std::vector<long long>{100LL, 100LL});
+	CHECK(db.result_cache_statistics().misses == statistics.misses + 1);
+
+	db.configure_result_cache(0);
+	CHECK(order_numbers({{"order_number", 108LL}}) == std::vector<long long>{108LL});
+	CHECK(db.result_cache_statistics().hits == 0);
+}
+
+TEST_CASE_METHOD(test_fixture, "Appending a row with mismatching cells throws and leaves the table unchanged.",
+				 "[database][table][errors]") {
+	auto& tab = db.lookup_table("article"sv);
+	CHECK_THROWS(db.append_row("article"sv, {3LL, 42LL, 1.5}));
+	CHECK_THROWS(db.append_row("article"sv, {3LL, "thing"s}));
+	CHECK(tab.row_count() == 2);
+	for(std::size_t column_index = 0; column_index != tab.columns().size(); ++column_index) {
+		CHECK(tab.column_data(column_index).size() == 2);
+	}
+}
+TEST_CASE_METHOD(test_fixture, "Column indexes are used by row filters and stay up to date on every mutation.",
+				 "[database][index]") {
+	auto kind = GENERATE(minidb::index_kind::hash, minidb::index_kind::ordered);
+	db.create_index("order_item"sv, "article_number"sv, kind);
+	db.create_index("order_item"sv, "count"sv, kind);
+	CHECK_THROWS(db.create_index("order_item"sv, "count"sv, kind));
+	CHECK_THROWS(db.create_index("order_item"sv, "dummy"sv, kind));
+	const auto& index = *db.lookup_table("order_item"sv).find_index(1);
+	CHECK(index.lookup(2LL) == std::vector<std::size_t>{1, 3, 5, 7, 9, 12});
+
+	std::map<minidb::value, std::size_t> expected_histogram = {{1LL, 1}, {4LL, 2}, {5LL, 3}, {10LL, 1}, {15LL, 1}};
+	CHECK(db.query_column_histogram("order_item"sv, "count"sv, {{"article_number"s, 1LL}}) == expected_histogram);
+
+	db.update_rows("order_item"sv, {{"article_number", 1LL}, {"count", 5LL}}, {{"count", 6LL}});
+	db.update_cell("order_item"sv, 1, 1, 3LL);
+	db.erase_row("order_item"sv, 0);
+	db.append_row("order_item"sv, {109LL, 2LL, 6LL, 123.45});
+	db.erase_rows("order_item"sv, {{"count", 4LL}});
+
+	std::vector<std::vector<minidb::value>> expected_order_items = {
+			{105LL, 1LL, 6LL, 42.12}, {107LL, 1LL, 6LL, 42.12}, {109LL, 2LL, 6LL, 123.45}};
+	std::size_t row_index = 0;
+	db.query_table("order_item"sv, {{"count"s, 6LL}}, [&](const minidb::row& row) {
+		CHECK(row_index < expected_order_items.size());
+		check_approx_row(row, expected_order_items.at(row_index++));
+	});
+	CHECK(row_index == expected_order_items.size());
+	CHECK(index.lookup(3LL) == std::vector<std::size_t>{1});
+	db.compact("order_item"sv);
+	CHECK(index.lookup(3LL) == std::vector<std::size_t>{0});
+	CHECK(index.lookup(1LL).size() == 5);
+	CHECK(index.lookup(42LL).empty());
+}
+TEST_CASE("Dictionary-encoded string columns store each distinct string once and behave like plain string columns.",
+		  "[database][table][dictionary]") {
+	minidb::database db;
+	CHECK_THROWS(minidb::column{"bad", minidb::value_type::integer, minidb::column_encoding::dictionary});
+	db.create_table("visit"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"country", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	db.append_row("visit"sv, {1LL, "DE"s});
+	db.append_row("visit"sv, {2LL, "FR"s});
+	db.append_row("visit"sv, {3LL, "DE"s});
+	db.append_row("visit"sv, {4LL, "IT"s});
+	db.append_row("visit"sv, {5LL, "DE"s});
+	CHECK_THROWS(db.append_row("visit"sv, {6LL, 42LL}));
+
+	const auto& tab = db.lookup_table("visit"sv);
+	const auto& column = tab.column_data(1);
+	CHECK(column.type() == minidb::value_type::string);
+	CHECK(column.dictionary().dictionary_size() == 3);
+	CHECK(column.dictionary().codes() == std::vector<std::uint32_t>{0, 1, 0, 2, 0});
+	CHECK(tab.rows().at(3).get_cell_value<std::string>(1) == "IT");
+
+	std::map<minidb::value, std::size_t> expected_histogram = {{"DE"s, 3}, {"FR"s, 1}, {"IT"s, 1}};
+	CHECK(db.query_column_histogram("visit"sv, "country"sv) == expected_histogram);
+	expected_histogram = {{"DE"s, 1}};
+	CHECK(db.query_column_histogram("visit"sv, "country"sv, {{"id"s, 3LL}}) == expected_histogram);
+
+	db.update_rows("visit"sv, {{"country", "FR"s}}, {{"country", "ES"s}});
+	db.erase_rows("visit"sv, {{"country", "IT"s}});
+	db.update_cell("visit"sv, 0, 1, "ES"s);
+	CHECK(column.dictionary().dictionary_size() == 4);
+	check_approx_table(tab, {{1LL, "ES"s}, {2LL, "ES"s}, {3LL, "DE"s}, {5LL, "DE"s}});
+
+	std::size_t matches = 0;
+	db.query_table("visit"sv, {{"country", "ES"s}}, [&matches](const auto&) { ++matches; });
+	CHECK(matches == 2);
+	db.query_table("visit"sv, {{"country", "IT"s}}, [&matches](const auto&) { ++matches; });
+	db.query_table("visit"sv, {{"country", "PL"s}}, [&matches](const auto&) { ++matches; });
+	db.query_table("visit"sv, {{"country", 42LL}}, [&matches](const auto&) { ++matches; });
+	CHECK(matches == 2);
+}
+TEST_CASE("Parallel scans return the same rows, in the same order, as serial scans.", "[database][parallel]") {
+	minidb::database db;
+	// A database only starts scan threads once it's configured to.
+	CHECK(db.scan_concurrency() == 1);
+	db.configure_scans(4, 1);
+	CHECK(db.scan_concurrency() == 4);
+	db.create_table("big"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											 {"bucket", minidb::value_type::integer},
+											 {"group", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	constexpr long long row_count = 20000;
+	for(long long i = 0; i != row_count; ++i) db.append_row("big"sv, {i, i % 7, "g"s + std::to_string(i % 3)});
+
+	std::vector<long long> ids;
+	db.query_table("big"sv, {{"bucket", 3LL}}, [&ids](const minidb::row& row) {
+		ids.push_back(row.get_cell_value<long long>(0));
+	});
+	std::vector<long long> expected_ids;
+	for(long long i = 3; i < row_count; i += 7) expected_ids.push_back(i);
+	CHECK(ids == expected_ids);
+
+	std::map<minidb::value, std::size_t> expected_histogram = {{"g0"s, 953}, {"g1"s, 952}, {"g2"s, 952}};
+	CHECK(db.query_column_histogram("big"sv, "group"sv, {{"bucket", 3LL}}) == expected_histogram);
+	expected_histogram = {{0LL, 2858}, {1LL, 2857}, {2LL, 2857}, {3LL, 2857}, {4LL, 2857}, {5LL, 2857}, {6LL, 2857}};
+	CHECK(db.query_column_histogram("big"sv, "bucket"sv) == expected_histogram);
+
+	db.update_rows("big"sv, {{"bucket", 3LL}}, {{"group", "three"s}});
+	db.erase_rows("big"sv, {{"group", "g0"s}});
+	expected_histogram = {{"g1"s, 5715}, {"g2"s, 5714}, {"three"s, 2857}};
+	CHECK(db.query_column_histogram("big"sv, "group"sv) == expected_histogram);
+	CHECK(db.lookup_table("big"sv).row_count() == 14286);
+}
+TEST_CASE("Tables can be queried and modified from several threads at once.", "[database][concurrency]") {
+	minidb::database db;
+	db.configure_scans(2, 1);
+	db.create_table("event"sv, minidb::schema{{{"writer", minidb::value_type::integer},
+											   {"twice", minidb::value_type::integer},
+											   {"label", minidb::value_type::string}}});
+	db.create_table("other"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+	constexpr long long writer_count = 3;
+	constexpr long long rows_per_writer = 500;
+	std::atomic<bool> writing{true};
+	std::atomic<std::size_t> inconsistent_reads{0};
+	std::atomic<std::size_t> reads{0};
+
+	std::vector<std::thread> threads;
+	for(long long writer = 0; writer != writer_count; ++writer) {
+		threads.emplace_back([&db, writer] {
+			for(long long i = 0; i != rows_per_writer; ++i) {
+				const auto id = db.append_row("event"sv, {writer, 2 * i, "row "s + std::to_string(i)});
+				if(i % 10 == 0) db.update_cell_by_id("event"sv, id, 2, "updated"s);
+			}
+		});
+	}
+	threads.emplace_back([&db] {
+		for(long long i = 0; i != rows_per_writer; ++i) db.append_row("other"sv, {i});
+		for(int i = 0; i != 20; ++i) {
+			db.create_table("scratch"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+			db.drop_table("scratch"sv);
+		}
+	});
+	for(int reader = 0; reader != 2; ++reader) {
+		threads.emplace_back([&] {
+			while(writing) {
+				// Every row is appended as a whole, so the cells of a row always match and each query sees a prefix
+				// of every writer's rows.
+				std::map<long long, long long> rows_by_writer;
+				db.query_table("event"sv, [&](const minidb::row& row) {
+					const auto writer = row.get_cell_value<long long>(0);
+					if(row.get_cell_value<long long>(1) != 2 * rows_by_writer[writer]++) ++inconsistent_reads;
+				});
+				std::size_t queried_rows = 0;
+				for(const auto& [writer, count] : rows_by_writer) queried_rows += static_cast<std::size_t>(count);
+				std::size_t histogram_rows = 0;
+				for(const auto& [writer, count] : db.query_column_histogram("event"sv, "writer"sv)) {
+					histogram_rows += count;
+				}
+				if(histogram_rows < queried_rows) ++inconsistent_reads;
+				++reads;
+			}
+		});
+	}
+	for(long long writer = 0; writer <= writer_count; ++writer) threads[static_cast<std::size_t>(writer)].join();
+	writing = false;
+	for(auto& thread : threads) {
+		if(thread.joinable()) thread.join();
+	}
+
+	CHECK(inconsistent_reads == 0);
+	CHECK(reads > 0);
+	CHECK(db.lookup_table("event"sv).row_count() == writer_count * rows_per_writer);
+	CHECK(db.lookup_table("other"sv).row_count() == rows_per_writer);
+	CHECK_THROWS(db.lookup_table("scratch"sv));
+	std::map<minidb::value, std::size_t> expected_histogram = {{0LL, 500}, {1LL, 500}, {2LL, 500}};
+	CHECK(db.query_column_histogram("event"sv, "writer"sv) == expected_histogram);
+	CHECK(db.query_column_histogram("event"sv, "label"sv, {{"label", "updated"s}}).at("updated"s) == 150);
+}
+TEST_CASE_METHOD(test_fixture, "A database can be saved to and loaded from a binary snapshot.",
+				 "[database][snapshot]") {
+	test::temporary_file snapshot("minidb_snapshot_test.snap");
+	db.create_table("tagged"sv, minidb::schema{{{"id", minidb::value_type::integer},
+												{"tag", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	db.append_row("tagged"sv, {1LL, "red"s});
+	db.append_row("tagged"sv, {2LL, "blue"s});
+	db.append_row("tagged"sv, {3LL, "red"s});
+	db.create_table("empty"sv, minidb::schema{{{"x", minidb::value_type::decimal}}});
+	db.create_index("order_item"sv, "article_number"sv, minidb::index_kind::ordered);
+	db.save(snapshot.path);
+
+	minidb::database loaded;
+	loaded.create_table("replaced"sv, minidb::schema{{{"x", minidb::value_type::integer}}});
+	loaded.load(snapshot.path);
+	REQUIRE(loaded.tables().size() == db.tables().size());
+	CHECK_THROWS(loaded.lookup_table("replaced"sv));
+	for(const auto& [name, expected] : db.tables()) {
+		CAPTURE(name);
+		const auto& actual = loaded.lookup_table(name);
+		REQUIRE(actual.columns().size() == expected.columns().size());
+		for(std::size_t column = 0; column != expected.columns().size(); ++column) {
+			CHECK(actual.columns()[column].name() == expected.columns()[column].name());
+			CHECK(actual.columns()[column].encoding() == expected.columns()[column].encoding());
+		}
+		std::vector<std::vector<minidb::value>> expected_cells;
+		for(const auto& row : expected.rows()) {
+			auto& cells = expected_cells.emplace_back();
+			for(std::size_t column = 0; column != row.size(); ++column) cells.push_back(row.get_cell_value(column));
+		}
+		check_approx_table(actual, expected_cells);
+	}
+
+	// Numeric columns are served from the mapped file until they are first modified.
+	const auto& counts = loaded.lookup_table("order_item"sv).column_data(2).data<long long>();
+	CHECK(counts.is_mapped());
+	CHECK_FALSE(loaded.lookup_table("order_item"sv).column_data(3).data<double>().empty());
+	CHECK(loaded.lookup_table("order_item"sv).find_index(1)->kind() == minidb::index_kind::ordered);
+	loaded.update_cell("order_item"sv, 0, 2, 99LL);
+	CHECK_FALSE(counts.is_mapped());
+	CHECK(counts.at(0) == 99);
+	CHECK(counts.at(13) == 15);
+	// The zones of mapped columns are only computed once they're needed, here by the update.
+	REQUIRE(counts.zones().size() == 1);
+	CHECK(counts.zones()[0].min == *std::min_element(counts.begin(), counts.end()));
+	CHECK(counts.zones()[0].max == 99);
+	std::size_t matches = 0;
+	loaded.query_table("order_item"sv, {{"article_number", 2LL}}, [&matches](const auto&) { ++matches; });
+	CHECK(matches == 6);
+	loaded.append_row("tagged"sv, {4LL, "red"s});
+	std::map<minidb::value, std::size_t> expected_histogram = {{"blue"s, 1}, {"red"s, 3}};
+	CHECK(loaded.query_column_histogram("tagged"sv, "tag"sv) == expected_histogram);
+	// The snapshot file can be overwritten while a loaded database still refers to it.
+	loaded.save(snapshot.path);
+	CHECK(counts.at(13) == 15);
+}
+
+TEST_CASE_METHOD(test_fixture, "Snapshots keep the erased rows of a table that wasn't compacted.", "[database][snapshot]") {
+	test::temporary_file snapshot("minidb_snapshot_tombstones.snap");
+	db.configure_compaction(0);
+	db.create_index("order_item"sv, "article_number"sv);
+	db.erase_rows("order_item"sv, {{"article_number", 2LL}});
+	db.save(snapshot.path);
+
+	minidb::database loaded;
+	loaded.load(snapshot.path);
+	const auto& expected = db.lookup_table("order_item"sv);
+	const auto& actual = loaded.lookup_table("order_item"sv);
+	CHECK(actual.slot_count() == 14);
+	CHECK(actual.erased_count() == 6);
+	for(std::size_t row_index = 0; row_index != actual.slot_count(); ++row_index) {
+		CHECK(actual.is_erased(row_index) == expected.is_erased(row_index));
+	}
+	CHECK(actual.find_index(1)->lookup(2LL).empty());
+	CHECK(actual.find_index(1)->lookup(1LL).size() == 8);
+	CHECK_THROWS_AS(loaded.erase_row("order_item"sv, 1), std::out_of_range);
+
+	// Row IDs survive a compaction before the snapshot.
+	loaded.compact("order_item"sv);
+	loaded.save(snapshot.path);
+	minidb::database reloaded;
+	reloaded.load(snapshot.path);
+	const auto& compacted = reloaded.lookup_table("order_item"sv);
+	CHECK(compacted.slot_count() == 8);
+	CHECK(compacted.rows()[1].id() == 2);
+	CHECK(compacted.slot_of(13) == 7);
+	CHECK(reloaded.append_row("order_item"sv, {109LL, 1LL, 1LL, 42.12}) == 14);
+}
+
+TEST_CASE("Loading an invalid snapshot throws and leaves the database unchanged.", "[database][snapshot]") {
+	test::temporary_file snapshot("minidb_snapshot_invalid.snap");
+	minidb::database db;
+	db.create_table("kept"sv, minidb::schema{{{"x", minidb::value_type::integer}}});
+	CHECK_THROWS(db.load(snapshot.path));
+	{
+		std::ofstream out(snapshot.path, std::ios::binary);
+		out << "MDBSNAP";
+	}
+	CHECK_THROWS(db.load(snapshot.path));
+	db.save(snapshot.path);
+	std::filesystem::resize_file(snapshot.path, std::filesystem::file_size(snapshot.path) - 1);
+	CHECK_THROWS(db.load(snapshot.path));
+	CHECK_NOTHROW(db.lookup_table("kept"sv));
+}
+
+TEST_CASE("CSV files can be bulk loaded into a table.", "[database][csv]") {
+	test::temporary_file file("minidb_bulk_load.csv");
+	{
+		std::ofstream out(file.path, std::ios::binary);
+		out << "id,name,tag,price\n";
+		for(int i = 0; i != 1000; ++i) {
+			out << i << ",\"name " << i << "\"," << (i % 3 == 0 ? "fizz" : "plain") << ", " << i * 0.5 << "\n";
+		}
+	}
+	minidb::database db;
+	db.create_table("items"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"name", minidb::value_type::string},
+											   {"tag", minidb::value_type::string, minidb::column_encoding::dictionary},
+											   {"price", minidb::value_type::decimal}}});
+	db.create_index("items"sv, "tag"sv);
+	db.append_row("items"sv, {-1LL, "existing"s, "fizz"s, 0.0});
+	minidb::csv_options options;
+	options.header = true;
+	options.batch_rows = 64;
+	CHECK(db.bulk_load_csv("items"sv, file.path, options) == 1000);
+
+	const auto& tab = db.lookup_table("items"sv);
+	REQUIRE(tab.row_count() == 1001);
+	check_approx_row(tab.rows().at(1), {0LL, "name 0"s, "fizz"s, 0.0});
+	check_approx_row(tab.rows().at(1000), {999LL, "name 999"s, "fizz"s, 499.5});
+	CHECK(tab.column_data(2).dictionary().dictionary_size() == 2);
+	std::map<minidb::value, std::size_t> expected_histogram = {{"fizz"s, 335}, {"plain"s, 666}};
+	CHECK(db.query_column_histogram("items"sv, "tag"sv) == expected_histogram);
+
+	// The header line doesn't parse as integer, the whole file is rejected in its first batch.
+	CHECK_THROWS_AS(db.bulk_load_csv("items"sv, file.path), std::invalid_argument);
+	CHECK(tab.row_count() == 1001);
+	{
+		std::ofstream out(file.path, std::ios::binary);
+		out << "1,a,b,1.0\n2,a,b\n";
+	}
+	CHECK_THROWS_WITH(db.bulk_load_csv("items"sv, file.path), Catch::Contains("Line 2"));
+	CHECK_THROWS(db.bulk_load_csv("missing"sv, file.path));
+}
+
+TEST_CASE("Bulk loaded rows are recorded in the write-ahead log.", "[database][csv][wal]") {
+	test::temporary_file file("minidb_bulk_load_logged.csv");
+	test::temporary_file log("minidb_bulk_load_logged.log");
+	{
+		std::ofstream out(file.path, std::ios::binary);
+		out << "1,one,1.5\n2,two,2.5\n3,three,3.5\n";
+	}
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"name", minidb::value_type::string},
+											   {"value", minidb::value_type::decimal}}});
+		minidb::csv_options options;
+		options.batch_rows = 2;
+		CHECK(db.bulk_load_csv("t"sv, file.path, options) == 3);
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	check_approx_table(db.lookup_table("t"sv), {{1LL, "one"s, 1.5}, {2LL, "two"s, 2.5}, {3LL, "three"s, 3.5}});
+}
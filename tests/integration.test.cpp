@@ -3,6 +3,7 @@
 #include <catch2/catch.hpp>
 #include <command_processor.hpp>
 #include <database.hpp>
+#include <fstream>
 #include <sstream>
 
 namespace {
@@ -50,6 +51,17 @@ TEST_CASE_METHOD(test_fixture, "The append_row command can be successfully used
 	CHECK(tab.rows().at(0).get_cell_value<double>(2) == Approx(-123.456));
 }
 
+TEST_CASE_METHOD(test_fixture, "The append_rows command appends many rows at once or none of them.",
+				 "[integration][append]") {
+	db.create_table("append-test", minidb::schema{{{"A", minidb::value_type::integer},
+												   {"B", minidb::value_type::string}}});
+	cmd_proc.execute("append_rows append-test [[1, \"one\"], [2, two], [3, \"three\"]]", output);
+	CHECK_THROWS(cmd_proc.execute("append_rows append-test [[4, four], [five, 5]]", output));
+	CHECK_THROWS(cmd_proc.execute("append_rows append-test [[4, four], [5]]", output));
+	CHECK_THROWS(cmd_proc.execute("append_rows append-test [4, four]", output));
+	check_approx_table(db.lookup_table("append-test"), {{1LL, "one"}, {2LL, "two"}, {3LL, "three"}});
+}
+
 TEST_CASE_METHOD(test_fixture,
 				 "The update_rows command can be successfully used to change cell values in an existing table.",
 				 "[integration][update]") {
@@ -161,6 +173,30 @@ TEST_CASE_METHOD(test_fixture, "The erase_row command can be successfully used t
 	cmd_proc.execute("erase_row erase-test 4", output);
 	check_approx_table(db.lookup_table("erase-test"), expected);
 }
+TEST_CASE_METHOD(test_fixture, "The compact command removes the erased rows of a table.", "[integration][compact]") {
+	db.configure_compaction(0);
+	db.create_table("compact-test", minidb::schema{{{"X", minidb::value_type::integer}}});
+	for(long long x = 0; x != 4; ++x) db.append_row("compact-test", {x});
+	cmd_proc.execute("erase_row compact-test 1", output);
+	cmd_proc.execute("erase_row compact-test 2", output);
+	CHECK(db.lookup_table("compact-test").slot_count() == 4);
+	cmd_proc.execute("compact compact-test", output);
+	CHECK(db.lookup_table("compact-test").slot_count() == 2);
+	check_approx_table(db.lookup_table("compact-test"), {{0LL}, {3LL}});
+	CHECK_THROWS(cmd_proc.execute("compact", output));
+}
+TEST_CASE_METHOD(test_fixture, "Rows can be updated and erased by their ID.", "[integration][row_id]") {
+	db.create_table("id-test", minidb::schema{{{"X", minidb::value_type::integer}}});
+	for(long long x = 0; x != 4; ++x) db.append_row("id-test", {x * 10});
+	cmd_proc.execute("erase_row_by_id id-test 0", output);
+	cmd_proc.execute("compact id-test", output);
+	cmd_proc.execute("update_cell_by_id id-test 2 0 21", output);
+	check_approx_table(db.lookup_table("id-test"), {{10LL}, {21LL}, {30LL}});
+	CHECK_THROWS(cmd_proc.execute("erase_row_by_id id-test 0", output));
+	output.str("");
+	cmd_proc.execute("row_ids id-test {X>15}", output);
+	CHECK(output.str() == "2\n3\n");
+}
 TEST_CASE_METHOD(test_fixture, "The update_cell command can be successfully used to update a single value in a row.",
 				 "[integration][update]") {
 	db.create_table("update-test", minidb::schema{{{"X", minidb::value_type::integer},
@@ -336,3 +372,263 @@ TEST_CASE_METHOD(test_fixture,
 		check_approx_output(output.str(), expected);
 	}
 }
+
+TEST_CASE_METHOD(test_fixture, "The create_index command can be successfully used to index a column of a table.",
+				 "[integration][index]") {
+	db.create_table("index-test", minidb::schema{{{"X", minidb::value_type::integer},
+												  {"B", minidb::value_type::string}}});
+	db.append_row("index-test", {1LL, "ABCD"});
+	db.append_row("index-test", {2LL, "Hello"});
+	db.append_row("index-test", {3LL, "ABCD"});
+
+	cmd_proc.execute("create_index index-test B", output);
+	cmd_proc.execute("create_index index-test X ordered", output);
+	CHECK_THROWS(cmd_proc.execute("create_index index-test X", output));
+	CHECK_THROWS(cmd_proc.execute("create_index index-test B btree", output));
+	const auto& tab = db.lookup_table("index-test");
+	CHECK(tab.find_index(0)->kind() == minidb::index_kind::ordered);
+	CHECK(tab.find_index(1)->kind() == minidb::index_kind::hash);
+
+	output.str("");
+	cmd_proc.execute("query_table index-test {B=ABCD}", output);
+	check_approx_output(output.str(), {"1", "ABCD", "3", "ABCD"});
+}
+
+TEST_CASE_METHOD(test_fixture, "The create_table command accepts dictionary-encoded string columns.",
+				 "[integration][table][dictionary]") {
+	cmd_proc.execute("create_table dict-test {id=integer, status=dictionary}", output);
+	const auto& tab = db.lookup_table("dict-test");
+	CHECK(tab.columns().at(1).type() == minidb::value_type::string);
+	CHECK(tab.columns().at(1).encoding() == minidb::column_encoding::dictionary);
+	CHECK(tab.column_data(1).is_dictionary());
+	cmd_proc.execute("append_row dict-test [1, open]", output);
+	cmd_proc.execute("append_row dict-test [2, closed]", output);
+	cmd_proc.execute("append_row dict-test [3, open]", output);
+	cmd_proc.execute("query_column_histogram dict-test status", output);
+	check_approx_output(output.str(), {"closed", "1", "open", "2"});
+}
+
+TEST_CASE_METHOD(test_fixture, "The save and load commands can be used to snapshot and restore all tables.",
+				 "[integration][snapshot]") {
+	test::temporary_file snapshot("minidb_snapshot_command.snap");
+	cmd_proc.execute("create_table snap-test {id=integer, price=decimal, status=dictionary, note=string}", output);
+	cmd_proc.execute("append_row snap-test [1, 2.5, open, \"first note\"]", output);
+	cmd_proc.execute("append_row snap-test [2, 7.25, closed, second]", output);
+	cmd_proc.execute("save \"" + snapshot.path.string() + "\"", output);
+	cmd_proc.execute("drop_table snap-test", output);
+	cmd_proc.execute("load \"" + snapshot.path.string() + "\"", output);
+	output.str("");
+	cmd_proc.execute("query_table snap-test", output);
+	check_approx_output(output.str(), {"1", "2.5", "open", "first note", "2", "7.25", "closed", "second"});
+	CHECK_THROWS(cmd_proc.execute("load", output));
+}
+
+TEST_CASE_METHOD(test_fixture, "The load_csv command can be used to append the records of a CSV file to a table.",
+				 "[integration][csv]") {
+	test::temporary_file file("minidb_load_csv_command.csv");
+	{
+		std::ofstream out(file.path, std::ios::binary);
+		out << "id;note\n1;'semi;colon'\n2;plain\n";
+	}
+	cmd_proc.execute("create_table csv-test {id=integer, note=string}", output);
+	cmd_proc.execute("load_csv csv-test \"" + file.path.string() + "\" {header=true, delimiter=;, quote=', batch_rows=1}",
+					 output);
+	CHECK(output.str() == "Loaded 2 rows");
+	output.str("");
+	cmd_proc.execute("query_table csv-test", output);
+	check_approx_output(output.str(), {"1", "semi;colon", "2", "plain"});
+	CHECK_THROWS(cmd_proc.execute("load_csv csv-test \"" + file.path.string() + "\" {colour=blue}", output));
+	CHECK_THROWS(cmd_proc.execute("load_csv csv-test \"" + file.path.string() + "\" {delimiter=ab}", output));
+}
+
+TEST_CASE_METHOD(test_fixture, "An unknown command throws an exception.", "[integration][errors]") {
+	CHECK_THROWS_AS(cmd_proc.execute("no_such_command foo", output), std::invalid_argument);
+	CHECK_FALSE(cmd_proc.should_exit());
+}
+
+TEST_CASE_METHOD(test_fixture, "Row filters in commands can use comparisons, between and in.",
+				 "[integration][query]") {
+	db.create_table("query-test", minidb::schema{{{"X", minidb::value_type::integer},
+												  {"B", minidb::value_type::string},
+												  {"C", minidb::value_type::decimal}}});
+	db.append_row("query-test", {1LL, "Hello", 123.45});
+	db.append_row("query-test", {2LL, "World", 234.56});
+	db.append_row("query-test", {3LL, "ABCD", 345.67});
+	db.append_row("query-test", {4LL, "is", 456.78});
+	db.append_row("query-test", {5LL, "a", 567.89});
+
+	cmd_proc.execute("query_table query-test {X>1, C<500, B != ABCD}", output);
+	check_approx_output(output.str(), {"2", "World", "234.56", "4", "is", "456.78"});
+
+	output.str("");
+	cmd_proc.execute("query_column_histogram query-test X {C between [200, 460]}", output);
+	check_approx_output(output.str(), {"2", "1", "3", "1", "4", "1"});
+
+	cmd_proc.execute("erase_rows query-test {B in [Hello, a, missing]}", output);
+	cmd_proc.execute("update_rows query-test {X>=3} {B=changed}", output);
+	output.str("");
+	cmd_proc.execute("query_table query-test", output);
+	check_approx_output(output.str(), {"2", "World", "234.56", "3", "changed", "345.67", "4", "changed", "456.78"});
+
+	CHECK_THROWS_AS(cmd_proc.execute("update_rows query-test {X=2} {B>x}", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("query_table query-test {B<3}", output), std::invalid_argument);
+}
+
+TEST_CASE_METHOD(test_fixture, "Row filters in commands can combine comparisons with and, or and not.",
+				 "[integration][query]") {
+	db.create_table("query-test", minidb::schema{{{"X", minidb::value_type::integer},
+												  {"B", minidb::value_type::string},
+												  {"C", minidb::value_type::decimal}}});
+	db.append_row("query-test", {1LL, "Hello", 123.45});
+	db.append_row("query-test", {2LL, "World", 234.56});
+	db.append_row("query-test", {3LL, "ABCD", 345.67});
+	db.append_row("query-test", {4LL, "is", 456.78});
+	db.append_row("query-test", {5LL, "a", 567.89});
+
+	cmd_proc.execute("query_table query-test (X>3 or (C<300 and not B in [Hello, a]))", output);
+	check_approx_output(output.str(), {"2", "World", "234.56", "4", "is", "456.78", "5", "a", "567.89"});
+
+	output.str("");
+	cmd_proc.execute("query_column_histogram query-test X (X=1 || X=5)", output);
+	check_approx_output(output.str(), {"1", "1", "5", "1"});
+
+	cmd_proc.execute("erase_rows query-test (!(X between [2, 4]))", output);
+	cmd_proc.execute("update_rows query-test (X=2 or B=is) {B=changed}", output);
+	output.str("");
+	cmd_proc.execute("query_table query-test", output);
+	check_approx_output(output.str(), {"2", "changed", "234.56", "3", "ABCD", "345.67", "4", "changed", "456.78"});
+
+	CHECK_THROWS_AS(cmd_proc.execute("query_table query-test (X=1 or)", output), minidb::syntax_error);
+}
+
+TEST_CASE_METHOD(test_fixture, "The set_output_format command selects the format query_table displays rows in.",
+				 "[integration][query]") {
+	db.create_table("query-test", minidb::schema{{{"X", minidb::value_type::integer},
+												  {"B", minidb::value_type::string}}});
+	db.append_row("query-test", {1LL, "Hello"});
+	db.append_row("query-test", {2LL, "a, b"});
+
+	cmd_proc.execute("set_output_format csv", output);
+	output.str("");
+	cmd_proc.execute("query_table query-test {X>1}", output);
+	CHECK(output.str() == "X,B\n2,\"a, b\"\n");
+
+	cmd_proc.execute("set_output_format json", output);
+	output.str("");
+	cmd_proc.execute("query_table query-test", output);
+	CHECK(output.str() == "{\"X\":1,\"B\":\"Hello\"}\n{\"X\":2,\"B\":\"a, b\"}\n");
+
+	CHECK_THROWS_AS(cmd_proc.execute("set_output_format xml", output), std::invalid_argument);
+}
+
+TEST_CASE_METHOD(test_fixture, "The aggregate command displays grouped aggregates of the matching rows.",
+				 "[integration][query]") {
+	db.create_table("sales", minidb::schema{{{"region", minidb::value_type::string},
+											 {"amount", minidb::value_type::integer},
+											 {"price", minidb::value_type::decimal}}});
+	db.append_row("sales", {"north", 3LL, 1.5});
+	db.append_row("sales", {"south", 5LL, 2.0});
+	db.append_row("sales", {"north", 4LL, 4.5});
+	db.append_row("sales", {"east", 1LL, 3.0});
+
+	cmd_proc.execute("aggregate sales {group_by=region} {sum=amount, avg=price, count=*}", output);
+	check_approx_output(output.str(), {"east", "1", "3", "1", "north", "7", "3", "2", "south", "5", "2", "1"});
+
+	output.str("");
+	cmd_proc.execute("aggregate sales {} {max=price} (amount>1 and region!=north)", output);
+	check_approx_output(output.str(), {"2"});
+
+	cmd_proc.execute("set_output_format csv", output);
+	output.str("");
+	cmd_proc.execute("aggregate sales {group_by=region} {count=*} {amount<5}", output);
+	CHECK(output.str() == "region,count\neast,1\nnorth,2\n");
+
+	CHECK_THROWS_AS(cmd_proc.execute("aggregate sales {group_by=region} {median=price}", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("aggregate sales {by=region} {sum=price}", output), std::invalid_argument);
+}
+
+TEST_CASE_METHOD(test_fixture, "The approx_distinct and approx_quantiles commands display estimates for a column.",
+				 "[integration][query]") {
+	db.create_table("sales", minidb::schema{{{"region", minidb::value_type::string},
+											 {"amount", minidb::value_type::integer}}});
+	for(long long amount = 1; amount <= 100; ++amount) db.append_row("sales", {amount % 2 == 0 ? "north" : "south", amount});
+
+	cmd_proc.execute("approx_distinct sales region", output);
+	CHECK(output.str() == "2\n");
+	output.str("");
+	cmd_proc.execute("approx_distinct sales amount {amount<=10}", output);
+	CHECK(output.str() == "10\n");
+
+	output.str("");
+	cmd_proc.execute("approx_quantiles sales amount [0, 1, 0.5]", output);
+	CHECK(output.str() == "0 1\n1 100\n0.5 50\n");
+	output.str("");
+	cmd_proc.execute("approx_quantiles sales amount [1] {region=south}", output);
+	CHECK(output.str() == "1 99\n");
+
+	CHECK_THROWS_AS(cmd_proc.execute("approx_quantiles sales amount [high]", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("approx_quantiles sales region [0.5]", output), std::invalid_argument);
+}
+
+TEST_CASE_METHOD(test_fixture, "Prepared statements execute commands with the values of their parameters.",
+				 "[integration][prepared]") {
+	db.create_table("items", minidb::schema{{{"id", minidb::value_type::integer},
+											 {"name", minidb::value_type::string},
+											 {"price", minidb::value_type::decimal}}});
+	cmd_proc.execute("prepare add append_row items [?, ?, 1.5]", output);
+	CHECK(output.str() == "Prepared add");
+	for(long long id = 1; id <= 4; ++id) cmd_proc.execute("execute add " + std::to_string(id) + " item", output);
+	cmd_proc.execute("execute add 5 \"?\"", output);
+	cmd_proc.execute("prepare \"by id\" query_table items (id>=? and not name=\"?\")", output);
+	cmd_proc.execute("prepare reprice update_rows items {id between [?, ?]} {price=?}", output);
+	cmd_proc.execute("prepare histogram query_column_histogram items price {id<=?}", output);
+	cmd_proc.execute("prepare remove erase_rows items {id=?}", output);
+
+	cmd_proc.execute("execute reprice 2 3 9.5", output);
+	output.str("");
+	cmd_proc.execute("execute \"by id\" 3", output);
+	CHECK(output.str() == "3 item 9.5 \n4 item 1.5 \n");
+	output.str("");
+	cmd_proc.execute("execute histogram 4", output);
+	CHECK(output.str() == "1.5 2\n9.5 2\n");
+	cmd_proc.execute("execute remove 3", output);
+	output.str("");
+	cmd_proc.execute("execute \"by id\" 0", output);
+	CHECK(output.str() == "1 item 1.5 \n2 item 9.5 \n4 item 1.5 \n");
+
+	// Statements outlive their table being dropped and created again.
+	cmd_proc.execute("drop_table items", output);
+	CHECK_THROWS_AS(cmd_proc.execute("execute add 6 item", output), std::out_of_range);
+	cmd_proc.execute("create_table items {name = string, id = integer, price = decimal}", output);
+	CHECK_THROWS_AS(cmd_proc.execute("execute add 6 item", output), std::invalid_argument);
+	cmd_proc.execute("append_row items [other, 7, 2.5]", output);
+	output.str("");
+	cmd_proc.execute("execute \"by id\" 7", output);
+	CHECK(output.str() == "other 7 2.5 \n");
+
+	CHECK_THROWS_AS(cmd_proc.execute("execute \"by id\"", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("execute \"by id\" 1 2", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("execute unknown 1", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("prepare ids row_ids items {id=?}", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("prepare any query_table ?", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("prepare any query_column_histogram items ?", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("prepare any query_table items {missing=?}", output), std::invalid_argument);
+	CHECK_THROWS_AS(cmd_proc.execute("prepare any query_table nowhere", output), std::out_of_range);
+}
+
+TEST_CASE_METHOD(test_fixture, "The result_cache_statistics command displays how often cached results were used.",
+				 "[integration][result_cache]") {
+	db.configure_result_cache(1 << 20);
+	db.create_table("items", minidb::schema{{{"id", minidb::value_type::integer},
+											 {"price", minidb::value_type::decimal}}});
+	cmd_proc.execute("append_rows items [[1, 1.5], [2, 2.5], [3, 1.5]]", output);
+	for(int query = 0; query != 3; ++query) cmd_proc.execute("query_column_histogram items price {id<3}", output);
+	cmd_proc.execute("append_row items [0, 2.5]", output);
+	output.str("");
+	cmd_proc.execute("query_column_histogram items price {id<3}", output);
+	CHECK(output.str() == "1.5 1\n2.5 2\n");
+	output.str("");
+	cmd_proc.execute("result_cache_statistics", output);
+	CHECK(output.str().starts_with("hits 2\nmisses 2\nevictions 0\nentries 1\nbytes "));
+	CHECK_THROWS_AS(cmd_proc.execute("result_cache_statistics items", output), std::invalid_argument);
+}
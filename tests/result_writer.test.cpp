@@ -0,0 +1,96 @@
+#define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <database.hpp>
+#include <result_writer.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+using namespace std::literals;
+
+std::string write_all(const minidb::table& tab, minidb::output_format format, std::size_t flush_size = 1 << 16) {
+	std::ostringstream output;
+	{
+		minidb::result_writer writer(output, format, tab, flush_size);
+		for(const auto& row : tab.rows()) writer.write_row(row);
+	}
+	return output.str();
+}
+
+// Fails every write.
+class failing_buffer : public std::streambuf {
+protected:
+	int_type overflow(int_type) override {
+		return traits_type::eof();
+	}
+};
+
+} // namespace
+
+TEST_CASE("The result writer formats rows as text, TSV, CSV and JSON lines.", "[output]") {
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+										   {"weight", minidb::value_type::decimal},
+										   {"name", minidb::value_type::string},
+										   {"group", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	db.append_row("t"sv, {-12LL, 2.5, "plain"s, "a"s});
+	db.append_row("t"sv, {34LL, 0.1, "with, \"quote\"\tand\nbreak\\"s, "b"s});
+	db.append_row("t"sv, {56LL, INFINITY, ""s, "a"s});
+	const auto& tab = db.lookup_table("t"sv);
+
+	std::ostringstream streamed;
+	for(const auto& row : tab.rows()) streamed << row << '\n';
+	CHECK(write_all(tab, minidb::output_format::text) == streamed.str());
+	CHECK(write_all(tab, minidb::output_format::tsv) == "id\tweight\tname\tgroup\n"
+	                                                   "-12\t2.5\tplain\ta\n"
+	                                                   "34\t0.1\twith, \"quote\"\\tand\\nbreak\\\\\tb\n"
+	                                                   "56\tinf\t\ta\n");
+	CHECK(write_all(tab, minidb::output_format::csv) == "id,weight,name,group\n"
+	                                                   "-12,2.5,plain,a\n"
+	                                                   "34,0.1,\"with, \"\"quote\"\"\tand\nbreak\\\",b\n"
+	                                                   "56,inf,,a\n");
+	CHECK(write_all(tab, minidb::output_format::json_lines) ==
+	      "{\"id\":-12,\"weight\":2.5,\"name\":\"plain\",\"group\":\"a\"}\n"
+	      "{\"id\":34,\"weight\":0.1,\"name\":\"with, \\\"quote\\\"\\tand\\nbreak\\\\\",\"group\":\"b\"}\n"
+	      "{\"id\":56,\"weight\":null,\"name\":\"\",\"group\":\"a\"}\n");
+	// Flushing after every row gives the same output.
+	CHECK(write_all(tab, minidb::output_format::csv, 1) == write_all(tab, minidb::output_format::csv));
+
+	CHECK(minidb::parse_output_format("json") == minidb::output_format::json_lines);
+	CHECK_THROWS_AS(minidb::parse_output_format("xml"), std::invalid_argument);
+}
+
+TEST_CASE("Decimals in the text format look the same as when written to a stream.", "[output]") {
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"weight", minidb::value_type::decimal}}});
+	for(const double weight : {0.0, -1.5, 1234567.0, 1e-7, 3.14159265, 1e300, -0.000123456789}) {
+		db.append_row("t"sv, {weight});
+	}
+	const auto& tab = db.lookup_table("t"sv);
+	std::ostringstream streamed;
+	for(const auto& row : tab.rows()) streamed << row << '\n';
+	CHECK(write_all(tab, minidb::output_format::text) == streamed.str());
+}
+
+TEST_CASE("Errors of the stream are thrown by an explicit flush of the result writer, not by its destructor.",
+		  "[output]") {
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+	db.append_row("t"sv, {1LL});
+	const auto& tab = db.lookup_table("t"sv);
+	failing_buffer buffer;
+	std::ostream output(&buffer);
+	output.exceptions(std::ios::badbit);
+	// The writer is destroyed while the exception of the query unwinds the stack.
+	CHECK_THROWS_AS([&] {
+		minidb::result_writer writer(output, minidb::output_format::csv, tab);
+		for(const auto& row : tab.rows()) writer.write_row(row);
+		throw std::runtime_error("query failed");
+	}(), std::runtime_error);
+	output.clear();
+	minidb::result_writer writer(output, minidb::output_format::csv, tab);
+	CHECK_THROWS_AS(writer.flush(), std::ios_base::failure);
+	output.clear();
+}
@@ -0,0 +1,321 @@
+#define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <database.hpp>
+#include <row_filter.hpp>
+#include <selection_kernels.hpp>
+#include <vector>
+
+namespace {
+using namespace std::literals;
+
+std::vector<minidb::simd_level> supported_simd_levels() {
+	std::vector<minidb::simd_level> levels{minidb::simd_level::scalar};
+	if(minidb::detected_simd_level() != minidb::simd_level::scalar) levels.push_back(minidb::simd_level::sse2);
+	if(minidb::detected_simd_level() == minidb::simd_level::avx2) levels.push_back(minidb::simd_level::avx2);
+	return levels;
+}
+
+struct simd_level_guard {
+	minidb::simd_level previous = minidb::active_simd_level();
+	~simd_level_guard() {
+		minidb::set_simd_level(previous);
+	}
+};
+
+} // namespace
+
+TEST_CASE("The selection kernels clear exactly the bits of non-matching rows on every supported SIMD level.",
+		  "[filter][simd]") {
+	simd_level_guard guard;
+	constexpr std::size_t count = 200;
+	std::vector<long long> integers(count);
+	std::vector<double> decimals(count);
+	std::vector<std::uint32_t> codes(count);
+	for(std::size_t i = 0; i != count; ++i) {
+		integers[i] = i % 3 == 0 ? 7 : static_cast<long long>(i) + (1LL << 32);
+		decimals[i] = i % 5 == 0 ? 2.5 : static_cast<double>(i);
+		codes[i] = i % 15 == 0 ? 1u : 3u;
+	}
+	for(const auto level : supported_simd_levels()) {
+		CAPTURE(static_cast<int>(level));
+		minidb::set_simd_level(level);
+		std::vector<std::uint64_t> selection(4, ~std::uint64_t{0});
+		minidb::select_equal(integers.data(), count, 7LL, selection.data());
+		minidb::select_equal(decimals.data(), count, 2.5, selection.data());
+		for(std::size_t i = 0; i != count; ++i) {
+			CAPTURE(i);
+			CHECK(((selection[i / 64] >> (i % 64)) & 1) == (i % 15 == 0 ? 1u : 0u));
+		}
+		// Bits past count are left alone.
+		CHECK((selection[3] >> (count % 64)) == (~std::uint64_t{0} >> (count % 64)));
+		minidb::select_equal(codes.data(), count, 3u, selection.data());
+		CHECK(selection == std::vector<std::uint64_t>{0, 0, 0, ~std::uint64_t{0} << (count % 64)});
+	}
+	CHECK_NOTHROW(minidb::set_simd_level(minidb::simd_level::scalar));
+}
+
+TEST_CASE("Filtered queries over more rows than one batch give the same result on every supported SIMD level.",
+		  "[filter][simd][database]") {
+	simd_level_guard guard;
+	minidb::database db;
+	db.create_table("big"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											 {"bucket", minidb::value_type::integer},
+											 {"weight", minidb::value_type::decimal},
+											 {"tag", minidb::value_type::string},
+											 {"group", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	constexpr long long row_count = 3 * minidb::row_filter::batch_size + 37;
+	for(long long i = 0; i != row_count; ++i) {
+		db.append_row("big"sv, {i, i % 7, (i % 2) * 0.5, i % 3 == 0 ? "x"s : "y"s, "g"s + std::to_string(i % 5)});
+	}
+	for(const auto level : supported_simd_levels()) {
+		CAPTURE(static_cast<int>(level));
+		minidb::set_simd_level(level);
+		std::vector<long long> ids;
+		db.query_table("big"sv, {{"bucket", 3LL}, {"weight", 0.5}, {"tag", "x"s}, {"group", "g1"s}},
+					   [&ids](const minidb::row& row) { ids.push_back(row.get_cell_value<long long>(0)); });
+		std::vector<long long> expected;
+		for(long long i = 0; i != row_count; ++i) {
+			if(i % 7 == 3 && i % 2 == 1 && i % 3 == 0 && i % 5 == 1) expected.push_back(i);
+		}
+		CHECK(ids == expected);
+		CHECK(db.query_column_histogram("big"sv, "bucket"sv, {{"weight", 0.0}}).at(0LL) ==
+			  static_cast<std::size_t>((row_count + 13) / 14));
+	}
+}
+
+TEST_CASE("The range kernels keep exactly the rows inside the inclusive range on every supported SIMD level.",
+		  "[filter][simd]") {
+	simd_level_guard guard;
+	constexpr std::size_t count = 150;
+	std::vector<long long> integers(count);
+	std::vector<double> decimals(count);
+	for(std::size_t i = 0; i != count; ++i) {
+		integers[i] = (static_cast<long long>(i) - 75) * (1LL << 40);
+		decimals[i] = i % 10 == 0 ? std::nan("") : static_cast<double>(i) / 4;
+	}
+	for(const auto level : supported_simd_levels()) {
+		CAPTURE(static_cast<int>(level));
+		minidb::set_simd_level(level);
+		std::vector<std::uint64_t> integer_selection(3, ~std::uint64_t{0});
+		minidb::select_range(integers.data(), count, -10 * (1LL << 40), 20 * (1LL << 40), integer_selection.data());
+		std::vector<std::uint64_t> decimal_selection(3, ~std::uint64_t{0});
+		minidb::select_range(decimals.data(), count, 5.0, 30.25, decimal_selection.data());
+		for(std::size_t i = 0; i != count; ++i) {
+			CAPTURE(i);
+			CHECK(((integer_selection[i / 64] >> (i % 64)) & 1) == (i >= 65 && i <= 95 ? 1u : 0u));
+			CHECK(((decimal_selection[i / 64] >> (i % 64)) & 1) == (i >= 20 && i <= 121 && i % 10 != 0 ? 1u : 0u));
+		}
+		CHECK((integer_selection[2] >> (count % 64)) == (~std::uint64_t{0} >> (count % 64)));
+	}
+}
+
+TEST_CASE("Comparison predicates match the same rows in batches and row by row.", "[filter]") {
+	using comparison = minidb::row_filter::comparison;
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+										   {"weight", minidb::value_type::decimal},
+										   {"tag", minidb::value_type::string},
+										   {"group", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	constexpr long long row_count = 2 * minidb::row_filter::batch_size + 100;
+	for(long long i = 0; i != row_count; ++i) {
+		db.append_row("t"sv, {i, static_cast<double>(i % 100) / 10, "t"s + std::to_string(i % 10),
+							  "g"s + std::to_string(i % 7)});
+	}
+	const auto check = [&](minidb::row_filter filter, const std::function<bool(long long)>& expected) {
+		const auto& tab = db.lookup_table("t"sv);
+		filter.bind_to_table(tab);
+		std::vector<long long> batch_ids;
+		filter.for_each_match([&batch_ids](std::size_t row) { batch_ids.push_back(static_cast<long long>(row)); });
+		std::vector<long long> row_ids;
+		std::vector<long long> expected_ids;
+		for(long long i = 0; i != row_count; ++i) {
+			if(filter(tab.row_at(static_cast<std::size_t>(i)))) row_ids.push_back(i);
+			if(expected(i)) expected_ids.push_back(i);
+		}
+		CHECK(batch_ids == expected_ids);
+		CHECK(row_ids == expected_ids);
+	};
+	SECTION("Integers") {
+		check({{{"id", comparison::less, {100LL}}}}, [](long long i) { return i < 100; });
+		check({{{"id", comparison::greater, {2.5}}, {"id", comparison::less_equal, {9.5}}}},
+			  [](long long i) { return i >= 3 && i <= 9; });
+		check({{{"id", comparison::between, {1000LL, 1100.0}}}}, [](long long i) { return i >= 1000 && i <= 1100; });
+		check({{{"id", comparison::not_equal, {5LL}}}}, [](long long i) { return i != 5; });
+		check({{{"id", comparison::in, {7LL, 3LL, 7LL, 2.0, 4.5, "x"s}}}},
+			  [](long long i) { return i == 2 || i == 3 || i == 7; });
+		check({{{"id", comparison::equal, {5.0}}}}, [](long long i) { return i == 5; });
+		check({{{"id", comparison::equal, {5.5}}}}, [](long long) { return false; });
+		check({{{"id", comparison::not_equal, {5.5}}}}, [](long long) { return true; });
+		check({{{"id", comparison::greater_equal, {1e300}}}}, [](long long) { return false; });
+		check({{{"id", comparison::greater_equal, {-1e300}}}}, [](long long) { return true; });
+		check({{{"id", comparison::between, {10LL, 5LL}}}}, [](long long) { return false; });
+	}
+	SECTION("Decimals") {
+		check({{{"weight", comparison::greater_equal, {9LL}}}}, [](long long i) { return i % 100 >= 90; });
+		check({{{"weight", comparison::greater, {0.5}}, {"weight", comparison::less, {1LL}}}},
+			  [](long long i) { return i % 100 > 5 && i % 100 < 10; });
+		check({{{"weight", comparison::not_equal, {1LL}}}}, [](long long i) { return i % 100 != 10; });
+		check({{{"weight", comparison::in, {1LL, 0.5, "1"s}}}},
+			  [](long long i) { return i % 100 == 10 || i % 100 == 5; });
+	}
+	SECTION("Strings") {
+		check({{{"tag", comparison::greater, {"t7"s}}}}, [](long long i) { return i % 10 > 7; });
+		check({{{"tag", comparison::in, {"t1"s, "t3"s, "zz"s}}}}, [](long long i) { return i % 10 == 1 || i % 10 == 3; });
+		check({{{"group", comparison::between, {"g2"s, "g4"s}}}},
+			  [](long long i) { return i % 7 >= 2 && i % 7 <= 4; });
+		check({{{"group", comparison::not_equal, {"g0"s}}, {"group", comparison::in, {"g0"s, "g1"s, "g9"s}}}},
+			  [](long long i) { return i % 7 == 1; });
+	}
+	SECTION("Invalid predicates") {
+		const auto& tab = db.lookup_table("t"sv);
+		minidb::row_filter order_string_by_number{{{"tag", comparison::less, {1LL}}}};
+		CHECK_THROWS_AS(order_string_by_number.bind_to_table(tab), std::invalid_argument);
+		minidb::row_filter order_number_by_string{{{"id", comparison::less, {"1"s}}}};
+		CHECK_THROWS_AS(order_number_by_string.bind_to_table(tab), std::invalid_argument);
+		minidb::row_filter missing_bound{{{"id", comparison::between, {1LL}}}};
+		CHECK_THROWS_AS(missing_bound.bind_to_table(tab), std::invalid_argument);
+	}
+}
+
+TEST_CASE("Filter expressions combine predicates with and, or and not in batches and row by row.", "[filter]") {
+	using comparison = minidb::row_filter::comparison;
+	using connective = minidb::row_filter::connective;
+	using predicate = minidb::row_filter::predicate;
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+										   {"tag", minidb::value_type::string},
+										   {"group", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	constexpr long long row_count = 3 * minidb::row_filter::batch_size + 17;
+	for(long long i = 0; i != row_count; ++i) {
+		db.append_row("t"sv, {i, "t"s + std::to_string(i % 10), "g"s + std::to_string(i % 7)});
+	}
+	db.create_index("t"sv, "id"sv, minidb::index_kind::hash);
+	const auto& tab = db.lookup_table("t"sv);
+	const auto check = [&](std::vector<minidb::row_filter::term> expression,
+	                       const std::function<bool(long long)>& expected) {
+		minidb::row_filter filter{std::move(expression)};
+		filter.bind_to_table(tab);
+		std::vector<long long> batch_ids;
+		filter.for_each_match([&batch_ids](std::size_t row) { batch_ids.push_back(static_cast<long long>(row)); });
+		std::vector<long long> row_ids;
+		std::vector<long long> expected_ids;
+		for(long long i = 0; i != row_count; ++i) {
+			if(filter(tab.row_at(static_cast<std::size_t>(i)))) row_ids.push_back(i);
+			if(expected(i)) expected_ids.push_back(i);
+		}
+		CHECK(batch_ids == expected_ids);
+		CHECK(row_ids == expected_ids);
+	};
+	const predicate low_id{"id", comparison::less, {100LL}};
+	const predicate indexed_id{"id", comparison::equal, {2000LL}};
+	const predicate tag{"tag", comparison::in, {"t1"s, "t2"s}};
+	const predicate group{"group", comparison::equal, {"g3"s}};
+	const predicate no_group{"group", comparison::equal, {"g9"s}};
+
+	check({low_id, indexed_id, connective::disjunction}, [](long long i) { return i < 100 || i == 2000; });
+	check({low_id, connective::negation}, [](long long i) { return i >= 100; });
+	check({low_id, tag, connective::disjunction, group, connective::conjunction},
+	      [](long long i) { return (i < 100 || i % 10 == 1 || i % 10 == 2) && i % 7 == 3; });
+	check({tag, group, connective::negation, connective::conjunction, indexed_id, connective::disjunction},
+	      [](long long i) { return ((i % 10 == 1 || i % 10 == 2) && i % 7 != 3) || i == 2000; });
+	check({no_group, connective::negation}, [](long long) { return true; });
+	check({no_group, low_id, connective::disjunction}, [](long long i) { return i < 100; });
+	// Leftover results are combined by conjunction.
+	check({low_id, tag}, [](long long i) { return i < 100 && (i % 10 == 1 || i % 10 == 2); });
+	check({}, [](long long) { return true; });
+
+	minidb::row_filter dangling{{low_id, connective::conjunction}};
+	CHECK_THROWS_AS(dangling.bind_to_table(tab), std::invalid_argument);
+	minidb::row_filter nothing_to_negate{{connective::negation}};
+	CHECK_THROWS_AS(nothing_to_negate.bind_to_table(tab), std::invalid_argument);
+}
+
+TEST_CASE("Zone maps let range filters skip the blocks of time-ordered data that can't match.", "[filter][zones]") {
+	using comparison = minidb::row_filter::comparison;
+	constexpr std::size_t zone_rows = minidb::column_storage::integer_data::zone_rows;
+	constexpr auto block_length = static_cast<long long>(zone_rows);
+	minidb::database db;
+	db.create_table("events"sv, minidb::schema{{{"time", minidb::value_type::integer},
+												{"value", minidb::value_type::decimal}}});
+	for(long long i = 0; i != 10 * block_length; ++i) db.append_row("events"sv, {1000 + i, static_cast<double>(i % 3)});
+	const auto& tab = db.lookup_table("events"sv);
+	const auto zones = [&tab] { return tab.column_data(0).data<long long>().zones(); };
+	REQUIRE(zones().size() == 10);
+	CHECK(zones()[3].min == 1000 + 3 * block_length);
+	CHECK(zones()[3].max == 1000 + 4 * block_length - 1);
+
+	minidb::row_filter filter{{{"time", comparison::between, {1000 + 4 * block_length + 10, 1000 + 5 * block_length}}}};
+	filter.bind_to_table(tab);
+	for(std::size_t block = 0; block != 10; ++block) {
+		CAPTURE(block);
+		CHECK(filter.may_match(block * zone_rows, zone_rows) == (block == 4 || block == 5));
+	}
+	std::size_t count = 0;
+	filter.for_each_match([&count](std::size_t) { ++count; });
+	CHECK(count == zone_rows - 9);
+
+	// Overwriting a cell widens its zone, compacting the table rebuilds the zones.
+	db.update_cell("events"sv, 0, 0, 1000 + 4 * block_length + 20);
+	filter.bind_to_table(tab);
+	CHECK(filter.may_match(0, zone_rows));
+	count = 0;
+	filter.for_each_match([&count](std::size_t) { ++count; });
+	CHECK(count == zone_rows - 8);
+	db.erase_row("events"sv, 0);
+	db.compact("events"sv);
+	CHECK(zones()[0].min == 1001);
+	CHECK(zones()[3].min == 1000 + 3 * block_length + 1);
+	CHECK(zones()[9].max == 1000 + 10 * block_length - 1);
+}
+
+TEST_CASE("Binding a filter to its table again takes over new operands and what changed in the table.",
+		  "[filter][prepared]") {
+	using comparison = minidb::row_filter::comparison;
+	minidb::database db;
+	db.create_table("people"sv,
+					minidb::schema{{{"age", minidb::value_type::integer},
+									{"city", minidb::value_type::string, minidb::column_encoding::dictionary}}});
+	db.create_index("people"sv, "city"sv);
+	for(long long age = 0; age != 10; ++age) db.append_row("people"sv, {age, age % 2 == 0 ? "Bonn"s : "Kiel"s});
+	const auto& tab = db.lookup_table("people"sv);
+	const auto matches = [](const minidb::row_filter& filter) {
+		std::vector<std::size_t> rows;
+		filter.for_each_match([&rows](std::size_t row_index) { rows.push_back(row_index); });
+		return rows;
+	};
+
+	minidb::row_filter filter{{{"age", comparison::less, {3LL}}, {"city", comparison::equal, {"Bonn"s}}}};
+	filter.bind_to_table(tab);
+	CHECK(matches(filter) == std::vector<std::size_t>{0, 2});
+	filter.set_operand(0, 0, 5LL);
+	filter.bind_to_table(tab);
+	CHECK(matches(filter) == std::vector<std::size_t>{0, 2, 4});
+	// An operand of a different type makes the predicate constant until it's replaced again.
+	filter.set_operand(1, 0, 1LL);
+	filter.bind_to_table(tab);
+	CHECK(matches(filter).empty());
+	CHECK_FALSE(filter.may_match(0, 10));
+
+	// A string the dictionary didn't hold when the filter was compiled matches once it's appended.
+	filter.set_operand(1, 0, "Ulm"s);
+	filter.bind_to_table(tab);
+	CHECK(matches(filter).empty());
+	db.append_row("people"sv, {1LL, "Ulm"s});
+	filter.bind_to_table(tab);
+	CHECK(matches(filter) == std::vector<std::size_t>{10});
+
+	CHECK_THROWS_AS((filter.set_operand(0, 0, "old"s), filter.bind_to_table(tab)), std::invalid_argument);
+	filter.set_operand(0, 0, 100LL);
+	filter.set_operand(1, 0, "Kiel"s);
+	filter.bind_to_table(tab);
+	CHECK(matches(filter) == std::vector<std::size_t>{1, 3, 5, 7, 9});
+	// A copy isn't bound and doesn't share the operands of the filter.
+	auto copy = filter;
+	copy.set_operand(1, 0, "Bonn"s);
+	copy.bind_to_table(tab);
+	CHECK(matches(copy) == std::vector<std::size_t>{0, 2, 4, 6, 8});
+	CHECK(matches(filter) == std::vector<std::size_t>{1, 3, 5, 7, 9});
+}
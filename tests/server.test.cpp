@@ -0,0 +1,192 @@
+#ifdef __linux__
+#include "test_helpers.hpp"
+#include <catch2/catch.hpp>
+#include <database.hpp>
+#include <netinet/in.h>
+#include <server.hpp>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+using namespace std::literals;
+
+// Blocking client speaking the server's protocol. Throws instead of using assertions, so it can run on other threads.
+class client {
+public:
+	explicit client(const std::string& socket_path) : fd_(::socket(AF_UNIX, SOCK_STREAM, 0)) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		socket_path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+		connect(reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	}
+	explicit client(std::uint16_t port) : fd_(::socket(AF_INET, SOCK_STREAM, 0)) {
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		connect(reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+	}
+	~client() {
+		::close(fd_);
+	}
+	client(const client&) = delete;
+	client& operator=(const client&) = delete;
+
+	void send(std::string_view data) {
+		while(!data.empty()) {
+			const auto sent = ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+			if(sent <= 0) throw std::runtime_error("Failed to send");
+			data.remove_prefix(static_cast<std::size_t>(sent));
+		}
+	}
+
+	// The status and body of the next response, an empty status once the server closed the connection.
+	std::pair<std::string, std::string> receive() {
+		std::string header;
+		while(header.empty() || header.back() != '\n') {
+			char c;
+			if(::recv(fd_, &c, 1, 0) != 1) return {};
+			header.push_back(c);
+		}
+		const auto blank = header.find(' ');
+		std::string body(std::stoul(header.substr(blank + 1)), '\0');
+		for(std::size_t received = 0; received != body.size();) {
+			const auto count = ::recv(fd_, body.data() + received, body.size() - received, 0);
+			if(count <= 0) throw std::runtime_error("Failed to receive");
+			received += static_cast<std::size_t>(count);
+		}
+		return {header.substr(0, blank), body};
+	}
+
+private:
+	void connect(const sockaddr* address, socklen_t size) {
+		if(::connect(fd_, address, size) != 0) {
+			::close(fd_);
+			throw std::runtime_error("Failed to connect");
+		}
+	}
+
+	int fd_;
+};
+
+struct running_server {
+	minidb::server srv;
+	std::thread thread;
+
+	running_server(minidb::database& db, std::string_view address, minidb::server::options opts)
+		: srv(db, address, opts), thread([this] { srv.run(); }) {}
+	~running_server() {
+		srv.stop();
+		thread.join();
+	}
+};
+
+} // namespace
+
+TEST_CASE("The server answers pipelined commands in order over a Unix socket.", "[server]") {
+	test::temporary_file socket_file("minidb_server.sock");
+	minidb::database db;
+	running_server server(db, socket_file.path.string(), {});
+	CHECK(server.srv.port() == 0);
+
+	client c(socket_file.path.string());
+	c.send("create_table t {id = integer, name = string}\n"
+	       "append_row t [1, \"one\"]\r\n"
+	       "\n"
+	       "append_row t [2, \"two\"]\n"
+	       "no_such_command\n"
+	       "query_table t {id = 2}\n"
+	       "exit\n"
+	       "append_row t [3, \"three\"]\n");
+	CHECK(c.receive().first == "ok");
+	CHECK(c.receive().first == "ok");
+	CHECK(c.receive().first == "ok");
+	CHECK(c.receive() == std::pair{"error"s, "Unknown command no_such_command"s});
+	CHECK(c.receive() == std::pair{"ok"s, "2 two \n"s});
+	CHECK(c.receive() == std::pair{"ok"s, ""s});
+	// Nothing after exit is executed.
+	CHECK(c.receive().first.empty());
+	CHECK(db.lookup_table("t"sv).row_count() == 2);
+}
+
+TEST_CASE("Clients of the server share one database and keep receiving output that backs up.", "[server]") {
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"client", minidb::value_type::integer},
+										   {"text", minidb::value_type::string}}});
+	running_server server(db, "0", {2, minidb::output_format::csv});
+	REQUIRE(server.srv.port() != 0);
+
+	constexpr int client_count = 4;
+	constexpr int rows_per_client = 300;
+	std::vector<std::thread> threads;
+	std::vector<int> failed_responses(client_count);
+	for(int index = 0; index != client_count; ++index) {
+		threads.emplace_back([&, index] {
+			try {
+				client c(server.srv.port());
+				std::string commands;
+				for(int row = 0; row != rows_per_client; ++row) {
+					commands += "append_row t [" + std::to_string(index) + ", \"" + std::string(100, 'x') + "\"]\n";
+				}
+				c.send(commands);
+				for(int row = 0; row != rows_per_client; ++row) failed_responses[index] += c.receive().first != "ok";
+			} catch(const std::exception&) {
+				failed_responses[index] = -1;
+			}
+		});
+	}
+	for(auto& thread : threads) thread.join();
+	CHECK(failed_responses == std::vector<int>(client_count, 0));
+	CHECK(db.lookup_table("t"sv).row_count() == client_count * rows_per_client);
+
+	// Far more output than a connection buffers before it stops executing commands.
+	client c(server.srv.port());
+	constexpr int query_count = 20;
+	std::string commands;
+	for(int query = 0; query != query_count; ++query) commands += "query_table t\n";
+	c.send(commands);
+	for(int query = 0; query != query_count; ++query) {
+		const auto [status, body] = c.receive();
+		CHECK(status == "ok");
+		CHECK(body.size() == "client,text\n"sv.size() + client_count * rows_per_client * (2 + 100 + 1));
+	}
+}
+
+TEST_CASE("The server keeps more pipelined lines than the longest line it accepts while output backs up.", "[server]") {
+	test::temporary_file socket_file("minidb_server_pipelined.sock");
+	minidb::database db;
+	db.create_table("t"sv, minidb::schema{{{"text", minidb::value_type::string}}});
+	for(int row = 0; row != 1500; ++row) db.append_row("t"sv, {std::string(1000, 'x')});
+	running_server server(db, socket_file.path.string(), {1, minidb::output_format::text, 1024});
+
+	client c(socket_file.path.string());
+	// The response to the query fills the output, so the lines after it are left over, together longer than a line
+	// may be.
+	std::string commands = "query_table t\n";
+	for(int line = 0; line != 100; ++line) commands += "append_row t [short]\n";
+	commands += "append_row t [" + std::string(1000, 'y') + "]\n";
+	c.send(commands);
+	const auto query = c.receive();
+	CHECK(query.first == "ok");
+	CHECK(query.second.size() == 1500 * 1002);
+	for(int line = 0; line != 101; ++line) CHECK(c.receive() == std::pair{"ok"s, ""s});
+	CHECK(db.lookup_table("t"sv).row_count() == 1601);
+
+	c.send(std::string(2000, 'z'));
+	CHECK(c.receive() == std::pair{"error"s, "Command line too long"s});
+	CHECK(c.receive().first.empty());
+}
+
+TEST_CASE("The server rejects invalid addresses.", "[server]") {
+	minidb::database db;
+	CHECK_THROWS_AS(minidb::server(db, "65536", {}), std::invalid_argument);
+	CHECK_THROWS_AS(minidb::server(db, std::string(200, 'x'), {}), std::invalid_argument);
+	CHECK_THROWS_AS(minidb::server(db, "/nonexistent/directory/minidb.sock", {}), std::system_error);
+}
+#endif
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstdint>
+#include <database.hpp>
+#include <numeric>
+#include <sketch.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+using namespace std::literals;
+
+std::uint64_t scramble(std::uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+} // namespace
+
+TEST_CASE("HyperLogLog estimates the number of distinct hashes within a few percent.", "[sketch]") {
+	minidb::hyperloglog few;
+	for(std::uint64_t i = 0; i != 100; ++i) few.add(scramble(i % 50));
+	CHECK(std::abs(few.estimate() - 50) <= 1);
+
+	minidb::hyperloglog first;
+	minidb::hyperloglog second;
+	for(std::uint64_t i = 0; i != 600'000; ++i) {
+		first.add(scramble(i));
+		second.add(scramble(i + 400'000));
+	}
+	CHECK(std::abs(first.estimate() / 600'000 - 1) < 0.03);
+	first.merge(second);
+	CHECK(std::abs(first.estimate() / 1'000'000 - 1) < 0.03);
+
+	CHECK(minidb::hyperloglog{}.estimate() == 0);
+	CHECK_THROWS_AS(minidb::hyperloglog{3}, std::invalid_argument);
+	CHECK_THROWS_AS(first.merge(minidb::hyperloglog{10}), std::invalid_argument);
+}
+
+TEST_CASE("Quantile sketches estimate quantiles within about one percent of the rank.", "[sketch]") {
+	constexpr std::size_t count = 200'000;
+	std::vector<double> numbers(count);
+	std::iota(numbers.begin(), numbers.end(), 0.0);
+	std::shuffle(numbers.begin(), numbers.end(), std::mt19937_64{7});
+	minidb::quantile_sketch whole;
+	minidb::quantile_sketch low_half(minidb::quantile_sketch::default_accuracy, 1);
+	minidb::quantile_sketch high_half(minidb::quantile_sketch::default_accuracy, 2);
+	for(const auto number : numbers) {
+		whole.add(number);
+		(number < count / 2 ? low_half : high_half).add(number);
+	}
+	low_half.merge(high_half);
+	CHECK(whole.count() == count);
+	CHECK(low_half.count() == count);
+	const std::vector<double> fractions{0, 0.01, 0.25, 0.5, 0.9, 0.999, 1};
+	for(const auto* sketch : {&whole, &low_half}) {
+		const auto estimates = sketch->quantiles(fractions);
+		REQUIRE(estimates.size() == fractions.size());
+		for(std::size_t i = 0; i != fractions.size(); ++i) {
+			CAPTURE(fractions[i]);
+			CHECK(std::abs(estimates[i] - fractions[i] * count) < 0.015 * count);
+		}
+		CHECK(std::is_sorted(estimates.begin(), estimates.end()));
+	}
+
+	minidb::quantile_sketch small;
+	for(const auto number : {3.0, 1.0, 2.0}) small.add(number);
+	CHECK(small.quantiles(std::vector{0.0, 0.5, 1.0}) == std::vector{1.0, 2.0, 3.0});
+	CHECK(std::isnan(minidb::quantile_sketch{}.quantiles(std::vector{0.5}).front()));
+	CHECK_THROWS_AS(small.quantiles(std::vector{1.5}), std::invalid_argument);
+}
+
+TEST_CASE("A database estimates distinct cells and quantiles of a column in the rows matching a filter.", "[sketch]") {
+	minidb::database db;
+	db.configure_scans(4, 1024);
+	db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+										   {"name", minidb::value_type::string},
+										   {"tag", minidb::value_type::string, minidb::column_encoding::dictionary},
+										   {"price", minidb::value_type::decimal}}});
+	constexpr long long row_count = 50'000;
+	for(long long i = 0; i != row_count; ++i) {
+		db.append_row("t"sv, {i, "n"s + std::to_string(i % 20'000), i % 3 == 0 ? "fizz"s : "plain"s,
+		                      static_cast<double>(i % 1000) / 10});
+	}
+	CHECK(std::abs(static_cast<double>(db.approx_distinct("t"sv, "id"sv)) / row_count - 1) < 0.03);
+	CHECK(std::abs(static_cast<double>(db.approx_distinct("t"sv, "name"sv)) / 20'000 - 1) < 0.03);
+	CHECK(db.approx_distinct("t"sv, "tag"sv) == 2);
+	CHECK(std::abs(static_cast<double>(db.approx_distinct("t"sv, "price"sv)) / 1000 - 1) < 0.02);
+	CHECK(db.approx_distinct("t"sv, "tag"sv, minidb::row_filter{{"tag", "fizz"s}}) == 1);
+	CHECK(db.approx_distinct("t"sv, "id"sv, minidb::row_filter{{{"id", minidb::row_filter::comparison::less,
+	                                                             {100LL}}}}) == 100);
+
+	const auto medians = db.approx_quantiles("t"sv, "id"sv, {0.5});
+	CHECK(std::abs(medians.front() - row_count / 2) < 0.015 * row_count);
+	const auto prices = db.approx_quantiles("t"sv, "price"sv, {0, 1}, minidb::row_filter{{"tag", "fizz"s}});
+	CHECK(prices == std::vector{0.0, 99.9});
+	CHECK_THROWS_AS(db.approx_quantiles("t"sv, "name"sv, {0.5}), std::invalid_argument);
+	CHECK_THROWS_AS(db.approx_quantiles("t"sv, "id"sv, {-0.5}), std::invalid_argument);
+}
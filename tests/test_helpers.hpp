@@ -1,6 +1,8 @@
 #ifndef TEST_HELPERS_INCLUDED
 #define TEST_HELPERS_INCLUDED
 
+#include <filesystem>
+#include <string_view>
 #include <table.hpp>
 #include <value.hpp>
 #include <vector>
@@ -12,6 +14,17 @@ void check_approx_row(const minidb::row& actual, const std::vector<minidb::value
 void check_approx_table(const minidb::table& actual, const std::vector<std::vector<minidb::value>>& expected_data);
 void check_approx_output(const std::string& output, const std::vector<std::string> expected_contents);
 
+// File path in the temporary directory that is removed before and after the test using it.
+struct temporary_file {
+	std::filesystem::path path;
+	explicit temporary_file(std::string_view name) : path(std::filesystem::temp_directory_path() / name) {
+		std::filesystem::remove(path);
+	}
+	~temporary_file() {
+		std::filesystem::remove(path);
+	}
+};
+
 } // namespace test
 
 #endif // TEST_HELPERS_INCLUDED
@@ -0,0 +1,62 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <thread_pool.hpp>
+#include <vector>
+
+TEST_CASE("The thread pool runs every morsel of a job exactly once.", "[thread_pool]") {
+	const auto concurrency = GENERATE(std::size_t{1}, std::size_t{2}, std::size_t{5});
+	minidb::thread_pool pool(concurrency);
+	CHECK(pool.concurrency() == concurrency);
+	for(const std::size_t size : {0u, 1u, 7u, 1000u, 10007u}) {
+		CAPTURE(concurrency, size);
+		std::vector<std::atomic<int>> visits(size);
+		std::atomic<bool> valid_participants = true;
+		pool.parallel_for(size, 64, [&](std::size_t begin, std::size_t end, std::size_t participant) {
+			if(participant >= concurrency || begin % 64 != 0 || end - begin > 64) valid_participants = false;
+			for(auto index = begin; index != end; ++index) ++visits[index];
+		});
+		CHECK(valid_participants);
+		bool all_once = true;
+		for(const auto& v : visits) all_once = all_once && v == 1;
+		CHECK(all_once);
+	}
+}
+
+TEST_CASE("An exception thrown by a thread pool task is rethrown by parallel_for.", "[thread_pool]") {
+	minidb::thread_pool pool(3);
+	CHECK_THROWS_AS(pool.parallel_for(1000, 10,
+									  [](std::size_t begin, std::size_t, std::size_t) {
+										  if(begin == 500) throw std::runtime_error("morsel failed");
+									  }),
+					std::runtime_error);
+	// The pool stays usable afterwards.
+	std::atomic<std::size_t> total = 0;
+	pool.parallel_for(1000, 10, [&](std::size_t begin, std::size_t end, std::size_t) { total += end - begin; });
+	CHECK(total == 1000);
+}
+
+TEST_CASE("A job doesn't wait for the job of another thread to finish.", "[thread_pool]") {
+	minidb::thread_pool pool(2);
+	std::atomic<bool> first_started = false;
+	std::atomic<bool> second_done = false;
+	bool second_done_first = false;
+	std::thread first([&] {
+		pool.parallel_for(2, 1, [&](std::size_t begin, std::size_t, std::size_t) {
+			if(begin != 0) return;
+			first_started = true;
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(!second_done && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+			second_done_first = second_done;
+		});
+	});
+	while(!first_started) std::this_thread::yield();
+	std::atomic<std::size_t> total = 0;
+	pool.parallel_for(1000, 10, [&](std::size_t begin, std::size_t end, std::size_t) { total += end - begin; });
+	second_done = true;
+	first.join();
+	CHECK(total == 1000);
+	CHECK(second_done_first);
+}
@@ -0,0 +1,239 @@
+#define CATCH_CONFIG_ENABLE_ALL_STRINGMAKERS
+#include "test_helpers.hpp"
+#include <catch2/catch.hpp>
+#include <database.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+using namespace std::literals;
+using test::temporary_file;
+
+void run_logged_operations(minidb::database& db) {
+	db.create_table("item"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											  {"name", minidb::value_type::string},
+											  {"tag", minidb::value_type::string, minidb::column_encoding::dictionary},
+											  {"price", minidb::value_type::decimal}}});
+	db.create_table("scratch"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+	db.create_index("item"sv, "tag"sv, minidb::index_kind::ordered);
+	for(long long i = 0; i != 10; ++i) {
+		db.append_row("item"sv, {i, "item " + std::to_string(i), i % 2 == 0 ? "even"s : "odd"s, i * 1.5 - 3.25});
+	}
+	db.update_rows("item"sv, {{"tag", "odd"s}}, {{"price", 0.5}});
+	db.update_cell("item"sv, 3, 1, "renamed"s);
+	db.erase_row("item"sv, 0);
+	db.erase_rows("item"sv, {{"id", 4LL}});
+	db.drop_table("scratch"sv);
+	// Failing operations throw before they're logged.
+	CHECK_THROWS(db.append_row("item"sv, {1LL}));
+	CHECK_THROWS(db.update_cell("item"sv, 100, 0, 1LL));
+}
+
+const std::vector<std::vector<minidb::value>> expected_items = {
+		{1LL, "item 1"s, "odd"s, 0.5},	{2LL, "item 2"s, "even"s, -0.25},	 {3LL, "renamed"s, "odd"s, 0.5},
+		{5LL, "item 5"s, "odd"s, 0.5},	{6LL, "item 6"s, "even"s, 5.75},	 {7LL, "item 7"s, "odd"s, 0.5},
+		{8LL, "item 8"s, "even"s, 8.75}, {9LL, "item 9"s, "odd"s, 0.5}};
+
+void check_recovered(const minidb::database& db) {
+	CHECK(db.tables().size() == 1);
+	const auto& tab = db.lookup_table("item"sv);
+	test::check_approx_table(tab, expected_items);
+	CHECK(tab.column_data(2).is_dictionary());
+	REQUIRE(tab.find_index(2) != nullptr);
+	CHECK(tab.find_index(2)->kind() == minidb::index_kind::ordered);
+}
+
+} // namespace
+
+TEST_CASE("Replaying the write-ahead log restores the database state after a restart.", "[database][wal]") {
+	const auto policy = GENERATE(minidb::write_ahead_log::sync_policy::none, minidb::write_ahead_log::sync_policy::batch,
+								 minidb::write_ahead_log::sync_policy::always);
+	temporary_file log("minidb_wal_replay.log");
+	{
+		minidb::database db;
+		db.open_log(log.path, {policy});
+		run_logged_operations(db);
+		check_recovered(db);
+	}
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		check_recovered(db);
+		// Operations after the replay are appended to the same log.
+		db.append_row("item"sv, {10LL, "item 10"s, "even"s, 1.0});
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	CHECK(db.lookup_table("item"sv).row_count() == expected_items.size() + 1);
+}
+
+TEST_CASE("Operations that fail aren't written to the write-ahead log.", "[database][wal]") {
+	temporary_file log("minidb_wal_failed.log");
+	minidb::database db;
+	db.open_log(log.path, {minidb::write_ahead_log::sync_policy::always});
+	run_logged_operations(db);
+	const auto logged_size = std::filesystem::file_size(log.path);
+	CHECK_THROWS(db.create_table("item"sv, minidb::schema{{{"id", minidb::value_type::integer}}}));
+	CHECK_THROWS(db.drop_table("scratch"sv));
+	CHECK_THROWS(db.create_index("item"sv, "tag"sv));
+	CHECK_THROWS(db.erase_row("item"sv, 0));
+	CHECK_THROWS(db.update_cell("item"sv, 1, 0, "one"s));
+	// A change of the wrong type fails before it's applied to any row.
+	CHECK_THROWS(db.update_rows("item"sv, {{"tag", "odd"s}}, {{"id", 1LL}, {"price", 1LL}}));
+	CHECK(std::filesystem::file_size(log.path) == logged_size);
+	check_recovered(db);
+}
+
+TEST_CASE("A torn record at the end of the write-ahead log is discarded on recovery.", "[database][wal]") {
+	temporary_file log("minidb_wal_torn.log");
+	{
+		minidb::database db;
+		db.open_log(log.path, {minidb::write_ahead_log::sync_policy::always});
+		run_logged_operations(db);
+	}
+	const auto intact_size = std::filesystem::file_size(log.path);
+	{
+		// A record header announcing more bytes than were written before the crash.
+		std::ofstream out(log.path, std::ios::binary | std::ios::app);
+		constexpr char torn_record[] = "\x40\x00\x00\x00\x12\x34\x56\x78\x03\x04item";
+		out.write(torn_record, sizeof(torn_record) - 1);
+	}
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		check_recovered(db);
+		CHECK(std::filesystem::file_size(log.path) == intact_size);
+		db.flush_log();
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	check_recovered(db);
+}
+
+TEST_CASE("A corrupt record length in the write-ahead log is discarded without reading past the file.",
+				 "[database][wal]") {
+	temporary_file log("minidb_wal_corrupt_length.log");
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		run_logged_operations(db);
+	}
+	const auto intact_size = std::filesystem::file_size(log.path);
+	{
+		std::ofstream out(log.path, std::ios::binary | std::ios::app);
+		constexpr char corrupt_header[] = "\xf0\xff\xff\xff\x12\x34\x56\x78";
+		out.write(corrupt_header, sizeof(corrupt_header) - 1);
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	check_recovered(db);
+	CHECK(std::filesystem::file_size(log.path) == intact_size);
+}
+
+TEST_CASE("Opening a file that is not a write-ahead log throws.", "[database][wal]") {
+	temporary_file log("minidb_wal_invalid.log");
+	{
+		std::ofstream out(log.path, std::ios::binary);
+		out << "definitely not a log file";
+	}
+	minidb::database db;
+	CHECK_THROWS(db.open_log(log.path));
+}
+
+TEST_CASE("Filtered operations with comparison predicates are replayed from the write-ahead log.", "[database][wal]") {
+	using comparison = minidb::row_filter::comparison;
+	temporary_file log("minidb_wal_predicates.log");
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"name", minidb::value_type::string}}});
+		for(long long i = 0; i != 10; ++i) db.append_row("t"sv, {i, "n" + std::to_string(i)});
+		db.erase_rows("t"sv, {{{"id", comparison::between, {2LL, 4.5}}, {"name", comparison::not_equal, {"n3"s}}}});
+		db.update_rows("t"sv, {{{"id", comparison::in, {0LL, 9LL}}}}, {{"name", "edge"s}});
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	test::check_approx_table(db.lookup_table("t"sv), {{0LL, "edge"s},
+													   {1LL, "n1"s},
+													   {3LL, "n3"s},
+													   {5LL, "n5"s},
+													   {6LL, "n6"s},
+													   {7LL, "n7"s},
+													   {8LL, "n8"s},
+													   {9LL, "edge"s}});
+}
+
+TEST_CASE("Filtered operations with filter expressions are replayed from the write-ahead log.", "[database][wal]") {
+	using comparison = minidb::row_filter::comparison;
+	using connective = minidb::row_filter::connective;
+	using predicate = minidb::row_filter::predicate;
+	temporary_file log("minidb_wal_expressions.log");
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer},
+											   {"name", minidb::value_type::string}}});
+		for(long long i = 0; i != 6; ++i) db.append_row("t"sv, {i, "n" + std::to_string(i)});
+		db.erase_rows("t"sv, minidb::row_filter{{predicate{"id", comparison::less, {2LL}},
+		                                         predicate{"name", comparison::equal, {"n4"s}}, connective::disjunction}});
+		db.update_rows("t"sv, minidb::row_filter{{predicate{"id", comparison::equal, {3LL}}, connective::negation}},
+		               {{"name", "other"s}});
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	test::check_approx_table(db.lookup_table("t"sv), {{2LL, "other"s}, {3LL, "n3"s}, {5LL, "other"s}});
+}
+
+TEST_CASE("Tombstones and compactions are replayed from the write-ahead log.", "[database][wal][compact]") {
+	temporary_file log("minidb_wal_tombstones.log");
+	const auto check_slots = [](const minidb::database& db) {
+		const auto& tab = db.lookup_table("t"sv);
+		CHECK(tab.slot_count() == 13);
+		CHECK(tab.erased_count() == 2);
+		CHECK(tab.is_erased(0));
+		CHECK(tab.is_erased(12));
+		CHECK(tab.rows()[0].get_cell_value(0) == minidb::value{8LL});
+	};
+	{
+		minidb::database db;
+		db.configure_compaction(0.25);
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+		for(long long i = 0; i != 20; ++i) db.append_row("t"sv, {i});
+		// The sixth erased row triggers an automatic compaction, the explicit one renumbers the rows again.
+		for(std::size_t row_index = 0; row_index != 6; ++row_index) db.erase_row("t"sv, row_index);
+		db.erase_row("t"sv, 0);
+		db.compact("t"sv);
+		db.erase_rows("t"sv, {{"id", 7LL}});
+		db.erase_row("t"sv, 12);
+		check_slots(db);
+	}
+	minidb::database db;
+	db.configure_compaction(0.1);
+	db.open_log(log.path);
+	check_slots(db);
+}
+
+TEST_CASE("Operations addressing rows by ID are replayed from the write-ahead log.", "[database][wal][row_id]") {
+	temporary_file log("minidb_wal_row_ids.log");
+	{
+		minidb::database db;
+		db.open_log(log.path);
+		db.create_table("t"sv, minidb::schema{{{"id", minidb::value_type::integer}}});
+		for(long long i = 0; i != 10; ++i) db.append_row("t"sv, {i});
+		db.erase_row_by_id("t"sv, 1);
+		db.erase_row_by_id("t"sv, 2);
+		db.erase_row_by_id("t"sv, 3);
+		db.update_cell_by_id("t"sv, 9, 0, 90LL);
+		CHECK_THROWS(db.update_cell_by_id("t"sv, 1, 0, 10LL));
+	}
+	minidb::database db;
+	db.open_log(log.path);
+	const auto& tab = db.lookup_table("t"sv);
+	CHECK(tab.row_count() == 7);
+	CHECK(tab.rows()[1].id() == 4);
+	CHECK(tab.row_at(tab.slot_of(9)).get_cell_value(0) == minidb::value{90LL});
+}